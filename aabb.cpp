@@ -0,0 +1,62 @@
+#include "aabb.h"
+
+#include "mathhelp.h"
+
+#include <float.h>
+
+AABB createEmptyAABB()
+{
+    return AABB(Vec3(FLT_MAX), Vec3(-FLT_MAX));
+}
+
+AABB merge(const AABB &a, const AABB &b)
+{
+    return AABB(minVec(a.min, b.min), maxVec(a.max, b.max));
+}
+
+AABB merge(const AABB &a, const Vec3 &p)
+{
+    return AABB(minVec(a.min, p), maxVec(a.max, p));
+}
+
+Vec3 getCenter(const AABB &box)
+{
+    Vec3 result{ UninitType{} };
+    result.x = (box.min.x + box.max.x) * 0.5f;
+    result.y = (box.min.y + box.max.y) * 0.5f;
+    result.z = (box.min.z + box.max.z) * 0.5f;
+    result.w = 0.0f;
+    return result;
+}
+
+Vec3 getSize(const AABB &box)
+{
+    Vec3 result{ UninitType{} };
+    result.x = box.max.x - box.min.x;
+    result.y = box.max.y - box.min.y;
+    result.z = box.max.z - box.min.z;
+    result.w = 0.0f;
+    return result;
+}
+
+float getSurfaceArea(const AABB &box)
+{
+    float x = sMaxF(box.max.x - box.min.x, 0.0f);
+    float y = sMaxF(box.max.y - box.min.y, 0.0f);
+    float z = sMaxF(box.max.z - box.min.z, 0.0f);
+    return 2.0f * (x * y + y * z + z * x);
+}
+
+bool overlaps(const AABB &a, const AABB &b)
+{
+    return a.min.x <= b.max.x && a.max.x >= b.min.x
+        && a.min.y <= b.max.y && a.max.y >= b.min.y
+        && a.min.z <= b.max.z && a.max.z >= b.min.z;
+}
+
+bool contains(const AABB &box, const Vec3 &p)
+{
+    return p.x >= box.min.x && p.x <= box.max.x
+        && p.y >= box.min.y && p.y <= box.max.y
+        && p.z >= box.min.z && p.z <= box.max.z;
+}
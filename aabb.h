@@ -0,0 +1,24 @@
+#pragma once
+
+#include "uninittype.h"
+#include "vec3.h"
+
+struct AABB
+{
+    AABB() {}
+    AABB(UninitType) : min(UninitType{}), max(UninitType{}) {}
+    AABB(const Vec3 &min, const Vec3 &max) : min(min), max(max) {}
+
+    Vec3 min;
+    Vec3 max;
+};
+
+// Inverted box, merging anything into it gives that thing.
+AABB createEmptyAABB();
+AABB merge(const AABB &a, const AABB &b);
+AABB merge(const AABB &a, const Vec3 &p);
+Vec3 getCenter(const AABB &box);
+Vec3 getSize(const AABB &box);
+float getSurfaceArea(const AABB &box);
+bool overlaps(const AABB &a, const AABB &b);
+bool contains(const AABB &box, const Vec3 &p);
@@ -0,0 +1,354 @@
+#include "animationtrack.h"
+
+#include "dispatch.h"
+#include "mathhelp.h"
+#include "profile.h"
+#include "simdhelp.h"
+#include "transform.h"
+
+#if SIMDHELP_SSE
+#include <emmintrin.h>
+#endif
+#if CARPMATH_X86
+#include <immintrin.h>
+#endif
+
+static constexpr uint32_t TrackSampleChunkSize = 64u;
+// Cursor walks this many keys forward before falling back to binary search.
+static constexpr uint32_t TrackCursorMaxSteps = 4u;
+
+static void sFree(AnimationTracks &tracks)
+{
+    delete[] tracks.times;
+    delete[] tracks.positions;
+    delete[] tracks.rotations;
+    delete[] tracks.keyBegin;
+    delete[] tracks.keyCount;
+    tracks.times = nullptr;
+    tracks.positions = nullptr;
+    tracks.rotations = nullptr;
+    tracks.keyBegin = nullptr;
+    tracks.keyCount = nullptr;
+    tracks.trackCount = 0;
+    tracks.keyTotal = 0;
+}
+
+AnimationTracks::~AnimationTracks()
+{
+    sFree(*this);
+}
+
+void initAnimationTracks(AnimationTracks &tracks, const uint32_t *keyCounts, uint32_t trackCount)
+{
+    sFree(tracks);
+    uint32_t keyTotal = 0;
+    for(uint32_t i = 0; i < trackCount; ++i)
+    {
+        ASSERT_MATH(keyCounts[i] > 0);
+        keyTotal += keyCounts[i];
+    }
+
+    tracks.keyBegin = new uint32_t[trackCount];
+    tracks.keyCount = new uint32_t[trackCount];
+    tracks.times = new float[keyTotal]();
+    tracks.positions = new Vec3[keyTotal];
+    tracks.rotations = new Quat[keyTotal];
+    tracks.trackCount = trackCount;
+    tracks.keyTotal = keyTotal;
+
+    uint32_t begin = 0;
+    for(uint32_t i = 0; i < trackCount; ++i)
+    {
+        tracks.keyBegin[i] = begin;
+        tracks.keyCount[i] = keyCounts[i];
+        begin += keyCounts[i];
+    }
+}
+
+void setTrackKeys(AnimationTracks &tracks, uint32_t track,
+    const float *times, const Vec3 *positions, const Quat *rotations)
+{
+    ASSERT_MATH(track < tracks.trackCount);
+    const uint32_t begin = tracks.keyBegin[track];
+    const uint32_t keyCount = tracks.keyCount[track];
+    for(uint32_t i = 0; i < keyCount; ++i)
+    {
+        ASSERT_MATH(i == 0 || times[i] > times[i - 1]);
+        tracks.times[begin + i] = times[i];
+        tracks.positions[begin + i] = positions[i];
+        tracks.rotations[begin + i] = rotations[i];
+    }
+}
+
+float getTrackStartTime(const AnimationTracks &tracks, uint32_t track)
+{
+    ASSERT_MATH(track < tracks.trackCount);
+    return tracks.times[tracks.keyBegin[track]];
+}
+
+float getTrackEndTime(const AnimationTracks &tracks, uint32_t track)
+{
+    ASSERT_MATH(track < tracks.trackCount);
+    return tracks.times[tracks.keyBegin[track] + tracks.keyCount[track] - 1];
+}
+
+// Returns k in [0, keyCount - 2] with times[k] <= time < times[k + 1], or the first or
+// last segment when time is outside the keys. keyCount must be at least 2.
+static uint32_t sFindKey(const float *times, uint32_t keyCount, float time, uint32_t cursor)
+{
+    const uint32_t lastSegment = keyCount - 2;
+    uint32_t k = cursor < lastSegment ? cursor : lastSegment;
+    if(time >= times[k])
+    {
+        for(uint32_t step = 0; step < TrackCursorMaxSteps; ++step)
+        {
+            if(k == lastSegment || time < times[k + 1])
+                return k;
+            ++k;
+        }
+    }
+    else if(k == 0 || time >= times[k - 1])
+    {
+        return k > 0 ? k - 1 : 0;
+    }
+
+    // First key after time, searching keys 1 .. keyCount - 1.
+    uint32_t low = 1;
+    uint32_t high = keyCount - 1;
+    while(low < high)
+    {
+        const uint32_t mid = (low + high) / 2;
+        if(times[mid] <= time)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low - 1;
+}
+
+// Fills key pair and fraction for one sample and advances the cursor.
+static void sLocateSample(const AnimationTracks &tracks, uint32_t track, float time, uint32_t &cursor,
+    uint32_t &outKeyA, uint32_t &outKeyB, float &outFraction)
+{
+    ASSERT_MATH(track < tracks.trackCount);
+    const uint32_t begin = tracks.keyBegin[track];
+    const uint32_t keyCount = tracks.keyCount[track];
+    if(keyCount < 2)
+    {
+        cursor = 0;
+        outKeyA = begin;
+        outKeyB = begin;
+        outFraction = 0.0f;
+        return;
+    }
+
+    const float *times = tracks.times + begin;
+    const uint32_t k = sFindKey(times, keyCount, time, cursor);
+    cursor = k;
+    outKeyA = begin + k;
+    outKeyB = begin + k + 1;
+    outFraction = sClampF((time - times[k]) / (times[k + 1] - times[k]), 0.0f, 1.0f);
+}
+
+static Quat sNlerp(const Quat &a, const Quat &b, float t)
+{
+    const float sign = dot(a, b) < 0.0f ? -1.0f : 1.0f;
+    const float d = 1.0f - t;
+    const float bt = t * sign;
+    const Quat q(
+        a.vx * d + b.vx * bt,
+        a.vy * d + b.vy * bt,
+        a.vz * d + b.vz * bt,
+        a.w * d + b.w * bt);
+    const float invLength = 1.0f / sSqrtF(dot(q, q));
+    return Quat(q.vx * invLength, q.vy * invLength, q.vz * invLength, q.w * invLength);
+}
+
+static void sInterpolateTrackKeysScalar(const Vec3 *positions, const Quat *rotations,
+    const uint32_t *keysA, const uint32_t *keysB, const float *fractions, uint32_t count,
+    TrackRotationMode mode, Transform *outTransforms)
+{
+    for(uint32_t i = 0; i < count; ++i)
+    {
+        const Vec3 &a = positions[keysA[i]];
+        const Vec3 &b = positions[keysB[i]];
+        const float t = fractions[i];
+        outTransforms[i].pos = Vec3(a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, a.z + (b.z - a.z) * t);
+        outTransforms[i].rot = mode == TrackRotationSlerp
+            ? sSlerpPolynomial(rotations[keysA[i]], rotations[keysB[i]], t)
+            : sNlerp(rotations[keysA[i]], rotations[keysB[i]], t);
+    }
+}
+
+#if SIMDHELP_SSE
+
+static void sLerpPositionSSE(const Vec3 &a, const Vec3 &b, float t, Vec3 &out)
+{
+    const __m128 pa = _mm_load_ps(&a.x);
+    const __m128 pb = _mm_load_ps(&b.x);
+    _mm_store_ps(&out.x, _mm_add_ps(pa, _mm_mul_ps(_mm_sub_ps(pb, pa), _mm_set1_ps(t))));
+}
+
+static Quat4 sNlerp4(const Quat4 &a, const Quat4 &b, __m128 t)
+{
+    const __m128 sign = _mm_and_ps(sDot4(a, b), _mm_set1_ps(-0.0f));
+    const __m128 d = _mm_sub_ps(_mm_set1_ps(1.0f), t);
+    const __m128 bt = _mm_xor_ps(t, sign);
+    Quat4 q;
+    q.x = _mm_add_ps(_mm_mul_ps(a.x, d), _mm_mul_ps(b.x, bt));
+    q.y = _mm_add_ps(_mm_mul_ps(a.y, d), _mm_mul_ps(b.y, bt));
+    q.z = _mm_add_ps(_mm_mul_ps(a.z, d), _mm_mul_ps(b.z, bt));
+    q.w = _mm_add_ps(_mm_mul_ps(a.w, d), _mm_mul_ps(b.w, bt));
+    const __m128 invLength = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(sDot4(q, q)));
+    q.x = _mm_mul_ps(q.x, invLength);
+    q.y = _mm_mul_ps(q.y, invLength);
+    q.z = _mm_mul_ps(q.z, invLength);
+    q.w = _mm_mul_ps(q.w, invLength);
+    return q;
+}
+
+static void sInterpolateTrackKeysSSE(const Vec3 *positions, const Quat *rotations,
+    const uint32_t *keysA, const uint32_t *keysB, const float *fractions, uint32_t count,
+    TrackRotationMode mode, Transform *outTransforms)
+{
+    uint32_t i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        for(uint32_t k = 0; k < 4; ++k)
+            sLerpPositionSSE(positions[keysA[i + k]], positions[keysB[i + k]], fractions[i + k], outTransforms[i + k].pos);
+
+        const Quat4 a = sLoadQuat4(rotations[keysA[i]], rotations[keysA[i + 1]], rotations[keysA[i + 2]], rotations[keysA[i + 3]]);
+        const Quat4 b = sLoadQuat4(rotations[keysB[i]], rotations[keysB[i + 1]], rotations[keysB[i + 2]], rotations[keysB[i + 3]]);
+        const __m128 t = _mm_loadu_ps(fractions + i);
+        const Quat4 q = mode == TrackRotationSlerp ? sSlerpPolynomial4(a, b, t) : sNlerp4(a, b, t);
+        sStoreQuat4(outTransforms[i].rot, outTransforms[i + 1].rot, outTransforms[i + 2].rot, outTransforms[i + 3].rot, q);
+    }
+    sInterpolateTrackKeysScalar(positions, rotations, keysA + i, keysB + i, fractions + i, count - i,
+        mode, outTransforms + i);
+}
+
+#endif
+
+#if CARPMATH_X86
+
+CARPMATH_TARGET_AVX2 static Quat8 sNlerp8(const Quat8 &a, const Quat8 &b, __m256 t)
+{
+    const __m256 sign = _mm256_and_ps(sDot8(a, b), _mm256_set1_ps(-0.0f));
+    const __m256 d = _mm256_sub_ps(_mm256_set1_ps(1.0f), t);
+    const __m256 bt = _mm256_xor_ps(t, sign);
+    Quat8 q;
+    q.x = _mm256_fmadd_ps(a.x, d, _mm256_mul_ps(b.x, bt));
+    q.y = _mm256_fmadd_ps(a.y, d, _mm256_mul_ps(b.y, bt));
+    q.z = _mm256_fmadd_ps(a.z, d, _mm256_mul_ps(b.z, bt));
+    q.w = _mm256_fmadd_ps(a.w, d, _mm256_mul_ps(b.w, bt));
+    const __m256 invLength = _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_sqrt_ps(sDot8(q, q)));
+    q.x = _mm256_mul_ps(q.x, invLength);
+    q.y = _mm256_mul_ps(q.y, invLength);
+    q.z = _mm256_mul_ps(q.z, invLength);
+    q.w = _mm256_mul_ps(q.w, invLength);
+    return q;
+}
+
+CARPMATH_TARGET_AVX2 static void sInterpolateTrackKeysAVX2(const Vec3 *positions, const Quat *rotations,
+    const uint32_t *keysA, const uint32_t *keysB, const float *fractions, uint32_t count,
+    TrackRotationMode mode, Transform *outTransforms)
+{
+    uint32_t i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        const Quat *as[8];
+        const Quat *bs[8];
+        Quat *outs[8];
+        for(uint32_t k = 0; k < 8; k += 2)
+        {
+            // Two positions per register.
+            const __m256 pa = _mm256_insertf128_ps(_mm256_castps128_ps256(
+                _mm_load_ps(&positions[keysA[i + k]].x)), _mm_load_ps(&positions[keysA[i + k + 1]].x), 1);
+            const __m256 pb = _mm256_insertf128_ps(_mm256_castps128_ps256(
+                _mm_load_ps(&positions[keysB[i + k]].x)), _mm_load_ps(&positions[keysB[i + k + 1]].x), 1);
+            const __m256 t = _mm256_insertf128_ps(_mm256_castps128_ps256(
+                _mm_set1_ps(fractions[i + k])), _mm_set1_ps(fractions[i + k + 1]), 1);
+            const __m256 p = _mm256_fmadd_ps(_mm256_sub_ps(pb, pa), t, pa);
+            _mm_store_ps(&outTransforms[i + k].pos.x, _mm256_castps256_ps128(p));
+            _mm_store_ps(&outTransforms[i + k + 1].pos.x, _mm256_extractf128_ps(p, 1));
+        }
+        for(uint32_t k = 0; k < 8; ++k)
+        {
+            as[k] = &rotations[keysA[i + k]];
+            bs[k] = &rotations[keysB[i + k]];
+            outs[k] = &outTransforms[i + k].rot;
+        }
+        const Quat8 a = sLoadQuat8(as);
+        const Quat8 b = sLoadQuat8(bs);
+        const __m256 t = _mm256_loadu_ps(fractions + i);
+        sStoreQuat8(outs, mode == TrackRotationSlerp ? sSlerpPolynomial8(a, b, t) : sNlerp8(a, b, t));
+    }
+    sInterpolateTrackKeysScalar(positions, rotations, keysA + i, keysB + i, fractions + i, count - i,
+        mode, outTransforms + i);
+}
+
+#endif
+
+void bindAnimationTrackKernels(SimdKernels &kernels, SimdBackend backend)
+{
+    kernels.interpolateTrackKeys = sInterpolateTrackKeysScalar;
+#if SIMDHELP_SSE
+    if(backend >= SimdBackendSSE4)
+        kernels.interpolateTrackKeys = sInterpolateTrackKeysSSE;
+#endif
+#if CARPMATH_X86
+    if(backend >= SimdBackendAVX2)
+        kernels.interpolateTrackKeys = sInterpolateTrackKeysAVX2;
+#endif
+}
+
+void sampleTrack(const AnimationTracks &tracks, uint32_t track, float time, uint32_t &cursor,
+    TrackRotationMode mode, Transform &outTransform)
+{
+    uint32_t keyA;
+    uint32_t keyB;
+    float fraction;
+    sLocateSample(tracks, track, time, cursor, keyA, keyB, fraction);
+    sInterpolateTrackKeysScalar(tracks.positions, tracks.rotations, &keyA, &keyB, &fraction, 1, mode, &outTransform);
+}
+
+void sampleTracks(const AnimationTracks &tracks, float time, uint32_t *cursors,
+    TrackRotationMode mode, Transform *outTransforms)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdSampleTracks, tracks.trackCount);
+    const SimdKernels &kernels = getSimdKernels();
+    uint32_t keysA[TrackSampleChunkSize];
+    uint32_t keysB[TrackSampleChunkSize];
+    alignas(32) float fractions[TrackSampleChunkSize];
+    for(uint32_t begin = 0; begin < tracks.trackCount; begin += TrackSampleChunkSize)
+    {
+        const uint32_t remaining = tracks.trackCount - begin;
+        const uint32_t count = remaining < TrackSampleChunkSize ? remaining : TrackSampleChunkSize;
+        for(uint32_t i = 0; i < count; ++i)
+            sLocateSample(tracks, begin + i, time, cursors[begin + i], keysA[i], keysB[i], fractions[i]);
+        kernels.interpolateTrackKeys(tracks.positions, tracks.rotations, keysA, keysB, fractions, count,
+            mode, outTransforms + begin);
+    }
+}
+
+void sampleTracks(const AnimationTracks &tracks, const uint32_t *trackIndices, const float *times,
+    uint32_t count, uint32_t *cursors, TrackRotationMode mode, Transform *outTransforms)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdSampleTracks, count);
+    const SimdKernels &kernels = getSimdKernels();
+    uint32_t keysA[TrackSampleChunkSize];
+    uint32_t keysB[TrackSampleChunkSize];
+    alignas(32) float fractions[TrackSampleChunkSize];
+    for(uint32_t begin = 0; begin < count; begin += TrackSampleChunkSize)
+    {
+        const uint32_t remaining = count - begin;
+        const uint32_t chunkCount = remaining < TrackSampleChunkSize ? remaining : TrackSampleChunkSize;
+        for(uint32_t i = 0; i < chunkCount; ++i)
+        {
+            sLocateSample(tracks, trackIndices[begin + i], times[begin + i], cursors[begin + i],
+                keysA[i], keysB[i], fractions[i]);
+        }
+        kernels.interpolateTrackKeys(tracks.positions, tracks.rotations, keysA, keysB, fractions, chunkCount,
+            mode, outTransforms + begin);
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "quat.h"
+#include "vec3.h"
+
+#include <stdint.h>
+
+struct Transform;
+
+// Position and rotation keyframes of many tracks. Keys of all tracks are in shared SoA
+// arrays, track i owns keys [keyBegin[i], keyBegin[i] + keyCount[i]) sorted by time.
+// Sampling takes a cursor per track or instance, the key index found last time. Sequential
+// playback then finds the next key in a few steps instead of a binary search. Cursors are
+// owned by the caller, start them from 0.
+
+enum TrackRotationMode : uint32_t
+{
+    // Normalized lerp, fast but speed varies along big rotations.
+    TrackRotationNlerp,
+    // Polynomial slerp, max error about 1e-6.
+    TrackRotationSlerp,
+};
+
+struct AnimationTracks
+{
+    AnimationTracks() {}
+    ~AnimationTracks();
+    AnimationTracks(const AnimationTracks &) = delete;
+    AnimationTracks &operator=(const AnimationTracks &) = delete;
+
+    float *times = nullptr;
+    Vec3 *positions = nullptr;
+    Quat *rotations = nullptr;
+
+    uint32_t *keyBegin = nullptr;
+    uint32_t *keyCount = nullptr;
+
+    uint32_t trackCount = 0;
+    uint32_t keyTotal = 0;
+};
+
+// Allocates trackCount tracks, every track needs at least one key. Keys are left as
+// identity at time 0 until set.
+void initAnimationTracks(AnimationTracks &tracks, const uint32_t *keyCounts, uint32_t trackCount);
+// Copies keyCount[track] keys, times must be strictly increasing.
+void setTrackKeys(AnimationTracks &tracks, uint32_t track,
+    const float *times, const Vec3 *positions, const Quat *rotations);
+float getTrackStartTime(const AnimationTracks &tracks, uint32_t track);
+float getTrackEndTime(const AnimationTracks &tracks, uint32_t track);
+
+// Time is clamped to the track's key range. Writes pos and rot, scale is left as is.
+void sampleTrack(const AnimationTracks &tracks, uint32_t track, float time, uint32_t &cursor,
+    TrackRotationMode mode, Transform &outTransform);
+// All tracks at one time, cursors and outTransforms have trackCount entries.
+void sampleTracks(const AnimationTracks &tracks, float time, uint32_t *cursors,
+    TrackRotationMode mode, Transform *outTransforms);
+// Instance i samples trackIndices[i] at times[i] with cursors[i].
+void sampleTracks(const AnimationTracks &tracks, const uint32_t *trackIndices, const float *times,
+    uint32_t count, uint32_t *cursors, TrackRotationMode mode, Transform *outTransforms);
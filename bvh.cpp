@@ -0,0 +1,748 @@
+#include "bvh.h"
+
+#include "mathhelp.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <float.h>
+#include <new>
+#include <string.h>
+#include <vector>
+
+#if (__AVX__ || __SSE__ || __SSE2__ || __SSE3__ || __SSE4_1__ || _M_AMD64 || _M_X64) && 1
+#define BVH_SIMD_SSE 1
+#include <emmintrin.h>
+#endif
+
+static constexpr uint32_t BVHBinCount = 16u;
+// Ranges bigger than this get binned with all threads during the serial top level build.
+static constexpr uint32_t BVHParallelBinThreshold = 1u << 16u;
+// Below this depth ranges split at the object median of their widest axis instead of
+// binned SAH, which halves them on each level. That bounds the depth to about
+// BVHMedianSplitDepth + 30 for any input, and the traversal stack to 3 per level.
+static constexpr uint32_t BVHMedianSplitDepth = 32u;
+static constexpr uint32_t BVHMaxDepth = BVHMedianSplitDepth + 32u;
+static constexpr uint32_t BVHTraversalStackSize = 256u;
+static_assert(1u + 3u * BVHMaxDepth <= BVHTraversalStackSize, "BVH traversal stack can overflow");
+static constexpr std::align_val_t BVHNodeAlignment{ 64 };
+
+struct BVHBin
+{
+    AABB bounds;
+    AABB centroidBounds;
+    uint32_t count;
+};
+
+struct BVHBuildRange
+{
+    uint32_t begin;
+    uint32_t end;
+    AABB bounds;
+    AABB centroidBounds;
+};
+
+struct BVHBuildTask
+{
+    BVHBuildRange range;
+    uint32_t nodeIndex;
+    uint32_t depth;
+};
+
+// During build BVH::primBounds is used as primitive reference array and
+// gets partitioned in place, original primitive index is stored in min.w.
+struct BVHBuildContext
+{
+    BVH *bvh;
+    std::atomic<uint32_t> nodeCount;
+    uint32_t threadCount;
+    // Subtrees smaller than this are deferred to be built in parallel.
+    uint32_t taskThreshold;
+    std::vector<BVHBuildTask> tasks;
+};
+
+
+static void sGrow(AABB &box, const AABB &other)
+{
+#if BVH_SIMD_SSE
+    _mm_store_ps(&box.min.x, _mm_min_ps(_mm_load_ps(&box.min.x), _mm_load_ps(&other.min.x)));
+    _mm_store_ps(&box.max.x, _mm_max_ps(_mm_load_ps(&box.max.x), _mm_load_ps(&other.max.x)));
+#else
+    box.min.x = sMinF(box.min.x, other.min.x);
+    box.min.y = sMinF(box.min.y, other.min.y);
+    box.min.z = sMinF(box.min.z, other.min.z);
+    box.max.x = sMaxF(box.max.x, other.max.x);
+    box.max.y = sMaxF(box.max.y, other.max.y);
+    box.max.z = sMaxF(box.max.z, other.max.z);
+#endif
+}
+
+static void sGrow(AABB &box, const Vec3 &p)
+{
+    box.min.x = sMinF(box.min.x, p.x);
+    box.min.y = sMinF(box.min.y, p.y);
+    box.min.z = sMinF(box.min.z, p.z);
+    box.max.x = sMaxF(box.max.x, p.x);
+    box.max.y = sMaxF(box.max.y, p.y);
+    box.max.z = sMaxF(box.max.z, p.z);
+}
+
+static float sHalfArea(const AABB &box)
+{
+    float x = box.max.x - box.min.x;
+    float y = box.max.y - box.min.y;
+    float z = box.max.z - box.min.z;
+    return x * y + y * z + z * x;
+}
+
+static void sSetSlot(BVHNode4 &node, uint32_t slot, const AABB &box)
+{
+    node.bounds.minX[slot] = box.min.x;
+    node.bounds.minY[slot] = box.min.y;
+    node.bounds.minZ[slot] = box.min.z;
+    node.bounds.maxX[slot] = box.max.x;
+    node.bounds.maxY[slot] = box.max.y;
+    node.bounds.maxZ[slot] = box.max.z;
+}
+
+static AABB sGetNodeBounds(const BVHNode4 &node)
+{
+    AABB result = createEmptyAABB();
+    for(uint32_t slot = 0; slot < 4; ++slot)
+    {
+        if(node.child[slot] == BVHInvalidIndex)
+            continue;
+        sGrow(result, AABB(
+            Vec3(node.bounds.minX[slot], node.bounds.minY[slot], node.bounds.minZ[slot]),
+            Vec3(node.bounds.maxX[slot], node.bounds.maxY[slot], node.bounds.maxZ[slot])));
+    }
+    return result;
+}
+
+static void sSetRefIndex(AABB &ref, uint32_t index)
+{
+    memcpy(&ref.min.w, &index, sizeof(index));
+}
+
+static uint32_t sGetRefIndex(const AABB &ref)
+{
+    uint32_t index;
+    memcpy(&index, &ref.min.w, sizeof(index));
+    return index;
+}
+
+static Vec3 sGetCentroid(const AABB &box)
+{
+    Vec3 result{ UninitType{} };
+    result.x = (box.min.x + box.max.x) * 0.5f;
+    result.y = (box.min.y + box.max.y) * 0.5f;
+    result.z = (box.min.z + box.max.z) * 0.5f;
+    result.w = 0.0f;
+    return result;
+}
+
+static uint32_t sGetBin(float centroid, float minCentroid, float scale)
+{
+    int bin = int((centroid - minCentroid) * scale);
+    bin = bin < 0 ? 0 : bin;
+    bin = bin >= int(BVHBinCount) ? int(BVHBinCount) - 1 : bin;
+    return uint32_t(bin);
+}
+
+static void sClearBins(BVHBin bins[3][BVHBinCount])
+{
+    for(uint32_t axis = 0; axis < 3; ++axis)
+    {
+        for(uint32_t i = 0; i < BVHBinCount; ++i)
+        {
+            bins[axis][i].bounds = AABB(Vec3(FLT_MAX), Vec3(-FLT_MAX));
+            bins[axis][i].centroidBounds = bins[axis][i].bounds;
+            bins[axis][i].count = 0;
+        }
+    }
+}
+
+static void sBinPrimitives(const BVHBuildContext &ctx, uint32_t begin, uint32_t end,
+    const Vec3 &minCentroid, const Vec3 &scale, BVHBin bins[3][BVHBinCount])
+{
+    const AABB *refs = ctx.bvh->primBounds;
+#if BVH_SIMD_SSE
+    // All three axes at once, AABB and Vec3 are 16 byte aligned so bins can be loaded directly.
+    // w lane is masked off since it holds the primitive index.
+    const __m128 xyzMask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 minC = _mm_load_ps(&minCentroid.x);
+    const __m128 scaleV = _mm_load_ps(&scale.x);
+    const __m128 maxBin = _mm_set1_ps(float(BVHBinCount - 1));
+    alignas(16) int32_t binIndex[4];
+    for(uint32_t i = begin; i < end; ++i)
+    {
+        const __m128 boxMin = _mm_and_ps(_mm_load_ps(&refs[i].min.x), xyzMask);
+        const __m128 boxMax = _mm_load_ps(&refs[i].max.x);
+        const __m128 c = _mm_mul_ps(_mm_add_ps(boxMin, boxMax), half);
+        __m128 binF = _mm_mul_ps(_mm_sub_ps(c, minC), scaleV);
+        binF = _mm_min_ps(_mm_max_ps(binF, _mm_setzero_ps()), maxBin);
+        _mm_store_si128((__m128i *)binIndex, _mm_cvttps_epi32(binF));
+        for(uint32_t axis = 0; axis < 3; ++axis)
+        {
+            BVHBin &bin = bins[axis][binIndex[axis]];
+            _mm_store_ps(&bin.bounds.min.x, _mm_min_ps(_mm_load_ps(&bin.bounds.min.x), boxMin));
+            _mm_store_ps(&bin.bounds.max.x, _mm_max_ps(_mm_load_ps(&bin.bounds.max.x), boxMax));
+            _mm_store_ps(&bin.centroidBounds.min.x, _mm_min_ps(_mm_load_ps(&bin.centroidBounds.min.x), c));
+            _mm_store_ps(&bin.centroidBounds.max.x, _mm_max_ps(_mm_load_ps(&bin.centroidBounds.max.x), c));
+            ++bin.count;
+        }
+    }
+#else
+    for(uint32_t i = begin; i < end; ++i)
+    {
+        const AABB &box = refs[i];
+        const Vec3 c = sGetCentroid(box);
+        for(uint32_t axis = 0; axis < 3; ++axis)
+        {
+            BVHBin &bin = bins[axis][sGetBin(c[axis], minCentroid[axis], scale[axis])];
+            sGrow(bin.bounds, box);
+            sGrow(bin.centroidBounds, c);
+            ++bin.count;
+        }
+    }
+#endif
+}
+
+static void sMedianSplit(BVHBuildContext &ctx, const BVHBuildRange &range,
+    BVHBuildRange &left, BVHBuildRange &right)
+{
+    const uint32_t mid = (range.begin + range.end) / 2;
+    const Vec3 extent = getSize(range.centroidBounds);
+    const int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+    if(extent[axis] > 0.0f)
+    {
+        std::nth_element(ctx.bvh->primBounds + range.begin, ctx.bvh->primBounds + mid,
+            ctx.bvh->primBounds + range.end, [axis](const AABB &a, const AABB &b)
+            {
+                return a.min[axis] + a.max[axis] < b.min[axis] + b.max[axis];
+            });
+    }
+    left.begin = range.begin;
+    left.end = mid;
+    right.begin = mid;
+    right.end = range.end;
+    for(BVHBuildRange *half : { &left, &right })
+    {
+        half->bounds = createEmptyAABB();
+        half->centroidBounds = createEmptyAABB();
+        for(uint32_t i = half->begin; i < half->end; ++i)
+        {
+            sGrow(half->bounds, ctx.bvh->primBounds[i]);
+            sGrow(half->centroidBounds, sGetCentroid(ctx.bvh->primBounds[i]));
+        }
+    }
+}
+
+static void sSplitRange(BVHBuildContext &ctx, const BVHBuildRange &range, bool parallel, uint32_t depth,
+    BVHBuildRange &left, BVHBuildRange &right)
+{
+    if(depth >= BVHMedianSplitDepth)
+    {
+        sMedianSplit(ctx, range, left, right);
+        return;
+    }
+
+    const uint32_t count = range.end - range.begin;
+    const Vec3 minCentroid = range.centroidBounds.min;
+    const Vec3 extent = getSize(range.centroidBounds);
+
+    Vec3 scale;
+    for(uint32_t axis = 0; axis < 3; ++axis)
+        scale[axis] = extent[axis] > 0.0f ? float(BVHBinCount) / extent[axis] : 0.0f;
+
+    BVHBin bins[3][BVHBinCount];
+    sClearBins(bins);
+
+    if(parallel && ctx.threadCount > 1 && count >= BVHParallelBinThreshold)
+    {
+        std::vector<BVHBin> threadBins(ctx.threadCount * 3 * BVHBinCount);
+        parallelFor(count, ctx.threadCount, [&](uint32_t begin, uint32_t end, uint32_t chunk)
+        {
+            BVHBin (*chunkBins)[BVHBinCount] = (BVHBin (*)[BVHBinCount])&threadBins[chunk * 3 * BVHBinCount];
+            sClearBins(chunkBins);
+            sBinPrimitives(ctx, range.begin + begin, range.begin + end, minCentroid, scale, chunkBins);
+        });
+        for(uint32_t chunk = 0; chunk < ctx.threadCount && chunk < count; ++chunk)
+        {
+            const BVHBin *chunkBins = &threadBins[chunk * 3 * BVHBinCount];
+            for(uint32_t axis = 0; axis < 3; ++axis)
+            {
+                for(uint32_t i = 0; i < BVHBinCount; ++i)
+                {
+                    const BVHBin &bin = chunkBins[axis * BVHBinCount + i];
+                    sGrow(bins[axis][i].bounds, bin.bounds);
+                    sGrow(bins[axis][i].centroidBounds, bin.centroidBounds);
+                    bins[axis][i].count += bin.count;
+                }
+            }
+        }
+    }
+    else
+    {
+        sBinPrimitives(ctx, range.begin, range.end, minCentroid, scale, bins);
+    }
+
+    // Sweep from both sides, split after bin i.
+    float bestCost = FLT_MAX;
+    int bestAxis = -1;
+    uint32_t bestSplit = 0;
+    for(uint32_t axis = 0; axis < 3; ++axis)
+    {
+        if(scale[axis] == 0.0f)
+            continue;
+
+        float rightCost[BVHBinCount];
+        AABB rightBounds = createEmptyAABB();
+        uint32_t rightCount = 0;
+        for(uint32_t i = BVHBinCount - 1; i > 0; --i)
+        {
+            sGrow(rightBounds, bins[axis][i].bounds);
+            rightCount += bins[axis][i].count;
+            rightCost[i - 1] = rightCount > 0 ? sHalfArea(rightBounds) * float(rightCount) : FLT_MAX;
+        }
+
+        AABB leftBounds = createEmptyAABB();
+        uint32_t leftCount = 0;
+        for(uint32_t i = 0; i < BVHBinCount - 1; ++i)
+        {
+            sGrow(leftBounds, bins[axis][i].bounds);
+            leftCount += bins[axis][i].count;
+            if(leftCount == 0 || leftCount == count)
+                continue;
+            float cost = sHalfArea(leftBounds) * float(leftCount) + rightCost[i];
+            if(cost < bestCost)
+            {
+                bestCost = cost;
+                bestAxis = int(axis);
+                bestSplit = i;
+            }
+        }
+    }
+
+    // All centroids in the same spot.
+    if(bestAxis < 0)
+    {
+        sMedianSplit(ctx, range, left, right);
+        return;
+    }
+
+    const float axisMin = minCentroid[bestAxis];
+    const float axisScale = scale[bestAxis];
+    AABB *mid = std::partition(ctx.bvh->primBounds + range.begin, ctx.bvh->primBounds + range.end,
+        [&](const AABB &ref)
+        {
+            float centroid = (ref.min[bestAxis] + ref.max[bestAxis]) * 0.5f;
+            return sGetBin(centroid, axisMin, axisScale) <= bestSplit;
+        });
+
+    left.begin = range.begin;
+    left.end = uint32_t(mid - ctx.bvh->primBounds);
+    right.begin = left.end;
+    right.end = range.end;
+    left.bounds = left.centroidBounds = createEmptyAABB();
+    right.bounds = right.centroidBounds = createEmptyAABB();
+    for(uint32_t i = 0; i < BVHBinCount; ++i)
+    {
+        BVHBuildRange &half = i <= bestSplit ? left : right;
+        sGrow(half.bounds, bins[bestAxis][i].bounds);
+        sGrow(half.centroidBounds, bins[bestAxis][i].centroidBounds);
+    }
+}
+
+static void sBuildNode(BVHBuildContext &ctx, const BVHBuildRange &range, uint32_t nodeIndex, uint32_t depth,
+    bool serialTopLevel)
+{
+    // Collapse binary splits into 4 wide node by always splitting the child with largest area.
+    BVHBuildRange children[4];
+    uint32_t childCount = 1;
+    children[0] = range;
+    while(childCount < 4)
+    {
+        int best = -1;
+        float bestArea = -1.0f;
+        for(uint32_t i = 0; i < childCount; ++i)
+        {
+            float area = sHalfArea(children[i].bounds);
+            // Nan area from inf bounds still gets split, else the range would recurse as is.
+            if(children[i].end - children[i].begin > BVHMaxLeafSize && (area > bestArea || best < 0))
+            {
+                best = int(i);
+                bestArea = area;
+            }
+        }
+        if(best < 0)
+            break;
+
+        BVHBuildRange left, right;
+        sSplitRange(ctx, children[best], serialTopLevel, depth, left, right);
+        children[best] = left;
+        children[childCount++] = right;
+    }
+
+    BVHNode4 &node = ctx.bvh->nodes[nodeIndex];
+    for(uint32_t slot = 0; slot < 4; ++slot)
+    {
+        if(slot >= childCount)
+        {
+            sSetSlot(node, slot, AABB());
+            node.child[slot] = BVHInvalidIndex;
+            node.primCount[slot] = 0;
+            continue;
+        }
+
+        const BVHBuildRange &child = children[slot];
+        const uint32_t count = child.end - child.begin;
+        sSetSlot(node, slot, child.bounds);
+        if(count <= BVHMaxLeafSize)
+        {
+            node.child[slot] = child.begin;
+            node.primCount[slot] = count;
+            continue;
+        }
+
+        uint32_t childIndex = ctx.nodeCount.fetch_add(1, std::memory_order_relaxed);
+        ASSERT_MATH(childIndex < ctx.bvh->capacity);
+        node.child[slot] = childIndex;
+        node.primCount[slot] = 0;
+
+        if(serialTopLevel && count <= ctx.taskThreshold)
+            ctx.tasks.push_back(BVHBuildTask{ child, childIndex, depth + 1u });
+        else
+            sBuildNode(ctx, child, childIndex, depth + 1u, serialTopLevel);
+    }
+}
+
+static void sFree(BVH &bvh)
+{
+    if(bvh.nodes)
+        ::operator delete(bvh.nodes, BVHNodeAlignment);
+    delete[] bvh.primIndices;
+    delete[] bvh.primBounds;
+    bvh.nodes = nullptr;
+    bvh.primIndices = nullptr;
+    bvh.primBounds = nullptr;
+    bvh.nodeCount = 0;
+    bvh.primCount = 0;
+    bvh.capacity = 0;
+}
+
+static void sReserve(BVH &bvh, uint32_t count)
+{
+    // Every inner node has at least two children, so node count <= leaf count <= primitive count.
+    uint32_t capacity = count > 0 ? count : 1u;
+    if(capacity <= bvh.capacity)
+        return;
+
+    sFree(bvh);
+    bvh.nodes = static_cast<BVHNode4 *>(::operator new(sizeof(BVHNode4) * capacity, BVHNodeAlignment));
+    bvh.primIndices = new uint32_t[capacity];
+    bvh.primBounds = new AABB[capacity];
+    bvh.capacity = capacity;
+}
+
+BVH::~BVH()
+{
+    sFree(*this);
+}
+
+void buildBVH(BVH &bvh, const AABB *bounds, uint32_t count, uint32_t threadCount)
+{
+    sReserve(bvh, count);
+    bvh.primCount = count;
+    bvh.nodeCount = 1;
+    if(count == 0)
+    {
+        for(uint32_t slot = 0; slot < 4; ++slot)
+        {
+            sSetSlot(bvh.nodes[0], slot, AABB());
+            bvh.nodes[0].child[slot] = BVHInvalidIndex;
+            bvh.nodes[0].primCount[slot] = 0;
+        }
+        return;
+    }
+
+    BVHBuildContext ctx;
+    ctx.bvh = &bvh;
+    ctx.nodeCount = 1;
+    ctx.threadCount = getThreadCount(threadCount);
+    ctx.taskThreshold = 0;
+    if(ctx.threadCount > 1)
+    {
+        ctx.taskThreshold = count / (ctx.threadCount * 8);
+        ctx.taskThreshold = ctx.taskThreshold < 4096u ? 4096u : ctx.taskThreshold;
+    }
+
+    std::vector<BVHBuildRange> chunkRanges(ctx.threadCount);
+    parallelFor(count, ctx.threadCount, [&](uint32_t begin, uint32_t end, uint32_t chunk)
+    {
+        BVHBuildRange &chunkRange = chunkRanges[chunk];
+        chunkRange.bounds = createEmptyAABB();
+        chunkRange.centroidBounds = createEmptyAABB();
+        for(uint32_t i = begin; i < end; ++i)
+        {
+            AABB &ref = bvh.primBounds[i];
+            ref = bounds[i];
+            sGrow(chunkRange.bounds, ref);
+            sGrow(chunkRange.centroidBounds, sGetCentroid(ref));
+            sSetRefIndex(ref, i);
+        }
+    });
+
+    BVHBuildRange root;
+    root.begin = 0;
+    root.end = count;
+    root.bounds = root.centroidBounds = createEmptyAABB();
+    for(uint32_t chunk = 0; chunk < ctx.threadCount && chunk < count; ++chunk)
+    {
+        sGrow(root.bounds, chunkRanges[chunk].bounds);
+        sGrow(root.centroidBounds, chunkRanges[chunk].centroidBounds);
+    }
+
+    sBuildNode(ctx, root, 0, 0u, ctx.threadCount > 1);
+
+    if(!ctx.tasks.empty())
+    {
+        // Biggest first for better load balance.
+        std::sort(ctx.tasks.begin(), ctx.tasks.end(), [](const BVHBuildTask &a, const BVHBuildTask &b)
+        {
+            return a.range.end - a.range.begin > b.range.end - b.range.begin;
+        });
+        std::atomic<uint32_t> nextTask{ 0 };
+        const uint32_t taskCount = uint32_t(ctx.tasks.size());
+        parallelFor(ctx.threadCount, ctx.threadCount, [&](uint32_t, uint32_t, uint32_t)
+        {
+            for(uint32_t task = nextTask++; task < taskCount; task = nextTask++)
+                sBuildNode(ctx, ctx.tasks[task].range, ctx.tasks[task].nodeIndex, ctx.tasks[task].depth, false);
+        });
+    }
+    bvh.nodeCount = ctx.nodeCount.load();
+
+    parallelFor(count, ctx.threadCount, [&](uint32_t begin, uint32_t end, uint32_t)
+    {
+        for(uint32_t i = begin; i < end; ++i)
+        {
+            bvh.primIndices[i] = sGetRefIndex(bvh.primBounds[i]);
+            bvh.primBounds[i].min.w = 0.0f;
+        }
+    });
+}
+
+void refitBVH(BVH &bvh, const AABB *bounds)
+{
+    for(uint32_t i = 0; i < bvh.primCount; ++i)
+        bvh.primBounds[i] = bounds[bvh.primIndices[i]];
+
+    // Children always come after parents.
+    for(uint32_t nodeIndex = bvh.nodeCount; nodeIndex-- > 0;)
+    {
+        BVHNode4 &node = bvh.nodes[nodeIndex];
+        for(uint32_t slot = 0; slot < 4; ++slot)
+        {
+            const uint32_t child = node.child[slot];
+            if(child == BVHInvalidIndex)
+                continue;
+
+            AABB box = createEmptyAABB();
+            if(node.primCount[slot] > 0)
+            {
+                for(uint32_t i = child; i < child + node.primCount[slot]; ++i)
+                    sGrow(box, bvh.primBounds[i]);
+            }
+            else
+            {
+                box = sGetNodeBounds(bvh.nodes[child]);
+            }
+            sSetSlot(node, slot, box);
+        }
+    }
+}
+
+AABB getBounds(const BVH &bvh)
+{
+    if(bvh.nodeCount == 0)
+        return createEmptyAABB();
+    return sGetNodeBounds(bvh.nodes[0]);
+}
+
+
+
+
+struct BVHStackEntry
+{
+    uint32_t node;
+    float t;
+};
+
+static bool sIntersectPrimitive(const BVH &bvh, uint32_t leafIndex, const Ray &ray, float maxT,
+    BVHRayHitFunc hitFunc, void *userData, float &outT)
+{
+    if(hitFunc)
+        return hitFunc(userData, bvh.primIndices[leafIndex], ray, maxT, outT);
+    return intersectRayAABB(ray, bvh.primBounds[leafIndex], maxT, outT);
+}
+
+uint32_t raycastBVH(const BVH &bvh, const Ray &ray, float maxT,
+    BVHRayHitFunc hitFunc, void *userData, float &outT)
+{
+    outT = FLT_MAX;
+    if(bvh.nodeCount == 0)
+        return BVHInvalidIndex;
+
+    BVHStackEntry stack[BVHTraversalStackSize];
+    uint32_t stackSize = 0;
+    stack[stackSize++] = BVHStackEntry{ 0, 0.0f };
+
+    float bestT = maxT;
+    uint32_t bestPrim = BVHInvalidIndex;
+    while(stackSize > 0)
+    {
+        const BVHStackEntry entry = stack[--stackSize];
+        if(entry.t > bestT)
+            continue;
+
+        const BVHNode4 &node = bvh.nodes[entry.node];
+        float t[4];
+        const uint32_t mask = intersectRayAABB(ray, node.bounds, bestT, t);
+
+        // Sort hit slots near to far.
+        uint32_t order[4];
+        uint32_t hitCount = 0;
+        for(uint32_t slot = 0; slot < 4; ++slot)
+        {
+            if((mask & (1u << slot)) == 0 || node.child[slot] == BVHInvalidIndex)
+                continue;
+            uint32_t k = hitCount++;
+            for(; k > 0 && t[order[k - 1]] > t[slot]; --k)
+                order[k] = order[k - 1];
+            order[k] = slot;
+        }
+
+        for(uint32_t k = 0; k < hitCount; ++k)
+        {
+            const uint32_t slot = order[k];
+            if(node.primCount[slot] == 0 || t[slot] > bestT)
+                continue;
+            for(uint32_t i = node.child[slot]; i < node.child[slot] + node.primCount[slot]; ++i)
+            {
+                float primT;
+                if(sIntersectPrimitive(bvh, i, ray, bestT, hitFunc, userData, primT) && primT <= bestT)
+                {
+                    bestT = primT;
+                    bestPrim = bvh.primIndices[i];
+                }
+            }
+        }
+        // Far ones first so nearest gets popped first.
+        for(uint32_t k = hitCount; k-- > 0;)
+        {
+            const uint32_t slot = order[k];
+            if(node.primCount[slot] != 0)
+                continue;
+            ASSERT_MATH(stackSize < BVHTraversalStackSize);
+            stack[stackSize++] = BVHStackEntry{ node.child[slot], t[slot] };
+        }
+    }
+
+    if(bestPrim != BVHInvalidIndex)
+        outT = bestT;
+    return bestPrim;
+}
+
+bool isOccludedBVH(const BVH &bvh, const Ray &ray, float maxT, BVHRayHitFunc hitFunc, void *userData)
+{
+    if(bvh.nodeCount == 0)
+        return false;
+
+    uint32_t stack[BVHTraversalStackSize];
+    uint32_t stackSize = 0;
+    stack[stackSize++] = 0;
+    while(stackSize > 0)
+    {
+        const BVHNode4 &node = bvh.nodes[stack[--stackSize]];
+        float t[4];
+        const uint32_t mask = intersectRayAABB(ray, node.bounds, maxT, t);
+        for(uint32_t slot = 0; slot < 4; ++slot)
+        {
+            if((mask & (1u << slot)) == 0 || node.child[slot] == BVHInvalidIndex)
+                continue;
+
+            if(node.primCount[slot] == 0)
+            {
+                ASSERT_MATH(stackSize < BVHTraversalStackSize);
+                stack[stackSize++] = node.child[slot];
+                continue;
+            }
+            for(uint32_t i = node.child[slot]; i < node.child[slot] + node.primCount[slot]; ++i)
+            {
+                float primT;
+                if(sIntersectPrimitive(bvh, i, ray, maxT, hitFunc, userData, primT))
+                    return true;
+            }
+        }
+    }
+    return false;
+}
+
+static uint32_t sOverlapMask(const AABBPacket4 &boxes, const AABB &box)
+{
+#if BVH_SIMD_SSE
+    __m128 m = _mm_cmple_ps(_mm_load_ps(boxes.minX), _mm_set1_ps(box.max.x));
+    m = _mm_and_ps(m, _mm_cmple_ps(_mm_load_ps(boxes.minY), _mm_set1_ps(box.max.y)));
+    m = _mm_and_ps(m, _mm_cmple_ps(_mm_load_ps(boxes.minZ), _mm_set1_ps(box.max.z)));
+    m = _mm_and_ps(m, _mm_cmpge_ps(_mm_load_ps(boxes.maxX), _mm_set1_ps(box.min.x)));
+    m = _mm_and_ps(m, _mm_cmpge_ps(_mm_load_ps(boxes.maxY), _mm_set1_ps(box.min.y)));
+    m = _mm_and_ps(m, _mm_cmpge_ps(_mm_load_ps(boxes.maxZ), _mm_set1_ps(box.min.z)));
+    return uint32_t(_mm_movemask_ps(m));
+#else
+    uint32_t mask = 0;
+    for(uint32_t i = 0; i < 4; ++i)
+    {
+        AABB slot(Vec3(boxes.minX[i], boxes.minY[i], boxes.minZ[i]), Vec3(boxes.maxX[i], boxes.maxY[i], boxes.maxZ[i]));
+        mask |= overlaps(slot, box) ? (1u << i) : 0u;
+    }
+    return mask;
+#endif
+}
+
+uint32_t queryBVH(const BVH &bvh, const AABB &box, uint32_t *outPrims, uint32_t maxCount)
+{
+    if(bvh.nodeCount == 0)
+        return 0;
+
+    uint32_t found = 0;
+    uint32_t stack[BVHTraversalStackSize];
+    uint32_t stackSize = 0;
+    stack[stackSize++] = 0;
+    while(stackSize > 0)
+    {
+        const BVHNode4 &node = bvh.nodes[stack[--stackSize]];
+        const uint32_t mask = sOverlapMask(node.bounds, box);
+        for(uint32_t slot = 0; slot < 4; ++slot)
+        {
+            if((mask & (1u << slot)) == 0 || node.child[slot] == BVHInvalidIndex)
+                continue;
+
+            if(node.primCount[slot] == 0)
+            {
+                ASSERT_MATH(stackSize < BVHTraversalStackSize);
+                stack[stackSize++] = node.child[slot];
+                continue;
+            }
+            for(uint32_t i = node.child[slot]; i < node.child[slot] + node.primCount[slot]; ++i)
+            {
+                if(!overlaps(bvh.primBounds[i], box))
+                    continue;
+                if(found < maxCount)
+                    outPrims[found] = bvh.primIndices[i];
+                ++found;
+            }
+        }
+    }
+    return found;
+}
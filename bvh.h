@@ -0,0 +1,60 @@
+#pragma once
+
+#include "aabb.h"
+#include "ray.h"
+
+#include <stdint.h>
+
+// 4 wide bounding volume hierarchy built with binned SAH.
+// All nodes are in one contiguous 64 byte aligned array, node 0 is root
+// and children always have bigger index than their parent, so refit can
+// walk the array backwards. Primitives are referred with their index in
+// the bounds array given to buildBVH.
+
+static constexpr uint32_t BVHInvalidIndex = ~0u;
+static constexpr uint32_t BVHMaxLeafSize = 4u;
+
+struct alignas(64) BVHNode4
+{
+    AABBPacket4 bounds;
+    // Inner node index when primCount is 0, otherwise first index into
+    // BVH::primIndices. BVHInvalidIndex for unused slot.
+    uint32_t child[4];
+    uint32_t primCount[4];
+};
+
+struct BVH
+{
+    BVH() {}
+    ~BVH();
+    BVH(const BVH &) = delete;
+    BVH &operator=(const BVH &) = delete;
+
+    BVHNode4 *nodes = nullptr;
+    // Leaf order, primIndices maps back to original primitive index.
+    uint32_t *primIndices = nullptr;
+    AABB *primBounds = nullptr;
+
+    uint32_t nodeCount = 0;
+    uint32_t primCount = 0;
+    uint32_t capacity = 0;
+};
+
+// Called for leaf primitives while raycasting, return true and set outT
+// if ray hits primitive before maxT.
+typedef bool (*BVHRayHitFunc)(void *userData, uint32_t primIndex, const Ray &ray, float maxT, float &outT);
+
+// threadCount 0 uses hardware concurrency.
+void buildBVH(BVH &bvh, const AABB *bounds, uint32_t count, uint32_t threadCount = 0);
+// Same primitives with moved bounds, topology stays the same.
+void refitBVH(BVH &bvh, const AABB *bounds);
+AABB getBounds(const BVH &bvh);
+
+// Returns closest hit primitive or BVHInvalidIndex. If hitFunc is null,
+// primitive bounds are used as the primitives.
+uint32_t raycastBVH(const BVH &bvh, const Ray &ray, float maxT,
+    BVHRayHitFunc hitFunc, void *userData, float &outT);
+// Any hit, for line of sight tests.
+bool isOccludedBVH(const BVH &bvh, const Ray &ray, float maxT, BVHRayHitFunc hitFunc, void *userData);
+// Writes up to maxCount overlapping primitive indices, returns total overlap count.
+uint32_t queryBVH(const BVH &bvh, const AABB &box, uint32_t *outPrims, uint32_t maxCount);
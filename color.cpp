@@ -0,0 +1,359 @@
+#include "color.h"
+
+#include "dispatch.h"
+#include "mathhelp.h"
+#include "profile.h"
+#include "simdhelp.h"
+
+#if SIMDHELP_SSE
+#include <emmintrin.h>
+#endif
+#if CARPMATH_X86
+#include <immintrin.h>
+#endif
+
+// Encode table buckets are floats in [2^-13, 1) by exponent and top 7 mantissa bits. Each
+// bucket spans less than one output step, so the bucket's first byte plus one compare
+// against the next threshold is exact. Everything below 2^-13 packs to 0.
+static constexpr uint32_t SRGBTableShift = 16u;
+static constexpr uint32_t SRGBTableMinBits = (127u - 13u) << 23u;
+static constexpr uint32_t SRGBTableSize = 13u << (23u - SRGBTableShift);
+static constexpr float SRGBTableMin = 1.0f / 8192.0f;
+// Largest float below 1.
+static constexpr float SRGBTableMax = 0.99999994f;
+static constexpr float ColorInv255 = 1.0f / 255.0f;
+
+struct SRGBTables
+{
+    // First byte of each bucket.
+    int32_t encode[SRGBTableSize];
+    // Smallest float that packs to k or more, [256] is infinity.
+    float thresholds[257];
+    float decode[256];
+};
+
+static double sLinearToSRGB(double v)
+{
+    return v <= 0.0031308 ? v * 12.92 : 1.055 * pow(v, 1.0 / 2.4) - 0.055;
+}
+
+static double sSRGBToLinear(double v)
+{
+    return v <= 0.04045 ? v / 12.92 : pow((v + 0.055) / 1.055, 2.4);
+}
+
+static bool sPacksToAtLeast(float v, uint32_t k)
+{
+    return sLinearToSRGB(v) * 255.0 + 0.5 >= double(k);
+}
+
+static float sGetFloat(uint32_t bits)
+{
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+static uint32_t sGetBits(float f)
+{
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    return bits;
+}
+
+static SRGBTables sBuildSRGBTables()
+{
+    SRGBTables tables;
+    tables.thresholds[0] = 0.0f;
+    for(uint32_t k = 1; k < 256; ++k)
+    {
+        float f = float(sSRGBToLinear((double(k) - 0.5) / 255.0));
+        while(!sPacksToAtLeast(f, k))
+            f = nextafterf(f, 2.0f);
+        while(sPacksToAtLeast(nextafterf(f, -1.0f), k))
+            f = nextafterf(f, -1.0f);
+        tables.thresholds[k] = f;
+    }
+    tables.thresholds[256] = INFINITY;
+
+    uint32_t k = 0;
+    for(uint32_t bucket = 0; bucket < SRGBTableSize; ++bucket)
+    {
+        const float begin = sGetFloat(SRGBTableMinBits + (bucket << SRGBTableShift));
+        const float end = sGetFloat(SRGBTableMinBits + ((bucket + 1u) << SRGBTableShift));
+        while(tables.thresholds[k + 1] <= begin)
+            ++k;
+        ASSERT_MATH(k + 2u > 256u || tables.thresholds[k + 2] >= end);
+        tables.encode[bucket] = int32_t(k);
+    }
+    for(uint32_t i = 0; i < 256; ++i)
+        tables.decode[i] = float(sSRGBToLinear(double(i) / 255.0));
+    return tables;
+}
+
+static const SRGBTables &sGetSRGBTables()
+{
+    static const SRGBTables tables = sBuildSRGBTables();
+    return tables;
+}
+
+// Nan goes to 0 like max with zero in SIMD.
+static float sSaturate(float v)
+{
+    v = v > 0.0f ? v : 0.0f;
+    return v < 1.0f ? v : 1.0f;
+}
+
+// v in [0, 1].
+static uint32_t sEncodeSRGB8(const SRGBTables &tables, float v)
+{
+    v = v > SRGBTableMin ? v : SRGBTableMin;
+    v = v < SRGBTableMax ? v : SRGBTableMax;
+    const int32_t k = tables.encode[(sGetBits(v) - SRGBTableMinBits) >> SRGBTableShift];
+    return uint32_t(k) + (v >= tables.thresholds[k + 1] ? 1u : 0u);
+}
+
+static uint32_t sPackColor(const SRGBTables *tables, const Vec4 &color, bool premultiplied)
+{
+    const float a = sSaturate(color.w);
+    float rgb[3] = { sSaturate(color.x), sSaturate(color.y), sSaturate(color.z) };
+    uint32_t result = uint32_t(lrintf(a * 255.0f)) << 24u;
+    for(uint32_t i = 0; i < 3; ++i)
+    {
+        const float v = premultiplied ? rgb[i] * a : rgb[i];
+        result |= (tables ? sEncodeSRGB8(*tables, v) : uint32_t(lrintf(v * 255.0f))) << (i * 8u);
+    }
+    return result;
+}
+
+static Vec4 sUnpackColor(const SRGBTables *tables, uint32_t color, bool premultiplied)
+{
+    const float a = float(color >> 24u) * ColorInv255;
+    float rgb[3];
+    for(uint32_t i = 0; i < 3; ++i)
+    {
+        const uint32_t byte = (color >> (i * 8u)) & 0xFFu;
+        rgb[i] = tables ? tables->decode[byte] : float(byte) * ColorInv255;
+        if(premultiplied)
+            rgb[i] = a > 0.0f ? rgb[i] / a : 0.0f;
+    }
+    return Vec4(rgb[0], rgb[1], rgb[2], a);
+}
+
+static void sPackColorsScalar(const Vec4 *colors, uint32_t count, uint32_t flags, uint32_t *outColors)
+{
+    const SRGBTables *tables = (flags & ColorPackSRGB) ? &sGetSRGBTables() : nullptr;
+    const bool premultiplied = (flags & ColorPackPremultiplied) != 0;
+    for(uint32_t i = 0; i < count; ++i)
+        outColors[i] = sPackColor(tables, colors[i], premultiplied);
+}
+
+static void sUnpackColorsScalar(const uint32_t *colors, uint32_t count, uint32_t flags, Vec4 *outColors)
+{
+    const SRGBTables *tables = (flags & ColorPackSRGB) ? &sGetSRGBTables() : nullptr;
+    const bool premultiplied = (flags & ColorPackPremultiplied) != 0;
+    for(uint32_t i = 0; i < count; ++i)
+        outColors[i] = sUnpackColor(tables, colors[i], premultiplied);
+}
+
+#if SIMDHELP_SSE
+
+// One color per register, rgba in lanes. Table lookups are scalar, sse2 has no gather.
+static void sPackColorsSSE(const Vec4 *colors, uint32_t count, uint32_t flags, uint32_t *outColors)
+{
+    const SRGBTables *tables = (flags & ColorPackSRGB) ? &sGetSRGBTables() : nullptr;
+    const bool premultiplied = (flags & ColorPackPremultiplied) != 0;
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 scale = _mm_set1_ps(255.0f);
+    const __m128 alphaMask = _mm_castsi128_ps(_mm_setr_epi32(0, 0, 0, -1));
+    uint32_t i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        __m128i c[4];
+        for(uint32_t j = 0; j < 4; ++j)
+        {
+            __m128 v = _mm_min_ps(_mm_max_ps(_mm_load_ps(&colors[i + j].x), zero), one);
+            if(premultiplied)
+                v = sSelect4(alphaMask, v, _mm_mul_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3))));
+            c[j] = _mm_cvtps_epi32(_mm_mul_ps(v, scale));
+            if(tables)
+            {
+                alignas(16) float f[4];
+                alignas(16) int32_t bytes[4];
+                _mm_store_ps(f, v);
+                _mm_store_si128(reinterpret_cast<__m128i *>(bytes), c[j]);
+                for(uint32_t k = 0; k < 3; ++k)
+                    bytes[k] = int32_t(sEncodeSRGB8(*tables, f[k]));
+                c[j] = _mm_load_si128(reinterpret_cast<const __m128i *>(bytes));
+            }
+        }
+        const __m128i packed = _mm_packus_epi16(_mm_packs_epi32(c[0], c[1]), _mm_packs_epi32(c[2], c[3]));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(outColors + i), packed);
+    }
+    sPackColorsScalar(colors + i, count - i, flags, outColors + i);
+}
+
+static void sUnpackColorsSSE(const uint32_t *colors, uint32_t count, uint32_t flags, Vec4 *outColors)
+{
+    const SRGBTables *tables = (flags & ColorPackSRGB) ? &sGetSRGBTables() : nullptr;
+    const bool premultiplied = (flags & ColorPackPremultiplied) != 0;
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 inv255 = _mm_set1_ps(ColorInv255);
+    const __m128 alphaMask = _mm_castsi128_ps(_mm_setr_epi32(0, 0, 0, -1));
+    uint32_t i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(colors + i));
+        const __m128i low = _mm_unpacklo_epi8(bytes, zero);
+        const __m128i high = _mm_unpackhi_epi8(bytes, zero);
+        const __m128i c[4] = {
+            _mm_unpacklo_epi16(low, zero), _mm_unpackhi_epi16(low, zero),
+            _mm_unpacklo_epi16(high, zero), _mm_unpackhi_epi16(high, zero) };
+        for(uint32_t j = 0; j < 4; ++j)
+        {
+            __m128 v = _mm_mul_ps(_mm_cvtepi32_ps(c[j]), inv255);
+            if(tables)
+            {
+                const uint32_t color = colors[i + j];
+                v = _mm_setr_ps(tables->decode[color & 0xFFu], tables->decode[(color >> 8u) & 0xFFu],
+                    tables->decode[(color >> 16u) & 0xFFu], float(color >> 24u) * ColorInv255);
+            }
+            if(premultiplied)
+            {
+                const __m128 a = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3));
+                const __m128 rgb = _mm_and_ps(_mm_div_ps(v, a), _mm_cmpgt_ps(a, _mm_setzero_ps()));
+                v = sSelect4(alphaMask, v, rgb);
+            }
+            _mm_store_ps(&outColors[i + j].x, v);
+        }
+    }
+    sUnpackColorsScalar(colors + i, count - i, flags, outColors + i);
+}
+
+#endif
+
+#if CARPMATH_X86
+
+// Two colors per register. Packs leave colors interleaved by lane, the permute restores order.
+CARPMATH_TARGET_AVX2 static void sPackColorsAVX2(const Vec4 *colors, uint32_t count, uint32_t flags,
+    uint32_t *outColors)
+{
+    const SRGBTables *tables = (flags & ColorPackSRGB) ? &sGetSRGBTables() : nullptr;
+    const bool premultiplied = (flags & ColorPackPremultiplied) != 0;
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 scale = _mm256_set1_ps(255.0f);
+    const __m256 tableMin = _mm256_set1_ps(SRGBTableMin);
+    const __m256 tableMax = _mm256_set1_ps(SRGBTableMax);
+    const __m256i tableBase = _mm256_set1_epi32(int32_t(SRGBTableMinBits >> SRGBTableShift));
+    const __m256 alphaMask = _mm256_castsi256_ps(_mm256_setr_epi32(0, 0, 0, -1, 0, 0, 0, -1));
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    uint32_t i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        __m256i c[4];
+        for(uint32_t j = 0; j < 4; ++j)
+        {
+            __m256 v = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(&colors[i + j * 2].x), zero), one);
+            if(premultiplied)
+                v = _mm256_blendv_ps(_mm256_mul_ps(v, _mm256_permute_ps(v, _MM_SHUFFLE(3, 3, 3, 3))), v, alphaMask);
+            c[j] = _mm256_cvtps_epi32(_mm256_mul_ps(v, scale));
+            if(tables)
+            {
+                const __m256 clamped = _mm256_min_ps(_mm256_max_ps(v, tableMin), tableMax);
+                const __m256i bucket = _mm256_sub_epi32(
+                    _mm256_srli_epi32(_mm256_castps_si256(clamped), SRGBTableShift), tableBase);
+                const __m256i first = _mm256_i32gather_epi32(tables->encode, bucket, 4);
+                const __m256 next = _mm256_i32gather_ps(tables->thresholds + 1, first, 4);
+                const __m256i k = _mm256_sub_epi32(first,
+                    _mm256_castps_si256(_mm256_cmp_ps(clamped, next, _CMP_GE_OQ)));
+                c[j] = _mm256_blendv_epi8(k, c[j], _mm256_castps_si256(alphaMask));
+            }
+        }
+        const __m256i packed = _mm256_packus_epi16(_mm256_packs_epi32(c[0], c[1]), _mm256_packs_epi32(c[2], c[3]));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(outColors + i), _mm256_permutevar8x32_epi32(packed, order));
+    }
+    sPackColorsScalar(colors + i, count - i, flags, outColors + i);
+}
+
+CARPMATH_TARGET_AVX2 static void sUnpackColorsAVX2(const uint32_t *colors, uint32_t count, uint32_t flags,
+    Vec4 *outColors)
+{
+    const SRGBTables *tables = (flags & ColorPackSRGB) ? &sGetSRGBTables() : nullptr;
+    const bool premultiplied = (flags & ColorPackPremultiplied) != 0;
+    const __m256 inv255 = _mm256_set1_ps(ColorInv255);
+    const __m256 alphaMask = _mm256_castsi256_ps(_mm256_setr_epi32(0, 0, 0, -1, 0, 0, 0, -1));
+    uint32_t i = 0;
+    for(; i + 2 <= count; i += 2)
+    {
+        const __m256i bytes = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(colors + i)));
+        __m256 v = _mm256_mul_ps(_mm256_cvtepi32_ps(bytes), inv255);
+        if(tables)
+            v = _mm256_blendv_ps(_mm256_i32gather_ps(tables->decode, bytes, 4), v, alphaMask);
+        if(premultiplied)
+        {
+            const __m256 a = _mm256_permute_ps(v, _MM_SHUFFLE(3, 3, 3, 3));
+            const __m256 rgb = _mm256_and_ps(_mm256_div_ps(v, a), _mm256_cmp_ps(a, _mm256_setzero_ps(), _CMP_GT_OQ));
+            v = _mm256_blendv_ps(rgb, v, alphaMask);
+        }
+        _mm256_storeu_ps(&outColors[i].x, v);
+    }
+    sUnpackColorsScalar(colors + i, count - i, flags, outColors + i);
+}
+
+#endif
+
+void bindColorKernels(SimdKernels &kernels, SimdBackend backend)
+{
+    kernels.packColors = sPackColorsScalar;
+    kernels.unpackColors = sUnpackColorsScalar;
+#if SIMDHELP_SSE
+    if(backend >= SimdBackendSSE4)
+    {
+        kernels.packColors = sPackColorsSSE;
+        kernels.unpackColors = sUnpackColorsSSE;
+    }
+#endif
+#if CARPMATH_X86
+    if(backend >= SimdBackendAVX2)
+    {
+        kernels.packColors = sPackColorsAVX2;
+        kernels.unpackColors = sUnpackColorsAVX2;
+    }
+#endif
+}
+
+float linearToSRGB(float v)
+{
+    return float(sLinearToSRGB(v));
+}
+
+float sRGBToLinear(float v)
+{
+    return float(sSRGBToLinear(v));
+}
+
+uint32_t packColor(const Vec4 &color, uint32_t flags)
+{
+    const SRGBTables *tables = (flags & ColorPackSRGB) ? &sGetSRGBTables() : nullptr;
+    return sPackColor(tables, color, (flags & ColorPackPremultiplied) != 0);
+}
+
+Vec4 unpackColor(uint32_t color, uint32_t flags)
+{
+    const SRGBTables *tables = (flags & ColorPackSRGB) ? &sGetSRGBTables() : nullptr;
+    return sUnpackColor(tables, color, (flags & ColorPackPremultiplied) != 0);
+}
+
+void packColors(const Vec4 *colors, uint32_t count, uint32_t flags, uint32_t *outColors)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdPackColors, count);
+    getSimdKernels().packColors(colors, count, flags, outColors);
+}
+
+void unpackColors(const uint32_t *colors, uint32_t count, uint32_t flags, Vec4 *outColors)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdUnpackColors, count);
+    getSimdKernels().unpackColors(colors, count, flags, outColors);
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "vec4.h"
+
+#include <stdint.h>
+
+// RGBA8 colors, r in the lowest byte like sGetColor. Packing clamps to [0, 1] and rounds
+// to nearest even, nan packs as 0. sRGB packing is exact, the same byte as rounding the
+// double precision sRGB curve, through a table indexed by float bits.
+
+enum ColorPackFlags : uint32_t
+{
+    ColorPackLinear = 0u,
+    // Rgb is encoded to sRGB on pack and decoded on unpack, alpha stays linear.
+    ColorPackSRGB = 1u << 0u,
+    // Packing multiplies rgb by alpha before encoding, unpacking divides it out.
+    // Zero alpha unpacks as zero rgb.
+    ColorPackPremultiplied = 1u << 1u,
+};
+
+float linearToSRGB(float v);
+float sRGBToLinear(float v);
+
+// flags is a combination of ColorPackFlags.
+uint32_t packColor(const Vec4 &color, uint32_t flags = ColorPackLinear);
+Vec4 unpackColor(uint32_t color, uint32_t flags = ColorPackLinear);
+void packColors(const Vec4 *colors, uint32_t count, uint32_t flags, uint32_t *outColors);
+void unpackColors(const uint32_t *colors, uint32_t count, uint32_t flags, Vec4 *outColors);
@@ -0,0 +1,165 @@
+#include "dispatch.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if CARPMATH_X86
+#if _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+static SimdKernels sKernels;
+static SimdBackend sBackend = SimdBackendScalar;
+
+#if CARPMATH_X86
+static void sCpuid(uint32_t leaf, uint32_t subLeaf, uint32_t regs[4])
+{
+#if _MSC_VER
+    int info[4];
+    __cpuidex(info, int(leaf), int(subLeaf));
+    for(int i = 0; i < 4; ++i)
+        regs[i] = uint32_t(info[i]);
+#else
+    __cpuid_count(leaf, subLeaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static uint64_t sXgetbv()
+{
+#if _MSC_VER
+    return _xgetbv(0);
+#else
+    uint32_t eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (uint64_t(edx) << 32u) | eax;
+#endif
+}
+#endif
+
+static CpuFeatures sDetectCpuFeatures()
+{
+    CpuFeatures features = {};
+#if CARPMATH_X86
+    uint32_t regs[4];
+    sCpuid(0, 0, regs);
+    const uint32_t maxLeaf = regs[0];
+    if(maxLeaf < 1)
+        return features;
+
+    sCpuid(1, 0, regs);
+    const uint32_t ecx1 = regs[2];
+    features.sse41 = (ecx1 & (1u << 19u)) != 0;
+    features.fma = (ecx1 & (1u << 12u)) != 0;
+    const bool osxsave = (ecx1 & (1u << 27u)) != 0;
+    const bool cpuAvx = (ecx1 & (1u << 28u)) != 0;
+
+    // Os has to save ymm and zmm state too, not only cpu support them.
+    const uint64_t xcr0 = osxsave ? sXgetbv() : 0;
+    const bool osAvx = (xcr0 & 0x6u) == 0x6u;
+    const bool osAvx512 = (xcr0 & 0xe6u) == 0xe6u;
+
+    features.avx = cpuAvx && osAvx;
+    features.fma = features.fma && osAvx;
+    if(maxLeaf >= 7)
+    {
+        sCpuid(7, 0, regs);
+        const uint32_t ebx7 = regs[1];
+        features.avx2 = osAvx && (ebx7 & (1u << 5u)) != 0;
+        features.bmi2 = (ebx7 & (1u << 8u)) != 0;
+        features.avx512f = osAvx512 && (ebx7 & (1u << 16u)) != 0;
+        features.avx512dq = osAvx512 && (ebx7 & (1u << 17u)) != 0;
+        features.avx512bw = osAvx512 && (ebx7 & (1u << 30u)) != 0;
+        features.avx512vl = osAvx512 && (ebx7 & (1u << 31u)) != 0;
+    }
+#endif
+    return features;
+}
+
+const CpuFeatures &getCpuFeatures()
+{
+    static const CpuFeatures features = sDetectCpuFeatures();
+    return features;
+}
+
+SimdBackend getBestSimdBackend()
+{
+    const CpuFeatures &features = getCpuFeatures();
+    if(features.avx512f && features.avx512vl && features.avx512dq && features.avx512bw
+        && features.avx2 && features.fma)
+        return SimdBackendAVX512;
+    if(features.avx2 && features.fma)
+        return SimdBackendAVX2;
+    if(features.sse41)
+        return SimdBackendSSE4;
+    return SimdBackendScalar;
+}
+
+const char *getSimdBackendName(SimdBackend backend)
+{
+    switch(backend)
+    {
+        case SimdBackendScalar: return "scalar";
+        case SimdBackendSSE4: return "sse4";
+        case SimdBackendAVX2: return "avx2";
+        case SimdBackendAVX512: return "avx512";
+        default: return "unknown";
+    }
+}
+
+static void sBindKernels(SimdBackend backend)
+{
+    SimdKernels kernels = {};
+    bindAnimationTrackKernels(kernels, backend);
+    bindColorKernels(kernels, backend);
+    bindEigenKernels(kernels, backend);
+    bindIntegrateKernels(kernels, backend);
+    bindMat4Kernels(kernels, backend);
+    bindMortonKernels(kernels, backend);
+    bindProjectionKernels(kernels, backend);
+    bindQuatKernels(kernels, backend);
+    bindRayKernels(kernels, backend);
+    bindSplineKernels(kernels, backend);
+    bindTransformStreamKernels(kernels, backend);
+    bindVec3Kernels(kernels, backend);
+    sKernels = kernels;
+    sBackend = backend;
+}
+
+static bool sInitKernels()
+{
+    SimdBackend backend = getBestSimdBackend();
+    if(const char *env = getenv("CARPMATH_SIMD"))
+    {
+        for(uint32_t i = 0; i < SimdBackendCount; ++i)
+        {
+            if(strcmp(env, getSimdBackendName(SimdBackend(i))) == 0 && SimdBackend(i) < backend)
+                backend = SimdBackend(i);
+        }
+    }
+    sBindKernels(backend);
+    return true;
+}
+
+const SimdKernels &getSimdKernels()
+{
+    static const bool initialized = sInitKernels();
+    (void)initialized;
+    return sKernels;
+}
+
+SimdBackend getSimdBackend()
+{
+    getSimdKernels();
+    return sBackend;
+}
+
+SimdBackend setSimdBackend(SimdBackend backend)
+{
+    getSimdKernels();
+    const SimdBackend best = getBestSimdBackend();
+    sBindKernels(backend < best ? backend : best);
+    return sBackend;
+}
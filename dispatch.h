@@ -0,0 +1,163 @@
+#pragma once
+
+#include <stdint.h>
+
+// Runtime selection of SIMD code paths. Cpu features are detected once and
+// kernels are bound to the best implementation through SimdKernels table.
+// Environment variable CARPMATH_SIMD=scalar|sse4|avx2|avx512 forces a lower
+// backend, for testing and benchmarking. Backends without their own version
+// of a kernel use the next best one.
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CARPMATH_X86 1
+#else
+#define CARPMATH_X86 0
+#endif
+
+// Lets single functions use instructions the whole file isn't compiled for.
+#if CARPMATH_X86 && (defined(__GNUC__) || defined(__clang__))
+#define CARPMATH_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define CARPMATH_TARGET_AVX512 __attribute__((target("avx512f,avx512vl,avx512dq,avx512bw,avx2,fma")))
+#define CARPMATH_TARGET_AVX2_BMI2 __attribute__((target("avx2,fma,bmi2")))
+#else
+#define CARPMATH_TARGET_AVX2
+#define CARPMATH_TARGET_AVX512
+#define CARPMATH_TARGET_AVX2_BMI2
+#endif
+
+struct AABB;
+struct AABBPacket8;
+struct CubicCurve;
+struct Mat3x4;
+struct Mat4x4;
+struct PackedVec3;
+struct Quat;
+struct Ray;
+struct RayPacket8;
+struct SpherePacket8;
+struct SquadSegment;
+struct SymMat3;
+struct Transform;
+struct TransformStreamBlock;
+struct TrianglePacket8;
+struct Vec2;
+struct Vec3;
+struct Vec4;
+struct Viewport;
+
+enum TrackRotationMode : uint32_t;
+
+enum SimdBackend : uint32_t
+{
+    SimdBackendScalar,
+    SimdBackendSSE4,
+    SimdBackendAVX2,
+    SimdBackendAVX512,
+
+    SimdBackendCount
+};
+
+struct CpuFeatures
+{
+    bool sse41;
+    bool avx;
+    bool avx2;
+    bool fma;
+    bool bmi2;
+    bool avx512f;
+    bool avx512vl;
+    bool avx512dq;
+    bool avx512bw;
+};
+
+struct SimdKernels
+{
+    void (*multiplyMatricesMat4Mat3x4)(const Mat4x4 &a, const Mat3x4 *b, uint32_t count, Mat4x4 *outResults);
+    void (*multiplyMatricesMat4Pairs)(const Mat4x4 *a, const Mat4x4 *b, uint32_t count, Mat4x4 *outResults);
+    void (*multiplyMatricesMat4)(const Mat4x4 &a, const Mat4x4 *b, uint32_t count, Mat4x4 *outResults);
+    void (*multiplyMatricesMat3x4Pairs)(const Mat3x4 *a, const Mat3x4 *b, uint32_t count, Mat3x4 *outResults);
+    void (*multiplyMatricesMat3x4)(const Mat3x4 &a, const Mat3x4 *b, uint32_t count, Mat3x4 *outResults);
+    void (*getTransformsFromMatrices)(const Mat3x4 *matrices, uint32_t count, Transform *outTransforms);
+    uint32_t (*orthonormalizeMatrices)(Mat3x4 *matrices, uint32_t count, float epsilon);
+    uint32_t (*diffEntries)(const float *current, const float *previous, uint32_t count,
+        uint32_t entryFloats, uint32_t compareMask, float epsilon, uint64_t *outChangedBits);
+
+    void (*rotateVectors)(const Vec3 *vectors, const Quat &q, uint32_t count, Vec3 *outVectors);
+    void (*rotateVectorsPairs)(const Vec3 *vectors, const Quat *quats, uint32_t count, Vec3 *outVectors);
+    void (*rotateVectorsPacked)(const PackedVec3 *vectors, const Quat &q, uint32_t count, PackedVec3 *outVectors);
+    void (*rotateVectorsPairsPacked)(const PackedVec3 *vectors, const Quat *quats, uint32_t count, PackedVec3 *outVectors);
+    uint32_t (*renormalizeQuats)(Quat *quats, uint32_t count, float epsilon);
+
+    uint32_t (*projectPointsToScreen)(const Mat4x4 &viewProj, const Viewport &viewport,
+        const Vec3 *points, uint32_t count, Vec2 *outPixels, uint8_t *outClipFlags, float *outDepth);
+    uint32_t (*projectPackedPointsToScreen)(const Mat4x4 &viewProj, const Viewport &viewport,
+        const PackedVec3 *points, uint32_t count, Vec2 *outPixels, uint8_t *outClipFlags, float *outDepth);
+
+    uint32_t (*intersectRayAABBPacket8)(const Ray &ray, const AABBPacket8 &boxes, float maxT, float *outT);
+    uint32_t (*intersectRayPacket8AABB)(const RayPacket8 &rays, const AABB &box, float maxT, float *outT);
+    uint32_t (*intersectRayTrianglePacket8)(const Ray &ray, const TrianglePacket8 &triangles, float maxT, float *outT);
+    uint32_t (*intersectRayPacket8Triangle)(const RayPacket8 &rays,
+        const Vec3 &v0, const Vec3 &v1, const Vec3 &v2, float maxT, float *outT);
+    uint32_t (*intersectRaySpherePacket8)(const Ray &ray, const SpherePacket8 &spheres, float maxT, float *outT);
+    uint32_t (*intersectRayPacket8Sphere)(const RayPacket8 &rays,
+        const Vec3 &center, float radius, float maxT, float *outT);
+
+    void (*packVec3s)(const Vec3 *vectors, uint32_t count, PackedVec3 *outPacked);
+    void (*unpackVec3s)(const PackedVec3 *packed, uint32_t count, Vec3 *outVectors);
+    void (*unpackVec3sToSoA)(const PackedVec3 *packed, uint32_t count, float *outX, float *outY, float *outZ);
+    void (*packVec3sFromSoA)(const float *x, const float *y, const float *z, uint32_t count, PackedVec3 *outPacked);
+    void (*normalizeVec3s)(const Vec3 *vectors, const Vec3 &fallback, uint32_t count, Vec3 *outVectors);
+    void (*normalizeVec3sFast)(const Vec3 *vectors, uint32_t count, Vec3 *outVectors);
+
+    uint64_t (*quantizeTransformBlock)(const Transform *previous, const Transform *current, uint32_t count,
+        float invStep, TransformStreamBlock &outBlock);
+    void (*decodeTransformBlock)(const TransformStreamBlock &block, uint32_t count, float step, Transform *transforms);
+
+    void (*evaluateCurves)(const CubicCurve *curves, float t, uint32_t count, Vec3 *outPoints);
+    void (*evaluateCurve)(const CubicCurve &curve, const float *ts, uint32_t count, Vec3 *outPoints);
+    void (*squadSegments)(const SquadSegment *segments, float t, uint32_t count, Quat *outQuats);
+    void (*squadSegment)(const SquadSegment &segment, const float *ts, uint32_t count, Quat *outQuats);
+
+    void (*interpolateTrackKeys)(const Vec3 *positions, const Quat *rotations, const uint32_t *keysA,
+        const uint32_t *keysB, const float *fractions, uint32_t count, TrackRotationMode mode, Transform *outTransforms);
+
+    void (*integrateEuler)(Vec3 *positions, Vec3 *velocities, const Vec3 *accelerations, uint32_t count, float dt);
+    void (*integrateVerlet)(Vec3 *positions, Vec3 *previousPositions, const Vec3 *accelerations, uint32_t count,
+        float dt, Vec3 *outVelocities);
+    void (*integrateOrientations)(Quat *orientations, const Vec3 *angularVelocities, uint32_t count, float dt);
+
+    void (*computeMortonCodes30)(const Vec3 *positions, uint32_t count, const Vec3 &origin, const Vec3 &scale,
+        uint32_t *outCodes);
+    void (*computeMortonCodes63)(const Vec3 *positions, uint32_t count, const Vec3 &origin, const Vec3 &scale,
+        uint64_t *outCodes);
+
+    void (*computeCovariance)(const Vec3 *points, uint32_t count, Vec3 &outMean, SymMat3 &outCovariance);
+    void (*solveSymmetricEigen)(const SymMat3 *matrices, uint32_t count, Vec3 *outValues, Quat *outVectors);
+
+    void (*packColors)(const Vec4 *colors, uint32_t count, uint32_t flags, uint32_t *outColors);
+    void (*unpackColors)(const uint32_t *colors, uint32_t count, uint32_t flags, Vec4 *outColors);
+};
+
+const CpuFeatures &getCpuFeatures();
+SimdBackend getBestSimdBackend();
+SimdBackend getSimdBackend();
+// Rebinds kernels, backend is clamped to what cpu supports. Returns the backend in use.
+// Must not be called while other threads run kernels.
+SimdBackend setSimdBackend(SimdBackend backend);
+const char *getSimdBackendName(SimdBackend backend);
+
+const SimdKernels &getSimdKernels();
+
+// Each module fills its own table entries.
+void bindAnimationTrackKernels(SimdKernels &kernels, SimdBackend backend);
+void bindColorKernels(SimdKernels &kernels, SimdBackend backend);
+void bindEigenKernels(SimdKernels &kernels, SimdBackend backend);
+void bindIntegrateKernels(SimdKernels &kernels, SimdBackend backend);
+void bindMat4Kernels(SimdKernels &kernels, SimdBackend backend);
+void bindMortonKernels(SimdKernels &kernels, SimdBackend backend);
+void bindProjectionKernels(SimdKernels &kernels, SimdBackend backend);
+void bindQuatKernels(SimdKernels &kernels, SimdBackend backend);
+void bindRayKernels(SimdKernels &kernels, SimdBackend backend);
+void bindSplineKernels(SimdKernels &kernels, SimdBackend backend);
+void bindTransformStreamKernels(SimdKernels &kernels, SimdBackend backend);
+void bindVec3Kernels(SimdKernels &kernels, SimdBackend backend);
@@ -0,0 +1,591 @@
+#include "eigen.h"
+
+#include "dispatch.h"
+#include "mat4.h"
+#include "mathhelp.h"
+#include "parallel.h"
+#include "profile.h"
+#include "simdhelp.h"
+
+#include <float.h>
+
+#if SIMDHELP_SSE
+#include <emmintrin.h>
+#endif
+#if CARPMATH_X86
+#include <immintrin.h>
+#endif
+
+// Jacobi converges quadratically, 3x3 is at float precision after 4 sweeps.
+static constexpr uint32_t EigenSweepCount = 4u;
+static constexpr uint32_t Eigen4MaxSweepCount = 16u;
+static constexpr float EigenSqrtHalf = 0.70710678f;
+// Below this many clusters per thread the thread start costs more than it saves.
+static constexpr uint32_t CovarianceMinClustersPerThread = 256u;
+static constexpr uint32_t EigenMatrixBatchSize = 64u;
+
+static void sComputeCovarianceScalar(const Vec3 *points, uint32_t count, Vec3 &outMean, SymMat3 &outCovariance)
+{
+    outMean = Vec3();
+    outCovariance = SymMat3();
+    if(count == 0)
+        return;
+
+    Vec3 sum;
+    for(uint32_t i = 0; i < count; ++i)
+    {
+        sum.x += points[i].x;
+        sum.y += points[i].y;
+        sum.z += points[i].z;
+    }
+    const float invCount = 1.0f / float(count);
+    const Vec3 mean(sum.x * invCount, sum.y * invCount, sum.z * invCount);
+
+    // Second pass around the mean, single pass sums lose precision far from origin.
+    SymMat3 c;
+    for(uint32_t i = 0; i < count; ++i)
+    {
+        const float dx = points[i].x - mean.x;
+        const float dy = points[i].y - mean.y;
+        const float dz = points[i].z - mean.z;
+        c.xx += dx * dx;
+        c.xy += dx * dy;
+        c.xz += dx * dz;
+        c.yy += dy * dy;
+        c.yz += dy * dz;
+        c.zz += dz * dz;
+    }
+    outMean = mean;
+    outCovariance.xx = c.xx * invCount;
+    outCovariance.xy = c.xy * invCount;
+    outCovariance.xz = c.xz * invCount;
+    outCovariance.yy = c.yy * invCount;
+    outCovariance.yz = c.yz * invCount;
+    outCovariance.zz = c.zz * invCount;
+}
+
+// Zeroes apq with a rotation in the p, q plane, arp and arq are the third row's entries.
+// The quaternion gets the same rotation around the remaining axis k, with i, j, k cyclic,
+// sign flips the direction for the pair that isn't in cyclic order.
+static void sJacobiRotate(float &app, float &aqq, float &apq, float &arp, float &arq,
+    float &qi, float &qj, float &qk, float &qw, float sign)
+{
+    const float h = aqq - app;
+    const float num = h < 0.0f ? -2.0f * apq : 2.0f * apq;
+    const float t = num / (sAbsF(h) + sSqrtF(h * h + num * num) + FLT_MIN);
+    const float c = 1.0f / sSqrtF(1.0f + t * t);
+    const float s = t * c;
+    app -= t * apq;
+    aqq += t * apq;
+    apq = 0.0f;
+    const float rp = arp;
+    arp = c * rp - s * arq;
+    arq = s * rp + c * arq;
+
+    const float ch = sSqrtF(0.5f + 0.5f * c);
+    const float sh = sign * 0.5f * s / ch;
+    const float i = qi;
+    const float k = qk;
+    qi = i * ch + qj * sh;
+    qj = qj * ch - i * sh;
+    qk = k * ch + qw * sh;
+    qw = qw * ch - k * sh;
+}
+
+// Swapping eigenvalues p and q is a 90 degree turn around k, column q becomes -column p.
+static void sSortPair(float &ap, float &aq, float &qi, float &qj, float &qk, float &qw)
+{
+    if(aq <= ap)
+        return;
+    const float a = ap;
+    ap = aq;
+    aq = a;
+    const float i = qi;
+    const float k = qk;
+    qi = (i + qj) * EigenSqrtHalf;
+    qj = (qj - i) * EigenSqrtHalf;
+    qk = (k + qw) * EigenSqrtHalf;
+    qw = (qw - k) * EigenSqrtHalf;
+}
+
+static void sSolveSymmetricEigenScalar(const SymMat3 *matrices, uint32_t count, Vec3 *outValues, Quat *outVectors)
+{
+    for(uint32_t i = 0; i < count; ++i)
+    {
+        const SymMat3 &m = matrices[i];
+        // Scaled to about 1 so squares in the rotations can't overflow.
+        float scale = sMaxF(sMaxF(sAbsF(m.xx), sAbsF(m.yy)), sAbsF(m.zz));
+        scale = sMaxF(sMaxF(sMaxF(scale, sAbsF(m.xy)), sMaxF(sAbsF(m.xz), sAbsF(m.yz))), FLT_MIN);
+        const float invScale = 1.0f / scale;
+        float a00 = m.xx * invScale;
+        float a01 = m.xy * invScale;
+        float a02 = m.xz * invScale;
+        float a11 = m.yy * invScale;
+        float a12 = m.yz * invScale;
+        float a22 = m.zz * invScale;
+        float qx = 0.0f;
+        float qy = 0.0f;
+        float qz = 0.0f;
+        float qw = 1.0f;
+        for(uint32_t sweep = 0; sweep < EigenSweepCount; ++sweep)
+        {
+            sJacobiRotate(a00, a11, a01, a02, a12, qx, qy, qz, qw, -1.0f);
+            sJacobiRotate(a00, a22, a02, a01, a12, qz, qx, qy, qw, 1.0f);
+            sJacobiRotate(a11, a22, a12, a01, a02, qy, qz, qx, qw, -1.0f);
+        }
+        sSortPair(a00, a11, qx, qy, qz, qw);
+        sSortPair(a11, a22, qy, qz, qx, qw);
+        sSortPair(a00, a11, qx, qy, qz, qw);
+
+        const float invLength = (qw < 0.0f ? -1.0f : 1.0f) / sSqrtF(qx * qx + qy * qy + qz * qz + qw * qw);
+        outValues[i] = Vec3(a00 * scale, a11 * scale, a22 * scale);
+        outVectors[i] = Quat(qx * invLength, qy * invLength, qz * invLength, qw * invLength);
+    }
+}
+
+#if SIMDHELP_SSE
+
+static void sComputeCovarianceSSE(const Vec3 *points, uint32_t count, Vec3 &outMean, SymMat3 &outCovariance)
+{
+    outMean = Vec3();
+    outCovariance = SymMat3();
+    if(count == 0)
+        return;
+
+    __m128 sum = _mm_setzero_ps();
+    for(uint32_t i = 0; i < count; ++i)
+        sum = _mm_add_ps(sum, _mm_load_ps(&points[i].x));
+    const __m128 invCount = _mm_set1_ps(1.0f / float(count));
+    const __m128 mean = _mm_mul_ps(sum, invCount);
+
+    // Diagonal as xx, yy, zz and off diagonal as xy, yz, zx.
+    __m128 diagonal = _mm_setzero_ps();
+    __m128 offDiagonal = _mm_setzero_ps();
+    for(uint32_t i = 0; i < count; ++i)
+    {
+        const __m128 d = _mm_sub_ps(_mm_load_ps(&points[i].x), mean);
+        diagonal = _mm_add_ps(diagonal, _mm_mul_ps(d, d));
+        offDiagonal = _mm_add_ps(offDiagonal, _mm_mul_ps(d, _mm_shuffle_ps(d, d, _MM_SHUFFLE(3, 0, 2, 1))));
+    }
+    alignas(16) float m[4];
+    alignas(16) float c[4];
+    alignas(16) float o[4];
+    _mm_store_ps(m, mean);
+    _mm_store_ps(c, _mm_mul_ps(diagonal, invCount));
+    _mm_store_ps(o, _mm_mul_ps(offDiagonal, invCount));
+    outMean = Vec3(m[0], m[1], m[2]);
+    outCovariance.xx = c[0];
+    outCovariance.yy = c[1];
+    outCovariance.zz = c[2];
+    outCovariance.xy = o[0];
+    outCovariance.yz = o[1];
+    outCovariance.xz = o[2];
+}
+
+static inline void sJacobiRotate4(__m128 &app, __m128 &aqq, __m128 &apq, __m128 &arp, __m128 &arq,
+    __m128 &qi, __m128 &qj, __m128 &qk, __m128 &qw, __m128 sign)
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    const __m128 h = _mm_sub_ps(aqq, app);
+    const __m128 twoApq = _mm_add_ps(apq, apq);
+    const __m128 num = _mm_xor_ps(twoApq, _mm_and_ps(_mm_cmplt_ps(h, zero), signMask));
+    const __m128 root = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(h, h), _mm_mul_ps(num, num)));
+    const __m128 t = _mm_div_ps(num, _mm_add_ps(_mm_add_ps(_mm_andnot_ps(signMask, h), root), _mm_set1_ps(FLT_MIN)));
+    const __m128 c = _mm_div_ps(one, _mm_sqrt_ps(_mm_add_ps(one, _mm_mul_ps(t, t))));
+    const __m128 s = _mm_mul_ps(t, c);
+    const __m128 tApq = _mm_mul_ps(t, apq);
+    app = _mm_sub_ps(app, tApq);
+    aqq = _mm_add_ps(aqq, tApq);
+    apq = zero;
+    const __m128 rp = arp;
+    arp = _mm_sub_ps(_mm_mul_ps(c, rp), _mm_mul_ps(s, arq));
+    arq = _mm_add_ps(_mm_mul_ps(s, rp), _mm_mul_ps(c, arq));
+
+    const __m128 ch = _mm_sqrt_ps(_mm_add_ps(half, _mm_mul_ps(half, c)));
+    const __m128 sh = _mm_div_ps(_mm_mul_ps(_mm_mul_ps(sign, half), s), ch);
+    const __m128 i = qi;
+    const __m128 k = qk;
+    qi = _mm_add_ps(_mm_mul_ps(i, ch), _mm_mul_ps(qj, sh));
+    qj = _mm_sub_ps(_mm_mul_ps(qj, ch), _mm_mul_ps(i, sh));
+    qk = _mm_add_ps(_mm_mul_ps(k, ch), _mm_mul_ps(qw, sh));
+    qw = _mm_sub_ps(_mm_mul_ps(qw, ch), _mm_mul_ps(k, sh));
+}
+
+static inline void sSortPair4(__m128 &ap, __m128 &aq, __m128 &qi, __m128 &qj, __m128 &qk, __m128 &qw)
+{
+    const __m128 swap = _mm_cmpgt_ps(aq, ap);
+    const __m128 sqrtHalf = _mm_set1_ps(EigenSqrtHalf);
+    const __m128 a = ap;
+    ap = sSelect4(swap, aq, ap);
+    aq = sSelect4(swap, a, aq);
+    const __m128 i = qi;
+    const __m128 k = qk;
+    qi = sSelect4(swap, _mm_mul_ps(_mm_add_ps(i, qj), sqrtHalf), i);
+    qj = sSelect4(swap, _mm_mul_ps(_mm_sub_ps(qj, i), sqrtHalf), qj);
+    qk = sSelect4(swap, _mm_mul_ps(_mm_add_ps(k, qw), sqrtHalf), k);
+    qw = sSelect4(swap, _mm_mul_ps(_mm_sub_ps(qw, k), sqrtHalf), qw);
+}
+
+static void sSolveSymmetricEigenSSE(const SymMat3 *matrices, uint32_t count, Vec3 *outValues, Quat *outVectors)
+{
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 minusOne = _mm_set1_ps(-1.0f);
+    uint32_t i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        const SymMat3 *m = matrices + i;
+        __m128 a00 = _mm_setr_ps(m[0].xx, m[1].xx, m[2].xx, m[3].xx);
+        __m128 a01 = _mm_setr_ps(m[0].xy, m[1].xy, m[2].xy, m[3].xy);
+        __m128 a02 = _mm_setr_ps(m[0].xz, m[1].xz, m[2].xz, m[3].xz);
+        __m128 a11 = _mm_setr_ps(m[0].yy, m[1].yy, m[2].yy, m[3].yy);
+        __m128 a12 = _mm_setr_ps(m[0].yz, m[1].yz, m[2].yz, m[3].yz);
+        __m128 a22 = _mm_setr_ps(m[0].zz, m[1].zz, m[2].zz, m[3].zz);
+        __m128 scale = _mm_max_ps(_mm_max_ps(_mm_andnot_ps(signMask, a00), _mm_andnot_ps(signMask, a11)),
+            _mm_andnot_ps(signMask, a22));
+        scale = _mm_max_ps(_mm_max_ps(scale, _mm_andnot_ps(signMask, a01)),
+            _mm_max_ps(_mm_andnot_ps(signMask, a02), _mm_andnot_ps(signMask, a12)));
+        scale = _mm_max_ps(scale, _mm_set1_ps(FLT_MIN));
+        const __m128 invScale = _mm_div_ps(one, scale);
+        a00 = _mm_mul_ps(a00, invScale);
+        a01 = _mm_mul_ps(a01, invScale);
+        a02 = _mm_mul_ps(a02, invScale);
+        a11 = _mm_mul_ps(a11, invScale);
+        a12 = _mm_mul_ps(a12, invScale);
+        a22 = _mm_mul_ps(a22, invScale);
+        Quat4 q{ _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), one };
+        for(uint32_t sweep = 0; sweep < EigenSweepCount; ++sweep)
+        {
+            sJacobiRotate4(a00, a11, a01, a02, a12, q.x, q.y, q.z, q.w, minusOne);
+            sJacobiRotate4(a00, a22, a02, a01, a12, q.z, q.x, q.y, q.w, one);
+            sJacobiRotate4(a11, a22, a12, a01, a02, q.y, q.z, q.x, q.w, minusOne);
+        }
+        sSortPair4(a00, a11, q.x, q.y, q.z, q.w);
+        sSortPair4(a11, a22, q.y, q.z, q.x, q.w);
+        sSortPair4(a00, a11, q.x, q.y, q.z, q.w);
+
+        const __m128 flip = _mm_and_ps(q.w, signMask);
+        const __m128 invLength = _mm_xor_ps(_mm_div_ps(one, _mm_sqrt_ps(sDot4(q, q))), flip);
+        q.x = _mm_mul_ps(q.x, invLength);
+        q.y = _mm_mul_ps(q.y, invLength);
+        q.z = _mm_mul_ps(q.z, invLength);
+        q.w = _mm_mul_ps(q.w, invLength);
+        sStoreVec3x4(outValues + i, _mm_mul_ps(a00, scale), _mm_mul_ps(a11, scale), _mm_mul_ps(a22, scale));
+        sStoreQuat4(outVectors + i, q);
+    }
+    sSolveSymmetricEigenScalar(matrices + i, count - i, outValues + i, outVectors + i);
+}
+
+#endif
+
+#if CARPMATH_X86
+
+// Two points per register.
+CARPMATH_TARGET_AVX2 static void sComputeCovarianceAVX2(const Vec3 *points, uint32_t count, Vec3 &outMean,
+    SymMat3 &outCovariance)
+{
+    outMean = Vec3();
+    outCovariance = SymMat3();
+    if(count == 0)
+        return;
+
+    __m256 sum2 = _mm256_setzero_ps();
+    uint32_t i = 0;
+    for(; i + 2 <= count; i += 2)
+        sum2 = _mm256_add_ps(sum2, _mm256_loadu_ps(&points[i].x));
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(sum2), _mm256_extractf128_ps(sum2, 1));
+    if(i < count)
+        sum = _mm_add_ps(sum, _mm_load_ps(&points[i].x));
+    const __m128 invCount = _mm_set1_ps(1.0f / float(count));
+    const __m128 mean = _mm_mul_ps(sum, invCount);
+    const __m256 mean2 = _mm256_insertf128_ps(_mm256_castps128_ps256(mean), mean, 1);
+
+    __m256 diagonal2 = _mm256_setzero_ps();
+    __m256 offDiagonal2 = _mm256_setzero_ps();
+    for(i = 0; i + 2 <= count; i += 2)
+    {
+        const __m256 d = _mm256_sub_ps(_mm256_loadu_ps(&points[i].x), mean2);
+        diagonal2 = _mm256_fmadd_ps(d, d, diagonal2);
+        offDiagonal2 = _mm256_fmadd_ps(d, _mm256_permute_ps(d, _MM_SHUFFLE(3, 0, 2, 1)), offDiagonal2);
+    }
+    __m128 diagonal = _mm_add_ps(_mm256_castps256_ps128(diagonal2), _mm256_extractf128_ps(diagonal2, 1));
+    __m128 offDiagonal = _mm_add_ps(_mm256_castps256_ps128(offDiagonal2), _mm256_extractf128_ps(offDiagonal2, 1));
+    if(i < count)
+    {
+        const __m128 d = _mm_sub_ps(_mm_load_ps(&points[i].x), mean);
+        diagonal = _mm_fmadd_ps(d, d, diagonal);
+        offDiagonal = _mm_fmadd_ps(d, _mm_permute_ps(d, _MM_SHUFFLE(3, 0, 2, 1)), offDiagonal);
+    }
+    alignas(16) float m[4];
+    alignas(16) float c[4];
+    alignas(16) float o[4];
+    _mm_store_ps(m, mean);
+    _mm_store_ps(c, _mm_mul_ps(diagonal, invCount));
+    _mm_store_ps(o, _mm_mul_ps(offDiagonal, invCount));
+    outMean = Vec3(m[0], m[1], m[2]);
+    outCovariance.xx = c[0];
+    outCovariance.yy = c[1];
+    outCovariance.zz = c[2];
+    outCovariance.xy = o[0];
+    outCovariance.yz = o[1];
+    outCovariance.xz = o[2];
+}
+
+CARPMATH_TARGET_AVX2 static inline void sJacobiRotate8(__m256 &app, __m256 &aqq, __m256 &apq, __m256 &arp,
+    __m256 &arq, __m256 &qi, __m256 &qj, __m256 &qk, __m256 &qw, __m256 sign)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    const __m256 h = _mm256_sub_ps(aqq, app);
+    const __m256 twoApq = _mm256_add_ps(apq, apq);
+    const __m256 num = _mm256_xor_ps(twoApq, _mm256_and_ps(_mm256_cmp_ps(h, zero, _CMP_LT_OQ), signMask));
+    const __m256 root = _mm256_sqrt_ps(_mm256_fmadd_ps(h, h, _mm256_mul_ps(num, num)));
+    const __m256 t = _mm256_div_ps(num,
+        _mm256_add_ps(_mm256_add_ps(_mm256_andnot_ps(signMask, h), root), _mm256_set1_ps(FLT_MIN)));
+    const __m256 c = _mm256_div_ps(one, _mm256_sqrt_ps(_mm256_fmadd_ps(t, t, one)));
+    const __m256 s = _mm256_mul_ps(t, c);
+    const __m256 tApq = _mm256_mul_ps(t, apq);
+    app = _mm256_sub_ps(app, tApq);
+    aqq = _mm256_add_ps(aqq, tApq);
+    apq = zero;
+    const __m256 rp = arp;
+    arp = _mm256_fmsub_ps(c, rp, _mm256_mul_ps(s, arq));
+    arq = _mm256_fmadd_ps(s, rp, _mm256_mul_ps(c, arq));
+
+    const __m256 ch = _mm256_sqrt_ps(_mm256_fmadd_ps(half, c, half));
+    const __m256 sh = _mm256_div_ps(_mm256_mul_ps(_mm256_mul_ps(sign, half), s), ch);
+    const __m256 i = qi;
+    const __m256 k = qk;
+    qi = _mm256_fmadd_ps(i, ch, _mm256_mul_ps(qj, sh));
+    qj = _mm256_fmsub_ps(qj, ch, _mm256_mul_ps(i, sh));
+    qk = _mm256_fmadd_ps(k, ch, _mm256_mul_ps(qw, sh));
+    qw = _mm256_fmsub_ps(qw, ch, _mm256_mul_ps(k, sh));
+}
+
+CARPMATH_TARGET_AVX2 static inline void sSortPair8(__m256 &ap, __m256 &aq, __m256 &qi, __m256 &qj,
+    __m256 &qk, __m256 &qw)
+{
+    const __m256 swap = _mm256_cmp_ps(aq, ap, _CMP_GT_OQ);
+    const __m256 sqrtHalf = _mm256_set1_ps(EigenSqrtHalf);
+    const __m256 a = ap;
+    ap = _mm256_blendv_ps(ap, aq, swap);
+    aq = _mm256_blendv_ps(aq, a, swap);
+    const __m256 i = qi;
+    const __m256 k = qk;
+    qi = _mm256_blendv_ps(i, _mm256_mul_ps(_mm256_add_ps(i, qj), sqrtHalf), swap);
+    qj = _mm256_blendv_ps(qj, _mm256_mul_ps(_mm256_sub_ps(qj, i), sqrtHalf), swap);
+    qk = _mm256_blendv_ps(k, _mm256_mul_ps(_mm256_add_ps(k, qw), sqrtHalf), swap);
+    qw = _mm256_blendv_ps(qw, _mm256_mul_ps(_mm256_sub_ps(qw, k), sqrtHalf), swap);
+}
+
+CARPMATH_TARGET_AVX2 static void sSolveSymmetricEigenAVX2(const SymMat3 *matrices, uint32_t count,
+    Vec3 *outValues, Quat *outVectors)
+{
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 minusOne = _mm256_set1_ps(-1.0f);
+    uint32_t i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        const SymMat3 *m = matrices + i;
+        __m256 a00 = _mm256_setr_ps(m[0].xx, m[1].xx, m[2].xx, m[3].xx, m[4].xx, m[5].xx, m[6].xx, m[7].xx);
+        __m256 a01 = _mm256_setr_ps(m[0].xy, m[1].xy, m[2].xy, m[3].xy, m[4].xy, m[5].xy, m[6].xy, m[7].xy);
+        __m256 a02 = _mm256_setr_ps(m[0].xz, m[1].xz, m[2].xz, m[3].xz, m[4].xz, m[5].xz, m[6].xz, m[7].xz);
+        __m256 a11 = _mm256_setr_ps(m[0].yy, m[1].yy, m[2].yy, m[3].yy, m[4].yy, m[5].yy, m[6].yy, m[7].yy);
+        __m256 a12 = _mm256_setr_ps(m[0].yz, m[1].yz, m[2].yz, m[3].yz, m[4].yz, m[5].yz, m[6].yz, m[7].yz);
+        __m256 a22 = _mm256_setr_ps(m[0].zz, m[1].zz, m[2].zz, m[3].zz, m[4].zz, m[5].zz, m[6].zz, m[7].zz);
+        __m256 scale = _mm256_max_ps(_mm256_max_ps(_mm256_andnot_ps(signMask, a00), _mm256_andnot_ps(signMask, a11)),
+            _mm256_andnot_ps(signMask, a22));
+        scale = _mm256_max_ps(_mm256_max_ps(scale, _mm256_andnot_ps(signMask, a01)),
+            _mm256_max_ps(_mm256_andnot_ps(signMask, a02), _mm256_andnot_ps(signMask, a12)));
+        scale = _mm256_max_ps(scale, _mm256_set1_ps(FLT_MIN));
+        const __m256 invScale = _mm256_div_ps(one, scale);
+        a00 = _mm256_mul_ps(a00, invScale);
+        a01 = _mm256_mul_ps(a01, invScale);
+        a02 = _mm256_mul_ps(a02, invScale);
+        a11 = _mm256_mul_ps(a11, invScale);
+        a12 = _mm256_mul_ps(a12, invScale);
+        a22 = _mm256_mul_ps(a22, invScale);
+        Quat8 q{ _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps(), one };
+        for(uint32_t sweep = 0; sweep < EigenSweepCount; ++sweep)
+        {
+            sJacobiRotate8(a00, a11, a01, a02, a12, q.x, q.y, q.z, q.w, minusOne);
+            sJacobiRotate8(a00, a22, a02, a01, a12, q.z, q.x, q.y, q.w, one);
+            sJacobiRotate8(a11, a22, a12, a01, a02, q.y, q.z, q.x, q.w, minusOne);
+        }
+        sSortPair8(a00, a11, q.x, q.y, q.z, q.w);
+        sSortPair8(a11, a22, q.y, q.z, q.x, q.w);
+        sSortPair8(a00, a11, q.x, q.y, q.z, q.w);
+
+        const __m256 flip = _mm256_and_ps(q.w, signMask);
+        const __m256 invLength = _mm256_xor_ps(_mm256_div_ps(one, _mm256_sqrt_ps(sDot8(q, q))), flip);
+        q.x = _mm256_mul_ps(q.x, invLength);
+        q.y = _mm256_mul_ps(q.y, invLength);
+        q.z = _mm256_mul_ps(q.z, invLength);
+        q.w = _mm256_mul_ps(q.w, invLength);
+        sStoreVec3x8(outValues + i, _mm256_mul_ps(a00, scale), _mm256_mul_ps(a11, scale), _mm256_mul_ps(a22, scale));
+        sStoreQuat8(outVectors + i, q);
+    }
+    sSolveSymmetricEigenScalar(matrices + i, count - i, outValues + i, outVectors + i);
+}
+
+#endif
+
+void bindEigenKernels(SimdKernels &kernels, SimdBackend backend)
+{
+    kernels.computeCovariance = sComputeCovarianceScalar;
+    kernels.solveSymmetricEigen = sSolveSymmetricEigenScalar;
+#if SIMDHELP_SSE
+    if(backend >= SimdBackendSSE4)
+    {
+        kernels.computeCovariance = sComputeCovarianceSSE;
+        kernels.solveSymmetricEigen = sSolveSymmetricEigenSSE;
+    }
+#endif
+#if CARPMATH_X86
+    if(backend >= SimdBackendAVX2)
+    {
+        kernels.computeCovariance = sComputeCovarianceAVX2;
+        kernels.solveSymmetricEigen = sSolveSymmetricEigenAVX2;
+    }
+#endif
+}
+
+void computeCovariance(const Vec3 *points, uint32_t count, Vec3 &outMean, SymMat3 &outCovariance)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdComputeCovariances, count);
+    getSimdKernels().computeCovariance(points, count, outMean, outCovariance);
+}
+
+void computeCovariances(const Vec3 *points, const uint32_t *clusterBegins, const uint32_t *clusterCounts,
+    uint32_t clusterCount, Vec3 *outMeans, SymMat3 *outCovariances, uint32_t threadCount)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdComputeCovariances, clusterCount);
+    const SimdKernels &kernels = getSimdKernels();
+    const uint32_t maxThreads = (clusterCount + CovarianceMinClustersPerThread - 1u) / CovarianceMinClustersPerThread;
+    const uint32_t threads = getThreadCount(threadCount);
+    parallelFor(clusterCount, threads < maxThreads ? threads : maxThreads, [&](uint32_t begin, uint32_t end, uint32_t)
+    {
+        for(uint32_t i = begin; i < end; ++i)
+            kernels.computeCovariance(points + clusterBegins[i], clusterCounts[i], outMeans[i], outCovariances[i]);
+    });
+}
+
+void solveSymmetricEigen(const SymMat3 &m, Vec3 &outValues, Quat &outVectors)
+{
+    sSolveSymmetricEigenScalar(&m, 1, &outValues, &outVectors);
+}
+
+void solveSymmetricEigen(const SymMat3 *matrices, uint32_t count, Vec3 *outValues, Quat *outVectors)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdSolveSymmetricEigen, count);
+    getSimdKernels().solveSymmetricEigen(matrices, count, outValues, outVectors);
+}
+
+void solveSymmetricEigen(const SymMat3 *matrices, uint32_t count, Vec3 *outValues, Mat3x4 *outVectors)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdSolveSymmetricEigen, count);
+    const SimdKernels &kernels = getSimdKernels();
+    Quat quats[EigenMatrixBatchSize];
+    for(uint32_t i = 0; i < count; i += EigenMatrixBatchSize)
+    {
+        const uint32_t batchCount = count - i < EigenMatrixBatchSize ? count - i : EigenMatrixBatchSize;
+        kernels.solveSymmetricEigen(matrices + i, batchCount, outValues + i, quats);
+        for(uint32_t j = 0; j < batchCount; ++j)
+            outVectors[i + j] = getMatrixFromQuaternion(quats[j]);
+    }
+}
+
+// Cyclic Jacobi on a full 4x4 matrix until the off diagonal is negligible, columns of v
+// become the eigenvectors.
+static void sJacobiEigen4(float a[4][4], float v[4][4])
+{
+    for(uint32_t r = 0; r < 4; ++r)
+    {
+        for(uint32_t c = 0; c < 4; ++c)
+            v[r][c] = r == c ? 1.0f : 0.0f;
+    }
+    for(uint32_t sweep = 0; sweep < Eigen4MaxSweepCount; ++sweep)
+    {
+        float off = 0.0f;
+        float diagonal = 0.0f;
+        for(uint32_t p = 0; p < 4; ++p)
+        {
+            diagonal += a[p][p] * a[p][p];
+            for(uint32_t q = p + 1; q < 4; ++q)
+                off += a[p][q] * a[p][q];
+        }
+        if(off <= diagonal * 1.0e-14f)
+            break;
+
+        for(uint32_t p = 0; p < 3; ++p)
+        {
+            for(uint32_t q = p + 1; q < 4; ++q)
+            {
+                const float apq = a[p][q];
+                if(apq == 0.0f)
+                    continue;
+                const float h = a[q][q] - a[p][p];
+                const float num = h < 0.0f ? -2.0f * apq : 2.0f * apq;
+                const float t = num / (sAbsF(h) + sSqrtF(h * h + num * num));
+                const float c = 1.0f / sSqrtF(1.0f + t * t);
+                const float s = t * c;
+                a[p][p] -= t * apq;
+                a[q][q] += t * apq;
+                a[p][q] = 0.0f;
+                a[q][p] = 0.0f;
+                for(uint32_t r = 0; r < 4; ++r)
+                {
+                    if(r != p && r != q)
+                    {
+                        const float arp = a[r][p];
+                        const float arq = a[r][q];
+                        a[r][p] = a[p][r] = c * arp - s * arq;
+                        a[r][q] = a[q][r] = s * arp + c * arq;
+                    }
+                    const float vrp = v[r][p];
+                    const float vrq = v[r][q];
+                    v[r][p] = c * vrp - s * vrq;
+                    v[r][q] = s * vrp + c * vrq;
+                }
+            }
+        }
+    }
+}
+
+Quat averageQuats(const Quat *quats, const float *weights, uint32_t count)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdAverageQuats, count);
+    float a[4][4] = {};
+    for(uint32_t i = 0; i < count; ++i)
+    {
+        const float w = weights ? weights[i] : 1.0f;
+        const float q[4] = { quats[i].vx, quats[i].vy, quats[i].vz, quats[i].w };
+        for(uint32_t r = 0; r < 4; ++r)
+        {
+            for(uint32_t c = r; c < 4; ++c)
+                a[r][c] += w * q[r] * q[c];
+        }
+    }
+    // Trace is the weight sum for unit quaternions.
+    if(!(a[0][0] + a[1][1] + a[2][2] + a[3][3] > 0.0f))
+        return Quat();
+    for(uint32_t r = 1; r < 4; ++r)
+    {
+        for(uint32_t c = 0; c < r; ++c)
+            a[r][c] = a[c][r];
+    }
+
+    float v[4][4];
+    sJacobiEigen4(a, v);
+    uint32_t best = 0;
+    for(uint32_t k = 1; k < 4; ++k)
+        best = a[k][k] > a[best][best] ? k : best;
+    const Quat result = normalize(Quat(v[0][best], v[1][best], v[2][best], v[3][best]));
+    return dot(result, quats[0]) < 0.0f ? result * -1.0f : result;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "quat.h"
+#include "vec3.h"
+
+#include <stdint.h>
+
+struct Mat3x4;
+
+// Symmetric 3x3 matrix, the upper triangle.
+struct SymMat3
+{
+    float xx = 0.0f;
+    float xy = 0.0f;
+    float xz = 0.0f;
+    float yy = 0.0f;
+    float yz = 0.0f;
+    float zz = 0.0f;
+};
+
+// Mean and covariance, divided by count, of points. Zero count gives zeros.
+void computeCovariance(const Vec3 *points, uint32_t count, Vec3 &outMean, SymMat3 &outCovariance);
+// Cluster i is points [clusterBegins[i], clusterBegins[i] + clusterCounts[i]). Clusters are
+// split over threads, threadCount 0 uses hardware concurrency.
+void computeCovariances(const Vec3 *points, const uint32_t *clusterBegins, const uint32_t *clusterCounts,
+    uint32_t clusterCount, Vec3 *outMeans, SymMat3 *outCovariances, uint32_t threadCount = 0);
+
+// Cyclic Jacobi with a fixed sweep count, accurate to about 1e-6 of the largest eigenvalue.
+// Eigenvalues are sorted largest first. Eigenvectors are the columns of the rotation
+// outVectors, x axis goes to the eigenvector of the largest eigenvalue, w >= 0. For a
+// covariance they are the principal axes and the orientation of a fitted box.
+void solveSymmetricEigen(const SymMat3 &m, Vec3 &outValues, Quat &outVectors);
+void solveSymmetricEigen(const SymMat3 *matrices, uint32_t count, Vec3 *outValues, Quat *outVectors);
+void solveSymmetricEigen(const SymMat3 *matrices, uint32_t count, Vec3 *outValues, Mat3x4 *outVectors);
+
+// Weighted average rotation by Markley et al., the eigenvector of the largest eigenvalue of
+// sum of weights[i] * quats[i] * quats[i]^T. q and -q count as the same rotation, the result
+// has the sign closest to quats[0]. Null weights are all 1, zero count gives identity.
+Quat averageQuats(const Quat *quats, const float *weights, uint32_t count);
@@ -0,0 +1,117 @@
+#include "framepipeline.h"
+
+#include "mathhelp.h"
+#include "parallel.h"
+#include "profile.h"
+
+#include <atomic>
+
+// Target bytes touched by one chunk, half of a typical 256 KiB L2 to leave room for
+// stage constants and the other hyperthread.
+static constexpr uint32_t FramePipelineChunkBytes = 128u * 1024u;
+static constexpr uint32_t FramePipelineChunkAlign = 64u;
+
+struct FramePipelineRange
+{
+    uint32_t stageBegin;
+    uint32_t stageEnd;
+    uint32_t bufferIndex;
+};
+
+// Workers take chunks in increasing order from a shared counter and run every stage of
+// both ranges on one chunk before taking the next. An ordered stage only waits for lower
+// chunks, which are already taken by running workers, so waiting cannot deadlock.
+static void sRunChunks(const FramePipeline &pipeline, const FramePipelineRange *ranges, uint32_t rangeCount)
+{
+    const uint32_t entityCount = pipeline.entityCount;
+    const uint32_t chunkSize = pipeline.chunkSize;
+    const uint32_t chunkCount = uint32_t((uint64_t(entityCount) + chunkSize - 1u) / chunkSize);
+    if(chunkCount == 0)
+        return;
+
+    std::atomic<uint32_t> nextChunk(0u);
+    std::atomic<uint32_t> doneChunks[FramePipelineMaxStages];
+    for(uint32_t i = 0; i < FramePipelineMaxStages; ++i)
+        doneChunks[i].store(0u, std::memory_order_relaxed);
+
+    const FrameStage *stages = pipeline.stages;
+    const uint32_t threads = getThreadCount(pipeline.threadCount);
+    parallelFor(chunkCount, threads < chunkCount ? threads : chunkCount, [&](uint32_t, uint32_t, uint32_t)
+    {
+        for(;;)
+        {
+            const uint32_t chunk = nextChunk.fetch_add(1u, std::memory_order_relaxed);
+            if(chunk >= chunkCount)
+                break;
+            const uint32_t begin = chunk * chunkSize;
+            const uint32_t end = entityCount - begin < chunkSize ? entityCount : begin + chunkSize;
+            for(uint32_t r = 0; r < rangeCount; ++r)
+            {
+                const FramePipelineRange &range = ranges[r];
+                for(uint32_t s = range.stageBegin; s < range.stageEnd; ++s)
+                {
+                    const FrameStage &stage = stages[s];
+                    if((stage.flags & FrameStageOrdered) == 0)
+                    {
+                        stage.func(stage.userData, begin, end, range.bufferIndex);
+                        continue;
+                    }
+                    while(doneChunks[s].load(std::memory_order_acquire) < chunk)
+                        std::this_thread::yield();
+                    stage.func(stage.userData, begin, end, range.bufferIndex);
+                    doneChunks[s].store(chunk + 1u, std::memory_order_release);
+                }
+            }
+        }
+    });
+}
+
+uint32_t getFramePipelineChunkSize(uint32_t bytesPerEntity)
+{
+    if(bytesPerEntity == 0)
+        bytesPerEntity = 1;
+    uint32_t chunkSize = FramePipelineChunkBytes / bytesPerEntity;
+    chunkSize -= chunkSize % FramePipelineChunkAlign;
+    return chunkSize > FramePipelineChunkAlign ? chunkSize : FramePipelineChunkAlign;
+}
+
+void initFramePipeline(FramePipeline &pipeline, const FrameStage *stages, uint32_t stageCount, uint32_t lateStage,
+    uint32_t entityCount, uint32_t chunkSize, uint32_t threadCount)
+{
+    ASSERT_MATH(stages != nullptr || stageCount == 0);
+    ASSERT_MATH(stageCount <= FramePipelineMaxStages);
+    ASSERT_MATH(lateStage <= stageCount);
+    ASSERT_MATH(chunkSize > 0);
+    pipeline.stages = stages;
+    pipeline.stageCount = stageCount < FramePipelineMaxStages ? stageCount : FramePipelineMaxStages;
+    pipeline.lateStage = lateStage < pipeline.stageCount ? lateStage : pipeline.stageCount;
+    pipeline.entityCount = entityCount;
+    pipeline.chunkSize = chunkSize > 0 ? chunkSize : FramePipelineChunkAlign;
+    pipeline.threadCount = threadCount;
+    pipeline.frame = 0;
+    pipeline.latePending = false;
+}
+
+void runFramePipeline(FramePipeline &pipeline)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdRunFramePipeline, pipeline.entityCount);
+    FramePipelineRange ranges[2];
+    uint32_t rangeCount = 0;
+    if(pipeline.latePending)
+        ranges[rangeCount++] = { pipeline.lateStage, pipeline.stageCount, (pipeline.frame - 1u) & 1u };
+    if(pipeline.lateStage > 0)
+        ranges[rangeCount++] = { 0u, pipeline.lateStage, pipeline.frame & 1u };
+    sRunChunks(pipeline, ranges, rangeCount);
+    pipeline.latePending = pipeline.lateStage < pipeline.stageCount;
+    ++pipeline.frame;
+}
+
+void flushFramePipeline(FramePipeline &pipeline)
+{
+    if(!pipeline.latePending)
+        return;
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdRunFramePipeline, pipeline.entityCount);
+    const FramePipelineRange range = { pipeline.lateStage, pipeline.stageCount, (pipeline.frame - 1u) & 1u };
+    sRunChunks(pipeline, &range, 1u);
+    pipeline.latePending = false;
+}
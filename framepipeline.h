@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stdint.h>
+
+// Runs a fixed chain of per entity stages over chunks of entities. A chunk goes through
+// all stages back to back, so its data is still in cache for the next stage, and chunks
+// run in parallel. Stages are split to early and late ones: each runFramePipeline call
+// runs the early stages of a new frame and the late stages of the previous frame in the
+// same chunk pass. Outputs of early stages read by late ones need two buffers, stages get
+// bufferIndex, frame & 1, to pick theirs. A typical chain has animation sampling,
+// getMat4FromTransform and hierarchy as early stages, culling and MVP packing as late ones.
+
+// Processes entities [begin, end) of one chunk.
+using FrameStageFunc = void (*)(void *userData, uint32_t begin, uint32_t end, uint32_t bufferIndex);
+
+static constexpr uint32_t FramePipelineMaxStages = 16u;
+
+enum FrameStageFlags : uint32_t
+{
+    // Chunk c runs the stage only after chunk c - 1 has finished it. For stages reading
+    // results of earlier entities, like hierarchy with parents sorted before children, or
+    // compacting output with a running offset kept in userData.
+    FrameStageOrdered = 1u << 0u,
+};
+
+struct FrameStage
+{
+    FrameStageFunc func;
+    void *userData;
+    // FrameStageFlags.
+    uint32_t flags;
+};
+
+// Stages are not copied, the array must outlive the pipeline.
+struct FramePipeline
+{
+    const FrameStage *stages = nullptr;
+    uint32_t stageCount = 0;
+    // First late stage, stageCount for no late stages.
+    uint32_t lateStage = 0;
+    // Flush before changing, pending late stages use the count of their own frame.
+    uint32_t entityCount = 0;
+    uint32_t chunkSize = 0;
+    // 0 uses hardware concurrency.
+    uint32_t threadCount = 0;
+    // Frames started so far.
+    uint32_t frame = 0;
+    bool latePending = false;
+};
+
+// Entities per chunk so that bytesPerEntity, summed over all arrays the stages touch,
+// fits a chunk in L2. Multiple of 64.
+uint32_t getFramePipelineChunkSize(uint32_t bytesPerEntity);
+
+void initFramePipeline(FramePipeline &pipeline, const FrameStage *stages, uint32_t stageCount, uint32_t lateStage,
+    uint32_t entityCount, uint32_t chunkSize, uint32_t threadCount = 0);
+
+// Starts frame f = pipeline.frame and increments it: runs early stages of f and late
+// stages of f - 1, if any. When this returns, late outputs of f - 1 and early outputs of
+// f, in buffer f & 1, are complete.
+void runFramePipeline(FramePipeline &pipeline);
+
+// Runs pending late stages alone, e.g. to finish the last frame or before changing entityCount.
+void flushFramePipeline(FramePipeline &pipeline);
@@ -0,0 +1,313 @@
+#include "integrate.h"
+
+#include "dispatch.h"
+#include "mathhelp.h"
+#include "parallel.h"
+#include "profile.h"
+#include "simdhelp.h"
+
+#if SIMDHELP_SSE
+#include <emmintrin.h>
+#endif
+#if CARPMATH_X86
+#include <immintrin.h>
+#endif
+
+// Below this many bodies per thread the thread start costs more than it saves.
+static constexpr uint32_t IntegrateMinBodiesPerThread = 1u << 15u;
+
+static void sIntegrateEulerScalar(Vec3 *positions, Vec3 *velocities, const Vec3 *accelerations,
+    uint32_t count, float dt)
+{
+    for(uint32_t i = 0; i < count; ++i)
+    {
+        Vec3 &p = positions[i];
+        Vec3 &v = velocities[i];
+        const Vec3 &a = accelerations[i];
+        v.x += a.x * dt;
+        v.y += a.y * dt;
+        v.z += a.z * dt;
+        p.x += v.x * dt;
+        p.y += v.y * dt;
+        p.z += v.z * dt;
+    }
+}
+
+static void sIntegrateVerletScalar(Vec3 *positions, Vec3 *previousPositions, const Vec3 *accelerations,
+    uint32_t count, float dt, Vec3 *outVelocities)
+{
+    const float sqrDt = dt * dt;
+    const float invDt = 1.0f / dt;
+    for(uint32_t i = 0; i < count; ++i)
+    {
+        const Vec3 p = positions[i];
+        const Vec3 &a = accelerations[i];
+        Vec3 &prev = previousPositions[i];
+        const Vec3 delta(p.x - prev.x + a.x * sqrDt, p.y - prev.y + a.y * sqrDt, p.z - prev.z + a.z * sqrDt);
+        positions[i] = Vec3(p.x + delta.x, p.y + delta.y, p.z + delta.z);
+        prev = p;
+        if(outVelocities)
+            outVelocities[i] = Vec3(delta.x * invDt, delta.y * invDt, delta.z * invDt);
+    }
+}
+
+static void sIntegrateOrientationsScalar(Quat *orientations, const Vec3 *angularVelocities,
+    uint32_t count, float dt)
+{
+    const float halfDt = 0.5f * dt;
+    for(uint32_t i = 0; i < count; ++i)
+    {
+        const Quat &q = orientations[i];
+        const float wx = angularVelocities[i].x * halfDt;
+        const float wy = angularVelocities[i].y * halfDt;
+        const float wz = angularVelocities[i].z * halfDt;
+        const Quat r(
+            q.vx + wx * q.w + wy * q.vz - wz * q.vy,
+            q.vy - wx * q.vz + wy * q.w + wz * q.vx,
+            q.vz + wx * q.vy - wy * q.vx + wz * q.w,
+            q.w - wx * q.vx - wy * q.vy - wz * q.vz);
+        const float invLength = 1.0f / sSqrtF(dot(r, r));
+        orientations[i] = Quat(r.vx * invLength, r.vy * invLength, r.vz * invLength, r.w * invLength);
+    }
+}
+
+#if SIMDHELP_SSE
+
+static void sIntegrateEulerSSE(Vec3 *positions, Vec3 *velocities, const Vec3 *accelerations,
+    uint32_t count, float dt)
+{
+    const __m128 dt4 = _mm_set1_ps(dt);
+    for(uint32_t i = 0; i < count; ++i)
+    {
+        const __m128 v = _mm_add_ps(_mm_load_ps(&velocities[i].x), _mm_mul_ps(_mm_load_ps(&accelerations[i].x), dt4));
+        _mm_store_ps(&velocities[i].x, v);
+        _mm_store_ps(&positions[i].x, _mm_add_ps(_mm_load_ps(&positions[i].x), _mm_mul_ps(v, dt4)));
+    }
+}
+
+static void sIntegrateVerletSSE(Vec3 *positions, Vec3 *previousPositions, const Vec3 *accelerations,
+    uint32_t count, float dt, Vec3 *outVelocities)
+{
+    const __m128 sqrDt = _mm_set1_ps(dt * dt);
+    const __m128 invDt = _mm_set1_ps(1.0f / dt);
+    for(uint32_t i = 0; i < count; ++i)
+    {
+        const __m128 p = _mm_load_ps(&positions[i].x);
+        const __m128 prev = _mm_load_ps(&previousPositions[i].x);
+        const __m128 delta = _mm_add_ps(_mm_sub_ps(p, prev), _mm_mul_ps(_mm_load_ps(&accelerations[i].x), sqrDt));
+        _mm_store_ps(&positions[i].x, _mm_add_ps(p, delta));
+        _mm_store_ps(&previousPositions[i].x, p);
+        if(outVelocities)
+            _mm_store_ps(&outVelocities[i].x, _mm_mul_ps(delta, invDt));
+    }
+}
+
+static void sIntegrateOrientationsSSE(Quat *orientations, const Vec3 *angularVelocities,
+    uint32_t count, float dt)
+{
+    const __m128 halfDt = _mm_set1_ps(0.5f * dt);
+    const __m128 one = _mm_set1_ps(1.0f);
+    uint32_t i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        Quat *out = orientations + i;
+        const Quat4 q = sLoadQuat4(out[0], out[1], out[2], out[3]);
+        __m128 wx;
+        __m128 wy;
+        __m128 wz;
+        sLoadVec3x4(angularVelocities + i, wx, wy, wz);
+        wx = _mm_mul_ps(wx, halfDt);
+        wy = _mm_mul_ps(wy, halfDt);
+        wz = _mm_mul_ps(wz, halfDt);
+
+        Quat4 r;
+        r.x = _mm_add_ps(q.x, _mm_sub_ps(_mm_add_ps(_mm_mul_ps(wx, q.w), _mm_mul_ps(wy, q.z)), _mm_mul_ps(wz, q.y)));
+        r.y = _mm_add_ps(q.y, _mm_add_ps(_mm_sub_ps(_mm_mul_ps(wy, q.w), _mm_mul_ps(wx, q.z)), _mm_mul_ps(wz, q.x)));
+        r.z = _mm_add_ps(q.z, _mm_add_ps(_mm_sub_ps(_mm_mul_ps(wx, q.y), _mm_mul_ps(wy, q.x)), _mm_mul_ps(wz, q.w)));
+        r.w = _mm_sub_ps(q.w, _mm_add_ps(_mm_add_ps(_mm_mul_ps(wx, q.x), _mm_mul_ps(wy, q.y)), _mm_mul_ps(wz, q.z)));
+        const __m128 invLength = _mm_div_ps(one, _mm_sqrt_ps(sDot4(r, r)));
+        r.x = _mm_mul_ps(r.x, invLength);
+        r.y = _mm_mul_ps(r.y, invLength);
+        r.z = _mm_mul_ps(r.z, invLength);
+        r.w = _mm_mul_ps(r.w, invLength);
+        sStoreQuat4(out, r);
+    }
+    sIntegrateOrientationsScalar(orientations + i, angularVelocities + i, count - i, dt);
+}
+
+#endif
+
+#if CARPMATH_X86
+
+// Two bodies per register.
+CARPMATH_TARGET_AVX2 static void sIntegrateEulerAVX2(Vec3 *positions, Vec3 *velocities, const Vec3 *accelerations,
+    uint32_t count, float dt)
+{
+    const __m256 dt8 = _mm256_set1_ps(dt);
+    uint32_t i = 0;
+    for(; i + 2 <= count; i += 2)
+    {
+        const __m256 v = _mm256_fmadd_ps(_mm256_loadu_ps(&accelerations[i].x), dt8, _mm256_loadu_ps(&velocities[i].x));
+        _mm256_storeu_ps(&velocities[i].x, v);
+        _mm256_storeu_ps(&positions[i].x, _mm256_fmadd_ps(v, dt8, _mm256_loadu_ps(&positions[i].x)));
+    }
+    sIntegrateEulerScalar(positions + i, velocities + i, accelerations + i, count - i, dt);
+}
+
+CARPMATH_TARGET_AVX2 static void sIntegrateVerletAVX2(Vec3 *positions, Vec3 *previousPositions, const Vec3 *accelerations,
+    uint32_t count, float dt, Vec3 *outVelocities)
+{
+    const __m256 sqrDt = _mm256_set1_ps(dt * dt);
+    const __m256 invDt = _mm256_set1_ps(1.0f / dt);
+    uint32_t i = 0;
+    for(; i + 2 <= count; i += 2)
+    {
+        const __m256 p = _mm256_loadu_ps(&positions[i].x);
+        const __m256 prev = _mm256_loadu_ps(&previousPositions[i].x);
+        const __m256 delta = _mm256_fmadd_ps(_mm256_loadu_ps(&accelerations[i].x), sqrDt, _mm256_sub_ps(p, prev));
+        _mm256_storeu_ps(&positions[i].x, _mm256_add_ps(p, delta));
+        _mm256_storeu_ps(&previousPositions[i].x, p);
+        if(outVelocities)
+            _mm256_storeu_ps(&outVelocities[i].x, _mm256_mul_ps(delta, invDt));
+    }
+    sIntegrateVerletScalar(positions + i, previousPositions + i, accelerations + i, count - i, dt,
+        outVelocities ? outVelocities + i : nullptr);
+}
+
+CARPMATH_TARGET_AVX2 static void sIntegrateOrientationsAVX2(Quat *orientations, const Vec3 *angularVelocities,
+    uint32_t count, float dt)
+{
+    const __m256 halfDt = _mm256_set1_ps(0.5f * dt);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    uint32_t i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        const Quat8 q = sLoadQuat8(orientations + i);
+        __m256 wx;
+        __m256 wy;
+        __m256 wz;
+        sLoadVec3x8(angularVelocities + i, wx, wy, wz);
+        wx = _mm256_mul_ps(wx, halfDt);
+        wy = _mm256_mul_ps(wy, halfDt);
+        wz = _mm256_mul_ps(wz, halfDt);
+
+        Quat8 r;
+        r.x = _mm256_fmadd_ps(wx, q.w, _mm256_fmsub_ps(wy, q.z, _mm256_fmsub_ps(wz, q.y, q.x)));
+        r.y = _mm256_fmadd_ps(wy, q.w, _mm256_fmsub_ps(wz, q.x, _mm256_fmsub_ps(wx, q.z, q.y)));
+        r.z = _mm256_fmadd_ps(wz, q.w, _mm256_fmsub_ps(wx, q.y, _mm256_fmsub_ps(wy, q.x, q.z)));
+        r.w = _mm256_fnmadd_ps(wx, q.x, _mm256_fnmadd_ps(wy, q.y, _mm256_fnmadd_ps(wz, q.z, q.w)));
+        const __m256 invLength = _mm256_div_ps(one, _mm256_sqrt_ps(sDot8(r, r)));
+        r.x = _mm256_mul_ps(r.x, invLength);
+        r.y = _mm256_mul_ps(r.y, invLength);
+        r.z = _mm256_mul_ps(r.z, invLength);
+        r.w = _mm256_mul_ps(r.w, invLength);
+        sStoreQuat8(orientations + i, r);
+    }
+    sIntegrateOrientationsScalar(orientations + i, angularVelocities + i, count - i, dt);
+}
+
+#endif
+
+void bindIntegrateKernels(SimdKernels &kernels, SimdBackend backend)
+{
+    kernels.integrateEuler = sIntegrateEulerScalar;
+    kernels.integrateVerlet = sIntegrateVerletScalar;
+    kernels.integrateOrientations = sIntegrateOrientationsScalar;
+#if SIMDHELP_SSE
+    if(backend >= SimdBackendSSE4)
+    {
+        kernels.integrateEuler = sIntegrateEulerSSE;
+        kernels.integrateVerlet = sIntegrateVerletSSE;
+        kernels.integrateOrientations = sIntegrateOrientationsSSE;
+    }
+#endif
+#if CARPMATH_X86
+    if(backend >= SimdBackendAVX2)
+    {
+        kernels.integrateEuler = sIntegrateEulerAVX2;
+        kernels.integrateVerlet = sIntegrateVerletAVX2;
+        kernels.integrateOrientations = sIntegrateOrientationsAVX2;
+    }
+#endif
+}
+
+// Calls func(begin, end) for each run of awake bodies. Threads get whole 64 body words so
+// runs never cross threads, neighbouring runs are merged across words.
+template <typename Func>
+static void sForAwakeRanges(uint32_t count, const uint64_t *sleepBits, uint32_t threadCount, const Func &func)
+{
+    const uint32_t wordCount = (count + 63u) / 64u;
+    const uint32_t maxThreads = (count + IntegrateMinBodiesPerThread - 1u) / IntegrateMinBodiesPerThread;
+    const uint32_t threads = getThreadCount(threadCount);
+    parallelFor(wordCount, threads < maxThreads ? threads : maxThreads,
+        [&](uint32_t wordBegin, uint32_t wordEnd, uint32_t)
+    {
+        const uint32_t end = wordEnd * 64u < count ? wordEnd * 64u : count;
+        if(!sleepBits)
+        {
+            func(wordBegin * 64u, end);
+            return;
+        }
+
+        uint32_t runBegin = 0;
+        uint32_t runEnd = 0;
+        for(uint32_t word = wordBegin; word < wordEnd; ++word)
+        {
+            uint64_t awake = ~sleepBits[word];
+            const uint32_t base = word * 64u;
+            if(count - base < 64u)
+                awake &= (uint64_t(1) << (count - base)) - 1u;
+            while(awake)
+            {
+                const uint32_t first = sCountTrailingZeros64(awake);
+                const uint64_t rest = ~(awake >> first);
+                const uint32_t length = rest ? sCountTrailingZeros64(rest) : 64u - first;
+                if(base + first != runEnd)
+                {
+                    if(runEnd > runBegin)
+                        func(runBegin, runEnd);
+                    runBegin = base + first;
+                }
+                runEnd = base + first + length;
+                awake = first + length < 64u ? awake & ~((uint64_t(1) << (first + length)) - 1u) : 0u;
+            }
+        }
+        if(runEnd > runBegin)
+            func(runBegin, runEnd);
+    });
+}
+
+void integrateEuler(Vec3 *positions, Vec3 *velocities, const Vec3 *accelerations, uint32_t count,
+    float dt, const uint64_t *sleepBits, uint32_t threadCount)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdIntegrateEuler, count);
+    const SimdKernels &kernels = getSimdKernels();
+    sForAwakeRanges(count, sleepBits, threadCount, [&](uint32_t begin, uint32_t end)
+    {
+        kernels.integrateEuler(positions + begin, velocities + begin, accelerations + begin, end - begin, dt);
+    });
+}
+
+void integrateVerlet(Vec3 *positions, Vec3 *previousPositions, const Vec3 *accelerations, uint32_t count,
+    float dt, Vec3 *outVelocities, const uint64_t *sleepBits, uint32_t threadCount)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdIntegrateVerlet, count);
+    ASSERT_MATH(dt > 0.0f);
+    const SimdKernels &kernels = getSimdKernels();
+    sForAwakeRanges(count, sleepBits, threadCount, [&](uint32_t begin, uint32_t end)
+    {
+        kernels.integrateVerlet(positions + begin, previousPositions + begin, accelerations + begin, end - begin,
+            dt, outVelocities ? outVelocities + begin : nullptr);
+    });
+}
+
+void integrateOrientations(Quat *orientations, const Vec3 *angularVelocities, uint32_t count,
+    float dt, const uint64_t *sleepBits, uint32_t threadCount)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdIntegrateOrientations, count);
+    const SimdKernels &kernels = getSimdKernels();
+    sForAwakeRanges(count, sleepBits, threadCount, [&](uint32_t begin, uint32_t end)
+    {
+        kernels.integrateOrientations(orientations + begin, angularVelocities + begin, end - begin, dt);
+    });
+}
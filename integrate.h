@@ -0,0 +1,25 @@
+#pragma once
+
+#include "quat.h"
+#include "vec3.h"
+
+#include <stdint.h>
+
+// Batch integration of body state kept in separate arrays per field. Bit i of sleepBits,
+// (count + 63) / 64 words, set means body i is asleep and left untouched, null sleepBits
+// updates all. Awake runs are split over threads, threadCount 0 uses hardware concurrency.
+// Small batches run on the calling thread.
+
+// Semi-implicit Euler, velocity += acceleration * dt then position += velocity * dt.
+void integrateEuler(Vec3 *positions, Vec3 *velocities, const Vec3 *accelerations, uint32_t count,
+    float dt, const uint64_t *sleepBits = nullptr, uint32_t threadCount = 0);
+
+// Position Verlet, next = 2 * position - previous + acceleration * dt^2. previousPositions
+// becomes positions. outVelocities, can be null, gets (next - position) / dt.
+void integrateVerlet(Vec3 *positions, Vec3 *previousPositions, const Vec3 *accelerations, uint32_t count,
+    float dt, Vec3 *outVelocities = nullptr, const uint64_t *sleepBits = nullptr, uint32_t threadCount = 0);
+
+// orientation += 0.5 * dt * Quat(angularVelocity, 0) * orientation, then normalized.
+// Angular velocity is in world space, radians per second.
+void integrateOrientations(Quat *orientations, const Vec3 *angularVelocities, uint32_t count,
+    float dt, const uint64_t *sleepBits = nullptr, uint32_t threadCount = 0);
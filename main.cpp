@@ -1,7 +1,12 @@
+#include "bvh.h"
+#include "dispatch.h"
 #include "mat4.h"
 #include "mathhelp.h"
+#include "projection.h"
 #include "transform.h"
 #include "quat.h"
+#include "ray.h"
+#include "textformat.h"
 #include "vec2.h"
 #include "vec3.h"
 #include "vec4.h"
@@ -53,6 +58,10 @@ void sTestQuat()
     Quat c = a * b;
 
     printf("Q: %f, %f, %f, %f\n", c.vx, c.vy, c.vz, c.w);
+
+    Vec3 dirs[2] = { Vec3(1, 0, 0), Vec3(0, 1, 0) };
+    rotateVectors(dirs, b, 2, dirs);
+    printf("Q-rotated: %f, %f, %f\n", dirs[1].x, dirs[1].y, dirs[1].z);
 }
 
 void sTestMat4()
@@ -61,27 +70,79 @@ void sTestMat4()
     Mat4x4 m2;
     Mat4x4 m3 = m1 * m2;
 
-    printf("\nMat4\n");
-    for(int i = 1; i <= 16; ++i)
+    char text[getMaxTextSize(16, 1)];
+    uint32_t length = formatText(m3, TextFormatJSON, text, sizeof(text));
+    printf("\nMat4\n%.*s\n", int(length), text);
+
+    Transform transform;
+    transform.pos = Vec3(1.0f, 2.0f, 3.0f);
+    transform.rot = getQuatFromAxisAngle(Vec3(0.0f, 1.0f, 0.0f), 0.5f);
+    transform.scale = Vec3(2.0f, 2.0f, -1.0f);
+    Transform decomposed = getTransformFromMatrix(getMat4FromTransform(transform));
+    printf("Decomposed scale: %f, %f, %f\n", decomposed.scale.x, decomposed.scale.y, decomposed.scale.z);
+}
+
+void sTestRay()
+{
+    Ray ray(Vec3(0.0f, 0.0f, -5.0f), Vec3(0.0f, 0.0f, 1.0f));
+
+    AABBPacket4 boxes;
+    for(int i = 0; i < 4; ++i)
     {
-        if((i % 4) == 0)
-        {
-            printf("%f\n", m3[i - 1]);
-        }
-        else
-        {
-            printf("%f, ", m3[i - 1]);
-        }
+        Vec3 offset(float(i) * 0.75f, 0.0f, float(i));
+        setAABB(boxes, i, AABB(offset - 0.5f, offset + 0.5f));
     }
+    float t[4];
+    uint32_t mask = intersectRayAABB(ray, boxes, 100.0f, t);
+
+    printf("\nRay-AABB mask: %x\n", mask);
+    printf("Ray-AABB t0: %f\n", t[0]);
+}
+
+void sTestBVH()
+{
+    AABB bounds[64];
+    for(int i = 0; i < 64; ++i)
+    {
+        Vec3 pos(float(i % 4) * 2.0f, float((i / 4) % 4) * 2.0f, float(i / 16) * 2.0f);
+        bounds[i] = AABB(pos - 0.5f, pos + 0.5f);
+    }
+    BVH bvh;
+    buildBVH(bvh, bounds, 64);
+
+    float t = 0.0f;
+    Ray ray(Vec3(0.0f, 0.0f, -5.0f), Vec3(0.0f, 0.0f, 1.0f));
+    uint32_t hit = raycastBVH(bvh, ray, 100.0f, nullptr, nullptr, t);
+
+    printf("BVH nodes: %u, hit: %u, t: %f\n", bvh.nodeCount, hit, t);
+}
+
+void sTestProjection()
+{
+    Mat4x4 view = createMatrixFromLookAt(Vec3(0.0f, 0.0f, 10.0f), Vec3(0.0f, 0.0f, 0.0f), Vec3(0.0f, 1.0f, 0.0f));
+    Mat4x4 proj = createPerspectiveMatrix(90.0f, 1.0f, 0.1f, 100.0f);
+
+    Vec3 points[2] = { Vec3(0.0f, 0.0f, 0.0f), Vec3(0.0f, 0.0f, 20.0f) };
+    Vec2 pixels[2];
+    uint8_t clipFlags[2];
+    uint32_t visible = projectPointsToScreen(proj * view, Viewport(800.0f, 600.0f), points, 2, pixels, clipFlags);
+
+    printf("Projected visible: %u, pixel: %f, %f, flags: %x\n", visible, pixels[0].x, pixels[0].y, clipFlags[1]);
 }
 
 int main()
 {
+    printf("Simd backend: %s\n", getSimdBackendName(getSimdBackend()));
+
     sTestVec2();
     sTestVec3();
     sTestVec4();
 
     sTestQuat();
     sTestMat4();
+
+    sTestRay();
+    sTestBVH();
+    sTestProjection();
     return 0;
 }
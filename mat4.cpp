@@ -1,12 +1,23 @@
 #include "mat4.h"
 
+#include "dispatch.h"
 #include "mathhelp.h"
+#include "profile.h"
 #include "quat.h"
+#include "simdhelp.h"
 #include "transform.h"
 #include "vec3.h"
 #include "vec4.h"
 
-#include <xmmintrin.h>
+#include <emmintrin.h>
+#if CARPMATH_X86
+#include <immintrin.h>
+#endif
+
+// Rows shorter than this are treated as zero scale when decomposing.
+static constexpr float DecomposeMinScaleSqr = 1.0e-16f;
+// Rows shorter than this make orthonormalization fall back to identity.
+static constexpr float OrthonormalizeMinSqrLength = 1.0e-8f;
 
 Mat4x4::Mat4x4(const Mat3x4 &mat)
     : _00(mat._00), _01(mat._01), _02(mat._02), _03(mat._03)
@@ -93,20 +104,58 @@ Mat4x4 createMatrixFromLookAt(const Vec3 &pos, const Vec3 &target, const Vec3 &u
     return result;
 }
 
+#if (__AVX__ || __SSE__ || __SSE2__ || __SSE3__ || __SSE4_1__ || _M_AMD64 || _M_X64) && 1
+// Movemask bits of |a - b| > epsilon for rowCount rows.
+static int sGetDiffMask(const float *a, const float *b, int rowCount, __m128 epsilon)
+{
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    __m128 diff = _mm_setzero_ps();
+    for(int row = 0; row < rowCount; ++row)
+    {
+        const __m128 d = _mm_andnot_ps(signMask, _mm_sub_ps(_mm_load_ps(a + row * 4), _mm_load_ps(b + row * 4)));
+        diff = _mm_or_ps(diff, _mm_cmpgt_ps(d, epsilon));
+    }
+    return _mm_movemask_ps(diff);
+}
+#endif
+
+bool isEqual(const Mat4x4 &a, const Mat4x4 &b, float epsilon)
+{
+#if (__AVX__ || __SSE__ || __SSE2__ || __SSE3__ || __SSE4_1__ || _M_AMD64 || _M_X64) && 1
+    return sGetDiffMask(&a._00, &b._00, 4, _mm_set1_ps(epsilon)) == 0;
+#else
+    bool equal = true;
+    for(int i = 0; i < 16; ++i)
+        equal &= !(sAbsF(a[i] - b[i]) > epsilon);
+    return equal;
+#endif
+}
+
+bool isEqual(const Mat3x4 &a, const Mat3x4 &b, float epsilon)
+{
+#if (__AVX__ || __SSE__ || __SSE2__ || __SSE3__ || __SSE4_1__ || _M_AMD64 || _M_X64) && 1
+    return sGetDiffMask(&a._00, &b._00, 3, _mm_set1_ps(epsilon)) == 0;
+#else
+    bool equal = true;
+    for(int i = 0; i < 12; ++i)
+        equal &= !(sAbsF(a[i] - b[i]) > epsilon);
+    return equal;
+#endif
+}
+
 bool operator==(const Mat4x4 &a, const Mat4x4 &b)
 {
     static constexpr float EPS_DIFF = 5.0e-2f;
+    return isEqual(a, b, EPS_DIFF);
+}
 
-    for(int i = 0; i < 16; ++i)
-    {
-        float f = sAbsF(a[i] - b[i]);
-        if(f > EPS_DIFF)
-            return false;
-    }
-    return true;
+bool operator==(const Mat3x4 &a, const Mat3x4 &b)
+{
+    static constexpr float EPS_DIFF = 5.0e-2f;
+    return isEqual(a, b, EPS_DIFF);
 }
 
-Mat4x4 inverse(const Mat4x4& m)
+static Mat4x4 sInverseGeneral(const Mat4x4 &m)
 {
     Mat4x4 inv(UninitType{});
     inv[0] = (
@@ -202,6 +251,7 @@ Mat4x4 inverse(const Mat4x4& m)
 
     if (det == 0)
     {
+        PROFILE_MATH_EVENT(ProfileEventInverseSingular);
         return Mat4x4();
     }
     det = 1.0f / det;
@@ -212,22 +262,187 @@ Mat4x4 inverse(const Mat4x4& m)
     return result;
 }
 
+static Mat4x4 sInverseTranslation(const Mat4x4 &m)
+{
+    Mat4x4 result;
+    result._03 = -m._03;
+    result._13 = -m._13;
+    result._23 = -m._23;
+    return result;
+}
 
-bool isIdentity(const Mat4x4 &m)
+static Mat4x4 sInverseRigid(const Mat4x4 &m)
 {
-    static constexpr float EPS_DIFF = 1.0e-4f;
+    Mat4x4 result(UninitType{});
+    result._00 = m._00;
+    result._01 = m._10;
+    result._02 = m._20;
+    result._03 = -(m._00 * m._03 + m._10 * m._13 + m._20 * m._23);
 
-    for(int i = 0; i < 16; ++i)
+    result._10 = m._01;
+    result._11 = m._11;
+    result._12 = m._21;
+    result._13 = -(m._01 * m._03 + m._11 * m._13 + m._21 * m._23);
+
+    result._20 = m._02;
+    result._21 = m._12;
+    result._22 = m._22;
+    result._23 = -(m._02 * m._03 + m._12 * m._13 + m._22 * m._23);
+
+    result._30 = 0.0f;
+    result._31 = 0.0f;
+    result._32 = 0.0f;
+    result._33 = 1.0f;
+    return result;
+}
+
+static Mat4x4 sInverseAffine(const Mat4x4 &m)
+{
+    // Columns of the 3x3 inverse are cross products of the rows.
+    const Vec3 r0(m._00, m._01, m._02);
+    const Vec3 r1(m._10, m._11, m._12);
+    const Vec3 r2(m._20, m._21, m._22);
+    const Vec3 c0 = cross(r1, r2);
+    const Vec3 c1 = cross(r2, r0);
+    const Vec3 c2 = cross(r0, r1);
+    float det = dot(r0, c0);
+    if(det == 0.0f)
     {
-        float f = m[i];
+        PROFILE_MATH_EVENT(ProfileEventInverseSingular);
+        return Mat4x4();
+    }
+    det = 1.0f / det;
 
-        if(i == (i / 4) + (i / 4) * 4)
-            f = f - 1.0f;
+    Mat4x4 result(UninitType{});
+    result._00 = c0.x * det;
+    result._01 = c1.x * det;
+    result._02 = c2.x * det;
+    result._10 = c0.y * det;
+    result._11 = c1.y * det;
+    result._12 = c2.y * det;
+    result._20 = c0.z * det;
+    result._21 = c1.z * det;
+    result._22 = c2.z * det;
+
+    result._03 = -(result._00 * m._03 + result._01 * m._13 + result._02 * m._23);
+    result._13 = -(result._10 * m._03 + result._11 * m._13 + result._12 * m._23);
+    result._23 = -(result._20 * m._03 + result._21 * m._13 + result._22 * m._23);
+
+    result._30 = 0.0f;
+    result._31 = 0.0f;
+    result._32 = 0.0f;
+    result._33 = 1.0f;
+    return result;
+}
 
-        if(sAbsF(f) > EPS_DIFF)
-            return false;
+// x' = a x + b z, y' = c y + d z, z' = e z + f w, w' = g z solved for x, y, z, w.
+static Mat4x4 sInversePerspective(const Mat4x4 &m)
+{
+    const float a = m._00;
+    const float b = m._02;
+    const float c = m._11;
+    const float d = m._12;
+    const float e = m._22;
+    const float f = m._23;
+    const float g = m._32;
+    if(a == 0.0f || c == 0.0f || f == 0.0f || g == 0.0f)
+    {
+        PROFILE_MATH_EVENT(ProfileEventInverseSingular);
+        return Mat4x4();
     }
-    return true;
+    const float invA = 1.0f / a;
+    const float invC = 1.0f / c;
+    const float invF = 1.0f / f;
+    const float invG = 1.0f / g;
+
+    Mat4x4 result(
+        invA, 0.0f, 0.0f, -b * invA * invG,
+        0.0f, invC, 0.0f, -d * invC * invG,
+        0.0f, 0.0f, 0.0f, invG,
+        0.0f, 0.0f, invF, -e * invF * invG);
+    return result;
+}
+
+MatrixKind getMatrixKind(const Mat4x4 &m, float epsilon)
+{
+    if(m._30 == 0.0f && m._31 == 0.0f && m._32 == 0.0f && m._33 == 1.0f)
+    {
+        if(m._00 == 1.0f && m._01 == 0.0f && m._02 == 0.0f
+            && m._10 == 0.0f && m._11 == 1.0f && m._12 == 0.0f
+            && m._20 == 0.0f && m._21 == 0.0f && m._22 == 1.0f)
+        {
+            return m._03 == 0.0f && m._13 == 0.0f && m._23 == 0.0f
+                ? MatrixKindIdentity
+                : MatrixKindTranslation;
+        }
+
+        const float d00 = m._00 * m._00 + m._01 * m._01 + m._02 * m._02;
+        const float d11 = m._10 * m._10 + m._11 * m._11 + m._12 * m._12;
+        const float d22 = m._20 * m._20 + m._21 * m._21 + m._22 * m._22;
+        const float d01 = m._00 * m._10 + m._01 * m._11 + m._02 * m._12;
+        const float d02 = m._00 * m._20 + m._01 * m._21 + m._02 * m._22;
+        const float d12 = m._10 * m._20 + m._11 * m._21 + m._12 * m._22;
+        const float error = sMaxF(sMaxF(sAbsF(d00 - 1.0f), sAbsF(d11 - 1.0f)),
+            sMaxF(sMaxF(sAbsF(d22 - 1.0f), sAbsF(d01)), sMaxF(sAbsF(d02), sAbsF(d12))));
+        return error <= epsilon ? MatrixKindRigid : MatrixKindAffine;
+    }
+
+    if(m._01 == 0.0f && m._03 == 0.0f
+        && m._10 == 0.0f && m._13 == 0.0f
+        && m._20 == 0.0f && m._21 == 0.0f
+        && m._30 == 0.0f && m._31 == 0.0f && m._33 == 0.0f
+        && m._00 != 0.0f && m._11 != 0.0f && m._23 != 0.0f && m._32 != 0.0f)
+    {
+        return MatrixKindPerspective;
+    }
+    return MatrixKindGeneral;
+}
+
+MatrixKind getProductKind(MatrixKind kindA, MatrixKind kindB)
+{
+    if(kindA == MatrixKindIdentity)
+        return kindB;
+    if(kindB == MatrixKindIdentity)
+        return kindA;
+    if(kindA == MatrixKindPerspective || kindB == MatrixKindPerspective)
+        return MatrixKindGeneral;
+    return kindA > kindB ? kindA : kindB;
+}
+
+Mat4x4 inverse(const Mat4x4 &m, MatrixKind kind)
+{
+    PROFILE_MATH_SCOPE(ProfileIdInverseMat4);
+    switch(kind)
+    {
+        case MatrixKindIdentity:
+            return m;
+        case MatrixKindTranslation:
+            return sInverseTranslation(m);
+        case MatrixKindRigid:
+            return sInverseRigid(m);
+        case MatrixKindAffine:
+            return sInverseAffine(m);
+        case MatrixKindPerspective:
+            return sInversePerspective(m);
+        default:
+            return sInverseGeneral(m);
+    }
+}
+
+Mat4x4 inverse(const Mat4x4 &m)
+{
+    return inverse(m, getMatrixKind(m));
+}
+
+
+bool isIdentity(const Mat4x4 &m, float epsilon)
+{
+    return isEqual(m, Mat4x4(), epsilon);
+}
+
+bool isIdentity(const Mat3x4 &m, float epsilon)
+{
+    return isEqual(m, Mat3x4(), epsilon);
 }
 
 Mat3x4 getMatrixFromQuaternion(const Quat &quat)
@@ -361,6 +576,96 @@ Mat3x4 getMat4FromTransform(const Transform &trans)
 
 
 
+// Largest of w, x, y, z comes from the diagonal, the others from off diagonal
+// sums and differences. Written with selects so batch versions do the same per lane.
+Quat getQuatFromMatrix(const Mat3x4 &m)
+{
+    const float tw = 1.0f + m._00 + m._11 + m._22;
+    const float tx = 1.0f + m._00 - m._11 - m._22;
+    const float ty = 1.0f - m._00 + m._11 - m._22;
+    const float tz = 1.0f - m._00 - m._11 + m._22;
+
+    const Quat qw(m._21 - m._12, m._02 - m._20, m._10 - m._01, tw);
+    const Quat qx(tx, m._01 + m._10, m._02 + m._20, m._21 - m._12);
+    const Quat qy(m._01 + m._10, ty, m._12 + m._21, m._02 - m._20);
+    const Quat qz(m._02 + m._20, m._12 + m._21, tz, m._10 - m._01);
+
+    float t = tw;
+    Quat result = qw;
+    result = tx > t ? qx : result;
+    t = tx > t ? tx : t;
+    result = ty > t ? qy : result;
+    t = ty > t ? ty : t;
+    result = tz > t ? qz : result;
+    t = tz > t ? tz : t;
+
+    // Keep w positive so same rotation gives same quaternion.
+    const float s = (result.w < 0.0f ? -0.5f : 0.5f) / sSqrtF(t);
+    return result * s;
+}
+
+Transform getTransformFromMatrix(const Mat3x4 &m)
+{
+    Transform result;
+    result.pos = Vec3(m._03, m._13, m._23);
+
+    Vec3 rows[3] = { Vec3(m._00, m._01, m._02), Vec3(m._10, m._11, m._12), Vec3(m._20, m._21, m._22) };
+    uint32_t degenerateCount = 0;
+    uint32_t degenerateRow = 0;
+    uint32_t validRow = 0;
+    for(uint32_t i = 0; i < 3; ++i)
+    {
+        const float lenSqr = sqrLen(rows[i]);
+        result.scale[i] = sSqrtF(lenSqr);
+        if(lenSqr < DecomposeMinScaleSqr)
+        {
+            ++degenerateCount;
+            degenerateRow = i;
+            continue;
+        }
+        validRow = i;
+        rows[i] = rows[i] * (1.0f / result.scale[i]);
+    }
+
+    // Zero scale rows are rebuilt so that rows stay right handed, row[i + 2] = cross(row[i], row[i + 1]).
+    if(degenerateCount == 3)
+    {
+        result.rot = Quat();
+        return result;
+    }
+    if(degenerateCount == 2)
+    {
+        const Vec3 &v = rows[validRow];
+        const Vec3 axis = sAbsF(v.x) < 0.707f ? Vec3(1.0f, 0.0f, 0.0f) : Vec3(0.0f, 1.0f, 0.0f);
+        const uint32_t b = (validRow + 1) % 3;
+        const uint32_t c = (validRow + 2) % 3;
+        rows[b] = normalize(cross(v, axis));
+        rows[c] = cross(v, rows[b]);
+    }
+    else if(degenerateCount == 1)
+    {
+        const uint32_t a = (degenerateRow + 1) % 3;
+        const uint32_t b = (degenerateRow + 2) % 3;
+        rows[degenerateRow] = normalize(cross(rows[a], rows[b]));
+    }
+    else if(dot(rows[0], cross(rows[1], rows[2])) < 0.0f)
+    {
+        // Mirrored, flip x axis so rotation part stays a rotation.
+        result.scale.x = -result.scale.x;
+        rows[0] = -rows[0];
+    }
+
+    const Mat3x4 rotation(
+        rows[0].x, rows[0].y, rows[0].z, 0.0f,
+        rows[1].x, rows[1].y, rows[1].z, 0.0f,
+        rows[2].x, rows[2].y, rows[2].z, 0.0f);
+    result.rot = normalize(getQuatFromMatrix(rotation));
+    return result;
+}
+
+
+
+
 Mat4x4 transpose(const Mat4x4 &m)
 {
     Mat4x4 result{ UninitType{} };
@@ -592,3 +897,1269 @@ Mat3x4 operator*(const Mat3x4 &a, const Mat3x4 &b)
     return result;
 }
 
+
+
+Mat4x4 multiply(const Mat4x4 &a, MatrixKind kindA, const Mat4x4 &b, MatrixKind kindB)
+{
+    if(kindA == MatrixKindIdentity)
+        return b;
+    if(kindB == MatrixKindIdentity)
+        return a;
+    if(kindA == MatrixKindTranslation && kindB <= MatrixKindAffine)
+    {
+        Mat4x4 result = b;
+        result._03 += a._03;
+        result._13 += a._13;
+        result._23 += a._23;
+        return result;
+    }
+    if(kindB == MatrixKindTranslation && kindA <= MatrixKindAffine)
+    {
+        Mat4x4 result = a;
+        result._03 += a._00 * b._03 + a._01 * b._13 + a._02 * b._23;
+        result._13 += a._10 * b._03 + a._11 * b._13 + a._12 * b._23;
+        result._23 += a._20 * b._03 + a._21 * b._13 + a._22 * b._23;
+        return result;
+    }
+    if(kindA <= MatrixKindAffine && kindB <= MatrixKindAffine)
+        return Mat4x4(Mat3x4(a) * Mat3x4(b));
+    return a * b;
+}
+
+Mat4x4 operator*(const Mat4x4 &a, const Mat3x4 &b)
+{
+    Mat4x4 result{ UninitType{} };
+
+#if (__AVX__ || __SSE__ || __SSE2__ || __SSE3__ || __SSE4_1__ || _M_AMD64 || _M_X64) && 1
+
+    // b row 3 is implicit 0, 0, 0, 1 so a._r3 only ends up in w.
+    const __m128 wMask = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+
+    const __m128 bR0 = _mm_load_ps(&b._00);
+    const __m128 bR1 = _mm_load_ps(&b._10);
+    const __m128 bR2 = _mm_load_ps(&b._20);
+
+    const float *aRows[4] = { &a._00, &a._10, &a._20, &a._30 };
+    float *resultRows[4] = { &result._00, &result._10, &result._20, &result._30 };
+    for(int row = 0; row < 4; ++row)
+    {
+        const __m128 aRow = _mm_load_ps(aRows[row]);
+        const __m128 r0 = _mm_mul_ps(_mm_shuffle_ps(aRow, aRow, _MM_SHUFFLE(0, 0, 0, 0)), bR0);
+        const __m128 r1 = _mm_mul_ps(_mm_shuffle_ps(aRow, aRow, _MM_SHUFFLE(1, 1, 1, 1)), bR1);
+        const __m128 r2 = _mm_mul_ps(_mm_shuffle_ps(aRow, aRow, _MM_SHUFFLE(2, 2, 2, 2)), bR2);
+        const __m128 r3 = _mm_and_ps(aRow, wMask);
+        _mm_store_ps(resultRows[row], _mm_add_ps(_mm_add_ps(r0, r1), _mm_add_ps(r2, r3)));
+    }
+
+#else
+
+    #define MATRIX_ADD_ROW_MULT0(row, col) (\
+        a._##row##0 * b._0##col + \
+        a._##row##1 * b._1##col + \
+        a._##row##2 * b._2##col)
+    #define MATRIX_ADD_ROW_MULT1(row, col) (\
+        a._##row##0 * b._0##col + \
+        a._##row##1 * b._1##col + \
+        a._##row##2 * b._2##col + \
+        a._##row##3)
+
+    #define MATRIX_SET0(row, col) (result._##row##col)  = MATRIX_ADD_ROW_MULT0(row, col)
+    #define MATRIX_SET1(row, col) (result._##row##col)  = MATRIX_ADD_ROW_MULT1(row, col)
+
+    MATRIX_SET0(0, 0);
+    MATRIX_SET0(0, 1);
+    MATRIX_SET0(0, 2);
+    MATRIX_SET1(0, 3);
+
+    MATRIX_SET0(1, 0);
+    MATRIX_SET0(1, 1);
+    MATRIX_SET0(1, 2);
+    MATRIX_SET1(1, 3);
+
+    MATRIX_SET0(2, 0);
+    MATRIX_SET0(2, 1);
+    MATRIX_SET0(2, 2);
+    MATRIX_SET1(2, 3);
+
+    MATRIX_SET0(3, 0);
+    MATRIX_SET0(3, 1);
+    MATRIX_SET0(3, 2);
+    MATRIX_SET1(3, 3);
+
+    #undef MATRIX_ADD_ROW_MULT0
+    #undef MATRIX_ADD_ROW_MULT1
+    #undef MATRIX_SET0
+    #undef MATRIX_SET1
+
+#endif
+    return result;
+}
+
+Mat4x4 operator*(const Mat3x4 &a, const Mat4x4 &b)
+{
+    Mat4x4 result{ UninitType{} };
+
+#if (__AVX__ || __SSE__ || __SSE2__ || __SSE3__ || __SSE4_1__ || _M_AMD64 || _M_X64) && 1
+
+    const __m128 bR0 = _mm_load_ps(&b._00);
+    const __m128 bR1 = _mm_load_ps(&b._10);
+    const __m128 bR2 = _mm_load_ps(&b._20);
+    const __m128 bR3 = _mm_load_ps(&b._30);
+
+    const float *aRows[3] = { &a._00, &a._10, &a._20 };
+    float *resultRows[3] = { &result._00, &result._10, &result._20 };
+    for(int row = 0; row < 3; ++row)
+    {
+        const __m128 aRow = _mm_load_ps(aRows[row]);
+        const __m128 r0 = _mm_mul_ps(_mm_shuffle_ps(aRow, aRow, _MM_SHUFFLE(0, 0, 0, 0)), bR0);
+        const __m128 r1 = _mm_mul_ps(_mm_shuffle_ps(aRow, aRow, _MM_SHUFFLE(1, 1, 1, 1)), bR1);
+        const __m128 r2 = _mm_mul_ps(_mm_shuffle_ps(aRow, aRow, _MM_SHUFFLE(2, 2, 2, 2)), bR2);
+        const __m128 r3 = _mm_mul_ps(_mm_shuffle_ps(aRow, aRow, _MM_SHUFFLE(3, 3, 3, 3)), bR3);
+        _mm_store_ps(resultRows[row], _mm_add_ps(_mm_add_ps(r0, r1), _mm_add_ps(r2, r3)));
+    }
+    // a row 3 is implicit 0, 0, 0, 1 which picks b row 3.
+    _mm_store_ps(&result._30, bR3);
+
+#else
+
+    #define MATRIX_ADD_ROW_MULT(row, col) (\
+        a._##row##0 * b._0##col + \
+        a._##row##1 * b._1##col + \
+        a._##row##2 * b._2##col + \
+        a._##row##3 * b._3##col)
+    #define MATRIX_SET(row, col) (result._##row##col)  = MATRIX_ADD_ROW_MULT(row, col)
+
+    MATRIX_SET(0, 0);
+    MATRIX_SET(0, 1);
+    MATRIX_SET(0, 2);
+    MATRIX_SET(0, 3);
+
+    MATRIX_SET(1, 0);
+    MATRIX_SET(1, 1);
+    MATRIX_SET(1, 2);
+    MATRIX_SET(1, 3);
+
+    MATRIX_SET(2, 0);
+    MATRIX_SET(2, 1);
+    MATRIX_SET(2, 2);
+    MATRIX_SET(2, 3);
+
+    result._30 = b._30;
+    result._31 = b._31;
+    result._32 = b._32;
+    result._33 = b._33;
+
+    #undef MATRIX_ADD_ROW_MULT
+    #undef MATRIX_SET
+
+#endif
+    return result;
+}
+
+static void sMultiplyMatricesScalar(const Mat4x4 &a, const Mat3x4 *b, uint32_t count, Mat4x4 *outResults)
+{
+    for(uint32_t i = 0; i < count; ++i)
+    {
+        const Mat3x4 &m = b[i];
+        Mat4x4 &result = outResults[i];
+        for(int row = 0; row < 4; ++row)
+        {
+            const float a0 = a[row * 4 + 0];
+            const float a1 = a[row * 4 + 1];
+            const float a2 = a[row * 4 + 2];
+            const float a3 = a[row * 4 + 3];
+            result[row * 4 + 0] = a0 * m._00 + a1 * m._10 + a2 * m._20;
+            result[row * 4 + 1] = a0 * m._01 + a1 * m._11 + a2 * m._21;
+            result[row * 4 + 2] = a0 * m._02 + a1 * m._12 + a2 * m._22;
+            result[row * 4 + 3] = a0 * m._03 + a1 * m._13 + a2 * m._23 + a3;
+        }
+    }
+}
+
+static Mat4x4 sMultiplyScalar(const Mat4x4 &a, const Mat4x4 &b)
+{
+    Mat4x4 result{ UninitType{} };
+    for(int row = 0; row < 4; ++row)
+    {
+        for(int col = 0; col < 4; ++col)
+        {
+            result[row * 4 + col] =
+                a[row * 4 + 0] * b[0 * 4 + col] +
+                a[row * 4 + 1] * b[1 * 4 + col] +
+                a[row * 4 + 2] * b[2 * 4 + col] +
+                a[row * 4 + 3] * b[3 * 4 + col];
+        }
+    }
+    return result;
+}
+
+static Mat3x4 sMultiplyScalar(const Mat3x4 &a, const Mat3x4 &b)
+{
+    Mat3x4 result{ UninitType{} };
+    for(int row = 0; row < 3; ++row)
+    {
+        for(int col = 0; col < 4; ++col)
+        {
+            result[row * 4 + col] =
+                a[row * 4 + 0] * b[0 * 4 + col] +
+                a[row * 4 + 1] * b[1 * 4 + col] +
+                a[row * 4 + 2] * b[2 * 4 + col] +
+                (col == 3 ? a[row * 4 + 3] : 0.0f);
+        }
+    }
+    return result;
+}
+
+// Results go through a temporary so outResults can alias the inputs.
+static void sMultiplyMat4PairsScalar(const Mat4x4 *a, const Mat4x4 *b, uint32_t count, Mat4x4 *outResults)
+{
+    for(uint32_t i = 0; i < count; ++i)
+        outResults[i] = sMultiplyScalar(a[i], b[i]);
+}
+
+static void sMultiplyMat4Scalar(const Mat4x4 &a, const Mat4x4 *b, uint32_t count, Mat4x4 *outResults)
+{
+    for(uint32_t i = 0; i < count; ++i)
+        outResults[i] = sMultiplyScalar(a, b[i]);
+}
+
+static void sMultiplyMat3x4PairsScalar(const Mat3x4 *a, const Mat3x4 *b, uint32_t count, Mat3x4 *outResults)
+{
+    for(uint32_t i = 0; i < count; ++i)
+        outResults[i] = sMultiplyScalar(a[i], b[i]);
+}
+
+static void sMultiplyMat3x4Scalar(const Mat3x4 &a, const Mat3x4 *b, uint32_t count, Mat3x4 *outResults)
+{
+    for(uint32_t i = 0; i < count; ++i)
+        outResults[i] = sMultiplyScalar(a, b[i]);
+}
+
+#if (__AVX__ || __SSE__ || __SSE2__ || __SSE3__ || __SSE4_1__ || _M_AMD64 || _M_X64) && 1
+
+static void sMultiplyMatricesSSE(const Mat4x4 &a, const Mat3x4 *b, uint32_t count, Mat4x4 *outResults)
+{
+    // a is the same for every product, so broadcasts are done once.
+    const __m128 wMask = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+    __m128 aSplat[4][3];
+    __m128 aW[4];
+    const float *aRows[4] = { &a._00, &a._10, &a._20, &a._30 };
+    for(int row = 0; row < 4; ++row)
+    {
+        const __m128 aRow = _mm_load_ps(aRows[row]);
+        aSplat[row][0] = _mm_shuffle_ps(aRow, aRow, _MM_SHUFFLE(0, 0, 0, 0));
+        aSplat[row][1] = _mm_shuffle_ps(aRow, aRow, _MM_SHUFFLE(1, 1, 1, 1));
+        aSplat[row][2] = _mm_shuffle_ps(aRow, aRow, _MM_SHUFFLE(2, 2, 2, 2));
+        aW[row] = _mm_and_ps(aRow, wMask);
+    }
+
+    for(uint32_t i = 0; i < count; ++i)
+    {
+        const __m128 bR0 = _mm_load_ps(&b[i]._00);
+        const __m128 bR1 = _mm_load_ps(&b[i]._10);
+        const __m128 bR2 = _mm_load_ps(&b[i]._20);
+        float *resultRows[4] = { &outResults[i]._00, &outResults[i]._10, &outResults[i]._20, &outResults[i]._30 };
+        for(int row = 0; row < 4; ++row)
+        {
+            const __m128 r01 = _mm_add_ps(_mm_mul_ps(aSplat[row][0], bR0), _mm_mul_ps(aSplat[row][1], bR1));
+            const __m128 r23 = _mm_add_ps(_mm_mul_ps(aSplat[row][2], bR2), aW[row]);
+            _mm_store_ps(resultRows[row], _mm_add_ps(r01, r23));
+        }
+    }
+}
+
+// The single product operators are already SSE.
+static void sMultiplyMat4PairsSSE(const Mat4x4 *a, const Mat4x4 *b, uint32_t count, Mat4x4 *outResults)
+{
+    for(uint32_t i = 0; i < count; ++i)
+        outResults[i] = a[i] * b[i];
+}
+
+static void sMultiplyMat4SSE(const Mat4x4 &a, const Mat4x4 *b, uint32_t count, Mat4x4 *outResults)
+{
+    for(uint32_t i = 0; i < count; ++i)
+        outResults[i] = a * b[i];
+}
+
+static void sMultiplyMat3x4PairsSSE(const Mat3x4 *a, const Mat3x4 *b, uint32_t count, Mat3x4 *outResults)
+{
+    for(uint32_t i = 0; i < count; ++i)
+        outResults[i] = a[i] * b[i];
+}
+
+static void sMultiplyMat3x4SSE(const Mat3x4 &a, const Mat3x4 *b, uint32_t count, Mat3x4 *outResults)
+{
+    for(uint32_t i = 0; i < count; ++i)
+        outResults[i] = a * b[i];
+}
+
+#endif
+
+#if CARPMATH_X86
+
+CARPMATH_TARGET_AVX2 static __m256 sCombine(__m128 low, __m128 high)
+{
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(low), high, 1);
+}
+
+CARPMATH_TARGET_AVX2 static __m256 sBroadcastRow(const float *row)
+{
+    return _mm256_broadcast_ps((const __m128 *)row);
+}
+
+CARPMATH_TARGET_AVX2 static void sMultiplyMatricesAVX2(
+    const Mat4x4 &a, const Mat3x4 *b, uint32_t count, Mat4x4 *outResults)
+{
+    // Two result rows per register, rows 0 and 1 in first, rows 2 and 3 in second.
+    const __m128 wMask = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+    const __m128 aR0 = _mm_load_ps(&a._00);
+    const __m128 aR1 = _mm_load_ps(&a._10);
+    const __m128 aR2 = _mm_load_ps(&a._20);
+    const __m128 aR3 = _mm_load_ps(&a._30);
+
+    __m256 a01[3];
+    __m256 a23[3];
+    a01[0] = sCombine(_mm_shuffle_ps(aR0, aR0, _MM_SHUFFLE(0, 0, 0, 0)), _mm_shuffle_ps(aR1, aR1, _MM_SHUFFLE(0, 0, 0, 0)));
+    a01[1] = sCombine(_mm_shuffle_ps(aR0, aR0, _MM_SHUFFLE(1, 1, 1, 1)), _mm_shuffle_ps(aR1, aR1, _MM_SHUFFLE(1, 1, 1, 1)));
+    a01[2] = sCombine(_mm_shuffle_ps(aR0, aR0, _MM_SHUFFLE(2, 2, 2, 2)), _mm_shuffle_ps(aR1, aR1, _MM_SHUFFLE(2, 2, 2, 2)));
+    a23[0] = sCombine(_mm_shuffle_ps(aR2, aR2, _MM_SHUFFLE(0, 0, 0, 0)), _mm_shuffle_ps(aR3, aR3, _MM_SHUFFLE(0, 0, 0, 0)));
+    a23[1] = sCombine(_mm_shuffle_ps(aR2, aR2, _MM_SHUFFLE(1, 1, 1, 1)), _mm_shuffle_ps(aR3, aR3, _MM_SHUFFLE(1, 1, 1, 1)));
+    a23[2] = sCombine(_mm_shuffle_ps(aR2, aR2, _MM_SHUFFLE(2, 2, 2, 2)), _mm_shuffle_ps(aR3, aR3, _MM_SHUFFLE(2, 2, 2, 2)));
+    const __m256 aW01 = sCombine(_mm_and_ps(aR0, wMask), _mm_and_ps(aR1, wMask));
+    const __m256 aW23 = sCombine(_mm_and_ps(aR2, wMask), _mm_and_ps(aR3, wMask));
+
+    for(uint32_t i = 0; i < count; ++i)
+    {
+        const __m256 bR0 = sBroadcastRow(&b[i]._00);
+        const __m256 bR1 = sBroadcastRow(&b[i]._10);
+        const __m256 bR2 = sBroadcastRow(&b[i]._20);
+        const __m256 r01 = _mm256_fmadd_ps(a01[0], bR0, _mm256_fmadd_ps(a01[1], bR1, _mm256_fmadd_ps(a01[2], bR2, aW01)));
+        const __m256 r23 = _mm256_fmadd_ps(a23[0], bR0, _mm256_fmadd_ps(a23[1], bR1, _mm256_fmadd_ps(a23[2], bR2, aW23)));
+        _mm256_storeu_ps(&outResults[i]._00, r01);
+        _mm256_storeu_ps(&outResults[i]._20, r23);
+    }
+}
+
+// Two rows of a in register, a row element k splatted within each 128 bit lane
+// times row k of b broadcast to both lanes.
+CARPMATH_TARGET_AVX2 static __m256 sMultiplyRows4(__m256 aRows, __m256 bR0, __m256 bR1, __m256 bR2, __m256 bR3)
+{
+    __m256 result = _mm256_mul_ps(_mm256_permute_ps(aRows, _MM_SHUFFLE(0, 0, 0, 0)), bR0);
+    result = _mm256_fmadd_ps(_mm256_permute_ps(aRows, _MM_SHUFFLE(1, 1, 1, 1)), bR1, result);
+    result = _mm256_fmadd_ps(_mm256_permute_ps(aRows, _MM_SHUFFLE(2, 2, 2, 2)), bR2, result);
+    return _mm256_fmadd_ps(_mm256_permute_ps(aRows, _MM_SHUFFLE(3, 3, 3, 3)), bR3, result);
+}
+
+// Same for Mat3x4, last row of b is implicit 0, 0, 0, 1 so a w is added as is.
+CARPMATH_TARGET_AVX2 static __m256 sMultiplyRows3(__m256 aRows, __m256 bR0, __m256 bR1, __m256 bR2)
+{
+    const __m256 wMask = _mm256_castsi256_ps(_mm256_set_epi32(-1, 0, 0, 0, -1, 0, 0, 0));
+    __m256 result = _mm256_fmadd_ps(_mm256_permute_ps(aRows, _MM_SHUFFLE(0, 0, 0, 0)), bR0, _mm256_and_ps(aRows, wMask));
+    result = _mm256_fmadd_ps(_mm256_permute_ps(aRows, _MM_SHUFFLE(1, 1, 1, 1)), bR1, result);
+    return _mm256_fmadd_ps(_mm256_permute_ps(aRows, _MM_SHUFFLE(2, 2, 2, 2)), bR2, result);
+}
+
+CARPMATH_TARGET_AVX2 static void sMultiplyMat4PairsAVX2(
+    const Mat4x4 *a, const Mat4x4 *b, uint32_t count, Mat4x4 *outResults)
+{
+    for(uint32_t i = 0; i < count; ++i)
+    {
+        const __m256 a01 = _mm256_loadu_ps(&a[i]._00);
+        const __m256 a23 = _mm256_loadu_ps(&a[i]._20);
+        const __m256 bR0 = sBroadcastRow(&b[i]._00);
+        const __m256 bR1 = sBroadcastRow(&b[i]._10);
+        const __m256 bR2 = sBroadcastRow(&b[i]._20);
+        const __m256 bR3 = sBroadcastRow(&b[i]._30);
+        const __m256 r01 = sMultiplyRows4(a01, bR0, bR1, bR2, bR3);
+        const __m256 r23 = sMultiplyRows4(a23, bR0, bR1, bR2, bR3);
+        _mm256_storeu_ps(&outResults[i]._00, r01);
+        _mm256_storeu_ps(&outResults[i]._20, r23);
+    }
+}
+
+CARPMATH_TARGET_AVX2 static void sMultiplyMat4AVX2(
+    const Mat4x4 &a, const Mat4x4 *b, uint32_t count, Mat4x4 *outResults)
+{
+    const __m256 a01 = _mm256_loadu_ps(&a._00);
+    const __m256 a23 = _mm256_loadu_ps(&a._20);
+    __m256 aSplat01[4];
+    __m256 aSplat23[4];
+    aSplat01[0] = _mm256_permute_ps(a01, _MM_SHUFFLE(0, 0, 0, 0));
+    aSplat01[1] = _mm256_permute_ps(a01, _MM_SHUFFLE(1, 1, 1, 1));
+    aSplat01[2] = _mm256_permute_ps(a01, _MM_SHUFFLE(2, 2, 2, 2));
+    aSplat01[3] = _mm256_permute_ps(a01, _MM_SHUFFLE(3, 3, 3, 3));
+    aSplat23[0] = _mm256_permute_ps(a23, _MM_SHUFFLE(0, 0, 0, 0));
+    aSplat23[1] = _mm256_permute_ps(a23, _MM_SHUFFLE(1, 1, 1, 1));
+    aSplat23[2] = _mm256_permute_ps(a23, _MM_SHUFFLE(2, 2, 2, 2));
+    aSplat23[3] = _mm256_permute_ps(a23, _MM_SHUFFLE(3, 3, 3, 3));
+
+    for(uint32_t i = 0; i < count; ++i)
+    {
+        const __m256 bR0 = sBroadcastRow(&b[i]._00);
+        const __m256 bR1 = sBroadcastRow(&b[i]._10);
+        const __m256 bR2 = sBroadcastRow(&b[i]._20);
+        const __m256 bR3 = sBroadcastRow(&b[i]._30);
+        __m256 r01 = _mm256_mul_ps(aSplat01[0], bR0);
+        __m256 r23 = _mm256_mul_ps(aSplat23[0], bR0);
+        r01 = _mm256_fmadd_ps(aSplat01[1], bR1, r01);
+        r23 = _mm256_fmadd_ps(aSplat23[1], bR1, r23);
+        r01 = _mm256_fmadd_ps(aSplat01[2], bR2, r01);
+        r23 = _mm256_fmadd_ps(aSplat23[2], bR2, r23);
+        r01 = _mm256_fmadd_ps(aSplat01[3], bR3, r01);
+        r23 = _mm256_fmadd_ps(aSplat23[3], bR3, r23);
+        _mm256_storeu_ps(&outResults[i]._00, r01);
+        _mm256_storeu_ps(&outResults[i]._20, r23);
+    }
+}
+
+// Two Mat3x4 are 24 floats, three registers. Middle register has
+// last row of first matrix and first row of second matrix.
+CARPMATH_TARGET_AVX2 static void sMultiplyMat3x4PairsAVX2(
+    const Mat3x4 *a, const Mat3x4 *b, uint32_t count, Mat3x4 *outResults)
+{
+    uint32_t i = 0;
+    for(; i + 2 <= count; i += 2)
+    {
+        const Mat3x4 &b0 = b[i + 0];
+        const Mat3x4 &b1 = b[i + 1];
+        const __m256 a0 = _mm256_loadu_ps(&a[i]._00);
+        const __m256 a1 = _mm256_loadu_ps(&a[i]._20);
+        const __m256 a2 = _mm256_loadu_ps(&a[i + 1]._10);
+
+        const __m256 r0 = sMultiplyRows3(a0, sBroadcastRow(&b0._00), sBroadcastRow(&b0._10), sBroadcastRow(&b0._20));
+        const __m256 r1 = sMultiplyRows3(a1,
+            sCombine(_mm_load_ps(&b0._00), _mm_load_ps(&b1._00)),
+            sCombine(_mm_load_ps(&b0._10), _mm_load_ps(&b1._10)),
+            sCombine(_mm_load_ps(&b0._20), _mm_load_ps(&b1._20)));
+        const __m256 r2 = sMultiplyRows3(a2, sBroadcastRow(&b1._00), sBroadcastRow(&b1._10), sBroadcastRow(&b1._20));
+
+        _mm256_storeu_ps(&outResults[i]._00, r0);
+        _mm256_storeu_ps(&outResults[i]._20, r1);
+        _mm256_storeu_ps(&outResults[i + 1]._10, r2);
+    }
+    for(; i < count; ++i)
+        outResults[i] = a[i] * b[i];
+}
+
+CARPMATH_TARGET_AVX2 static void sMultiplyMat3x4AVX2(
+    const Mat3x4 &a, const Mat3x4 *b, uint32_t count, Mat3x4 *outResults)
+{
+    // Rows of a in the order they appear in registers for two consecutive results.
+    const __m128 aR0 = _mm_load_ps(&a._00);
+    const __m128 aR1 = _mm_load_ps(&a._10);
+    const __m128 aR2 = _mm_load_ps(&a._20);
+    const __m256 aRows[3] = { sCombine(aR0, aR1), sCombine(aR2, aR0), sCombine(aR1, aR2) };
+    const __m256 wMask = _mm256_castsi256_ps(_mm256_set_epi32(-1, 0, 0, 0, -1, 0, 0, 0));
+    __m256 aSplat[3][3];
+    __m256 aW[3];
+    for(int reg = 0; reg < 3; ++reg)
+    {
+        aSplat[reg][0] = _mm256_permute_ps(aRows[reg], _MM_SHUFFLE(0, 0, 0, 0));
+        aSplat[reg][1] = _mm256_permute_ps(aRows[reg], _MM_SHUFFLE(1, 1, 1, 1));
+        aSplat[reg][2] = _mm256_permute_ps(aRows[reg], _MM_SHUFFLE(2, 2, 2, 2));
+        aW[reg] = _mm256_and_ps(aRows[reg], wMask);
+    }
+
+    uint32_t i = 0;
+    for(; i + 2 <= count; i += 2)
+    {
+        const Mat3x4 &b0 = b[i + 0];
+        const Mat3x4 &b1 = b[i + 1];
+        const __m128 b0R0 = _mm_load_ps(&b0._00);
+        const __m128 b0R1 = _mm_load_ps(&b0._10);
+        const __m128 b0R2 = _mm_load_ps(&b0._20);
+        const __m128 b1R0 = _mm_load_ps(&b1._00);
+        const __m128 b1R1 = _mm_load_ps(&b1._10);
+        const __m128 b1R2 = _mm_load_ps(&b1._20);
+
+        __m256 r0 = _mm256_fmadd_ps(aSplat[0][0], sCombine(b0R0, b0R0), aW[0]);
+        __m256 r1 = _mm256_fmadd_ps(aSplat[1][0], sCombine(b0R0, b1R0), aW[1]);
+        __m256 r2 = _mm256_fmadd_ps(aSplat[2][0], sCombine(b1R0, b1R0), aW[2]);
+        r0 = _mm256_fmadd_ps(aSplat[0][1], sCombine(b0R1, b0R1), r0);
+        r1 = _mm256_fmadd_ps(aSplat[1][1], sCombine(b0R1, b1R1), r1);
+        r2 = _mm256_fmadd_ps(aSplat[2][1], sCombine(b1R1, b1R1), r2);
+        r0 = _mm256_fmadd_ps(aSplat[0][2], sCombine(b0R2, b0R2), r0);
+        r1 = _mm256_fmadd_ps(aSplat[1][2], sCombine(b0R2, b1R2), r1);
+        r2 = _mm256_fmadd_ps(aSplat[2][2], sCombine(b1R2, b1R2), r2);
+
+        _mm256_storeu_ps(&outResults[i]._00, r0);
+        _mm256_storeu_ps(&outResults[i]._20, r1);
+        _mm256_storeu_ps(&outResults[i + 1]._10, r2);
+    }
+    for(; i < count; ++i)
+        outResults[i] = a * b[i];
+}
+
+CARPMATH_TARGET_AVX512 static void sMultiplyMatricesAVX512(
+    const Mat4x4 &a, const Mat3x4 *b, uint32_t count, Mat4x4 *outResults)
+{
+    // Whole result matrix in one register, each 128 bit lane is one row.
+    const __m512 aRows = _mm512_loadu_ps(&a._00);
+    const __m512 aSplat0 = _mm512_permute_ps(aRows, _MM_SHUFFLE(0, 0, 0, 0));
+    const __m512 aSplat1 = _mm512_permute_ps(aRows, _MM_SHUFFLE(1, 1, 1, 1));
+    const __m512 aSplat2 = _mm512_permute_ps(aRows, _MM_SHUFFLE(2, 2, 2, 2));
+    const __m512 aW = _mm512_maskz_mov_ps(__mmask16(0x8888), aRows);
+
+    for(uint32_t i = 0; i < count; ++i)
+    {
+        const __m512 bR0 = _mm512_broadcast_f32x4(_mm_load_ps(&b[i]._00));
+        const __m512 bR1 = _mm512_broadcast_f32x4(_mm_load_ps(&b[i]._10));
+        const __m512 bR2 = _mm512_broadcast_f32x4(_mm_load_ps(&b[i]._20));
+        const __m512 result = _mm512_fmadd_ps(aSplat0, bR0, _mm512_fmadd_ps(aSplat1, bR1, _mm512_fmadd_ps(aSplat2, bR2, aW)));
+        _mm512_storeu_ps(&outResults[i]._00, result);
+    }
+}
+
+#endif
+
+static void sGetTransformsFromMatricesScalar(const Mat3x4 *matrices, uint32_t count, Transform *outTransforms)
+{
+    for(uint32_t i = 0; i < count; ++i)
+        outTransforms[i] = getTransformFromMatrix(matrices[i]);
+}
+
+#if (__AVX__ || __SSE__ || __SSE2__ || __SSE3__ || __SSE4_1__ || _M_AMD64 || _M_X64) && 1
+
+static void sNormalizeRow4(const __m128 *row, __m128 *outRow, __m128 &outLen, __m128 &degenerate)
+{
+    const __m128 lenSqr = _mm_add_ps(_mm_add_ps(_mm_mul_ps(row[0], row[0]), _mm_mul_ps(row[1], row[1])),
+        _mm_mul_ps(row[2], row[2]));
+    degenerate = _mm_or_ps(degenerate, _mm_cmplt_ps(lenSqr, _mm_set1_ps(DecomposeMinScaleSqr)));
+    outLen = _mm_sqrt_ps(lenSqr);
+    const __m128 invLen = _mm_div_ps(_mm_set1_ps(1.0f), outLen);
+    outRow[0] = _mm_mul_ps(row[0], invLen);
+    outRow[1] = _mm_mul_ps(row[1], invLen);
+    outRow[2] = _mm_mul_ps(row[2], invLen);
+}
+
+// m is 12 matrix elements for 4 matrices in SoA. Returns lanes which had zero
+// scale row, those go through scalar path.
+static int sDecompose4(const __m128 *m, __m128 *outRot, __m128 *outScale)
+{
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    const __m128 one = _mm_set1_ps(1.0f);
+    __m128 degenerate = _mm_setzero_ps();
+    __m128 r[9];
+    sNormalizeRow4(m + 0, r + 0, outScale[0], degenerate);
+    sNormalizeRow4(m + 4, r + 3, outScale[1], degenerate);
+    sNormalizeRow4(m + 8, r + 6, outScale[2], degenerate);
+
+    // Mirrored matrices flip x axis.
+    const __m128 c0 = _mm_sub_ps(_mm_mul_ps(r[4], r[8]), _mm_mul_ps(r[5], r[7]));
+    const __m128 c1 = _mm_sub_ps(_mm_mul_ps(r[5], r[6]), _mm_mul_ps(r[3], r[8]));
+    const __m128 c2 = _mm_sub_ps(_mm_mul_ps(r[3], r[7]), _mm_mul_ps(r[4], r[6]));
+    const __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r[0], c0), _mm_mul_ps(r[1], c1)), _mm_mul_ps(r[2], c2));
+    const __m128 flip = _mm_and_ps(det, signMask);
+    outScale[0] = _mm_xor_ps(outScale[0], flip);
+    r[0] = _mm_xor_ps(r[0], flip);
+    r[1] = _mm_xor_ps(r[1], flip);
+    r[2] = _mm_xor_ps(r[2], flip);
+
+    const __m128 tw = _mm_add_ps(_mm_add_ps(one, r[0]), _mm_add_ps(r[4], r[8]));
+    const __m128 tx = _mm_sub_ps(_mm_add_ps(one, r[0]), _mm_add_ps(r[4], r[8]));
+    const __m128 ty = _mm_sub_ps(_mm_add_ps(one, r[4]), _mm_add_ps(r[0], r[8]));
+    const __m128 tz = _mm_sub_ps(_mm_add_ps(one, r[8]), _mm_add_ps(r[0], r[4]));
+    const __m128 d21 = _mm_sub_ps(r[7], r[5]);
+    const __m128 d02 = _mm_sub_ps(r[2], r[6]);
+    const __m128 d10 = _mm_sub_ps(r[3], r[1]);
+    const __m128 s01 = _mm_add_ps(r[1], r[3]);
+    const __m128 s02 = _mm_add_ps(r[2], r[6]);
+    const __m128 s12 = _mm_add_ps(r[5], r[7]);
+
+    __m128 t = tw;
+    __m128 qx = d21, qy = d02, qz = d10, qw = tw;
+    __m128 use = _mm_cmpgt_ps(tx, t);
+    t = _mm_max_ps(t, tx);
+    qx = sSelect4(use, tx, qx); qy = sSelect4(use, s01, qy); qz = sSelect4(use, s02, qz); qw = sSelect4(use, d21, qw);
+    use = _mm_cmpgt_ps(ty, t);
+    t = _mm_max_ps(t, ty);
+    qx = sSelect4(use, s01, qx); qy = sSelect4(use, ty, qy); qz = sSelect4(use, s12, qz); qw = sSelect4(use, d02, qw);
+    use = _mm_cmpgt_ps(tz, t);
+    qx = sSelect4(use, s02, qx); qy = sSelect4(use, s12, qy); qz = sSelect4(use, tz, qz); qw = sSelect4(use, d10, qw);
+
+    // Normalizing also covers the 0.5 / sqrt(t) scale, w sign is made positive.
+    const __m128 lenSqr = _mm_add_ps(_mm_add_ps(_mm_mul_ps(qx, qx), _mm_mul_ps(qy, qy)),
+        _mm_add_ps(_mm_mul_ps(qz, qz), _mm_mul_ps(qw, qw)));
+    const __m128 invLen = _mm_xor_ps(_mm_div_ps(one, _mm_sqrt_ps(lenSqr)), _mm_and_ps(qw, signMask));
+    outRot[0] = _mm_mul_ps(qx, invLen);
+    outRot[1] = _mm_mul_ps(qy, invLen);
+    outRot[2] = _mm_mul_ps(qz, invLen);
+    outRot[3] = _mm_mul_ps(qw, invLen);
+    return _mm_movemask_ps(degenerate);
+}
+
+// Row of 4 matrices transposed, out[k] has element k of the row.
+static inline void sLoadRow4(const Mat3x4 *matrices, int rowStart, __m128 *out)
+{
+    out[0] = _mm_load_ps(&matrices[0]._00 + rowStart);
+    out[1] = _mm_load_ps(&matrices[1]._00 + rowStart);
+    out[2] = _mm_load_ps(&matrices[2]._00 + rowStart);
+    out[3] = _mm_load_ps(&matrices[3]._00 + rowStart);
+    _MM_TRANSPOSE4_PS(out[0], out[1], out[2], out[3]);
+}
+
+static void sGetTransformsFromMatricesSSE(const Mat3x4 *matrices, uint32_t count, Transform *outTransforms)
+{
+    uint32_t i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        __m128 m[12];
+        sLoadRow4(matrices + i, 0, m + 0);
+        sLoadRow4(matrices + i, 4, m + 4);
+        sLoadRow4(matrices + i, 8, m + 8);
+
+        __m128 rot[4];
+        __m128 scale[4];
+        const int degenerate = sDecompose4(m, rot, scale);
+
+        __m128 pos[4] = { m[3], m[7], m[11], _mm_setzero_ps() };
+        scale[3] = _mm_setzero_ps();
+        _MM_TRANSPOSE4_PS(pos[0], pos[1], pos[2], pos[3]);
+        _MM_TRANSPOSE4_PS(rot[0], rot[1], rot[2], rot[3]);
+        _MM_TRANSPOSE4_PS(scale[0], scale[1], scale[2], scale[3]);
+        for(int lane = 0; lane < 4; ++lane)
+        {
+            Transform &transform = outTransforms[i + lane];
+            _mm_store_ps(&transform.pos.x, pos[lane]);
+            _mm_store_ps(&transform.rot.vx, rot[lane]);
+            _mm_store_ps(&transform.scale.x, scale[lane]);
+            if(degenerate & (1 << lane))
+                transform = getTransformFromMatrix(matrices[i + lane]);
+        }
+    }
+    for(; i < count; ++i)
+        outTransforms[i] = getTransformFromMatrix(matrices[i]);
+}
+
+#endif
+
+#if CARPMATH_X86
+
+CARPMATH_TARGET_AVX2 static void sNormalizeRow8(const __m256 *row, __m256 *outRow, __m256 &outLen, __m256 &degenerate)
+{
+    const __m256 lenSqr = _mm256_fmadd_ps(row[0], row[0], _mm256_fmadd_ps(row[1], row[1], _mm256_mul_ps(row[2], row[2])));
+    degenerate = _mm256_or_ps(degenerate, _mm256_cmp_ps(lenSqr, _mm256_set1_ps(DecomposeMinScaleSqr), _CMP_LT_OQ));
+    outLen = _mm256_sqrt_ps(lenSqr);
+    const __m256 invLen = _mm256_div_ps(_mm256_set1_ps(1.0f), outLen);
+    outRow[0] = _mm256_mul_ps(row[0], invLen);
+    outRow[1] = _mm256_mul_ps(row[1], invLen);
+    outRow[2] = _mm256_mul_ps(row[2], invLen);
+}
+
+// Same as sDecompose4 for 8 matrices.
+CARPMATH_TARGET_AVX2 static int sDecompose8(const __m256 *m, __m256 *outRot, __m256 *outScale)
+{
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    __m256 degenerate = _mm256_setzero_ps();
+    __m256 r[9];
+    sNormalizeRow8(m + 0, r + 0, outScale[0], degenerate);
+    sNormalizeRow8(m + 4, r + 3, outScale[1], degenerate);
+    sNormalizeRow8(m + 8, r + 6, outScale[2], degenerate);
+
+    const __m256 c0 = _mm256_fmsub_ps(r[4], r[8], _mm256_mul_ps(r[5], r[7]));
+    const __m256 c1 = _mm256_fmsub_ps(r[5], r[6], _mm256_mul_ps(r[3], r[8]));
+    const __m256 c2 = _mm256_fmsub_ps(r[3], r[7], _mm256_mul_ps(r[4], r[6]));
+    const __m256 det = _mm256_fmadd_ps(r[0], c0, _mm256_fmadd_ps(r[1], c1, _mm256_mul_ps(r[2], c2)));
+    const __m256 flip = _mm256_and_ps(det, signMask);
+    outScale[0] = _mm256_xor_ps(outScale[0], flip);
+    r[0] = _mm256_xor_ps(r[0], flip);
+    r[1] = _mm256_xor_ps(r[1], flip);
+    r[2] = _mm256_xor_ps(r[2], flip);
+
+    const __m256 tw = _mm256_add_ps(_mm256_add_ps(one, r[0]), _mm256_add_ps(r[4], r[8]));
+    const __m256 tx = _mm256_sub_ps(_mm256_add_ps(one, r[0]), _mm256_add_ps(r[4], r[8]));
+    const __m256 ty = _mm256_sub_ps(_mm256_add_ps(one, r[4]), _mm256_add_ps(r[0], r[8]));
+    const __m256 tz = _mm256_sub_ps(_mm256_add_ps(one, r[8]), _mm256_add_ps(r[0], r[4]));
+    const __m256 d21 = _mm256_sub_ps(r[7], r[5]);
+    const __m256 d02 = _mm256_sub_ps(r[2], r[6]);
+    const __m256 d10 = _mm256_sub_ps(r[3], r[1]);
+    const __m256 s01 = _mm256_add_ps(r[1], r[3]);
+    const __m256 s02 = _mm256_add_ps(r[2], r[6]);
+    const __m256 s12 = _mm256_add_ps(r[5], r[7]);
+
+    __m256 t = tw;
+    __m256 qx = d21, qy = d02, qz = d10, qw = tw;
+    __m256 use = _mm256_cmp_ps(tx, t, _CMP_GT_OQ);
+    t = _mm256_max_ps(t, tx);
+    qx = _mm256_blendv_ps(qx, tx, use); qy = _mm256_blendv_ps(qy, s01, use);
+    qz = _mm256_blendv_ps(qz, s02, use); qw = _mm256_blendv_ps(qw, d21, use);
+    use = _mm256_cmp_ps(ty, t, _CMP_GT_OQ);
+    t = _mm256_max_ps(t, ty);
+    qx = _mm256_blendv_ps(qx, s01, use); qy = _mm256_blendv_ps(qy, ty, use);
+    qz = _mm256_blendv_ps(qz, s12, use); qw = _mm256_blendv_ps(qw, d02, use);
+    use = _mm256_cmp_ps(tz, t, _CMP_GT_OQ);
+    qx = _mm256_blendv_ps(qx, s02, use); qy = _mm256_blendv_ps(qy, s12, use);
+    qz = _mm256_blendv_ps(qz, tz, use); qw = _mm256_blendv_ps(qw, d10, use);
+
+    const __m256 lenSqr = _mm256_fmadd_ps(qx, qx, _mm256_fmadd_ps(qy, qy, _mm256_fmadd_ps(qz, qz, _mm256_mul_ps(qw, qw))));
+    const __m256 invLen = _mm256_xor_ps(_mm256_div_ps(one, _mm256_sqrt_ps(lenSqr)), _mm256_and_ps(qw, signMask));
+    outRot[0] = _mm256_mul_ps(qx, invLen);
+    outRot[1] = _mm256_mul_ps(qy, invLen);
+    outRot[2] = _mm256_mul_ps(qz, invLen);
+    outRot[3] = _mm256_mul_ps(qw, invLen);
+    return _mm256_movemask_ps(degenerate);
+}
+
+// In lane 4x4 transpose, lanes hold elements 0-3 and 4-7.
+CARPMATH_TARGET_AVX2 static void sTranspose8(__m256 &a, __m256 &b, __m256 &c, __m256 &d)
+{
+    const __m256 ab0 = _mm256_unpacklo_ps(a, b);
+    const __m256 ab1 = _mm256_unpackhi_ps(a, b);
+    const __m256 cd0 = _mm256_unpacklo_ps(c, d);
+    const __m256 cd1 = _mm256_unpackhi_ps(c, d);
+    a = _mm256_shuffle_ps(ab0, cd0, _MM_SHUFFLE(1, 0, 1, 0));
+    b = _mm256_shuffle_ps(ab0, cd0, _MM_SHUFFLE(3, 2, 3, 2));
+    c = _mm256_shuffle_ps(ab1, cd1, _MM_SHUFFLE(1, 0, 1, 0));
+    d = _mm256_shuffle_ps(ab1, cd1, _MM_SHUFFLE(3, 2, 3, 2));
+}
+
+CARPMATH_TARGET_AVX2 static inline void sLoadRow8(const Mat3x4 *matrices, int rowStart, __m256 *out)
+{
+    out[0] = sCombine(_mm_load_ps(&matrices[0]._00 + rowStart), _mm_load_ps(&matrices[4]._00 + rowStart));
+    out[1] = sCombine(_mm_load_ps(&matrices[1]._00 + rowStart), _mm_load_ps(&matrices[5]._00 + rowStart));
+    out[2] = sCombine(_mm_load_ps(&matrices[2]._00 + rowStart), _mm_load_ps(&matrices[6]._00 + rowStart));
+    out[3] = sCombine(_mm_load_ps(&matrices[3]._00 + rowStart), _mm_load_ps(&matrices[7]._00 + rowStart));
+    sTranspose8(out[0], out[1], out[2], out[3]);
+}
+
+CARPMATH_TARGET_AVX2 static void sGetTransformsFromMatricesAVX2(const Mat3x4 *matrices, uint32_t count, Transform *outTransforms)
+{
+    uint32_t i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        __m256 m[12];
+        sLoadRow8(matrices + i, 0, m + 0);
+        sLoadRow8(matrices + i, 4, m + 4);
+        sLoadRow8(matrices + i, 8, m + 8);
+
+        __m256 rot[4];
+        __m256 scale[4];
+        const int degenerate = sDecompose8(m, rot, scale);
+
+        __m256 pos[4] = { m[3], m[7], m[11], _mm256_setzero_ps() };
+        scale[3] = _mm256_setzero_ps();
+        sTranspose8(pos[0], pos[1], pos[2], pos[3]);
+        sTranspose8(rot[0], rot[1], rot[2], rot[3]);
+        sTranspose8(scale[0], scale[1], scale[2], scale[3]);
+        for(int lane = 0; lane < 4; ++lane)
+        {
+            Transform &low = outTransforms[i + lane];
+            Transform &high = outTransforms[i + lane + 4];
+            _mm_store_ps(&low.pos.x, _mm256_castps256_ps128(pos[lane]));
+            _mm_store_ps(&low.rot.vx, _mm256_castps256_ps128(rot[lane]));
+            _mm_store_ps(&low.scale.x, _mm256_castps256_ps128(scale[lane]));
+            _mm_store_ps(&high.pos.x, _mm256_extractf128_ps(pos[lane], 1));
+            _mm_store_ps(&high.rot.vx, _mm256_extractf128_ps(rot[lane], 1));
+            _mm_store_ps(&high.scale.x, _mm256_extractf128_ps(scale[lane], 1));
+        }
+        for(int lane = 0; lane < 8; ++lane)
+        {
+            if(degenerate & (1 << lane))
+                outTransforms[i + lane] = getTransformFromMatrix(matrices[i + lane]);
+        }
+    }
+    for(; i < count; ++i)
+        outTransforms[i] = getTransformFromMatrix(matrices[i]);
+}
+
+#endif
+
+// Gram-Schmidt on rows: row 0 is normalized, row 1 made perpendicular to it and
+// row 2 is cross of them. Error is the largest |dot(row i, row j) - (i == j)|.
+static uint32_t sOrthonormalizeMatricesScalar(Mat3x4 *matrices, uint32_t count, float epsilon)
+{
+    uint32_t fixedCount = 0;
+    for(uint32_t i = 0; i < count; ++i)
+    {
+        Mat3x4 &m = matrices[i];
+        Vec3 r0(m._00, m._01, m._02);
+        Vec3 r1(m._10, m._11, m._12);
+        const Vec3 r2(m._20, m._21, m._22);
+
+        float error = sAbsF(dot(r0, r0) - 1.0f);
+        error = sMaxF(error, sAbsF(dot(r1, r1) - 1.0f));
+        error = sMaxF(error, sAbsF(dot(r2, r2) - 1.0f));
+        error = sMaxF(error, sAbsF(dot(r0, r1)));
+        error = sMaxF(error, sAbsF(dot(r0, r2)));
+        error = sMaxF(error, sAbsF(dot(r1, r2)));
+        if(error <= epsilon)
+            continue;
+        ++fixedCount;
+
+        const float sqrLength0 = dot(r0, r0);
+        r0 = r0 * (1.0f / sSqrtF(sqrLength0));
+        r1 = r1 - r0 * dot(r0, r1);
+        const float sqrLength1 = dot(r1, r1);
+        r1 = r1 * (1.0f / sSqrtF(sqrLength1));
+        Vec3 n2 = cross(r0, r1);
+        if(sqrLength0 < OrthonormalizeMinSqrLength || sqrLength1 < OrthonormalizeMinSqrLength)
+        {
+            r0 = Vec3(1.0f, 0.0f, 0.0f);
+            r1 = Vec3(0.0f, 1.0f, 0.0f);
+            n2 = Vec3(0.0f, 0.0f, 1.0f);
+        }
+        m._00 = r0.x; m._01 = r0.y; m._02 = r0.z;
+        m._10 = r1.x; m._11 = r1.y; m._12 = r1.z;
+        m._20 = n2.x; m._21 = n2.y; m._22 = n2.z;
+    }
+    return fixedCount;
+}
+
+#if (__AVX__ || __SSE__ || __SSE2__ || __SSE3__ || __SSE4_1__ || _M_AMD64 || _M_X64) && 1
+
+static __m128 sRsqrt4(__m128 x)
+{
+    const __m128 y = _mm_rsqrt_ps(x);
+    const __m128 yyx = _mm_mul_ps(_mm_mul_ps(y, y), x);
+    return _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), y), _mm_sub_ps(_mm_set1_ps(3.0f), yyx));
+}
+
+static __m128 sDot3(__m128 ax, __m128 ay, __m128 az, __m128 bx, __m128 by, __m128 bz)
+{
+    return _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)), _mm_mul_ps(az, bz));
+}
+
+static inline void sStoreRow4(Mat3x4 *matrices, int rowStart, __m128 *row)
+{
+    _MM_TRANSPOSE4_PS(row[0], row[1], row[2], row[3]);
+    _mm_store_ps(&matrices[0]._00 + rowStart, row[0]);
+    _mm_store_ps(&matrices[1]._00 + rowStart, row[1]);
+    _mm_store_ps(&matrices[2]._00 + rowStart, row[2]);
+    _mm_store_ps(&matrices[3]._00 + rowStart, row[3]);
+}
+
+static uint32_t sOrthonormalizeMatricesSSE(Mat3x4 *matrices, uint32_t count, float epsilon)
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    const __m128 maxError = _mm_set1_ps(epsilon);
+    const __m128 minSqrLength = _mm_set1_ps(OrthonormalizeMinSqrLength);
+    __m128i fixedCount = _mm_setzero_si128();
+
+    uint32_t i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        __m128 m[12];
+        sLoadRow4(matrices + i, 0, m + 0);
+        sLoadRow4(matrices + i, 4, m + 4);
+        sLoadRow4(matrices + i, 8, m + 8);
+
+        const __m128 d00 = sDot3(m[0], m[1], m[2], m[0], m[1], m[2]);
+        const __m128 d11 = sDot3(m[4], m[5], m[6], m[4], m[5], m[6]);
+        const __m128 d22 = sDot3(m[8], m[9], m[10], m[8], m[9], m[10]);
+        const __m128 d01 = sDot3(m[0], m[1], m[2], m[4], m[5], m[6]);
+        const __m128 d02 = sDot3(m[0], m[1], m[2], m[8], m[9], m[10]);
+        const __m128 d12 = sDot3(m[4], m[5], m[6], m[8], m[9], m[10]);
+        __m128 error = _mm_max_ps(_mm_andnot_ps(signMask, _mm_sub_ps(d00, one)), _mm_andnot_ps(signMask, _mm_sub_ps(d11, one)));
+        error = _mm_max_ps(error, _mm_andnot_ps(signMask, _mm_sub_ps(d22, one)));
+        error = _mm_max_ps(error, _mm_andnot_ps(signMask, d01));
+        error = _mm_max_ps(error, _mm_andnot_ps(signMask, d02));
+        error = _mm_max_ps(error, _mm_andnot_ps(signMask, d12));
+        const __m128 fix = _mm_cmpgt_ps(error, maxError);
+
+        const __m128 inv0 = sRsqrt4(d00);
+        const __m128 n0x = _mm_mul_ps(m[0], inv0);
+        const __m128 n0y = _mm_mul_ps(m[1], inv0);
+        const __m128 n0z = _mm_mul_ps(m[2], inv0);
+        const __m128 proj = _mm_mul_ps(d01, inv0);
+        const __m128 u1x = _mm_sub_ps(m[4], _mm_mul_ps(n0x, proj));
+        const __m128 u1y = _mm_sub_ps(m[5], _mm_mul_ps(n0y, proj));
+        const __m128 u1z = _mm_sub_ps(m[6], _mm_mul_ps(n0z, proj));
+        const __m128 sqrLength1 = sDot3(u1x, u1y, u1z, u1x, u1y, u1z);
+        const __m128 inv1 = sRsqrt4(sqrLength1);
+        const __m128 n1x = _mm_mul_ps(u1x, inv1);
+        const __m128 n1y = _mm_mul_ps(u1y, inv1);
+        const __m128 n1z = _mm_mul_ps(u1z, inv1);
+        const __m128 n2x = _mm_sub_ps(_mm_mul_ps(n0y, n1z), _mm_mul_ps(n0z, n1y));
+        const __m128 n2y = _mm_sub_ps(_mm_mul_ps(n0z, n1x), _mm_mul_ps(n0x, n1z));
+        const __m128 n2z = _mm_sub_ps(_mm_mul_ps(n0x, n1y), _mm_mul_ps(n0y, n1x));
+
+        const __m128 degenerate = _mm_or_ps(_mm_cmplt_ps(d00, minSqrLength), _mm_cmplt_ps(sqrLength1, minSqrLength));
+        const __m128 normal = _mm_andnot_ps(degenerate, fix);
+        const __m128 identity = _mm_and_ps(degenerate, fix);
+        const __m128 n[9] = { n0x, n0y, n0z, n1x, n1y, n1z, n2x, n2y, n2z };
+        for(int k = 0; k < 9; ++k)
+        {
+            const int index = (k / 3) * 4 + k % 3;
+            const __m128 diagonal = (k % 4) == 0 ? one : zero;
+            m[index] = sSelect4(normal, n[k], sSelect4(identity, diagonal, m[index]));
+        }
+        fixedCount = _mm_sub_epi32(fixedCount, _mm_castps_si128(fix));
+
+        sStoreRow4(matrices + i, 0, m + 0);
+        sStoreRow4(matrices + i, 4, m + 4);
+        sStoreRow4(matrices + i, 8, m + 8);
+    }
+
+    alignas(16) uint32_t laneCounts[4];
+    _mm_store_si128((__m128i *)laneCounts, fixedCount);
+    const uint32_t fixed = laneCounts[0] + laneCounts[1] + laneCounts[2] + laneCounts[3];
+    return fixed + sOrthonormalizeMatricesScalar(matrices + i, count - i, epsilon);
+}
+
+#endif
+
+#if CARPMATH_X86
+
+CARPMATH_TARGET_AVX2 static __m256 sRsqrt8(__m256 x)
+{
+    const __m256 y = _mm256_rsqrt_ps(x);
+    const __m256 yyx = _mm256_mul_ps(_mm256_mul_ps(y, y), x);
+    return _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(0.5f), y), _mm256_sub_ps(_mm256_set1_ps(3.0f), yyx));
+}
+
+CARPMATH_TARGET_AVX2 static __m256 sDot3(__m256 ax, __m256 ay, __m256 az, __m256 bx, __m256 by, __m256 bz)
+{
+    return _mm256_fmadd_ps(ax, bx, _mm256_fmadd_ps(ay, by, _mm256_mul_ps(az, bz)));
+}
+
+CARPMATH_TARGET_AVX2 static inline void sStoreRow8(Mat3x4 *matrices, int rowStart, __m256 *row)
+{
+    sTranspose8(row[0], row[1], row[2], row[3]);
+    for(int k = 0; k < 4; ++k)
+    {
+        _mm_store_ps(&matrices[k]._00 + rowStart, _mm256_castps256_ps128(row[k]));
+        _mm_store_ps(&matrices[k + 4]._00 + rowStart, _mm256_extractf128_ps(row[k], 1));
+    }
+}
+
+CARPMATH_TARGET_AVX2 static uint32_t sOrthonormalizeMatricesAVX2(Mat3x4 *matrices, uint32_t count, float epsilon)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    const __m256 maxError = _mm256_set1_ps(epsilon);
+    const __m256 minSqrLength = _mm256_set1_ps(OrthonormalizeMinSqrLength);
+    __m256i fixedCount = _mm256_setzero_si256();
+
+    uint32_t i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        __m256 m[12];
+        sLoadRow8(matrices + i, 0, m + 0);
+        sLoadRow8(matrices + i, 4, m + 4);
+        sLoadRow8(matrices + i, 8, m + 8);
+
+        const __m256 d00 = sDot3(m[0], m[1], m[2], m[0], m[1], m[2]);
+        const __m256 d11 = sDot3(m[4], m[5], m[6], m[4], m[5], m[6]);
+        const __m256 d22 = sDot3(m[8], m[9], m[10], m[8], m[9], m[10]);
+        const __m256 d01 = sDot3(m[0], m[1], m[2], m[4], m[5], m[6]);
+        const __m256 d02 = sDot3(m[0], m[1], m[2], m[8], m[9], m[10]);
+        const __m256 d12 = sDot3(m[4], m[5], m[6], m[8], m[9], m[10]);
+        __m256 error = _mm256_max_ps(_mm256_andnot_ps(signMask, _mm256_sub_ps(d00, one)), _mm256_andnot_ps(signMask, _mm256_sub_ps(d11, one)));
+        error = _mm256_max_ps(error, _mm256_andnot_ps(signMask, _mm256_sub_ps(d22, one)));
+        error = _mm256_max_ps(error, _mm256_andnot_ps(signMask, d01));
+        error = _mm256_max_ps(error, _mm256_andnot_ps(signMask, d02));
+        error = _mm256_max_ps(error, _mm256_andnot_ps(signMask, d12));
+        const __m256 fix = _mm256_cmp_ps(error, maxError, _CMP_GT_OQ);
+
+        const __m256 inv0 = sRsqrt8(d00);
+        const __m256 n0x = _mm256_mul_ps(m[0], inv0);
+        const __m256 n0y = _mm256_mul_ps(m[1], inv0);
+        const __m256 n0z = _mm256_mul_ps(m[2], inv0);
+        const __m256 proj = _mm256_mul_ps(d01, inv0);
+        const __m256 u1x = _mm256_fnmadd_ps(n0x, proj, m[4]);
+        const __m256 u1y = _mm256_fnmadd_ps(n0y, proj, m[5]);
+        const __m256 u1z = _mm256_fnmadd_ps(n0z, proj, m[6]);
+        const __m256 sqrLength1 = sDot3(u1x, u1y, u1z, u1x, u1y, u1z);
+        const __m256 inv1 = sRsqrt8(sqrLength1);
+        const __m256 n1x = _mm256_mul_ps(u1x, inv1);
+        const __m256 n1y = _mm256_mul_ps(u1y, inv1);
+        const __m256 n1z = _mm256_mul_ps(u1z, inv1);
+        const __m256 n2x = _mm256_fmsub_ps(n0y, n1z, _mm256_mul_ps(n0z, n1y));
+        const __m256 n2y = _mm256_fmsub_ps(n0z, n1x, _mm256_mul_ps(n0x, n1z));
+        const __m256 n2z = _mm256_fmsub_ps(n0x, n1y, _mm256_mul_ps(n0y, n1x));
+
+        const __m256 degenerate = _mm256_or_ps(_mm256_cmp_ps(d00, minSqrLength, _CMP_LT_OQ),
+            _mm256_cmp_ps(sqrLength1, minSqrLength, _CMP_LT_OQ));
+        const __m256 normal = _mm256_andnot_ps(degenerate, fix);
+        const __m256 identity = _mm256_and_ps(degenerate, fix);
+        const __m256 n[9] = { n0x, n0y, n0z, n1x, n1y, n1z, n2x, n2y, n2z };
+        for(int k = 0; k < 9; ++k)
+        {
+            const int index = (k / 3) * 4 + k % 3;
+            const __m256 diagonal = (k % 4) == 0 ? one : zero;
+            m[index] = _mm256_blendv_ps(_mm256_blendv_ps(m[index], diagonal, identity), n[k], normal);
+        }
+        fixedCount = _mm256_sub_epi32(fixedCount, _mm256_castps_si256(fix));
+
+        sStoreRow8(matrices + i, 0, m + 0);
+        sStoreRow8(matrices + i, 4, m + 4);
+        sStoreRow8(matrices + i, 8, m + 8);
+    }
+
+    alignas(32) uint32_t laneCounts[8];
+    _mm256_store_si256((__m256i *)laneCounts, fixedCount);
+    uint32_t fixed = 0;
+    for(uint32_t lane = 0; lane < 8; ++lane)
+        fixed += laneCounts[lane];
+    return fixed + sOrthonormalizeMatricesScalar(matrices + i, count - i, epsilon);
+}
+
+#endif
+
+// Change detection works on entries of 12 or 16 floats, compareMask picks which
+// elements count. NaN differences count as changed.
+static uint32_t sGetChangedElementsScalar(const float *a, const float *b, uint32_t entryFloats, float epsilon)
+{
+    uint32_t changed = 0;
+    for(uint32_t j = 0; j < entryFloats; ++j)
+        changed |= uint32_t(!(sAbsF(a[j] - b[j]) <= epsilon)) << j;
+    return changed;
+}
+
+static uint32_t sDiffEntriesScalar(const float *current, const float *previous, uint32_t count,
+    uint32_t entryFloats, uint32_t compareMask, float epsilon, uint64_t *outChangedBits)
+{
+    uint32_t changedCount = 0;
+    for(uint32_t begin = 0; begin < count; begin += 64)
+    {
+        const uint32_t end = count - begin > 64 ? begin + 64 : count;
+        uint64_t bits = 0;
+        for(uint32_t i = begin; i < end; ++i)
+        {
+            const size_t offset = size_t(i) * entryFloats;
+            const uint32_t changed = sGetChangedElementsScalar(current + offset, previous + offset, entryFloats, epsilon);
+            bits |= uint64_t((changed & compareMask) != 0) << (i - begin);
+        }
+        outChangedBits[begin / 64] = bits;
+        changedCount += sPopCount64(bits);
+    }
+    return changedCount;
+}
+
+#if (__AVX__ || __SSE__ || __SSE2__ || __SSE3__ || __SSE4_1__ || _M_AMD64 || _M_X64) && 1
+
+static __m128 sGetRowCompareMask(uint32_t compareMask, uint32_t row)
+{
+    const uint32_t bits = compareMask >> (row * 4);
+    return _mm_castsi128_ps(_mm_set_epi32(-int32_t((bits >> 3) & 1u), -int32_t((bits >> 2) & 1u),
+        -int32_t((bits >> 1) & 1u), -int32_t(bits & 1u)));
+}
+
+static inline __m128 sGetChangedRow(const float *a, const float *b, __m128 maxDiff, __m128 rowMask)
+{
+    const __m128 d = _mm_andnot_ps(_mm_set1_ps(-0.0f), _mm_sub_ps(_mm_load_ps(a), _mm_load_ps(b)));
+    return _mm_and_ps(_mm_cmpnle_ps(d, maxDiff), rowMask);
+}
+
+template <uint32_t RowCount>
+static uint32_t sDiffEntriesSSE(const float *current, const float *previous, uint32_t count,
+    uint32_t compareMask, float epsilon, uint64_t *outChangedBits)
+{
+    const __m128 maxDiff = _mm_set1_ps(epsilon);
+    const __m128 rowMask0 = sGetRowCompareMask(compareMask, 0);
+    const __m128 rowMask1 = sGetRowCompareMask(compareMask, 1);
+    const __m128 rowMask2 = sGetRowCompareMask(compareMask, 2);
+    const __m128 rowMask3 = sGetRowCompareMask(compareMask, 3);
+    uint32_t changedCount = 0;
+    for(uint32_t begin = 0; begin < count; begin += 64)
+    {
+        const uint32_t end = count - begin > 64 ? begin + 64 : count;
+        uint64_t bits = 0;
+        for(uint32_t i = begin; i < end; ++i)
+        {
+            const float *a = current + size_t(i) * RowCount * 4;
+            const float *b = previous + size_t(i) * RowCount * 4;
+            __m128 changed = _mm_or_ps(sGetChangedRow(a, b, maxDiff, rowMask0), sGetChangedRow(a + 4, b + 4, maxDiff, rowMask1));
+            changed = _mm_or_ps(changed, sGetChangedRow(a + 8, b + 8, maxDiff, rowMask2));
+            if(RowCount == 4)
+                changed = _mm_or_ps(changed, sGetChangedRow(a + 12, b + 12, maxDiff, rowMask3));
+            bits |= uint64_t(_mm_movemask_ps(changed) != 0) << (i - begin);
+        }
+        outChangedBits[begin / 64] = bits;
+        changedCount += sPopCount64(bits);
+    }
+    return changedCount;
+}
+
+static uint32_t sDiffEntriesSSE(const float *current, const float *previous, uint32_t count,
+    uint32_t entryFloats, uint32_t compareMask, float epsilon, uint64_t *outChangedBits)
+{
+    if(entryFloats == 16)
+        return sDiffEntriesSSE<4>(current, previous, count, compareMask, epsilon, outChangedBits);
+    return sDiffEntriesSSE<3>(current, previous, count, compareMask, epsilon, outChangedBits);
+}
+
+#endif
+
+#if CARPMATH_X86
+
+CARPMATH_TARGET_AVX2 static uint32_t sGetChangedMask8(const float *a, const float *b, __m256 maxDiff)
+{
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    const __m256 d = _mm256_andnot_ps(signMask, _mm256_sub_ps(_mm256_loadu_ps(a), _mm256_loadu_ps(b)));
+    return uint32_t(_mm256_movemask_ps(_mm256_cmp_ps(d, maxDiff, _CMP_NLE_UQ)));
+}
+
+// 16 float entries are two registers each, 12 float entries are done in pairs of three registers.
+CARPMATH_TARGET_AVX2 static uint32_t sDiffEntriesAVX2(const float *current, const float *previous, uint32_t count,
+    uint32_t entryFloats, uint32_t compareMask, float epsilon, uint64_t *outChangedBits)
+{
+    const __m256 maxDiff = _mm256_set1_ps(epsilon);
+    uint32_t changedCount = 0;
+    for(uint32_t begin = 0; begin < count; begin += 64)
+    {
+        const uint32_t end = count - begin > 64 ? begin + 64 : count;
+        uint64_t bits = 0;
+        uint32_t i = begin;
+        if(entryFloats == 16)
+        {
+            for(; i < end; ++i)
+            {
+                const float *a = current + size_t(i) * 16;
+                const float *b = previous + size_t(i) * 16;
+                const uint32_t changed = sGetChangedMask8(a, b, maxDiff) | (sGetChangedMask8(a + 8, b + 8, maxDiff) << 8);
+                bits |= uint64_t((changed & compareMask) != 0) << (i - begin);
+            }
+        }
+        else
+        {
+            for(; i + 2 <= end; i += 2)
+            {
+                const float *a = current + size_t(i) * 12;
+                const float *b = previous + size_t(i) * 12;
+                const uint32_t m0 = sGetChangedMask8(a, b, maxDiff);
+                const uint32_t m1 = sGetChangedMask8(a + 8, b + 8, maxDiff);
+                const uint32_t m2 = sGetChangedMask8(a + 16, b + 16, maxDiff);
+                const uint32_t changed0 = m0 | ((m1 & 0xfu) << 8);
+                const uint32_t changed1 = (m1 >> 4) | (m2 << 4);
+                bits |= uint64_t((changed0 & compareMask) != 0) << (i - begin);
+                bits |= uint64_t((changed1 & compareMask) != 0) << (i + 1 - begin);
+            }
+            for(; i < end; ++i)
+            {
+                const size_t offset = size_t(i) * 12;
+                const uint32_t changed = sGetChangedElementsScalar(current + offset, previous + offset, 12, epsilon);
+                bits |= uint64_t((changed & compareMask) != 0) << (i - begin);
+            }
+        }
+        outChangedBits[begin / 64] = bits;
+        changedCount += sPopCount64(bits);
+    }
+    return changedCount;
+}
+
+#endif
+
+void bindMat4Kernels(SimdKernels &kernels, SimdBackend backend)
+{
+    kernels.multiplyMatricesMat4Mat3x4 = sMultiplyMatricesScalar;
+    kernels.multiplyMatricesMat4Pairs = sMultiplyMat4PairsScalar;
+    kernels.multiplyMatricesMat4 = sMultiplyMat4Scalar;
+    kernels.multiplyMatricesMat3x4Pairs = sMultiplyMat3x4PairsScalar;
+    kernels.multiplyMatricesMat3x4 = sMultiplyMat3x4Scalar;
+    kernels.getTransformsFromMatrices = sGetTransformsFromMatricesScalar;
+    kernels.orthonormalizeMatrices = sOrthonormalizeMatricesScalar;
+    kernels.diffEntries = sDiffEntriesScalar;
+#if (__AVX__ || __SSE__ || __SSE2__ || __SSE3__ || __SSE4_1__ || _M_AMD64 || _M_X64) && 1
+    if(backend >= SimdBackendSSE4)
+    {
+        kernels.multiplyMatricesMat4Mat3x4 = sMultiplyMatricesSSE;
+        kernels.multiplyMatricesMat4Pairs = sMultiplyMat4PairsSSE;
+        kernels.multiplyMatricesMat4 = sMultiplyMat4SSE;
+        kernels.multiplyMatricesMat3x4Pairs = sMultiplyMat3x4PairsSSE;
+        kernels.multiplyMatricesMat3x4 = sMultiplyMat3x4SSE;
+        kernels.getTransformsFromMatrices = sGetTransformsFromMatricesSSE;
+        kernels.orthonormalizeMatrices = sOrthonormalizeMatricesSSE;
+        kernels.diffEntries = sDiffEntriesSSE;
+    }
+#endif
+#if CARPMATH_X86
+    if(backend >= SimdBackendAVX2)
+    {
+        kernels.multiplyMatricesMat4Mat3x4 = sMultiplyMatricesAVX2;
+        kernels.multiplyMatricesMat4Pairs = sMultiplyMat4PairsAVX2;
+        kernels.multiplyMatricesMat4 = sMultiplyMat4AVX2;
+        kernels.multiplyMatricesMat3x4Pairs = sMultiplyMat3x4PairsAVX2;
+        kernels.multiplyMatricesMat3x4 = sMultiplyMat3x4AVX2;
+        kernels.getTransformsFromMatrices = sGetTransformsFromMatricesAVX2;
+        kernels.orthonormalizeMatrices = sOrthonormalizeMatricesAVX2;
+        kernels.diffEntries = sDiffEntriesAVX2;
+    }
+    if(backend >= SimdBackendAVX512)
+        kernels.multiplyMatricesMat4Mat3x4 = sMultiplyMatricesAVX512;
+#endif
+}
+
+void multiplyMatrices(const Mat4x4 &a, const Mat3x4 *b, uint32_t count, Mat4x4 *outResults)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdMultiplyMatrices, count);
+    getSimdKernels().multiplyMatricesMat4Mat3x4(a, b, count, outResults);
+}
+
+void multiplyMatrices(const Mat4x4 *a, const Mat4x4 *b, uint32_t count, Mat4x4 *outResults)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdMultiplyMatrices, count);
+    getSimdKernels().multiplyMatricesMat4Pairs(a, b, count, outResults);
+}
+
+void multiplyMatrices(const Mat4x4 &a, const Mat4x4 *b, uint32_t count, Mat4x4 *outResults)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdMultiplyMatrices, count);
+    getSimdKernels().multiplyMatricesMat4(a, b, count, outResults);
+}
+
+void multiplyMatrices(const Mat3x4 *a, const Mat3x4 *b, uint32_t count, Mat3x4 *outResults)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdMultiplyMatrices, count);
+    getSimdKernels().multiplyMatricesMat3x4Pairs(a, b, count, outResults);
+}
+
+void multiplyMatrices(const Mat3x4 &a, const Mat3x4 *b, uint32_t count, Mat3x4 *outResults)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdMultiplyMatrices, count);
+    getSimdKernels().multiplyMatricesMat3x4(a, b, count, outResults);
+}
+
+void getTransformsFromMatrices(const Mat3x4 *matrices, uint32_t count, Transform *outTransforms)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdGetTransformsFromMatrices, count);
+    getSimdKernels().getTransformsFromMatrices(matrices, count, outTransforms);
+}
+
+uint32_t orthonormalizeMatrices(Mat3x4 *matrices, uint32_t count, float epsilon)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdOrthonormalizeMatrices, count);
+    return getSimdKernels().orthonormalizeMatrices(matrices, count, epsilon);
+}
+
+uint32_t diffMatrices(const Mat4x4 *current, const Mat4x4 *previous, uint32_t count, float epsilon, uint64_t *outChangedBits)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdDiff, count);
+    return getSimdKernels().diffEntries(&current->_00, &previous->_00, count, 16, 0xffffu, epsilon, outChangedBits);
+}
+
+uint32_t diffMatrices(const Mat3x4 *current, const Mat3x4 *previous, uint32_t count, float epsilon, uint64_t *outChangedBits)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdDiff, count);
+    return getSimdKernels().diffEntries(&current->_00, &previous->_00, count, 12, 0xfffu, epsilon, outChangedBits);
+}
+
+uint32_t diffTransforms(const Transform *current, const Transform *previous, uint32_t count, float epsilon, uint64_t *outChangedBits)
+{
+    static_assert(sizeof(Transform) == 12 * sizeof(float), "Transform must be pos, rot, scale without extra padding");
+    // pos.w and scale.w are padding.
+    static constexpr uint32_t TransformCompareMask = 0xfffu & ~((1u << 3u) | (1u << 11u));
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdDiff, count);
+    return getSimdKernels().diffEntries(&current->pos.x, &previous->pos.x, count, 12, TransformCompareMask, epsilon, outChangedBits);
+}
+
+uint32_t getIndicesFromBits(const uint64_t *bits, uint32_t count, uint32_t *outIndices)
+{
+    uint32_t indexCount = 0;
+    for(uint32_t begin = 0; begin < count; begin += 64)
+    {
+        uint64_t word = bits[begin / 64];
+        if(count - begin < 64)
+            word &= (uint64_t(1) << (count - begin)) - 1u;
+        while(word)
+        {
+            outIndices[indexCount++] = begin + sCountTrailingZeros64(word);
+            word &= word - 1u;
+        }
+    }
+    return indexCount;
+}
@@ -6,6 +6,8 @@
 #include "vec3.h"
 #include "vec4.h"
 
+#include <stdint.h>
+
 // The matrices are used mostly in row order where
 // row 0 = x vec, transpose.x
 // row 1 = y vec, transpose.y
@@ -101,22 +103,79 @@ struct alignas(16) Mat3x4
 };
 
 Mat3x4 getMat4FromTransform(const Transform& transform);
-Mat3x4 getMat4FromQuaternion(const Quat &quat);
-Mat3x4 getMat4FromScale(const Vec3 &scale);
-Mat3x4 getMat4FromTranslation(const Vec3 &pos);
-
-Mat4x4 createOrthoMat4(float width, float height, float nearPlane, float farPlane);
-Mat4x4 createPerspectiveMat4(float fov, float aspectRatio, float nearPlane, float farPlane);
-
-Mat4x4 createMat4FromLookAt(const Vec3 &pos, const Vec3 &target, const Vec3 &up);
+Mat3x4 getInverseMatrixFromTransform(const Transform &transform);
+Mat3x4 getMatrixFromQuaternion(const Quat &quat);
+Mat3x4 getMatrixFromScale(const Vec3 &scale);
+Mat3x4 getMatrixFromTranslation(const Vec3 &pos);
+
+// Inverse of getMat4FromTransform. Scale is the row lengths, mirrored matrix gives
+// negative scale.x. Rotation of non-orthogonal matrix is approximate, w of rot is >= 0.
+Transform getTransformFromMatrix(const Mat3x4 &m);
+void getTransformsFromMatrices(const Mat3x4 *matrices, uint32_t count, Transform *outTransforms);
+
+// Change detection against previous frame. Bit i of outChangedBits, (count + 63) / 64 words,
+// is set when any element of entry i differs by more than epsilon, NaN counts as changed.
+// Transform padding is ignored. Returns the number of changed entries.
+uint32_t diffMatrices(const Mat4x4 *current, const Mat4x4 *previous, uint32_t count, float epsilon, uint64_t *outChangedBits);
+uint32_t diffMatrices(const Mat3x4 *current, const Mat3x4 *previous, uint32_t count, float epsilon, uint64_t *outChangedBits);
+uint32_t diffTransforms(const Transform *current, const Transform *previous, uint32_t count, float epsilon, uint64_t *outChangedBits);
+// Writes indices of set bits among the first count bits in increasing order, returns how many.
+uint32_t getIndicesFromBits(const uint64_t *bits, uint32_t count, uint32_t *outIndices);
+// m must be pure rotation.
+Quat getQuatFromMatrix(const Mat3x4 &m);
+
+// Makes rotation part of matrices orthonormal in place, translation is kept. Only
+// matrices whose rows are off by more than epsilon are changed, epsilon 0 does all.
+// Rotation part of degenerate matrices becomes identity. Returns how many were changed.
+uint32_t orthonormalizeMatrices(Mat3x4 *matrices, uint32_t count, float epsilon = 0.0f);
+
+Mat4x4 createOrthoMatrix(float width, float height, float nearPlane, float farPlane);
+Mat4x4 createPerspectiveMatrix(float fov, float aspectRatio, float nearPlane, float farPlane);
+
+Mat4x4 createMatrixFromLookAt(const Vec3 &pos, const Vec3 &target, const Vec3 &up);
 
 Mat4x4 transpose(const Mat4x4 &m);
 Mat4x4 operator*(const Mat4x4 &a, const Mat4x4 &b);
 
+// Equal when no element differs by more than epsilon, operator== uses 5e-2.
+bool isEqual(const Mat4x4 &a, const Mat4x4 &b, float epsilon);
+bool isEqual(const Mat3x4 &a, const Mat3x4 &b, float epsilon);
 bool operator==(const Mat4x4 &a, const Mat4x4 &b);
+bool operator==(const Mat3x4 &a, const Mat3x4 &b);
+
+// Structure of a Mat4x4, lets inverse and multiply skip work. Identity, translation, rigid
+// and affine each include the kinds before them, all kinds are general.
+enum MatrixKind : uint32_t
+{
+    MatrixKindIdentity,
+    // Identity 3x3 with translation, getMatrixFromTranslation.
+    MatrixKindTranslation,
+    // Orthonormal 3x3 with translation, createMatrixFromLookAt.
+    MatrixKindRigid,
+    // Last row 0, 0, 0, 1, createOrthoMatrix, getMatrixFromScale and getMat4FromTransform.
+    MatrixKindAffine,
+    // Only _00, _02, _11, _12, _22, _23 and _32 non-zero, createPerspectiveMatrix and
+    // off-center frustums.
+    MatrixKindPerspective,
+    MatrixKindGeneral,
+};
+
+// Structural zeros and ones are compared exactly, epsilon is for rigid row lengths and
+// angles. About as expensive as a matrix multiply.
+MatrixKind getMatrixKind(const Mat4x4 &m, float epsilon = 1.0e-5f);
+// Kind of a * b, assuming a has kindA and b kindB.
+MatrixKind getProductKind(MatrixKind kindA, MatrixKind kindB);
+
+// Without kind detects it with getMatrixKind. kind must be right, a rigid matrix is
+// inverted by transposing and a general one given as affine loses its last row.
 Mat4x4 inverse(const Mat4x4 &m);
+Mat4x4 inverse(const Mat4x4 &m, MatrixKind kind);
+// a * b with known kinds, cheaper paths for identity, translation and affine products.
+// operator* does not detect kinds, since detecting costs as much as multiplying.
+Mat4x4 multiply(const Mat4x4 &a, MatrixKind kindA, const Mat4x4 &b, MatrixKind kindB);
 
-bool isIdentity(const Mat4x4 &m);
+bool isIdentity(const Mat4x4 &m, float epsilon = 1.0e-4f);
+bool isIdentity(const Mat3x4 &m, float epsilon = 1.0e-4f);
 
 
 Vec4 operator*(const Mat4x4& m, const Vec4& v);
@@ -129,3 +188,13 @@ Mat4x4 operator*(const Mat4x4 &a, const Mat3x4 &b);
 Mat4x4 operator*(const Mat3x4 &a, const Mat4x4 &b);
 Mat3x4 operator*(const Mat3x4 &a, const Mat3x4 &b);
 
+// outResults[i] = a * b[i], for example per instance MVP from view projection and model matrices.
+void multiplyMatrices(const Mat4x4 &a, const Mat3x4 *b, uint32_t count, Mat4x4 *outResults);
+
+// Batch products, outResults[i] = a[i] * b[i] or a * b[i].
+// outResults can be the same array as a or b for in place update.
+void multiplyMatrices(const Mat4x4 *a, const Mat4x4 *b, uint32_t count, Mat4x4 *outResults);
+void multiplyMatrices(const Mat4x4 &a, const Mat4x4 *b, uint32_t count, Mat4x4 *outResults);
+void multiplyMatrices(const Mat3x4 *a, const Mat3x4 *b, uint32_t count, Mat3x4 *outResults);
+void multiplyMatrices(const Mat3x4 &a, const Mat3x4 *b, uint32_t count, Mat3x4 *outResults);
+
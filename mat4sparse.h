@@ -0,0 +1,286 @@
+#pragma once
+
+#include "mat4.h"
+
+#include <stdint.h>
+#include <utility>
+
+// Products specialized at compile time on the structure of the operands. A sparsity has
+// 2 bits per element, element row * 4 + col at bits 2 * (row * 4 + col), a MatrixElement
+// telling whether the element is always 0, 1, -1 or any value. multiplySparse emits only
+// the terms whose factors can both be other than 0, and a factor of 1 or -1 becomes a copy
+// or a subtract. Terms are summed in the same order as operator*, skipped terms are
+// assumed exactly 0 so inf or nan in an element declared 0 does not spread.
+enum MatrixElement : uint32_t
+{
+    MatrixElementZero = 0u,
+    MatrixElementOne = 1u,
+    MatrixElementMinusOne = 2u,
+    MatrixElementAny = 3u,
+};
+
+constexpr uint32_t getMatrixSparsity(
+    uint32_t e00, uint32_t e01, uint32_t e02, uint32_t e03,
+    uint32_t e10, uint32_t e11, uint32_t e12, uint32_t e13,
+    uint32_t e20, uint32_t e21, uint32_t e22, uint32_t e23,
+    uint32_t e30, uint32_t e31, uint32_t e32, uint32_t e33)
+{
+    return (e00 << 0u) | (e01 << 2u) | (e02 << 4u) | (e03 << 6u)
+        | (e10 << 8u) | (e11 << 10u) | (e12 << 12u) | (e13 << 14u)
+        | (e20 << 16u) | (e21 << 18u) | (e22 << 20u) | (e23 << 22u)
+        | (e30 << 24u) | (e31 << 26u) | (e32 << 28u) | (e33 << 30u);
+}
+
+constexpr uint32_t getMatrixElement(uint32_t sparsity, uint32_t index)
+{
+    return (sparsity >> (index * 2u)) & 3u;
+}
+
+// Sparsity with the last row replaced by the implicit 0, 0, 0, 1 of Mat3x4.
+constexpr uint32_t getMat3x4Sparsity(uint32_t sparsity)
+{
+    return (sparsity & 0x00ff'ffffu) | (MatrixElementOne << 30u);
+}
+
+static constexpr uint32_t MatrixSparsityGeneral = 0xffff'ffffu;
+static constexpr uint32_t MatrixSparsityIdentity = getMatrixSparsity(
+    MatrixElementOne, MatrixElementZero, MatrixElementZero, MatrixElementZero,
+    MatrixElementZero, MatrixElementOne, MatrixElementZero, MatrixElementZero,
+    MatrixElementZero, MatrixElementZero, MatrixElementOne, MatrixElementZero,
+    MatrixElementZero, MatrixElementZero, MatrixElementZero, MatrixElementOne);
+// getMatrixFromTranslation.
+static constexpr uint32_t MatrixSparsityTranslation = getMatrixSparsity(
+    MatrixElementOne, MatrixElementZero, MatrixElementZero, MatrixElementAny,
+    MatrixElementZero, MatrixElementOne, MatrixElementZero, MatrixElementAny,
+    MatrixElementZero, MatrixElementZero, MatrixElementOne, MatrixElementAny,
+    MatrixElementZero, MatrixElementZero, MatrixElementZero, MatrixElementOne);
+// getMatrixFromScale.
+static constexpr uint32_t MatrixSparsityScale = getMatrixSparsity(
+    MatrixElementAny, MatrixElementZero, MatrixElementZero, MatrixElementZero,
+    MatrixElementZero, MatrixElementAny, MatrixElementZero, MatrixElementZero,
+    MatrixElementZero, MatrixElementZero, MatrixElementAny, MatrixElementZero,
+    MatrixElementZero, MatrixElementZero, MatrixElementZero, MatrixElementOne);
+// getMatrixFromQuaternion.
+static constexpr uint32_t MatrixSparsityRotation = getMatrixSparsity(
+    MatrixElementAny, MatrixElementAny, MatrixElementAny, MatrixElementZero,
+    MatrixElementAny, MatrixElementAny, MatrixElementAny, MatrixElementZero,
+    MatrixElementAny, MatrixElementAny, MatrixElementAny, MatrixElementZero,
+    MatrixElementZero, MatrixElementZero, MatrixElementZero, MatrixElementOne);
+// Any Mat3x4, getMat4FromTransform and createMatrixFromLookAt.
+static constexpr uint32_t MatrixSparsityAffine = getMat3x4Sparsity(MatrixSparsityGeneral);
+// createOrthoMatrix.
+static constexpr uint32_t MatrixSparsityOrtho = getMatrixSparsity(
+    MatrixElementAny, MatrixElementZero, MatrixElementZero, MatrixElementZero,
+    MatrixElementZero, MatrixElementAny, MatrixElementZero, MatrixElementZero,
+    MatrixElementZero, MatrixElementZero, MatrixElementAny, MatrixElementAny,
+    MatrixElementZero, MatrixElementZero, MatrixElementZero, MatrixElementOne);
+// createPerspectiveMatrix.
+static constexpr uint32_t MatrixSparsityPerspective = getMatrixSparsity(
+    MatrixElementAny, MatrixElementZero, MatrixElementZero, MatrixElementZero,
+    MatrixElementZero, MatrixElementAny, MatrixElementZero, MatrixElementZero,
+    MatrixElementZero, MatrixElementZero, MatrixElementAny, MatrixElementAny,
+    MatrixElementZero, MatrixElementZero, MatrixElementMinusOne, MatrixElementZero);
+
+// Sparsity covering every matrix of kind, for getting from MatrixKind to multiplySparse.
+constexpr uint32_t getMatrixKindSparsity(MatrixKind kind)
+{
+    return kind == MatrixKindIdentity ? MatrixSparsityIdentity
+        : kind == MatrixKindTranslation ? MatrixSparsityTranslation
+        : kind <= MatrixKindAffine ? MatrixSparsityAffine
+        : kind == MatrixKindPerspective ? getMatrixSparsity(
+            MatrixElementAny, MatrixElementZero, MatrixElementAny, MatrixElementZero,
+            MatrixElementZero, MatrixElementAny, MatrixElementAny, MatrixElementZero,
+            MatrixElementZero, MatrixElementZero, MatrixElementAny, MatrixElementAny,
+            MatrixElementZero, MatrixElementZero, MatrixElementAny, MatrixElementZero)
+        : MatrixSparsityGeneral;
+}
+
+// Term a[row][k] * b[k][col] of a product element.
+enum SparseTerm : uint32_t
+{
+    SparseTermZero,
+    SparseTermOne,
+    SparseTermMinusOne,
+    SparseTermA,
+    SparseTermMinusA,
+    SparseTermB,
+    SparseTermMinusB,
+    SparseTermAB,
+};
+
+constexpr uint32_t getSparseTerm(uint32_t sparsityA, uint32_t sparsityB, uint32_t index, uint32_t k)
+{
+    const uint32_t elementA = getMatrixElement(sparsityA, (index & ~3u) + k);
+    const uint32_t elementB = getMatrixElement(sparsityB, k * 4u + (index & 3u));
+    if(elementA == MatrixElementZero || elementB == MatrixElementZero)
+        return SparseTermZero;
+    if(elementA == MatrixElementAny && elementB == MatrixElementAny)
+        return SparseTermAB;
+    if(elementA == MatrixElementAny)
+        return elementB == MatrixElementOne ? SparseTermA : SparseTermMinusA;
+    if(elementB == MatrixElementAny)
+        return elementA == MatrixElementOne ? SparseTermB : SparseTermMinusB;
+    return elementA == elementB ? SparseTermOne : SparseTermMinusOne;
+}
+
+constexpr bool isSparseTermNegative(uint32_t term)
+{
+    return term == SparseTermMinusOne || term == SparseTermMinusA || term == SparseTermMinusB;
+}
+
+// Sparsity of a * b. An element is constant only when it has a single constant term.
+constexpr uint32_t getProductSparsity(uint32_t sparsityA, uint32_t sparsityB)
+{
+    uint32_t result = 0u;
+    for(uint32_t index = 0; index < 16u; ++index)
+    {
+        uint32_t termCount = 0u;
+        uint32_t lastTerm = SparseTermZero;
+        for(uint32_t k = 0; k < 4u; ++k)
+        {
+            const uint32_t term = getSparseTerm(sparsityA, sparsityB, index, k);
+            if(term != SparseTermZero)
+            {
+                ++termCount;
+                lastTerm = term;
+            }
+        }
+        uint32_t element = MatrixElementAny;
+        if(termCount == 0u)
+            element = MatrixElementZero;
+        else if(termCount == 1u && lastTerm == SparseTermOne)
+            element = MatrixElementOne;
+        else if(termCount == 1u && lastTerm == SparseTermMinusOne)
+            element = MatrixElementMinusOne;
+        result |= element << (index * 2u);
+    }
+    return result;
+}
+
+// Elements declared 0, 1 or -1 are exactly that, for checking inputs of multiplySparse.
+inline bool isMatchingSparsity(const float *m, uint32_t elementCount, uint32_t sparsity)
+{
+    for(uint32_t i = 0; i < elementCount; ++i)
+    {
+        const uint32_t element = getMatrixElement(sparsity, i);
+        if((element == MatrixElementZero && m[i] != 0.0f)
+            || (element == MatrixElementOne && m[i] != 1.0f)
+            || (element == MatrixElementMinusOne && m[i] != -1.0f))
+            return false;
+    }
+    return true;
+}
+
+inline bool isMatchingSparsity(const Mat4x4 &m, uint32_t sparsity)
+{
+    return isMatchingSparsity(&m._00, 16u, sparsity);
+}
+
+inline bool isMatchingSparsity(const Mat3x4 &m, uint32_t sparsity)
+{
+    return isMatchingSparsity(&m._00, 12u, sparsity);
+}
+
+template <uint32_t SparsityA, uint32_t SparsityB, uint32_t Index, uint32_t K>
+static inline float sGetSparseTermValue(const float *a, const float *b)
+{
+    constexpr uint32_t term = getSparseTerm(SparsityA, SparsityB, Index, K);
+    if constexpr(term == SparseTermAB)
+        return a[(Index & ~3u) + K] * b[K * 4u + (Index & 3u)];
+    else if constexpr(term == SparseTermA || term == SparseTermMinusA)
+        return a[(Index & ~3u) + K];
+    else if constexpr(term == SparseTermB || term == SparseTermMinusB)
+        return b[K * 4u + (Index & 3u)];
+    else
+        return 1.0f;
+}
+
+template <uint32_t SparsityA, uint32_t SparsityB, uint32_t Index, uint32_t K>
+static inline float sAddSparseTerms(float sum, const float *a, const float *b)
+{
+    if constexpr(K == 4u)
+        return sum;
+    else
+    {
+        constexpr uint32_t term = getSparseTerm(SparsityA, SparsityB, Index, K);
+        if constexpr(term == SparseTermZero)
+            return sAddSparseTerms<SparsityA, SparsityB, Index, K + 1u>(sum, a, b);
+        else if constexpr(isSparseTermNegative(term))
+            return sAddSparseTerms<SparsityA, SparsityB, Index, K + 1u>(
+                sum - sGetSparseTermValue<SparsityA, SparsityB, Index, K>(a, b), a, b);
+        else
+            return sAddSparseTerms<SparsityA, SparsityB, Index, K + 1u>(
+                sum + sGetSparseTermValue<SparsityA, SparsityB, Index, K>(a, b), a, b);
+    }
+}
+
+// The first non-zero term starts the sum, so no 0.0f + x is left for the compiler.
+template <uint32_t SparsityA, uint32_t SparsityB, uint32_t Index, uint32_t K = 0u>
+static inline float sGetSparseProductElement(const float *a, const float *b)
+{
+    if constexpr(K == 4u)
+        return 0.0f;
+    else
+    {
+        constexpr uint32_t term = getSparseTerm(SparsityA, SparsityB, Index, K);
+        if constexpr(term == SparseTermZero)
+            return sGetSparseProductElement<SparsityA, SparsityB, Index, K + 1u>(a, b);
+        else if constexpr(isSparseTermNegative(term))
+            return sAddSparseTerms<SparsityA, SparsityB, Index, K + 1u>(
+                -sGetSparseTermValue<SparsityA, SparsityB, Index, K>(a, b), a, b);
+        else
+            return sAddSparseTerms<SparsityA, SparsityB, Index, K + 1u>(
+                sGetSparseTermValue<SparsityA, SparsityB, Index, K>(a, b), a, b);
+    }
+}
+
+template <uint32_t SparsityA, uint32_t SparsityB, uint32_t... Indices>
+static inline void sMultiplySparse(const float *a, const float *b, float *outResult,
+    std::integer_sequence<uint32_t, Indices...>)
+{
+    ((outResult[Indices] = sGetSparseProductElement<SparsityA, SparsityB, Indices>(a, b)), ...);
+}
+
+// a * b where a matches SparsityA and b SparsityB, e.g.
+// multiplySparse<MatrixSparsityPerspective, MatrixSparsityAffine>(projection, view).
+// Chains take the sparsity of the earlier product from getProductSparsity.
+// Mat3x4 operands use getMat3x4Sparsity of theirs.
+template <uint32_t SparsityA, uint32_t SparsityB>
+inline Mat4x4 multiplySparse(const Mat4x4 &a, const Mat4x4 &b)
+{
+    Mat4x4 result{ UninitType{} };
+    sMultiplySparse<SparsityA, SparsityB>(&a._00, &b._00, &result._00,
+        std::make_integer_sequence<uint32_t, 16u>{});
+    return result;
+}
+
+template <uint32_t SparsityA, uint32_t SparsityB>
+inline Mat4x4 multiplySparse(const Mat4x4 &a, const Mat3x4 &b)
+{
+    Mat4x4 result{ UninitType{} };
+    sMultiplySparse<SparsityA, getMat3x4Sparsity(SparsityB)>(&a._00, &b._00, &result._00,
+        std::make_integer_sequence<uint32_t, 16u>{});
+    return result;
+}
+
+template <uint32_t SparsityA, uint32_t SparsityB>
+inline Mat4x4 multiplySparse(const Mat3x4 &a, const Mat4x4 &b)
+{
+    Mat4x4 result{ UninitType{} };
+    sMultiplySparse<getMat3x4Sparsity(SparsityA), SparsityB>(&a._00, &b._00, &result._00,
+        std::make_integer_sequence<uint32_t, 12u>{});
+    result._30 = b._30;
+    result._31 = b._31;
+    result._32 = b._32;
+    result._33 = b._33;
+    return result;
+}
+
+template <uint32_t SparsityA, uint32_t SparsityB>
+inline Mat3x4 multiplySparse(const Mat3x4 &a, const Mat3x4 &b)
+{
+    Mat3x4 result{ UninitType{} };
+    sMultiplySparse<getMat3x4Sparsity(SparsityA), getMat3x4Sparsity(SparsityB)>(&a._00, &b._00, &result._00,
+        std::make_integer_sequence<uint32_t, 12u>{});
+    return result;
+}
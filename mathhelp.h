@@ -1,9 +1,25 @@
 #pragma once
 
 
+// What failed ASSERT_MATH and DEBUG_BREAK_MACRO_MATH do, set CARPMATH_ASSERT_POLICY
+// (cmake cache string trap/count/ignore). Trap breaks into debugger, count adds to
+// getMathAssertFailureCount and ignore compiles the checks out.
+#define CARPMATH_ASSERT_TRAP 0
+#define CARPMATH_ASSERT_COUNT 1
+#define CARPMATH_ASSERT_IGNORE 2
+
+#ifndef CARPMATH_ASSERT_POLICY
+#define CARPMATH_ASSERT_POLICY CARPMATH_ASSERT_TRAP
+#endif
+
 #ifndef DEBUG_BREAK_MACRO_MATH
-#if _MSC_VER
-#define DEBUG_BREAK_MACRO() __debugbreak()
+#if CARPMATH_ASSERT_POLICY == CARPMATH_ASSERT_IGNORE
+#define DEBUG_BREAK_MACRO_MATH() do {} while(0)
+#elif CARPMATH_ASSERT_POLICY == CARPMATH_ASSERT_COUNT
+#include "profile.h"
+#define DEBUG_BREAK_MACRO_MATH() addMathAssertFailure()
+#elif _MSC_VER
+#define DEBUG_BREAK_MACRO_MATH() __debugbreak()
 #else
 #include <signal.h>
 #define DEBUG_BREAK_MACRO_MATH() raise(SIGTRAP)
@@ -11,16 +27,29 @@
 #endif
 
 #ifndef ASSERT_MATH
+#if CARPMATH_ASSERT_POLICY == CARPMATH_ASSERT_IGNORE
+#define ASSERT_MATH(x) do {} while(0)
+#else
 #define ASSERT_MATH(x) do{ if(x) {} else { DEBUG_BREAK_MACRO_MATH(); } } while(0)
 #endif
+#endif
 
 #include <math.h>
 #include <stdint.h>
+#include <string.h>
 
 #ifndef PI
 #define PI (3.141596f)
 #endif
 
+#if (__AVX__ || __SSE__ || __SSE2__ || __SSE3__ || __SSE4_1__ || _M_AMD64 || _M_X64) && 1
+#define MATHHELP_SIMD_SSE 1
+#include <xmmintrin.h>
+#endif
+
+// Below this normalize treats vectors as zero length.
+static constexpr float NormalizeMinSqrLength = 1.0e-8f;
+
 static float sTanF(float f)
 {
     return ::tanf(f);
@@ -35,11 +64,69 @@ static float sCosF(float f)
     return ::cosf(f);
 }
 
+static float sAcosF(float f)
+{
+    return ::acosf(f);
+}
+
 static float sSqrtF(float f)
 {
     return ::sqrt(f);
 }
 
+// Approximate 1 / sqrt(f), rsqrt estimate with one Newton-Raphson step.
+static float sRsqrtFastF(float f)
+{
+#if MATHHELP_SIMD_SSE
+    const float y = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(f)));
+    return y * (1.5f - 0.5f * f * y * y);
+#else
+    return 1.0f / sSqrtF(f);
+#endif
+}
+
+// Returns f >= limit ? a : b, selected with a bit mask instead of a branch. False for NaN f.
+static float sSelectGreaterEqualF(float f, float limit, float a, float b)
+{
+    const uint32_t mask = 0u - uint32_t(f >= limit);
+    uint32_t bitsA;
+    uint32_t bitsB;
+    memcpy(&bitsA, &a, sizeof(float));
+    memcpy(&bitsB, &b, sizeof(float));
+    const uint32_t bits = (bitsA & mask) | (bitsB & ~mask);
+    float result;
+    memcpy(&result, &bits, sizeof(float));
+    return result;
+}
+
+static uint32_t sPopCount64(uint64_t v)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return uint32_t(__builtin_popcountll(v));
+#else
+    v = v - ((v >> 1u) & 0x5555555555555555ull);
+    v = (v & 0x3333333333333333ull) + ((v >> 2u) & 0x3333333333333333ull);
+    v = (v + (v >> 4u)) & 0x0f0f0f0f0f0f0f0full;
+    return uint32_t((v * 0x0101010101010101ull) >> 56u);
+#endif
+}
+
+// v must not be 0.
+static uint32_t sCountTrailingZeros64(uint64_t v)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return uint32_t(__builtin_ctzll(v));
+#else
+    uint32_t count = 0;
+    while((v & 1u) == 0)
+    {
+        v >>= 1u;
+        ++count;
+    }
+    return count;
+#endif
+}
+
 static float sMinF(float f1, float f2)
 {
     return f1 < f2 ? f1 : f2;
@@ -0,0 +1,334 @@
+#include "morton.h"
+
+#include "dispatch.h"
+#include "profile.h"
+#include "simdhelp.h"
+
+#if SIMDHELP_SSE
+#include <emmintrin.h>
+#endif
+#if CARPMATH_X86
+#include <immintrin.h>
+#endif
+
+static constexpr float Morton30CellCount = 1024.0f;
+static constexpr float Morton63CellCount = 2097152.0f;
+
+// Spreads the low 10 bits so 2 zero bits follow each.
+static uint32_t sSpreadBits30(uint32_t v)
+{
+    v &= 0x3FFu;
+    v = (v | v << 16u) & 0x030000FFu;
+    v = (v | v << 8u) & 0x0300F00Fu;
+    v = (v | v << 4u) & 0x030C30C3u;
+    v = (v | v << 2u) & 0x09249249u;
+    return v;
+}
+
+static uint32_t sCompactBits30(uint32_t v)
+{
+    v &= 0x09249249u;
+    v = (v ^ v >> 2u) & 0x030C30C3u;
+    v = (v ^ v >> 4u) & 0x0300F00Fu;
+    v = (v ^ v >> 8u) & 0x030000FFu;
+    v = (v ^ v >> 16u) & 0x3FFu;
+    return v;
+}
+
+// Spreads the low 21 bits so 2 zero bits follow each.
+static uint64_t sSpreadBits63(uint64_t v)
+{
+    v &= 0x1FFFFFu;
+    v = (v | v << 32u) & 0x001F00000000FFFFull;
+    v = (v | v << 16u) & 0x001F0000FF0000FFull;
+    v = (v | v << 8u) & 0x100F00F00F00F00Full;
+    v = (v | v << 4u) & 0x10C30C30C30C30C3ull;
+    v = (v | v << 2u) & 0x1249249249249249ull;
+    return v;
+}
+
+static uint32_t sCompactBits63(uint64_t v)
+{
+    v &= 0x1249249249249249ull;
+    v = (v ^ v >> 2u) & 0x10C30C30C30C30C3ull;
+    v = (v ^ v >> 4u) & 0x100F00F00F00F00Full;
+    v = (v ^ v >> 8u) & 0x001F0000FF0000FFull;
+    v = (v ^ v >> 16u) & 0x001F00000000FFFFull;
+    v = (v ^ v >> 32u) & 0x1FFFFFu;
+    return uint32_t(v);
+}
+
+uint32_t encodeMorton30(uint32_t x, uint32_t y, uint32_t z)
+{
+    return sSpreadBits30(x) | sSpreadBits30(y) << 1u | sSpreadBits30(z) << 2u;
+}
+
+uint64_t encodeMorton63(uint32_t x, uint32_t y, uint32_t z)
+{
+    return sSpreadBits63(x) | sSpreadBits63(y) << 1u | sSpreadBits63(z) << 2u;
+}
+
+void decodeMorton30(uint32_t code, uint32_t &outX, uint32_t &outY, uint32_t &outZ)
+{
+    outX = sCompactBits30(code);
+    outY = sCompactBits30(code >> 1u);
+    outZ = sCompactBits30(code >> 2u);
+}
+
+void decodeMorton63(uint64_t code, uint32_t &outX, uint32_t &outY, uint32_t &outZ)
+{
+    outX = sCompactBits63(code);
+    outY = sCompactBits63(code >> 1u);
+    outZ = sCompactBits63(code >> 2u);
+}
+
+// Nan goes to cell 0 like the SIMD versions.
+static uint32_t sQuantize(float v, float origin, float scale, float maxCell)
+{
+    float f = (v - origin) * scale;
+    f = f > 0.0f ? f : 0.0f;
+    f = f < maxCell ? f : maxCell;
+    return uint32_t(f);
+}
+
+static void sComputeMortonCodes30Scalar(const Vec3 *positions, uint32_t count, const Vec3 &origin,
+    const Vec3 &scale, uint32_t *outCodes)
+{
+    const float maxCell = Morton30CellCount - 1.0f;
+    for(uint32_t i = 0; i < count; ++i)
+    {
+        const Vec3 &p = positions[i];
+        outCodes[i] = encodeMorton30(
+            sQuantize(p.x, origin.x, scale.x, maxCell),
+            sQuantize(p.y, origin.y, scale.y, maxCell),
+            sQuantize(p.z, origin.z, scale.z, maxCell));
+    }
+}
+
+static void sComputeMortonCodes63Scalar(const Vec3 *positions, uint32_t count, const Vec3 &origin,
+    const Vec3 &scale, uint64_t *outCodes)
+{
+    const float maxCell = Morton63CellCount - 1.0f;
+    for(uint32_t i = 0; i < count; ++i)
+    {
+        const Vec3 &p = positions[i];
+        outCodes[i] = encodeMorton63(
+            sQuantize(p.x, origin.x, scale.x, maxCell),
+            sQuantize(p.y, origin.y, scale.y, maxCell),
+            sQuantize(p.z, origin.z, scale.z, maxCell));
+    }
+}
+
+#if SIMDHELP_SSE
+
+// Max with zero first, it returns the second operand for nan.
+static inline __m128i sQuantize4(__m128 v, __m128 origin, __m128 scale, __m128 maxCell)
+{
+    const __m128 f = _mm_max_ps(_mm_mul_ps(_mm_sub_ps(v, origin), scale), _mm_setzero_ps());
+    return _mm_cvttps_epi32(_mm_min_ps(f, maxCell));
+}
+
+static inline __m128i sSpreadBits30x4(__m128i v)
+{
+    v = _mm_and_si128(_mm_or_si128(v, _mm_slli_epi32(v, 16)), _mm_set1_epi32(0x030000FF));
+    v = _mm_and_si128(_mm_or_si128(v, _mm_slli_epi32(v, 8)), _mm_set1_epi32(0x0300F00F));
+    v = _mm_and_si128(_mm_or_si128(v, _mm_slli_epi32(v, 4)), _mm_set1_epi32(0x030C30C3));
+    v = _mm_and_si128(_mm_or_si128(v, _mm_slli_epi32(v, 2)), _mm_set1_epi32(0x09249249));
+    return v;
+}
+
+// Two 64 bit lanes, input is at most 21 bits so the first step needs no mask.
+static inline __m128i sSpreadBits63x2(__m128i v)
+{
+    v = _mm_and_si128(_mm_or_si128(v, _mm_slli_epi64(v, 32)), _mm_set1_epi64x(0x001F00000000FFFFll));
+    v = _mm_and_si128(_mm_or_si128(v, _mm_slli_epi64(v, 16)), _mm_set1_epi64x(0x001F0000FF0000FFll));
+    v = _mm_and_si128(_mm_or_si128(v, _mm_slli_epi64(v, 8)), _mm_set1_epi64x(0x100F00F00F00F00Fll));
+    v = _mm_and_si128(_mm_or_si128(v, _mm_slli_epi64(v, 4)), _mm_set1_epi64x(0x10C30C30C30C30C3ll));
+    v = _mm_and_si128(_mm_or_si128(v, _mm_slli_epi64(v, 2)), _mm_set1_epi64x(0x1249249249249249ll));
+    return v;
+}
+
+static void sComputeMortonCodes30SSE(const Vec3 *positions, uint32_t count, const Vec3 &origin,
+    const Vec3 &scale, uint32_t *outCodes)
+{
+    const __m128 maxCell = _mm_set1_ps(Morton30CellCount - 1.0f);
+    const __m128 originX = _mm_set1_ps(origin.x);
+    const __m128 originY = _mm_set1_ps(origin.y);
+    const __m128 originZ = _mm_set1_ps(origin.z);
+    const __m128 scaleX = _mm_set1_ps(scale.x);
+    const __m128 scaleY = _mm_set1_ps(scale.y);
+    const __m128 scaleZ = _mm_set1_ps(scale.z);
+    uint32_t i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        __m128 x;
+        __m128 y;
+        __m128 z;
+        sLoadVec3x4(positions + i, x, y, z);
+        const __m128i cx = sSpreadBits30x4(sQuantize4(x, originX, scaleX, maxCell));
+        const __m128i cy = sSpreadBits30x4(sQuantize4(y, originY, scaleY, maxCell));
+        const __m128i cz = sSpreadBits30x4(sQuantize4(z, originZ, scaleZ, maxCell));
+        const __m128i code = _mm_or_si128(cx, _mm_or_si128(_mm_slli_epi32(cy, 1), _mm_slli_epi32(cz, 2)));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(outCodes + i), code);
+    }
+    sComputeMortonCodes30Scalar(positions + i, count - i, origin, scale, outCodes + i);
+}
+
+static void sComputeMortonCodes63SSE(const Vec3 *positions, uint32_t count, const Vec3 &origin,
+    const Vec3 &scale, uint64_t *outCodes)
+{
+    const __m128 maxCell = _mm_set1_ps(Morton63CellCount - 1.0f);
+    const __m128 originX = _mm_set1_ps(origin.x);
+    const __m128 originY = _mm_set1_ps(origin.y);
+    const __m128 originZ = _mm_set1_ps(origin.z);
+    const __m128 scaleX = _mm_set1_ps(scale.x);
+    const __m128 scaleY = _mm_set1_ps(scale.y);
+    const __m128 scaleZ = _mm_set1_ps(scale.z);
+    const __m128i zero = _mm_setzero_si128();
+    uint32_t i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        __m128 x;
+        __m128 y;
+        __m128 z;
+        sLoadVec3x4(positions + i, x, y, z);
+        const __m128i qx = sQuantize4(x, originX, scaleX, maxCell);
+        const __m128i qy = sQuantize4(y, originY, scaleY, maxCell);
+        const __m128i qz = sQuantize4(z, originZ, scaleZ, maxCell);
+        const __m128i low = _mm_or_si128(sSpreadBits63x2(_mm_unpacklo_epi32(qx, zero)),
+            _mm_or_si128(_mm_slli_epi64(sSpreadBits63x2(_mm_unpacklo_epi32(qy, zero)), 1),
+                _mm_slli_epi64(sSpreadBits63x2(_mm_unpacklo_epi32(qz, zero)), 2)));
+        const __m128i high = _mm_or_si128(sSpreadBits63x2(_mm_unpackhi_epi32(qx, zero)),
+            _mm_or_si128(_mm_slli_epi64(sSpreadBits63x2(_mm_unpackhi_epi32(qy, zero)), 1),
+                _mm_slli_epi64(sSpreadBits63x2(_mm_unpackhi_epi32(qz, zero)), 2)));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(outCodes + i), low);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(outCodes + i + 2), high);
+    }
+    sComputeMortonCodes63Scalar(positions + i, count - i, origin, scale, outCodes + i);
+}
+
+#endif
+
+#if CARPMATH_X86
+
+CARPMATH_TARGET_AVX2 static inline __m256i sQuantize8(__m256 v, __m256 origin, __m256 scale, __m256 maxCell)
+{
+    const __m256 f = _mm256_max_ps(_mm256_mul_ps(_mm256_sub_ps(v, origin), scale), _mm256_setzero_ps());
+    return _mm256_cvttps_epi32(_mm256_min_ps(f, maxCell));
+}
+
+CARPMATH_TARGET_AVX2 static inline __m256i sSpreadBits30x8(__m256i v)
+{
+    v = _mm256_and_si256(_mm256_or_si256(v, _mm256_slli_epi32(v, 16)), _mm256_set1_epi32(0x030000FF));
+    v = _mm256_and_si256(_mm256_or_si256(v, _mm256_slli_epi32(v, 8)), _mm256_set1_epi32(0x0300F00F));
+    v = _mm256_and_si256(_mm256_or_si256(v, _mm256_slli_epi32(v, 4)), _mm256_set1_epi32(0x030C30C3));
+    v = _mm256_and_si256(_mm256_or_si256(v, _mm256_slli_epi32(v, 2)), _mm256_set1_epi32(0x09249249));
+    return v;
+}
+
+CARPMATH_TARGET_AVX2 static void sComputeMortonCodes30AVX2(const Vec3 *positions, uint32_t count,
+    const Vec3 &origin, const Vec3 &scale, uint32_t *outCodes)
+{
+    const __m256 maxCell = _mm256_set1_ps(Morton30CellCount - 1.0f);
+    const __m256 originX = _mm256_set1_ps(origin.x);
+    const __m256 originY = _mm256_set1_ps(origin.y);
+    const __m256 originZ = _mm256_set1_ps(origin.z);
+    const __m256 scaleX = _mm256_set1_ps(scale.x);
+    const __m256 scaleY = _mm256_set1_ps(scale.y);
+    const __m256 scaleZ = _mm256_set1_ps(scale.z);
+    uint32_t i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        __m256 x;
+        __m256 y;
+        __m256 z;
+        sLoadVec3x8(positions + i, x, y, z);
+        const __m256i cx = sSpreadBits30x8(sQuantize8(x, originX, scaleX, maxCell));
+        const __m256i cy = sSpreadBits30x8(sQuantize8(y, originY, scaleY, maxCell));
+        const __m256i cz = sSpreadBits30x8(sQuantize8(z, originZ, scaleZ, maxCell));
+        const __m256i code = _mm256_or_si256(cx, _mm256_or_si256(_mm256_slli_epi32(cy, 1), _mm256_slli_epi32(cz, 2)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(outCodes + i), code);
+    }
+    sComputeMortonCodes30Scalar(positions + i, count - i, origin, scale, outCodes + i);
+}
+
+// 64 bit spreading takes 5 steps on 4 lanes, three pdeps per point are cheaper.
+CARPMATH_TARGET_AVX2_BMI2 static void sComputeMortonCodes63BMI2(const Vec3 *positions, uint32_t count,
+    const Vec3 &origin, const Vec3 &scale, uint64_t *outCodes)
+{
+    const __m256 maxCell = _mm256_set1_ps(Morton63CellCount - 1.0f);
+    const __m256 originX = _mm256_set1_ps(origin.x);
+    const __m256 originY = _mm256_set1_ps(origin.y);
+    const __m256 originZ = _mm256_set1_ps(origin.z);
+    const __m256 scaleX = _mm256_set1_ps(scale.x);
+    const __m256 scaleY = _mm256_set1_ps(scale.y);
+    const __m256 scaleZ = _mm256_set1_ps(scale.z);
+    alignas(32) uint32_t qx[8];
+    alignas(32) uint32_t qy[8];
+    alignas(32) uint32_t qz[8];
+    uint32_t i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        __m256 x;
+        __m256 y;
+        __m256 z;
+        sLoadVec3x8(positions + i, x, y, z);
+        _mm256_store_si256(reinterpret_cast<__m256i *>(qx), sQuantize8(x, originX, scaleX, maxCell));
+        _mm256_store_si256(reinterpret_cast<__m256i *>(qy), sQuantize8(y, originY, scaleY, maxCell));
+        _mm256_store_si256(reinterpret_cast<__m256i *>(qz), sQuantize8(z, originZ, scaleZ, maxCell));
+        for(uint32_t j = 0; j < 8; ++j)
+        {
+            outCodes[i + j] = _pdep_u64(qx[j], 0x1249249249249249ull)
+                | _pdep_u64(qy[j], 0x2492492492492492ull)
+                | _pdep_u64(qz[j], 0x4924924924924924ull);
+        }
+    }
+    sComputeMortonCodes63Scalar(positions + i, count - i, origin, scale, outCodes + i);
+}
+
+#endif
+
+void bindMortonKernels(SimdKernels &kernels, SimdBackend backend)
+{
+    kernels.computeMortonCodes30 = sComputeMortonCodes30Scalar;
+    kernels.computeMortonCodes63 = sComputeMortonCodes63Scalar;
+#if SIMDHELP_SSE
+    if(backend >= SimdBackendSSE4)
+    {
+        kernels.computeMortonCodes30 = sComputeMortonCodes30SSE;
+        kernels.computeMortonCodes63 = sComputeMortonCodes63SSE;
+    }
+#endif
+#if CARPMATH_X86
+    if(backend >= SimdBackendAVX2)
+    {
+        kernels.computeMortonCodes30 = sComputeMortonCodes30AVX2;
+        if(getCpuFeatures().bmi2)
+            kernels.computeMortonCodes63 = sComputeMortonCodes63BMI2;
+    }
+#endif
+}
+
+// Cells per unit on each axis, flat axes put everything in cell 0.
+static Vec3 sGetQuantizeScale(const AABB &bounds, float cellCount)
+{
+    const Vec3 size = getSize(bounds);
+    return Vec3(
+        size.x > 0.0f ? cellCount / size.x : 0.0f,
+        size.y > 0.0f ? cellCount / size.y : 0.0f,
+        size.z > 0.0f ? cellCount / size.z : 0.0f);
+}
+
+void computeMortonCodes(const Vec3 *positions, uint32_t count, const AABB &bounds, uint32_t *outCodes)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdComputeMortonCodes, count);
+    getSimdKernels().computeMortonCodes30(positions, count, bounds.min,
+        sGetQuantizeScale(bounds, Morton30CellCount), outCodes);
+}
+
+void computeMortonCodes(const Vec3 *positions, uint32_t count, const AABB &bounds, uint64_t *outCodes)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdComputeMortonCodes, count);
+    getSimdKernels().computeMortonCodes63(positions, count, bounds.min,
+        sGetQuantizeScale(bounds, Morton63CellCount), outCodes);
+}
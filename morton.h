@@ -0,0 +1,23 @@
+#pragma once
+
+#include "aabb.h"
+#include "vec3.h"
+
+#include <stdint.h>
+
+// Morton, or Z-order, codes interleave the bits of quantized x, y and z, x in the lowest
+// bit. Points close in space mostly get close codes, so sorting items by code with
+// radixSort and reordering their arrays with applyPermutation makes later batch passes
+// walk memory in spatial order.
+
+// 10 bits per axis.
+uint32_t encodeMorton30(uint32_t x, uint32_t y, uint32_t z);
+// 21 bits per axis.
+uint64_t encodeMorton63(uint32_t x, uint32_t y, uint32_t z);
+void decodeMorton30(uint32_t code, uint32_t &outX, uint32_t &outY, uint32_t &outZ);
+void decodeMorton63(uint64_t code, uint32_t &outX, uint32_t &outY, uint32_t &outZ);
+
+// Quantizes each axis of bounds to the full range of the code, positions outside bounds
+// are clamped to it. Sort 30 bit codes with keyBits 30 and 63 bit codes with keyBits 63.
+void computeMortonCodes(const Vec3 *positions, uint32_t count, const AABB &bounds, uint32_t *outCodes);
+void computeMortonCodes(const Vec3 *positions, uint32_t count, const AABB &bounds, uint64_t *outCodes);
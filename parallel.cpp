@@ -0,0 +1,162 @@
+#include "parallel.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+static constexpr uint32_t ParallelMaxChunks = 256u;
+
+// Workers sleep on wake until generation changes, then take chunks of the current job
+// from nextChunk. Job fields are only written while no worker is active.
+struct ParallelPool
+{
+    ParallelPool() {}
+    ParallelPool(const ParallelPool &) = delete;
+    ParallelPool &operator=(const ParallelPool &) = delete;
+    ~ParallelPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wake.notify_all();
+        for(uint32_t i = 0; i < workerCount; ++i)
+            workers[i].join();
+    }
+
+    // Held by the thread running a job on the pool.
+    std::mutex submitMutex;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    std::thread workers[ParallelMaxChunks - 1u];
+    uint32_t workerCount = 0;
+    uint32_t activeCount = 0;
+    uint64_t generation = 0;
+    bool quit = false;
+
+    ParallelForFunc call = nullptr;
+    const void *func = nullptr;
+    uint32_t count = 0;
+    uint32_t chunkCount = 0;
+    std::atomic<uint32_t> nextChunk{ 0 };
+    std::atomic<uint32_t> finishedChunks{ 0 };
+};
+
+static thread_local bool sInParallelFor = false;
+
+static ParallelPool &sGetPool()
+{
+    static ParallelPool pool;
+    return pool;
+}
+
+// Returns true when this call finished the last chunk.
+static bool sRunChunks(ParallelPool &pool)
+{
+    bool finishedLast = false;
+    for(;;)
+    {
+        const uint32_t chunk = pool.nextChunk.fetch_add(1u, std::memory_order_relaxed);
+        if(chunk >= pool.chunkCount)
+            break;
+        const uint32_t begin = uint32_t(uint64_t(pool.count) * chunk / pool.chunkCount);
+        const uint32_t end = uint32_t(uint64_t(pool.count) * (chunk + 1u) / pool.chunkCount);
+        pool.call(pool.func, begin, end, chunk);
+        finishedLast = pool.finishedChunks.fetch_add(1u, std::memory_order_acq_rel) + 1u == pool.chunkCount;
+    }
+    return finishedLast;
+}
+
+static void sWorkerLoop(ParallelPool &pool, uint32_t workerIndex)
+{
+    sInParallelFor = true;
+    uint64_t seenGeneration = 0;
+    for(;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(pool.mutex);
+            pool.wake.wait(lock, [&]() { return pool.quit || pool.generation != seenGeneration; });
+            if(pool.quit)
+                return;
+            seenGeneration = pool.generation;
+            // Chunks beyond the caller and the first workers would only be contended for.
+            if(workerIndex + 1u >= pool.chunkCount)
+                continue;
+            ++pool.activeCount;
+        }
+        sRunChunks(pool);
+        {
+            std::lock_guard<std::mutex> lock(pool.mutex);
+            --pool.activeCount;
+        }
+        pool.done.notify_all();
+    }
+}
+
+uint32_t getThreadCount(uint32_t threadCount)
+{
+    if(threadCount > 0)
+        return threadCount;
+
+    uint32_t hwCount = uint32_t(std::thread::hardware_concurrency());
+    return hwCount > 0 ? hwCount : 1u;
+}
+
+void runParallelFor(uint32_t count, uint32_t chunkCount, ParallelForFunc call, const void *func)
+{
+    if(chunkCount > count)
+        chunkCount = count;
+    if(chunkCount > ParallelMaxChunks)
+        chunkCount = ParallelMaxChunks;
+    if(chunkCount <= 1)
+    {
+        if(count > 0)
+            call(func, 0u, count, 0u);
+        return;
+    }
+
+    ParallelPool &pool = sGetPool();
+    if(sInParallelFor || !pool.submitMutex.try_lock())
+    {
+        for(uint32_t chunk = 0; chunk < chunkCount; ++chunk)
+        {
+            call(func, uint32_t(uint64_t(count) * chunk / chunkCount),
+                uint32_t(uint64_t(count) * (chunk + 1u) / chunkCount), chunk);
+        }
+        return;
+    }
+    sInParallelFor = true;
+
+    {
+        std::unique_lock<std::mutex> lock(pool.mutex);
+        // Workers that woke late for the previous job may still read its fields.
+        pool.done.wait(lock, [&]() { return pool.activeCount == 0; });
+        while(pool.workerCount + 1u < chunkCount)
+        {
+            const uint32_t workerIndex = pool.workerCount++;
+            pool.workers[workerIndex] = std::thread([&pool, workerIndex]() { sWorkerLoop(pool, workerIndex); });
+        }
+        pool.call = call;
+        pool.func = func;
+        pool.count = count;
+        pool.chunkCount = chunkCount;
+        pool.nextChunk.store(0u, std::memory_order_relaxed);
+        pool.finishedChunks.store(0u, std::memory_order_relaxed);
+        ++pool.generation;
+    }
+    pool.wake.notify_all();
+
+    if(!sRunChunks(pool))
+    {
+        std::unique_lock<std::mutex> lock(pool.mutex);
+        pool.done.wait(lock, [&]()
+        {
+            return pool.finishedChunks.load(std::memory_order_acquire) == pool.chunkCount;
+        });
+    }
+
+    sInParallelFor = false;
+    pool.submitMutex.unlock();
+}
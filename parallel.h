@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdint.h>
+#include <thread>
+
+// Returns threadCount, or hardware concurrency when threadCount is 0.
+uint32_t getThreadCount(uint32_t threadCount);
+
+using ParallelForFunc = void (*)(const void *func, uint32_t begin, uint32_t end, uint32_t chunkIndex);
+
+// Type erased parallelFor, calls call(func, begin, end, chunkIndex).
+void runParallelFor(uint32_t count, uint32_t chunkCount, ParallelForFunc call, const void *func);
+
+// Splits [0, count) into chunkCount contiguous ranges and calls
+// func(begin, end, chunkIndex) for each range. Ranges run on a persistent worker pool,
+// started on first use and grown up to the largest chunkCount seen, and the calling
+// thread runs ranges too and waits for the rest. Once the pool has grown, calls do not
+// allocate. Nested calls, and calls while another thread uses the pool, run the ranges
+// in order on the calling thread, so ranges must not wait for each other.
+template <typename Func>
+void parallelFor(uint32_t count, uint32_t chunkCount, const Func &func)
+{
+    runParallelFor(count, chunkCount, [](const void *f, uint32_t begin, uint32_t end, uint32_t chunkIndex)
+    {
+        (*(const Func *)f)(begin, end, chunkIndex);
+    }, &func);
+}
@@ -0,0 +1,280 @@
+#include "profile.h"
+
+#include <atomic>
+
+static std::atomic<uint64_t> sMathAssertFailures{ 0 };
+
+void addMathAssertFailure()
+{
+    sMathAssertFailures.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t getMathAssertFailureCount()
+{
+    return sMathAssertFailures.load(std::memory_order_relaxed);
+}
+
+void resetMathAssertFailureCount()
+{
+    sMathAssertFailures.store(0, std::memory_order_relaxed);
+}
+
+static const char *sProfileIdNames[ProfileIdCount] =
+{
+    "normalize(Vec2)",
+    "normalize(Vec3)",
+    "normalize(Vec4)",
+    "normalize(Quat)",
+    "inverse(Mat4x4)",
+    "multiplyMatrices",
+    "getTransformsFromMatrices",
+    "orthonormalizeMatrices",
+    "rotateVectors",
+    "renormalizeQuats",
+    "projectPointsToScreen",
+    "intersectRayPacket8",
+    "convertVec3s",
+    "normalizeVec3s",
+    "diff",
+    "encodeTransformStream",
+    "decodeTransformStream",
+    "evaluateCurves",
+    "squad",
+    "sampleTracks",
+    "integrateEuler",
+    "integrateVerlet",
+    "integrateOrientations",
+    "buildSpatialHash",
+    "findPairs",
+    "computeMortonCodes",
+    "radixSort",
+    "applyPermutation",
+    "computeCovariances",
+    "solveSymmetricEigen",
+    "averageQuats",
+    "packColors",
+    "unpackColors",
+    "runFramePipeline",
+};
+
+static const char *sProfileEventNames[ProfileEventCount] =
+{
+    "normalize zero length",
+    "inverse singular",
+};
+
+const char *getProfileIdName(ProfileId id)
+{
+    return id < ProfileIdCount ? sProfileIdNames[id] : "unknown";
+}
+
+const char *getProfileEventName(ProfileEvent event)
+{
+    return event < ProfileEventCount ? sProfileEventNames[event] : "unknown";
+}
+
+#if CARPMATH_PROFILE
+
+#include <chrono>
+#include <mutex>
+
+// Only the owning thread writes, so plain load + store is enough and readers
+// on other threads see a consistent value per counter.
+using ProfileCounter = std::atomic<uint64_t>;
+
+struct ProfileTotals
+{
+    uint64_t calls[ProfileIdCount];
+    uint64_t items[ProfileIdCount];
+    uint64_t sampledCalls[ProfileIdCount];
+    uint64_t sampledNanoseconds[ProfileIdCount];
+    uint64_t events[ProfileEventCount];
+};
+
+struct ProfileThreadCounters
+{
+    ProfileThreadCounters();
+    ~ProfileThreadCounters();
+
+    ProfileCounter calls[ProfileIdCount];
+    ProfileCounter items[ProfileIdCount];
+    ProfileCounter sampledCalls[ProfileIdCount];
+    ProfileCounter sampledNanoseconds[ProfileIdCount];
+    ProfileCounter events[ProfileEventCount];
+    uint32_t sampleCountdown;
+
+    ProfileThreadCounters *prev;
+    ProfileThreadCounters *next;
+};
+
+static constexpr uint32_t ProfileDefaultSampleInterval = 64u;
+
+// Thread list, totals of exited threads and reset baseline are guarded by sMutex.
+// Hot path never takes it.
+static std::mutex sMutex;
+static ProfileThreadCounters *sThreads = nullptr;
+static ProfileTotals sExitedTotals = {};
+static ProfileTotals sBaseline = {};
+static std::atomic<uint32_t> sSampleInterval{ ProfileDefaultSampleInterval };
+
+static thread_local ProfileThreadCounters sCounters;
+
+static void sIncrement(ProfileCounter &counter, uint64_t amount)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+static int64_t sGetTimeNanoseconds()
+{
+    return int64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+static void sAddThreadCounters(const ProfileThreadCounters &counters, ProfileTotals &totals)
+{
+    for(uint32_t i = 0; i < ProfileIdCount; ++i)
+    {
+        totals.calls[i] += counters.calls[i].load(std::memory_order_relaxed);
+        totals.items[i] += counters.items[i].load(std::memory_order_relaxed);
+        totals.sampledCalls[i] += counters.sampledCalls[i].load(std::memory_order_relaxed);
+        totals.sampledNanoseconds[i] += counters.sampledNanoseconds[i].load(std::memory_order_relaxed);
+    }
+    for(uint32_t i = 0; i < ProfileEventCount; ++i)
+        totals.events[i] += counters.events[i].load(std::memory_order_relaxed);
+}
+
+// Caller holds sMutex.
+static ProfileTotals sGetTotals()
+{
+    ProfileTotals totals = sExitedTotals;
+    for(const ProfileThreadCounters *counters = sThreads; counters; counters = counters->next)
+        sAddThreadCounters(*counters, totals);
+    return totals;
+}
+
+ProfileThreadCounters::ProfileThreadCounters()
+{
+    for(uint32_t i = 0; i < ProfileIdCount; ++i)
+    {
+        calls[i].store(0, std::memory_order_relaxed);
+        items[i].store(0, std::memory_order_relaxed);
+        sampledCalls[i].store(0, std::memory_order_relaxed);
+        sampledNanoseconds[i].store(0, std::memory_order_relaxed);
+    }
+    for(uint32_t i = 0; i < ProfileEventCount; ++i)
+        events[i].store(0, std::memory_order_relaxed);
+    sampleCountdown = 0;
+
+    std::lock_guard<std::mutex> lock(sMutex);
+    prev = nullptr;
+    next = sThreads;
+    if(sThreads)
+        sThreads->prev = this;
+    sThreads = this;
+}
+
+ProfileThreadCounters::~ProfileThreadCounters()
+{
+    std::lock_guard<std::mutex> lock(sMutex);
+    sAddThreadCounters(*this, sExitedTotals);
+    if(prev)
+        prev->next = next;
+    else
+        sThreads = next;
+    if(next)
+        next->prev = prev;
+}
+
+ProfileScope::ProfileScope(ProfileId id, uint64_t items) : id(id), startTime(0)
+{
+    ProfileThreadCounters &counters = sCounters;
+    sIncrement(counters.calls[id], 1u);
+    sIncrement(counters.items[id], items);
+
+    const uint32_t interval = sSampleInterval.load(std::memory_order_relaxed);
+    if(interval == 0)
+        return;
+    if(counters.sampleCountdown == 0)
+    {
+        counters.sampleCountdown = interval - 1;
+        startTime = sGetTimeNanoseconds();
+    }
+    else
+    {
+        --counters.sampleCountdown;
+    }
+}
+
+ProfileScope::~ProfileScope()
+{
+    if(startTime == 0)
+        return;
+    const int64_t elapsed = sGetTimeNanoseconds() - startTime;
+    ProfileThreadCounters &counters = sCounters;
+    sIncrement(counters.sampledCalls[id], 1u);
+    sIncrement(counters.sampledNanoseconds[id], uint64_t(elapsed > 0 ? elapsed : 0));
+}
+
+void addProfileEvent(ProfileEvent event)
+{
+    sIncrement(sCounters.events[event], 1u);
+}
+
+ProfileStats getProfileStats(ProfileId id)
+{
+    ProfileStats stats = {};
+    if(id >= ProfileIdCount)
+        return stats;
+
+    std::lock_guard<std::mutex> lock(sMutex);
+    const ProfileTotals totals = sGetTotals();
+    stats.calls = totals.calls[id] - sBaseline.calls[id];
+    stats.items = totals.items[id] - sBaseline.items[id];
+    stats.sampledCalls = totals.sampledCalls[id] - sBaseline.sampledCalls[id];
+    stats.sampledNanoseconds = totals.sampledNanoseconds[id] - sBaseline.sampledNanoseconds[id];
+    return stats;
+}
+
+uint64_t getProfileEventCount(ProfileEvent event)
+{
+    if(event >= ProfileEventCount)
+        return 0;
+
+    std::lock_guard<std::mutex> lock(sMutex);
+    return sGetTotals().events[event] - sBaseline.events[event];
+}
+
+// Other threads may be writing, so instead of zeroing their counters the current
+// totals become the baseline that reads subtract.
+void resetProfileCounters()
+{
+    std::lock_guard<std::mutex> lock(sMutex);
+    sBaseline = sGetTotals();
+}
+
+void setProfileSampleInterval(uint32_t interval)
+{
+    sSampleInterval.store(interval, std::memory_order_relaxed);
+}
+
+#else
+
+ProfileStats getProfileStats(ProfileId)
+{
+    return ProfileStats{};
+}
+
+uint64_t getProfileEventCount(ProfileEvent)
+{
+    return 0;
+}
+
+void resetProfileCounters()
+{
+}
+
+void setProfileSampleInterval(uint32_t)
+{
+}
+
+#endif
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <stdint.h>
+
+// Opt-in instrumentation, enabled by building with CARPMATH_PROFILE=1 (cmake option
+// CARPMATH_PROFILE). Each thread writes its own counters without locks or atomic
+// read-modify-writes, readers sum over all threads. Every n-th call per thread is
+// timed, see setProfileSampleInterval. Without CARPMATH_PROFILE the macros compile to
+// nothing and the api returns zeros.
+
+#ifndef CARPMATH_PROFILE
+#define CARPMATH_PROFILE 0
+#endif
+
+enum ProfileId : uint32_t
+{
+    ProfileIdNormalizeVec2,
+    ProfileIdNormalizeVec3,
+    ProfileIdNormalizeVec4,
+    ProfileIdNormalizeQuat,
+    ProfileIdInverseMat4,
+    ProfileIdMultiplyMatrices,
+    ProfileIdGetTransformsFromMatrices,
+    ProfileIdOrthonormalizeMatrices,
+    ProfileIdRotateVectors,
+    ProfileIdRenormalizeQuats,
+    ProfileIdProjectPointsToScreen,
+    ProfileIdIntersectRayPacket8,
+    ProfileIdConvertVec3s,
+    ProfileIdNormalizeVec3s,
+    ProfileIdDiff,
+    ProfileIdEncodeTransformStream,
+    ProfileIdDecodeTransformStream,
+    ProfileIdEvaluateCurves,
+    ProfileIdSquad,
+    ProfileIdSampleTracks,
+    ProfileIdIntegrateEuler,
+    ProfileIdIntegrateVerlet,
+    ProfileIdIntegrateOrientations,
+    ProfileIdBuildSpatialHash,
+    ProfileIdFindPairs,
+    ProfileIdComputeMortonCodes,
+    ProfileIdRadixSort,
+    ProfileIdApplyPermutation,
+    ProfileIdComputeCovariances,
+    ProfileIdSolveSymmetricEigen,
+    ProfileIdAverageQuats,
+    ProfileIdPackColors,
+    ProfileIdUnpackColors,
+    ProfileIdRunFramePipeline,
+
+    ProfileIdCount
+};
+
+// Degenerate inputs that got a fallback result.
+enum ProfileEvent : uint32_t
+{
+    ProfileEventNormalizeZeroLength,
+    ProfileEventInverseSingular,
+
+    ProfileEventCount
+};
+
+struct ProfileStats
+{
+    uint64_t calls;
+    // Elements processed, 1 per call for single value functions.
+    uint64_t items;
+    uint64_t sampledCalls;
+    uint64_t sampledNanoseconds;
+};
+
+// Counts since the last reset, summed over all threads, including ones that have exited.
+ProfileStats getProfileStats(ProfileId id);
+uint64_t getProfileEventCount(ProfileEvent event);
+void resetProfileCounters();
+
+// Times every interval-th call on each thread, 0 disables timing. Default is 64.
+void setProfileSampleInterval(uint32_t interval);
+
+// Failed ASSERT_MATH checks when built with CARPMATH_ASSERT_POLICY count, all threads.
+uint64_t getMathAssertFailureCount();
+void resetMathAssertFailureCount();
+void addMathAssertFailure();
+
+const char *getProfileIdName(ProfileId id);
+const char *getProfileEventName(ProfileEvent event);
+
+#if CARPMATH_PROFILE
+
+struct ProfileScope
+{
+    ProfileScope(ProfileId id, uint64_t items);
+    ~ProfileScope();
+
+    ProfileId id;
+    int64_t startTime;
+};
+
+void addProfileEvent(ProfileEvent event);
+
+#define PROFILE_MATH_CONCAT2(a, b) a##b
+#define PROFILE_MATH_CONCAT(a, b) PROFILE_MATH_CONCAT2(a, b)
+#define PROFILE_MATH_SCOPE(id) ProfileScope PROFILE_MATH_CONCAT(profileScope, __LINE__)((id), 1u)
+#define PROFILE_MATH_BATCH_SCOPE(id, count) ProfileScope PROFILE_MATH_CONCAT(profileScope, __LINE__)((id), (count))
+#define PROFILE_MATH_EVENT(event) addProfileEvent(event)
+
+#else
+
+#define PROFILE_MATH_SCOPE(id) do {} while(0)
+#define PROFILE_MATH_BATCH_SCOPE(id, count) do {} while(0)
+#define PROFILE_MATH_EVENT(event) do {} while(0)
+
+#endif
@@ -0,0 +1,237 @@
+#include "projection.h"
+
+#include "dispatch.h"
+#include "mathhelp.h"
+#include "profile.h"
+#include "simdhelp.h"
+
+#include <string.h>
+
+#if (__AVX__ || __SSE__ || __SSE2__ || __SSE3__ || __SSE4_1__ || _M_AMD64 || _M_X64) && 1
+#define PROJECTION_SIMD_SSE 1
+#include <emmintrin.h>
+#endif
+#if CARPMATH_X86
+#include <immintrin.h>
+#endif
+
+static uint8_t sGetClipFlags(float x, float y, float z, float w)
+{
+    uint8_t flags = 0;
+    flags |= x < -w ? ClipFlagLeft : 0;
+    flags |= x > w ? ClipFlagRight : 0;
+    flags |= y < -w ? ClipFlagBottom : 0;
+    flags |= y > w ? ClipFlagTop : 0;
+    flags |= z < 0.0f ? ClipFlagNear : 0;
+    flags |= z > w ? ClipFlagFar : 0;
+    return flags;
+}
+
+// Kernels are templates over Vec3 and PackedVec3 points.
+template <typename PointType>
+static uint32_t sProjectPointsScalar(const Mat4x4 &viewProj, const Viewport &viewport,
+    const PointType *points, uint32_t count, Vec2 *outPixels, uint8_t *outClipFlags, float *outDepth)
+{
+    const Mat4x4 &m = viewProj;
+    const float halfWidth = viewport.width * 0.5f;
+    const float halfHeight = viewport.height * 0.5f;
+    const float centerX = viewport.x + halfWidth;
+    const float centerY = viewport.y + halfHeight;
+
+    uint32_t visible = 0;
+    for(uint32_t i = 0; i < count; ++i)
+    {
+        const PointType &p = points[i];
+        const float cx = m._00 * p.x + m._01 * p.y + m._02 * p.z + m._03;
+        const float cy = m._10 * p.x + m._11 * p.y + m._12 * p.z + m._13;
+        const float cz = m._20 * p.x + m._21 * p.y + m._22 * p.z + m._23;
+        const float cw = m._30 * p.x + m._31 * p.y + m._32 * p.z + m._33;
+
+        const uint8_t flags = sGetClipFlags(cx, cy, cz, cw);
+        outClipFlags[i] = flags;
+        visible += flags == 0 ? 1u : 0u;
+
+        const float invW = 1.0f / cw;
+        outPixels[i].x = cx * invW * halfWidth + centerX;
+        outPixels[i].y = -cy * invW * halfHeight + centerY;
+        if(outDepth)
+            outDepth[i] = cz * invW;
+    }
+    return visible;
+}
+
+#if PROJECTION_SIMD_SSE
+
+template <typename PointType>
+static uint32_t sProjectPointsSSE(const Mat4x4 &viewProj, const Viewport &viewport,
+    const PointType *points, uint32_t count, Vec2 *outPixels, uint8_t *outClipFlags, float *outDepth)
+{
+    const Mat4x4 &m = viewProj;
+    const float halfWidth = viewport.width * 0.5f;
+    const float halfHeight = viewport.height * 0.5f;
+
+    const __m128 m00 = _mm_set1_ps(m._00), m01 = _mm_set1_ps(m._01), m02 = _mm_set1_ps(m._02), m03 = _mm_set1_ps(m._03);
+    const __m128 m10 = _mm_set1_ps(m._10), m11 = _mm_set1_ps(m._11), m12 = _mm_set1_ps(m._12), m13 = _mm_set1_ps(m._13);
+    const __m128 m20 = _mm_set1_ps(m._20), m21 = _mm_set1_ps(m._21), m22 = _mm_set1_ps(m._22), m23 = _mm_set1_ps(m._23);
+    const __m128 m30 = _mm_set1_ps(m._30), m31 = _mm_set1_ps(m._31), m32 = _mm_set1_ps(m._32), m33 = _mm_set1_ps(m._33);
+
+    const __m128 scaleX = _mm_set1_ps(halfWidth);
+    const __m128 scaleY = _mm_set1_ps(-halfHeight);
+    const __m128 offsetX = _mm_set1_ps(viewport.x + halfWidth);
+    const __m128 offsetY = _mm_set1_ps(viewport.y + halfHeight);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 two = _mm_set1_ps(2.0f);
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    __m128i visibleCount = _mm_setzero_si128();
+
+    uint32_t i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        __m128 px, py, pz;
+        sLoadVec3x4(points + i, px, py, pz);
+
+        const __m128 cx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m00, px), _mm_mul_ps(m01, py)), _mm_add_ps(_mm_mul_ps(m02, pz), m03));
+        const __m128 cy = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m10, px), _mm_mul_ps(m11, py)), _mm_add_ps(_mm_mul_ps(m12, pz), m13));
+        const __m128 cz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m20, px), _mm_mul_ps(m21, py)), _mm_add_ps(_mm_mul_ps(m22, pz), m23));
+        const __m128 cw = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m30, px), _mm_mul_ps(m31, py)), _mm_add_ps(_mm_mul_ps(m32, pz), m33));
+
+        // Outcodes as 32 bit lanes, packed to bytes at the end.
+        const __m128 negW = _mm_xor_ps(cw, signMask);
+        __m128i flags = _mm_and_si128(_mm_castps_si128(_mm_cmplt_ps(cx, negW)), _mm_set1_epi32(ClipFlagLeft));
+        flags = _mm_or_si128(flags, _mm_and_si128(_mm_castps_si128(_mm_cmpgt_ps(cx, cw)), _mm_set1_epi32(ClipFlagRight)));
+        flags = _mm_or_si128(flags, _mm_and_si128(_mm_castps_si128(_mm_cmplt_ps(cy, negW)), _mm_set1_epi32(ClipFlagBottom)));
+        flags = _mm_or_si128(flags, _mm_and_si128(_mm_castps_si128(_mm_cmpgt_ps(cy, cw)), _mm_set1_epi32(ClipFlagTop)));
+        flags = _mm_or_si128(flags, _mm_and_si128(_mm_castps_si128(_mm_cmplt_ps(cz, zero)), _mm_set1_epi32(ClipFlagNear)));
+        flags = _mm_or_si128(flags, _mm_and_si128(_mm_castps_si128(_mm_cmpgt_ps(cz, cw)), _mm_set1_epi32(ClipFlagFar)));
+
+        const __m128i packed = _mm_packus_epi16(_mm_packs_epi32(flags, flags), _mm_setzero_si128());
+        const int32_t flagBytes = _mm_cvtsi128_si32(packed);
+        memcpy(outClipFlags + i, &flagBytes, sizeof(flagBytes));
+        // Inside lanes compare to -1.
+        visibleCount = _mm_sub_epi32(visibleCount, _mm_cmpeq_epi32(flags, _mm_setzero_si128()));
+
+        // Reciprocal with one Newton-Raphson step instead of divide.
+        __m128 invW = _mm_rcp_ps(cw);
+        invW = _mm_mul_ps(invW, _mm_sub_ps(two, _mm_mul_ps(cw, invW)));
+
+        const __m128 sx = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(cx, invW), scaleX), offsetX);
+        const __m128 sy = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(cy, invW), scaleY), offsetY);
+        _mm_storeu_ps(&outPixels[i + 0].x, _mm_unpacklo_ps(sx, sy));
+        _mm_storeu_ps(&outPixels[i + 2].x, _mm_unpackhi_ps(sx, sy));
+        if(outDepth)
+            _mm_storeu_ps(outDepth + i, _mm_mul_ps(cz, invW));
+    }
+
+    alignas(16) uint32_t laneCounts[4];
+    _mm_store_si128((__m128i *)laneCounts, visibleCount);
+    uint32_t visible = laneCounts[0] + laneCounts[1] + laneCounts[2] + laneCounts[3];
+    return visible + sProjectPointsScalar(viewProj, viewport, points + i, count - i,
+        outPixels + i, outClipFlags + i, outDepth ? outDepth + i : nullptr);
+}
+
+#endif
+
+#if CARPMATH_X86
+
+template <typename PointType>
+CARPMATH_TARGET_AVX2 static uint32_t sProjectPointsAVX2(const Mat4x4 &viewProj, const Viewport &viewport,
+    const PointType *points, uint32_t count, Vec2 *outPixels, uint8_t *outClipFlags, float *outDepth)
+{
+    const Mat4x4 &m = viewProj;
+    const float halfWidth = viewport.width * 0.5f;
+    const float halfHeight = viewport.height * 0.5f;
+
+    const __m256 m00 = _mm256_set1_ps(m._00), m01 = _mm256_set1_ps(m._01), m02 = _mm256_set1_ps(m._02), m03 = _mm256_set1_ps(m._03);
+    const __m256 m10 = _mm256_set1_ps(m._10), m11 = _mm256_set1_ps(m._11), m12 = _mm256_set1_ps(m._12), m13 = _mm256_set1_ps(m._13);
+    const __m256 m20 = _mm256_set1_ps(m._20), m21 = _mm256_set1_ps(m._21), m22 = _mm256_set1_ps(m._22), m23 = _mm256_set1_ps(m._23);
+    const __m256 m30 = _mm256_set1_ps(m._30), m31 = _mm256_set1_ps(m._31), m32 = _mm256_set1_ps(m._32), m33 = _mm256_set1_ps(m._33);
+
+    const __m256 scaleX = _mm256_set1_ps(halfWidth);
+    const __m256 scaleY = _mm256_set1_ps(-halfHeight);
+    const __m256 offsetX = _mm256_set1_ps(viewport.x + halfWidth);
+    const __m256 offsetY = _mm256_set1_ps(viewport.y + halfHeight);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 two = _mm256_set1_ps(2.0f);
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    __m256i visibleCount = _mm256_setzero_si256();
+
+    uint32_t i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        __m256 px, py, pz;
+        sLoadVec3x8(points + i, px, py, pz);
+
+        const __m256 cx = _mm256_fmadd_ps(m00, px, _mm256_fmadd_ps(m01, py, _mm256_fmadd_ps(m02, pz, m03)));
+        const __m256 cy = _mm256_fmadd_ps(m10, px, _mm256_fmadd_ps(m11, py, _mm256_fmadd_ps(m12, pz, m13)));
+        const __m256 cz = _mm256_fmadd_ps(m20, px, _mm256_fmadd_ps(m21, py, _mm256_fmadd_ps(m22, pz, m23)));
+        const __m256 cw = _mm256_fmadd_ps(m30, px, _mm256_fmadd_ps(m31, py, _mm256_fmadd_ps(m32, pz, m33)));
+
+        const __m256 negW = _mm256_xor_ps(cw, signMask);
+        __m256i flags = _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(cx, negW, _CMP_LT_OQ)), _mm256_set1_epi32(ClipFlagLeft));
+        flags = _mm256_or_si256(flags, _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(cx, cw, _CMP_GT_OQ)), _mm256_set1_epi32(ClipFlagRight)));
+        flags = _mm256_or_si256(flags, _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(cy, negW, _CMP_LT_OQ)), _mm256_set1_epi32(ClipFlagBottom)));
+        flags = _mm256_or_si256(flags, _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(cy, cw, _CMP_GT_OQ)), _mm256_set1_epi32(ClipFlagTop)));
+        flags = _mm256_or_si256(flags, _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(cz, zero, _CMP_LT_OQ)), _mm256_set1_epi32(ClipFlagNear)));
+        flags = _mm256_or_si256(flags, _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(cz, cw, _CMP_GT_OQ)), _mm256_set1_epi32(ClipFlagFar)));
+
+        const __m128i flags16 = _mm_packs_epi32(_mm256_castsi256_si128(flags), _mm256_extracti128_si256(flags, 1));
+        _mm_storel_epi64((__m128i *)(outClipFlags + i), _mm_packus_epi16(flags16, _mm_setzero_si128()));
+        visibleCount = _mm256_sub_epi32(visibleCount, _mm256_cmpeq_epi32(flags, _mm256_setzero_si256()));
+
+        __m256 invW = _mm256_rcp_ps(cw);
+        invW = _mm256_mul_ps(invW, _mm256_fnmadd_ps(cw, invW, two));
+
+        const __m256 sx = _mm256_fmadd_ps(_mm256_mul_ps(cx, invW), scaleX, offsetX);
+        const __m256 sy = _mm256_fmadd_ps(_mm256_mul_ps(cy, invW), scaleY, offsetY);
+        const __m256 lo = _mm256_unpacklo_ps(sx, sy);
+        const __m256 hi = _mm256_unpackhi_ps(sx, sy);
+        _mm256_storeu_ps(&outPixels[i + 0].x, _mm256_permute2f128_ps(lo, hi, 0x20));
+        _mm256_storeu_ps(&outPixels[i + 4].x, _mm256_permute2f128_ps(lo, hi, 0x31));
+        if(outDepth)
+            _mm256_storeu_ps(outDepth + i, _mm256_mul_ps(cz, invW));
+    }
+
+    alignas(32) uint32_t laneCounts[8];
+    _mm256_store_si256((__m256i *)laneCounts, visibleCount);
+    uint32_t visible = 0;
+    for(uint32_t lane = 0; lane < 8; ++lane)
+        visible += laneCounts[lane];
+    return visible + sProjectPointsScalar(viewProj, viewport, points + i, count - i,
+        outPixels + i, outClipFlags + i, outDepth ? outDepth + i : nullptr);
+}
+
+#endif
+
+void bindProjectionKernels(SimdKernels &kernels, SimdBackend backend)
+{
+    kernels.projectPointsToScreen = sProjectPointsScalar<Vec3>;
+    kernels.projectPackedPointsToScreen = sProjectPointsScalar<PackedVec3>;
+#if PROJECTION_SIMD_SSE
+    if(backend >= SimdBackendSSE4)
+    {
+        kernels.projectPointsToScreen = sProjectPointsSSE<Vec3>;
+        kernels.projectPackedPointsToScreen = sProjectPointsSSE<PackedVec3>;
+    }
+#endif
+#if CARPMATH_X86
+    if(backend >= SimdBackendAVX2)
+    {
+        kernels.projectPointsToScreen = sProjectPointsAVX2<Vec3>;
+        kernels.projectPackedPointsToScreen = sProjectPointsAVX2<PackedVec3>;
+    }
+#endif
+}
+
+uint32_t projectPointsToScreen(const Mat4x4 &viewProj, const Viewport &viewport,
+    const Vec3 *points, uint32_t count, Vec2 *outPixels, uint8_t *outClipFlags, float *outDepth)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdProjectPointsToScreen, count);
+    return getSimdKernels().projectPointsToScreen(viewProj, viewport, points, count, outPixels, outClipFlags, outDepth);
+}
+
+uint32_t projectPointsToScreen(const Mat4x4 &viewProj, const Viewport &viewport,
+    const PackedVec3 *points, uint32_t count, Vec2 *outPixels, uint8_t *outClipFlags, float *outDepth)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdProjectPointsToScreen, count);
+    return getSimdKernels().projectPackedPointsToScreen(viewProj, viewport, points, count, outPixels, outClipFlags, outDepth);
+}
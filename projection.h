@@ -0,0 +1,41 @@
+#pragma once
+
+#include "mat4.h"
+#include "vec2.h"
+#include "vec3.h"
+
+#include <stdint.h>
+
+// Clip volume is -w <= x <= w, -w <= y <= w, 0 <= z <= w, which is
+// what createPerspectiveMatrix and createOrthoMatrix produce.
+enum ClipFlags : uint8_t
+{
+    ClipFlagLeft = 1u << 0u,
+    ClipFlagRight = 1u << 1u,
+    ClipFlagBottom = 1u << 2u,
+    ClipFlagTop = 1u << 3u,
+    ClipFlagNear = 1u << 4u,
+    ClipFlagFar = 1u << 5u,
+};
+
+struct Viewport
+{
+    Viewport() : x(0.0f), y(0.0f), width(1.0f), height(1.0f) {}
+    Viewport(float width, float height) : x(0.0f), y(0.0f), width(width), height(height) {}
+    Viewport(float x, float y, float width, float height) : x(x), y(y), width(width), height(height) {}
+
+    float x;
+    float y;
+    float width;
+    float height;
+};
+
+// Transforms world points with viewProj = proj * view, writes clip flags and
+// pixel positions where y grows downwards. Points with any clip flag set
+// are outside of the frustum, their pixel positions are still written but
+// are meaningless behind the camera. outDepth gets z / w and can be null.
+// Returns the number of points inside the frustum.
+uint32_t projectPointsToScreen(const Mat4x4 &viewProj, const Viewport &viewport,
+    const Vec3 *points, uint32_t count, Vec2 *outPixels, uint8_t *outClipFlags, float *outDepth = nullptr);
+uint32_t projectPointsToScreen(const Mat4x4 &viewProj, const Viewport &viewport,
+    const PackedVec3 *points, uint32_t count, Vec2 *outPixels, uint8_t *outClipFlags, float *outDepth = nullptr);
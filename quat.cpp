@@ -1,5 +1,17 @@
 #include "quat.h"
+
+#include "dispatch.h"
 #include "mathhelp.h"
+#include "profile.h"
+#include "simdhelp.h"
+
+#if (__AVX__ || __SSE__ || __SSE2__ || __SSE3__ || __SSE4_1__ || _M_AMD64 || _M_X64) && 1
+#define QUAT_SIMD_SSE 1
+#include <emmintrin.h>
+#endif
+#if CARPMATH_X86
+#include <immintrin.h>
+#endif
 
 static Quat operator -(const Quat &v)
 {
@@ -24,18 +36,69 @@ float dot(const Quat &q1, const Quat &q2)
 
 
 
+#if QUAT_SIMD_SSE
+
+static __m128 sSplat(__m128 v, int index)
+{
+    switch(index)
+    {
+        case 0: return _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0));
+        case 1: return _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1));
+        case 2: return _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2));
+        default: return _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3));
+    }
+}
+
+// x + y + z + w in every lane.
+static __m128 sHorizontalSum(__m128 v)
+{
+    const __m128 sum = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_add_ps(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(1, 0, 3, 2)));
+}
+
+// a.yzx * b.zxy - a.zxy * b.yzx, w stays 0 when both w are 0.
+static __m128 sCross(__m128 a, __m128 b)
+{
+    const __m128 aYZX = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+    const __m128 bYZX = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+    const __m128 c = _mm_sub_ps(_mm_mul_ps(a, bYZX), _mm_mul_ps(aYZX, b));
+    return _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
+}
+
+#endif
+
 Quat operator *(const Quat &a, const Quat &b)
 {
-    Vec3 av(a.vx, a.vy, a.vz);
-    Vec3 bv(b.vx, b.vy, b.vz);
-    return Quat(cross(av, bv) + a.w * bv + b.w * av, a.w * b.w - dot(av, bv));
+    Quat result{ UninitType{} };
+#if QUAT_SIMD_SSE
+    // Each component of a times b shuffled and sign flipped, lanes are x, y, z, w.
+    const __m128 aq = _mm_load_ps(&a.vx);
+    const __m128 bq = _mm_load_ps(&b.vx);
+    const __m128 signX = _mm_set_ps(-0.0f, 0.0f, -0.0f, 0.0f);
+    const __m128 signY = _mm_set_ps(-0.0f, -0.0f, 0.0f, 0.0f);
+    const __m128 signZ = _mm_set_ps(-0.0f, 0.0f, 0.0f, -0.0f);
+
+    const __m128 rw = _mm_mul_ps(sSplat(aq, 3), bq);
+    const __m128 rx = _mm_mul_ps(sSplat(aq, 0), _mm_xor_ps(_mm_shuffle_ps(bq, bq, _MM_SHUFFLE(0, 1, 2, 3)), signX));
+    const __m128 ry = _mm_mul_ps(sSplat(aq, 1), _mm_xor_ps(_mm_shuffle_ps(bq, bq, _MM_SHUFFLE(1, 0, 3, 2)), signY));
+    const __m128 rz = _mm_mul_ps(sSplat(aq, 2), _mm_xor_ps(_mm_shuffle_ps(bq, bq, _MM_SHUFFLE(2, 3, 0, 1)), signZ));
+    _mm_store_ps(&result.vx, _mm_add_ps(_mm_add_ps(rw, rx), _mm_add_ps(ry, rz)));
+#else
+    result.vx = a.w * b.vx + a.vx * b.w + a.vy * b.vz - a.vz * b.vy;
+    result.vy = a.w * b.vy - a.vx * b.vz + a.vy * b.w + a.vz * b.vx;
+    result.vz = a.w * b.vz + a.vx * b.vy - a.vy * b.vx + a.vz * b.w;
+    result.w = a.w * b.w - a.vx * b.vx - a.vy * b.vy - a.vz * b.vz;
+#endif
+    return result;
 }
 
 Quat normalize(const Quat &q)
 {
+    PROFILE_MATH_SCOPE(ProfileIdNormalizeQuat);
     float sqrLength = q.vx * q.vx + q.vy * q.vy + q.vz * q.vz + q.w * q.w;
-    if(sqrLength < 1.0e-8f)
+    if(sqrLength < NormalizeMinSqrLength)
     {
+        PROFILE_MATH_EVENT(ProfileEventNormalizeZeroLength);
         DEBUG_BREAK_MACRO_MATH();
         return Quat();
     }
@@ -43,16 +106,61 @@ Quat normalize(const Quat &q)
     return q * length;
 }
 
+Quat normalizeOr(const Quat &a, const Quat &fallback)
+{
+    const float l2 = a.vx * a.vx + a.vy * a.vy + a.vz * a.vz + a.w * a.w;
+    const float perLen = 1.0f / sSqrtF(sSelectGreaterEqualF(l2, NormalizeMinSqrLength, l2, 1.0f));
+    Quat result{UninitType{} };
+    result.vx = sSelectGreaterEqualF(l2, NormalizeMinSqrLength, a.vx * perLen, fallback.vx);
+    result.vy = sSelectGreaterEqualF(l2, NormalizeMinSqrLength, a.vy * perLen, fallback.vy);
+    result.vz = sSelectGreaterEqualF(l2, NormalizeMinSqrLength, a.vz * perLen, fallback.vz);
+    result.w = sSelectGreaterEqualF(l2, NormalizeMinSqrLength, a.w * perLen, fallback.w);
+    return result;
+}
+
+Quat normalizeOrZero(const Quat &a)
+{
+    return normalizeOr(a, Quat(0.0f, 0.0f, 0.0f, 0.0f));
+}
+
+Quat normalizeFast(const Quat &a)
+{
+    const float l2 = a.vx * a.vx + a.vy * a.vy + a.vz * a.vz + a.w * a.w;
+    const float perLen = sSelectGreaterEqualF(l2, NormalizeMinSqrLength, sRsqrtFastF(sMaxF(l2, NormalizeMinSqrLength)), 0.0f);
+    return Quat(a.vx * perLen, a.vy * perLen, a.vz * perLen, a.w * perLen);
+}
+
 Quat conjugate(const Quat &q)
 {
     return Quat(-q.vx, -q.vy, -q.vz, q.w);
 }
 
+// v * (w * w - dot(qv, qv)) + 2 * (qv * dot(v, qv) + cross(qv, v) * w)
 Vec3 rotateVector(const Vec3 &v, const Quat &q)
 {
-    Vec3 qv(q.vx, q.vy, q.vz);
-    float d = sqrLen(qv);
-    return (v * (q.w * q.w - d) + 2.0f * (qv * dot(v, qv) + cross(qv, v) * q.w));
+    Vec3 result{ UninitType{} };
+#if QUAT_SIMD_SSE
+    const __m128 xyzMask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+    const __m128 vv = _mm_and_ps(_mm_load_ps(&v.x), xyzMask);
+    const __m128 qq = _mm_load_ps(&q.vx);
+    const __m128 qv = _mm_and_ps(qq, xyzMask);
+    const __m128 qw = sSplat(qq, 3);
+
+    const __m128 d = sHorizontalSum(_mm_mul_ps(qv, qv));
+    const __m128 dv = sHorizontalSum(_mm_mul_ps(vv, qv));
+    const __m128 scale = _mm_sub_ps(_mm_mul_ps(qw, qw), d);
+    const __m128 sum = _mm_add_ps(_mm_mul_ps(qv, dv), _mm_mul_ps(sCross(qv, vv), qw));
+    _mm_store_ps(&result.x, _mm_add_ps(_mm_mul_ps(vv, scale), _mm_add_ps(sum, sum)));
+#else
+    const float d = q.vx * q.vx + q.vy * q.vy + q.vz * q.vz;
+    const float dv = v.x * q.vx + v.y * q.vy + v.z * q.vz;
+    const float scale = q.w * q.w - d;
+    result.x = v.x * scale + 2.0f * (q.vx * dv + (q.vy * v.z - q.vz * v.y) * q.w);
+    result.y = v.y * scale + 2.0f * (q.vy * dv + (q.vz * v.x - q.vx * v.z) * q.w);
+    result.z = v.z * scale + 2.0f * (q.vz * dv + (q.vx * v.y - q.vy * v.x) * q.w);
+    result.w = 0.0f;
+#endif
+    return result;
 }
 
 void getAxis(const Quat &quat, Vec3 &right, Vec3 &up, Vec3 &forward)
@@ -136,17 +244,19 @@ Quat lerp(Quat const &q1, Quat const &q2, float t)
 Quat slerp(Quat const &q1, Quat const &q2, float t)
 {
     float dotAngle = dot(q1, q2);
+    Quat to = q2;
 
     if (dotAngle < 0.0f)
     {
         dotAngle = -dotAngle;
+        to = -q2;
     }
     if (dotAngle > 0.9995)
     {
         return normalize(lerp(q1, q2, t));
     }
 
-    float theta0 = sCosF(dotAngle);
+    float theta0 = sAcosF(dotAngle);
     float theta = theta0 * t;
 
     float sinTheta = sSinF(theta);
@@ -156,10 +266,10 @@ Quat slerp(Quat const &q1, Quat const &q2, float t)
     float s1 = sCosF(theta) - dotAngle * s2;
 
     return normalize(Quat(
-        q1.vx * s1 + q2.vx * s2,
-        q1.vy * s1 + q2.vy * s2,
-        q1.vz * s1 + q2.vz * s2,
-        q1.w * s1 + q2.w * s2));
+        q1.vx * s1 + to.vx * s2,
+        q1.vy * s1 + to.vy * s2,
+        q1.vz * s1 + to.vz * s2,
+        q1.w * s1 + to.w * s2));
 }
 
 void getDirectionsFromPitchYawRoll(
@@ -175,3 +285,342 @@ void getDirectionsFromPitchYawRoll(
 }
 
 
+
+
+// Batch kernels are templates over Vec3 and PackedVec3.
+template <typename VecType>
+static void sRotateVectorsScalar(const VecType *vectors, const Quat &q, uint32_t count, VecType *outVectors)
+{
+    for(uint32_t i = 0; i < count; ++i)
+        outVectors[i] = VecType(rotateVector(Vec3(vectors[i]), q));
+}
+
+template <typename VecType>
+static void sRotateVectorsPairsScalar(const VecType *vectors, const Quat *quats, uint32_t count, VecType *outVectors)
+{
+    for(uint32_t i = 0; i < count; ++i)
+        outVectors[i] = VecType(rotateVector(Vec3(vectors[i]), quats[i]));
+}
+
+#if QUAT_SIMD_SSE
+
+// Same formula as rotateVector for 4 vectors in SoA form.
+static void sRotate4(__m128 &x, __m128 &y, __m128 &z, __m128 qx, __m128 qy, __m128 qz, __m128 qw)
+{
+    const __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(qx, qx), _mm_mul_ps(qy, qy)), _mm_mul_ps(qz, qz));
+    const __m128 dv = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, qx), _mm_mul_ps(y, qy)), _mm_mul_ps(z, qz));
+    const __m128 scale = _mm_sub_ps(_mm_mul_ps(qw, qw), d);
+    const __m128 cx = _mm_sub_ps(_mm_mul_ps(qy, z), _mm_mul_ps(qz, y));
+    const __m128 cy = _mm_sub_ps(_mm_mul_ps(qz, x), _mm_mul_ps(qx, z));
+    const __m128 cz = _mm_sub_ps(_mm_mul_ps(qx, y), _mm_mul_ps(qy, x));
+    const __m128 sx = _mm_add_ps(_mm_mul_ps(qx, dv), _mm_mul_ps(cx, qw));
+    const __m128 sy = _mm_add_ps(_mm_mul_ps(qy, dv), _mm_mul_ps(cy, qw));
+    const __m128 sz = _mm_add_ps(_mm_mul_ps(qz, dv), _mm_mul_ps(cz, qw));
+    x = _mm_add_ps(_mm_mul_ps(x, scale), _mm_add_ps(sx, sx));
+    y = _mm_add_ps(_mm_mul_ps(y, scale), _mm_add_ps(sy, sy));
+    z = _mm_add_ps(_mm_mul_ps(z, scale), _mm_add_ps(sz, sz));
+}
+
+template <typename VecType>
+static void sRotateVectorsSSE(const VecType *vectors, const Quat &q, uint32_t count, VecType *outVectors)
+{
+    const __m128 qx = _mm_set1_ps(q.vx);
+    const __m128 qy = _mm_set1_ps(q.vy);
+    const __m128 qz = _mm_set1_ps(q.vz);
+    const __m128 qw = _mm_set1_ps(q.w);
+
+    uint32_t i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        __m128 x, y, z;
+        sLoadVec3x4(vectors + i, x, y, z);
+        sRotate4(x, y, z, qx, qy, qz, qw);
+        sStoreVec3x4(outVectors + i, x, y, z);
+    }
+    sRotateVectorsScalar(vectors + i, q, count - i, outVectors + i);
+}
+
+template <typename VecType>
+static void sRotateVectorsPairsSSE(const VecType *vectors, const Quat *quats, uint32_t count, VecType *outVectors)
+{
+    uint32_t i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        __m128 qx = _mm_load_ps(&quats[i + 0].vx);
+        __m128 qy = _mm_load_ps(&quats[i + 1].vx);
+        __m128 qz = _mm_load_ps(&quats[i + 2].vx);
+        __m128 qw = _mm_load_ps(&quats[i + 3].vx);
+        _MM_TRANSPOSE4_PS(qx, qy, qz, qw);
+
+        __m128 x, y, z;
+        sLoadVec3x4(vectors + i, x, y, z);
+        sRotate4(x, y, z, qx, qy, qz, qw);
+        sStoreVec3x4(outVectors + i, x, y, z);
+    }
+    sRotateVectorsPairsScalar(vectors + i, quats + i, count - i, outVectors + i);
+}
+
+#endif
+
+#if CARPMATH_X86
+
+// 8 Quats into SoA, elements 0-3 in low lanes and 4-7 in high lanes.
+CARPMATH_TARGET_AVX2 static void sLoadTranspose8(const float *p0, const float *p4,
+    __m256 &x, __m256 &y, __m256 &z, __m256 &w)
+{
+    const __m256 t0 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_load_ps(p0 + 0)), _mm_load_ps(p4 + 0), 1);
+    const __m256 t1 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_load_ps(p0 + 4)), _mm_load_ps(p4 + 4), 1);
+    const __m256 t2 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_load_ps(p0 + 8)), _mm_load_ps(p4 + 8), 1);
+    const __m256 t3 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_load_ps(p0 + 12)), _mm_load_ps(p4 + 12), 1);
+    const __m256 xy01 = _mm256_unpacklo_ps(t0, t1);
+    const __m256 xy23 = _mm256_unpacklo_ps(t2, t3);
+    const __m256 zw01 = _mm256_unpackhi_ps(t0, t1);
+    const __m256 zw23 = _mm256_unpackhi_ps(t2, t3);
+    x = _mm256_shuffle_ps(xy01, xy23, _MM_SHUFFLE(1, 0, 1, 0));
+    y = _mm256_shuffle_ps(xy01, xy23, _MM_SHUFFLE(3, 2, 3, 2));
+    z = _mm256_shuffle_ps(zw01, zw23, _MM_SHUFFLE(1, 0, 1, 0));
+    w = _mm256_shuffle_ps(zw01, zw23, _MM_SHUFFLE(3, 2, 3, 2));
+}
+
+CARPMATH_TARGET_AVX2 static void sRotate8(__m256 &x, __m256 &y, __m256 &z, __m256 qx, __m256 qy, __m256 qz, __m256 qw)
+{
+    const __m256 d = _mm256_fmadd_ps(qx, qx, _mm256_fmadd_ps(qy, qy, _mm256_mul_ps(qz, qz)));
+    const __m256 dv = _mm256_fmadd_ps(x, qx, _mm256_fmadd_ps(y, qy, _mm256_mul_ps(z, qz)));
+    const __m256 scale = _mm256_fmsub_ps(qw, qw, d);
+    const __m256 cx = _mm256_fmsub_ps(qy, z, _mm256_mul_ps(qz, y));
+    const __m256 cy = _mm256_fmsub_ps(qz, x, _mm256_mul_ps(qx, z));
+    const __m256 cz = _mm256_fmsub_ps(qx, y, _mm256_mul_ps(qy, x));
+    const __m256 sx = _mm256_fmadd_ps(qx, dv, _mm256_mul_ps(cx, qw));
+    const __m256 sy = _mm256_fmadd_ps(qy, dv, _mm256_mul_ps(cy, qw));
+    const __m256 sz = _mm256_fmadd_ps(qz, dv, _mm256_mul_ps(cz, qw));
+    x = _mm256_fmadd_ps(x, scale, _mm256_add_ps(sx, sx));
+    y = _mm256_fmadd_ps(y, scale, _mm256_add_ps(sy, sy));
+    z = _mm256_fmadd_ps(z, scale, _mm256_add_ps(sz, sz));
+}
+
+template <typename VecType>
+CARPMATH_TARGET_AVX2 static void sRotateVectorsAVX2(const VecType *vectors, const Quat &q, uint32_t count, VecType *outVectors)
+{
+    const __m256 qx = _mm256_set1_ps(q.vx);
+    const __m256 qy = _mm256_set1_ps(q.vy);
+    const __m256 qz = _mm256_set1_ps(q.vz);
+    const __m256 qw = _mm256_set1_ps(q.w);
+
+    uint32_t i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        __m256 x, y, z;
+        sLoadVec3x8(vectors + i, x, y, z);
+        sRotate8(x, y, z, qx, qy, qz, qw);
+        sStoreVec3x8(outVectors + i, x, y, z);
+    }
+    sRotateVectorsScalar(vectors + i, q, count - i, outVectors + i);
+}
+
+template <typename VecType>
+CARPMATH_TARGET_AVX2 static void sRotateVectorsPairsAVX2(const VecType *vectors, const Quat *quats, uint32_t count, VecType *outVectors)
+{
+    uint32_t i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        __m256 qx, qy, qz, qw;
+        sLoadTranspose8(&quats[i].vx, &quats[i + 4].vx, qx, qy, qz, qw);
+        __m256 x, y, z;
+        sLoadVec3x8(vectors + i, x, y, z);
+        sRotate8(x, y, z, qx, qy, qz, qw);
+        sStoreVec3x8(outVectors + i, x, y, z);
+    }
+    sRotateVectorsPairsScalar(vectors + i, quats + i, count - i, outVectors + i);
+}
+
+#endif
+
+// Drift correction, error is |dot(q, q) - 1|. Zero quaternions become identity.
+static uint32_t sRenormalizeQuatsScalar(Quat *quats, uint32_t count, float epsilon)
+{
+    uint32_t fixedCount = 0;
+    for(uint32_t i = 0; i < count; ++i)
+    {
+        Quat &q = quats[i];
+        const float sqrLength = dot(q, q);
+        if(sAbsF(sqrLength - 1.0f) <= epsilon)
+            continue;
+        ++fixedCount;
+        q = sqrLength < NormalizeMinSqrLength ? Quat() : q * (1.0f / sSqrtF(sqrLength));
+    }
+    return fixedCount;
+}
+
+#if QUAT_SIMD_SSE
+
+// rsqrt with one Newton-Raphson step.
+static __m128 sRsqrt4(__m128 x)
+{
+    const __m128 y = _mm_rsqrt_ps(x);
+    const __m128 yyx = _mm_mul_ps(_mm_mul_ps(y, y), x);
+    return _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), y), _mm_sub_ps(_mm_set1_ps(3.0f), yyx));
+}
+
+static uint32_t sRenormalizeQuatsSSE(Quat *quats, uint32_t count, float epsilon)
+{
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    const __m128 maxError = _mm_set1_ps(epsilon);
+    const __m128 minSqrLength = _mm_set1_ps(NormalizeMinSqrLength);
+    __m128i fixedCount = _mm_setzero_si128();
+
+    uint32_t i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        __m128 x = _mm_load_ps(&quats[i + 0].vx);
+        __m128 y = _mm_load_ps(&quats[i + 1].vx);
+        __m128 z = _mm_load_ps(&quats[i + 2].vx);
+        __m128 w = _mm_load_ps(&quats[i + 3].vx);
+        _MM_TRANSPOSE4_PS(x, y, z, w);
+
+        const __m128 sqrLength = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)),
+            _mm_add_ps(_mm_mul_ps(z, z), _mm_mul_ps(w, w)));
+        const __m128 fix = _mm_cmpgt_ps(_mm_andnot_ps(signMask, _mm_sub_ps(sqrLength, one)), maxError);
+        const __m128 degenerate = _mm_and_ps(fix, _mm_cmplt_ps(sqrLength, minSqrLength));
+        const __m128 scale = _mm_andnot_ps(degenerate, sSelect4(fix, sRsqrt4(sqrLength), one));
+        x = _mm_mul_ps(x, scale);
+        y = _mm_mul_ps(y, scale);
+        z = _mm_mul_ps(z, scale);
+        w = sSelect4(degenerate, one, _mm_mul_ps(w, scale));
+        fixedCount = _mm_sub_epi32(fixedCount, _mm_castps_si128(fix));
+
+        _MM_TRANSPOSE4_PS(x, y, z, w);
+        _mm_store_ps(&quats[i + 0].vx, x);
+        _mm_store_ps(&quats[i + 1].vx, y);
+        _mm_store_ps(&quats[i + 2].vx, z);
+        _mm_store_ps(&quats[i + 3].vx, w);
+    }
+
+    alignas(16) uint32_t laneCounts[4];
+    _mm_store_si128((__m128i *)laneCounts, fixedCount);
+    const uint32_t fixed = laneCounts[0] + laneCounts[1] + laneCounts[2] + laneCounts[3];
+    return fixed + sRenormalizeQuatsScalar(quats + i, count - i, epsilon);
+}
+
+#endif
+
+#if CARPMATH_X86
+
+CARPMATH_TARGET_AVX2 static void sTransposeStore8(float *p0, float *p4, __m256 x, __m256 y, __m256 z, __m256 w)
+{
+    const __m256 xy0 = _mm256_unpacklo_ps(x, y);
+    const __m256 xy1 = _mm256_unpackhi_ps(x, y);
+    const __m256 zw0 = _mm256_unpacklo_ps(z, w);
+    const __m256 zw1 = _mm256_unpackhi_ps(z, w);
+    const __m256 v0 = _mm256_shuffle_ps(xy0, zw0, _MM_SHUFFLE(1, 0, 1, 0));
+    const __m256 v1 = _mm256_shuffle_ps(xy0, zw0, _MM_SHUFFLE(3, 2, 3, 2));
+    const __m256 v2 = _mm256_shuffle_ps(xy1, zw1, _MM_SHUFFLE(1, 0, 1, 0));
+    const __m256 v3 = _mm256_shuffle_ps(xy1, zw1, _MM_SHUFFLE(3, 2, 3, 2));
+    _mm256_storeu_ps(p0 + 0, _mm256_permute2f128_ps(v0, v1, 0x20));
+    _mm256_storeu_ps(p0 + 8, _mm256_permute2f128_ps(v2, v3, 0x20));
+    _mm256_storeu_ps(p4 + 0, _mm256_permute2f128_ps(v0, v1, 0x31));
+    _mm256_storeu_ps(p4 + 8, _mm256_permute2f128_ps(v2, v3, 0x31));
+}
+
+CARPMATH_TARGET_AVX2 static __m256 sRsqrt8(__m256 x)
+{
+    const __m256 y = _mm256_rsqrt_ps(x);
+    const __m256 yyx = _mm256_mul_ps(_mm256_mul_ps(y, y), x);
+    return _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(0.5f), y), _mm256_sub_ps(_mm256_set1_ps(3.0f), yyx));
+}
+
+CARPMATH_TARGET_AVX2 static uint32_t sRenormalizeQuatsAVX2(Quat *quats, uint32_t count, float epsilon)
+{
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    const __m256 maxError = _mm256_set1_ps(epsilon);
+    const __m256 minSqrLength = _mm256_set1_ps(NormalizeMinSqrLength);
+    __m256i fixedCount = _mm256_setzero_si256();
+
+    uint32_t i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        __m256 x, y, z, w;
+        sLoadTranspose8(&quats[i].vx, &quats[i + 4].vx, x, y, z, w);
+
+        const __m256 sqrLength = _mm256_fmadd_ps(x, x, _mm256_fmadd_ps(y, y, _mm256_fmadd_ps(z, z, _mm256_mul_ps(w, w))));
+        const __m256 fix = _mm256_cmp_ps(_mm256_andnot_ps(signMask, _mm256_sub_ps(sqrLength, one)), maxError, _CMP_GT_OQ);
+        const __m256 degenerate = _mm256_and_ps(fix, _mm256_cmp_ps(sqrLength, minSqrLength, _CMP_LT_OQ));
+        const __m256 scale = _mm256_andnot_ps(degenerate, _mm256_blendv_ps(one, sRsqrt8(sqrLength), fix));
+        x = _mm256_mul_ps(x, scale);
+        y = _mm256_mul_ps(y, scale);
+        z = _mm256_mul_ps(z, scale);
+        w = _mm256_blendv_ps(_mm256_mul_ps(w, scale), one, degenerate);
+        fixedCount = _mm256_sub_epi32(fixedCount, _mm256_castps_si256(fix));
+
+        sTransposeStore8(&quats[i].vx, &quats[i + 4].vx, x, y, z, w);
+    }
+
+    alignas(32) uint32_t laneCounts[8];
+    _mm256_store_si256((__m256i *)laneCounts, fixedCount);
+    uint32_t fixed = 0;
+    for(uint32_t lane = 0; lane < 8; ++lane)
+        fixed += laneCounts[lane];
+    return fixed + sRenormalizeQuatsScalar(quats + i, count - i, epsilon);
+}
+
+#endif
+
+void bindQuatKernels(SimdKernels &kernels, SimdBackend backend)
+{
+    kernels.rotateVectors = sRotateVectorsScalar<Vec3>;
+    kernels.rotateVectorsPairs = sRotateVectorsPairsScalar<Vec3>;
+    kernels.rotateVectorsPacked = sRotateVectorsScalar<PackedVec3>;
+    kernels.rotateVectorsPairsPacked = sRotateVectorsPairsScalar<PackedVec3>;
+    kernels.renormalizeQuats = sRenormalizeQuatsScalar;
+#if QUAT_SIMD_SSE
+    if(backend >= SimdBackendSSE4)
+    {
+        kernels.rotateVectors = sRotateVectorsSSE<Vec3>;
+        kernels.rotateVectorsPairs = sRotateVectorsPairsSSE<Vec3>;
+        kernels.rotateVectorsPacked = sRotateVectorsSSE<PackedVec3>;
+        kernels.rotateVectorsPairsPacked = sRotateVectorsPairsSSE<PackedVec3>;
+        kernels.renormalizeQuats = sRenormalizeQuatsSSE;
+    }
+#endif
+#if CARPMATH_X86
+    if(backend >= SimdBackendAVX2)
+    {
+        kernels.rotateVectors = sRotateVectorsAVX2<Vec3>;
+        kernels.rotateVectorsPairs = sRotateVectorsPairsAVX2<Vec3>;
+        kernels.rotateVectorsPacked = sRotateVectorsAVX2<PackedVec3>;
+        kernels.rotateVectorsPairsPacked = sRotateVectorsPairsAVX2<PackedVec3>;
+        kernels.renormalizeQuats = sRenormalizeQuatsAVX2;
+    }
+#endif
+}
+
+void rotateVectors(const Vec3 *vectors, const Quat &q, uint32_t count, Vec3 *outVectors)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdRotateVectors, count);
+    getSimdKernels().rotateVectors(vectors, q, count, outVectors);
+}
+
+void rotateVectors(const Vec3 *vectors, const Quat *quats, uint32_t count, Vec3 *outVectors)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdRotateVectors, count);
+    getSimdKernels().rotateVectorsPairs(vectors, quats, count, outVectors);
+}
+
+void rotateVectors(const PackedVec3 *vectors, const Quat &q, uint32_t count, PackedVec3 *outVectors)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdRotateVectors, count);
+    getSimdKernels().rotateVectorsPacked(vectors, q, count, outVectors);
+}
+
+void rotateVectors(const PackedVec3 *vectors, const Quat *quats, uint32_t count, PackedVec3 *outVectors)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdRotateVectors, count);
+    getSimdKernels().rotateVectorsPairsPacked(vectors, quats, count, outVectors);
+}
+
+uint32_t renormalizeQuats(Quat *quats, uint32_t count, float epsilon)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdRenormalizeQuats, count);
+    return getSimdKernels().renormalizeQuats(quats, count, epsilon);
+}
@@ -3,6 +3,8 @@
 #include "uninittype.h"
 #include "vec3.h"
 
+#include <stdint.h>
+
 struct alignas(16) Quat
 {
     Quat() : vx(0.0f), vy(0.0f), vz(0.0f), w(1.0f) {}
@@ -18,6 +20,10 @@ struct alignas(16) Quat
 float dot(const Quat &q1, const Quat &q2);
 Quat operator *(const Quat &a, const Quat &b);
 Quat normalize(const Quat &q);
+// See Vec3 versions. normalizeOr(q, Quat()) gives identity for degenerate input.
+Quat normalizeOrZero(const Quat &a);
+Quat normalizeOr(const Quat &a, const Quat &fallback);
+Quat normalizeFast(const Quat &a);
 Quat conjugate(const Quat &q);
 Vec3 rotateVector(const Vec3 &v, const Quat &q);
 void getAxis(const Quat &quat, Vec3 &right, Vec3 &up, Vec3 &forward);
@@ -30,4 +36,15 @@ Quat slerp(Quat const &q1, Quat const &q2, float t);
 void getDirectionsFromPitchYawRoll(
     float pitch, float yaw, float roll, Vec3 &rightDir, Vec3 &upDir, Vec3 &forwardDir);
 
+// Batch rotateVector with one quaternion for all, or quats[i] for vectors[i].
+// outVectors can be the same array as vectors.
+void rotateVectors(const Vec3 *vectors, const Quat &q, uint32_t count, Vec3 *outVectors);
+void rotateVectors(const Vec3 *vectors, const Quat *quats, uint32_t count, Vec3 *outVectors);
+void rotateVectors(const PackedVec3 *vectors, const Quat &q, uint32_t count, PackedVec3 *outVectors);
+void rotateVectors(const PackedVec3 *vectors, const Quat *quats, uint32_t count, PackedVec3 *outVectors);
+
+// Normalizes in place quaternions whose |dot(q, q) - 1| > epsilon, epsilon 0 does all.
+// Zero length ones become identity. Returns how many were changed.
+uint32_t renormalizeQuats(Quat *quats, uint32_t count, float epsilon = 0.0f);
+
 
@@ -0,0 +1,196 @@
+#include "radixsort.h"
+
+#include "mathhelp.h"
+#include "parallel.h"
+#include "profile.h"
+
+#include <string.h>
+
+static constexpr uint32_t RadixSortDigitBits = 11u;
+static constexpr uint32_t RadixSortDigitCount = 1u << RadixSortDigitBits;
+// Below this many items per thread the thread start costs more than it saves.
+static constexpr uint32_t RadixSortMinItemsPerThread = 1u << 14u;
+static constexpr uint32_t RadixSortMaxChunks = 256u;
+
+static uint32_t sGetWorkerCount(uint32_t count, uint32_t threadCount)
+{
+    const uint32_t maxThreads = (count + RadixSortMinItemsPerThread - 1u) / RadixSortMinItemsPerThread;
+    const uint32_t threads = getThreadCount(threadCount);
+    const uint32_t workers = threads < maxThreads ? threads : maxThreads;
+    return workers < RadixSortMaxChunks ? workers : RadixSortMaxChunks;
+}
+
+RadixSortBuffers::~RadixSortBuffers()
+{
+    delete[] scratchKeys;
+    delete[] scratchKeys64;
+    delete[] scratchIndices;
+    delete[] histograms;
+}
+
+static void sReserveCommon(RadixSortBuffers &buffers, uint32_t count, uint32_t workers)
+{
+    if(count > buffers.indexCapacity)
+    {
+        delete[] buffers.scratchIndices;
+        buffers.scratchIndices = new uint32_t[count];
+        buffers.indexCapacity = count;
+    }
+    const uint32_t histogramSize = workers * RadixSortDigitCount;
+    if(histogramSize > buffers.histogramCapacity)
+    {
+        delete[] buffers.histograms;
+        buffers.histograms = new uint32_t[histogramSize];
+        buffers.histogramCapacity = histogramSize;
+    }
+}
+
+static uint32_t *sReserve(RadixSortBuffers &buffers, uint32_t count, uint32_t workers, uint32_t *)
+{
+    sReserveCommon(buffers, count, workers);
+    if(count > buffers.keyCapacity)
+    {
+        delete[] buffers.scratchKeys;
+        buffers.scratchKeys = new uint32_t[count];
+        buffers.keyCapacity = count;
+    }
+    return buffers.scratchKeys;
+}
+
+static uint64_t *sReserve(RadixSortBuffers &buffers, uint32_t count, uint32_t workers, uint64_t *)
+{
+    sReserveCommon(buffers, count, workers);
+    if(count > buffers.key64Capacity)
+    {
+        delete[] buffers.scratchKeys64;
+        buffers.scratchKeys64 = new uint64_t[count];
+        buffers.key64Capacity = count;
+    }
+    return buffers.scratchKeys64;
+}
+
+// Keys and indices ping-pong between the caller's arrays and scratch. The first scatter
+// writes item indices directly, after an odd number of scatters the result is copied back.
+template <typename Key>
+static void sRadixSort(RadixSortBuffers &buffers, Key *keys, uint32_t count, uint32_t keyBits,
+    uint32_t *outIndices, uint32_t threadCount)
+{
+    ASSERT_MATH(keyBits <= sizeof(Key) * 8u);
+    if(count == 0)
+        return;
+    const uint32_t workers = sGetWorkerCount(count, threadCount);
+    Key *scratchKeys = sReserve(buffers, count, workers, keys);
+    uint32_t *histograms = buffers.histograms;
+
+    Key *srcKeys = keys;
+    uint32_t *srcIndices = outIndices;
+    Key *dstKeys = scratchKeys;
+    uint32_t *dstIndices = buffers.scratchIndices;
+    bool hasIndices = false;
+    for(uint32_t shift = 0; shift < keyBits; shift += RadixSortDigitBits)
+    {
+        parallelFor(count, workers, [&](uint32_t begin, uint32_t end, uint32_t chunk)
+        {
+            uint32_t *histogram = histograms + chunk * RadixSortDigitCount;
+            for(uint32_t digit = 0; digit < RadixSortDigitCount; ++digit)
+                histogram[digit] = 0;
+            for(uint32_t i = begin; i < end; ++i)
+                ++histogram[uint32_t(srcKeys[i] >> shift) & (RadixSortDigitCount - 1u)];
+        });
+
+        uint32_t offset = 0;
+        bool singleDigit = false;
+        for(uint32_t digit = 0; digit < RadixSortDigitCount; ++digit)
+        {
+            const uint32_t digitBegin = offset;
+            for(uint32_t chunk = 0; chunk < workers; ++chunk)
+            {
+                uint32_t &slot = histograms[chunk * RadixSortDigitCount + digit];
+                const uint32_t digitCount = slot;
+                slot = offset;
+                offset += digitCount;
+            }
+            singleDigit = singleDigit || offset - digitBegin == count;
+        }
+        if(singleDigit)
+            continue;
+
+        parallelFor(count, workers, [&](uint32_t begin, uint32_t end, uint32_t chunk)
+        {
+            uint32_t *histogram = histograms + chunk * RadixSortDigitCount;
+            for(uint32_t i = begin; i < end; ++i)
+            {
+                const uint32_t slot = histogram[uint32_t(srcKeys[i] >> shift) & (RadixSortDigitCount - 1u)]++;
+                dstKeys[slot] = srcKeys[i];
+                dstIndices[slot] = hasIndices ? srcIndices[i] : i;
+            }
+        });
+        hasIndices = true;
+        Key *swapKeys = srcKeys;
+        uint32_t *swapIndices = srcIndices;
+        srcKeys = dstKeys;
+        srcIndices = dstIndices;
+        dstKeys = swapKeys;
+        dstIndices = swapIndices;
+    }
+
+    if(!hasIndices)
+    {
+        for(uint32_t i = 0; i < count; ++i)
+            outIndices[i] = i;
+    }
+    else if(srcKeys != keys)
+    {
+        parallelFor(count, workers, [&](uint32_t begin, uint32_t end, uint32_t)
+        {
+            memcpy(keys + begin, srcKeys + begin, (end - begin) * sizeof(Key));
+            memcpy(outIndices + begin, srcIndices + begin, (end - begin) * sizeof(uint32_t));
+        });
+    }
+}
+
+void radixSort(RadixSortBuffers &buffers, uint32_t *keys, uint32_t count, uint32_t keyBits,
+    uint32_t *outIndices, uint32_t threadCount)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdRadixSort, count);
+    sRadixSort(buffers, keys, count, keyBits, outIndices, threadCount);
+}
+
+void radixSort(RadixSortBuffers &buffers, uint64_t *keys, uint32_t count, uint32_t keyBits,
+    uint32_t *outIndices, uint32_t threadCount)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdRadixSort, count);
+    sRadixSort(buffers, keys, count, keyBits, outIndices, threadCount);
+}
+
+// Fixed size copies become single moves.
+template <uint32_t ElementSize>
+static void sGather(const uint32_t *permutation, uint32_t begin, uint32_t end, const uint8_t *input,
+    uint8_t *output)
+{
+    for(uint32_t i = begin; i < end; ++i)
+        memcpy(output + size_t(i) * ElementSize, input + size_t(permutation[i]) * ElementSize, ElementSize);
+}
+
+void applyPermutation(const uint32_t *permutation, uint32_t count, const void *input, uint32_t elementSize,
+    void *output, uint32_t threadCount)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdApplyPermutation, count);
+    const uint8_t *in = static_cast<const uint8_t *>(input);
+    uint8_t *out = static_cast<uint8_t *>(output);
+    ASSERT_MATH(out + size_t(count) * elementSize <= in || in + size_t(count) * elementSize <= out);
+    parallelFor(count, sGetWorkerCount(count, threadCount), [&](uint32_t begin, uint32_t end, uint32_t)
+    {
+        switch(elementSize)
+        {
+            case 4: sGather<4>(permutation, begin, end, in, out); break;
+            case 8: sGather<8>(permutation, begin, end, in, out); break;
+            case 12: sGather<12>(permutation, begin, end, in, out); break;
+            case 16: sGather<16>(permutation, begin, end, in, out); break;
+            default:
+                for(uint32_t i = begin; i < end; ++i)
+                    memcpy(out + size_t(i) * elementSize, in + size_t(permutation[i]) * elementSize, elementSize);
+                break;
+        }
+    });
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdint.h>
+
+// Parallel stable LSD radix sort. Each pass counts digits per thread, prefix sums over
+// digits and threads, then scatters, so the result doesn't depend on thread count.
+// Passes where every key has the same digit are skipped. Scratch arrays live in
+// RadixSortBuffers and only grow, and passes run on the parallelFor worker pool, so once
+// warmed up, sorting the same or smaller count with the same thread count does not allocate.
+
+struct RadixSortBuffers
+{
+    RadixSortBuffers() {}
+    ~RadixSortBuffers();
+    RadixSortBuffers(const RadixSortBuffers &) = delete;
+    RadixSortBuffers &operator=(const RadixSortBuffers &) = delete;
+
+    uint32_t *scratchKeys = nullptr;
+    uint64_t *scratchKeys64 = nullptr;
+    uint32_t *scratchIndices = nullptr;
+    uint32_t *histograms = nullptr;
+
+    uint32_t keyCapacity = 0;
+    uint32_t key64Capacity = 0;
+    uint32_t indexCapacity = 0;
+    uint32_t histogramCapacity = 0;
+};
+
+// Sorts keys in place by their low keyBits bits, higher bits must be 0. outIndices[i] gets
+// the original index of sorted keys[i], equal keys keep their original order.
+// threadCount 0 uses hardware concurrency.
+void radixSort(RadixSortBuffers &buffers, uint32_t *keys, uint32_t count, uint32_t keyBits,
+    uint32_t *outIndices, uint32_t threadCount = 0);
+void radixSort(RadixSortBuffers &buffers, uint64_t *keys, uint32_t count, uint32_t keyBits,
+    uint32_t *outIndices, uint32_t threadCount = 0);
+
+// output[i] = input[permutation[i]] for elements of elementSize bytes. Reorders one SoA
+// stream by a permutation from radixSort, input and output must not overlap.
+void applyPermutation(const uint32_t *permutation, uint32_t count, const void *input, uint32_t elementSize,
+    void *output, uint32_t threadCount = 0);
+
+template <typename T>
+void applyPermutation(const uint32_t *permutation, uint32_t count, const T *input, T *output,
+    uint32_t threadCount = 0)
+{
+    applyPermutation(permutation, count, static_cast<const void *>(input), uint32_t(sizeof(T)),
+        static_cast<void *>(output), threadCount);
+}
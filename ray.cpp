@@ -0,0 +1,924 @@
+#include "ray.h"
+
+#include "dispatch.h"
+#include "mathhelp.h"
+#include "profile.h"
+#include "simdhelp.h"
+
+#include <float.h>
+
+#define RAY_SIMD_SSE ((__AVX__ || __SSE__ || __SSE2__ || __SSE3__ || __SSE4_1__ || _M_AMD64 || _M_X64) && 1)
+
+#if RAY_SIMD_SSE
+#include <xmmintrin.h>
+#endif
+#if CARPMATH_X86
+#include <immintrin.h>
+#endif
+
+static constexpr float RayTriangleDetEpsilon = 1.0e-8f;
+
+
+template <typename Packet>
+static void sSetRay(Packet &packet, int index, const Ray &ray)
+{
+    packet.posX[index] = ray.pos.x;
+    packet.posY[index] = ray.pos.y;
+    packet.posZ[index] = ray.pos.z;
+    packet.dirX[index] = ray.dir.x;
+    packet.dirY[index] = ray.dir.y;
+    packet.dirZ[index] = ray.dir.z;
+}
+
+template <typename Packet>
+static void sSetAABB(Packet &packet, int index, const AABB &box)
+{
+    packet.minX[index] = box.min.x;
+    packet.minY[index] = box.min.y;
+    packet.minZ[index] = box.min.z;
+    packet.maxX[index] = box.max.x;
+    packet.maxY[index] = box.max.y;
+    packet.maxZ[index] = box.max.z;
+}
+
+template <typename Packet>
+static void sSetTriangle(Packet &packet, int index, const Vec3 &v0, const Vec3 &v1, const Vec3 &v2)
+{
+    packet.v0X[index] = v0.x;
+    packet.v0Y[index] = v0.y;
+    packet.v0Z[index] = v0.z;
+    packet.e1X[index] = v1.x - v0.x;
+    packet.e1Y[index] = v1.y - v0.y;
+    packet.e1Z[index] = v1.z - v0.z;
+    packet.e2X[index] = v2.x - v0.x;
+    packet.e2Y[index] = v2.y - v0.y;
+    packet.e2Z[index] = v2.z - v0.z;
+}
+
+template <typename Packet>
+static void sSetSphere(Packet &packet, int index, const Vec3 &center, float radius)
+{
+    packet.centerX[index] = center.x;
+    packet.centerY[index] = center.y;
+    packet.centerZ[index] = center.z;
+    packet.radius[index] = radius;
+}
+
+void setRay(RayPacket4 &packet, int index, const Ray &ray)
+{
+    ASSERT_MATH(index >= 0 && index < 4);
+    sSetRay(packet, index, ray);
+}
+
+void setRay(RayPacket8 &packet, int index, const Ray &ray)
+{
+    ASSERT_MATH(index >= 0 && index < 8);
+    sSetRay(packet, index, ray);
+}
+
+void setAABB(AABBPacket4 &packet, int index, const AABB &box)
+{
+    ASSERT_MATH(index >= 0 && index < 4);
+    sSetAABB(packet, index, box);
+}
+
+void setAABB(AABBPacket8 &packet, int index, const AABB &box)
+{
+    ASSERT_MATH(index >= 0 && index < 8);
+    sSetAABB(packet, index, box);
+}
+
+void setTriangle(TrianglePacket4 &packet, int index, const Vec3 &v0, const Vec3 &v1, const Vec3 &v2)
+{
+    ASSERT_MATH(index >= 0 && index < 4);
+    sSetTriangle(packet, index, v0, v1, v2);
+}
+
+void setTriangle(TrianglePacket8 &packet, int index, const Vec3 &v0, const Vec3 &v1, const Vec3 &v2)
+{
+    ASSERT_MATH(index >= 0 && index < 8);
+    sSetTriangle(packet, index, v0, v1, v2);
+}
+
+void setSphere(SpherePacket4 &packet, int index, const Vec3 &center, float radius)
+{
+    ASSERT_MATH(index >= 0 && index < 4);
+    sSetSphere(packet, index, center, radius);
+}
+
+void setSphere(SpherePacket8 &packet, int index, const Vec3 &center, float radius)
+{
+    ASSERT_MATH(index >= 0 && index < 8);
+    sSetSphere(packet, index, center, radius);
+}
+
+
+
+
+bool intersectRayAABB(const Ray &ray, const AABB &box, float maxT, float &outT)
+{
+    float tNear = 0.0f;
+    float tFar = maxT;
+    for(int i = 0; i < 3; ++i)
+    {
+        float invDir = 1.0f / ray.dir[i];
+        float t0 = (box.min[i] - ray.pos[i]) * invDir;
+        float t1 = (box.max[i] - ray.pos[i]) * invDir;
+        tNear = sMaxF(tNear, sMinF(t0, t1));
+        tFar = sMinF(tFar, sMaxF(t0, t1));
+    }
+    bool hit = tNear <= tFar;
+    outT = hit ? tNear : FLT_MAX;
+    return hit;
+}
+
+bool intersectRayTriangle(const Ray &ray, const Vec3 &v0, const Vec3 &v1, const Vec3 &v2, float maxT, float &outT)
+{
+    outT = FLT_MAX;
+    Vec3 e1 = v1 - v0;
+    Vec3 e2 = v2 - v0;
+    Vec3 pVec = cross(ray.dir, e2);
+    float det = dot(e1, pVec);
+    if(sAbsF(det) <= RayTriangleDetEpsilon)
+        return false;
+
+    float invDet = 1.0f / det;
+    Vec3 tVec = ray.pos - v0;
+    float u = dot(tVec, pVec) * invDet;
+    if(u < 0.0f || u > 1.0f)
+        return false;
+
+    Vec3 qVec = cross(tVec, e1);
+    float v = dot(ray.dir, qVec) * invDet;
+    if(v < 0.0f || u + v > 1.0f)
+        return false;
+
+    float t = dot(e2, qVec) * invDet;
+    if(t < 0.0f || t > maxT)
+        return false;
+
+    outT = t;
+    return true;
+}
+
+bool intersectRaySphere(const Ray &ray, const Vec3 &center, float radius, float maxT, float &outT)
+{
+    outT = FLT_MAX;
+    Vec3 oc = ray.pos - center;
+    float a = dot(ray.dir, ray.dir);
+    float b = dot(oc, ray.dir);
+    float c = dot(oc, oc) - radius * radius;
+    float disc = b * b - a * c;
+    if(disc < 0.0f || a <= 0.0f)
+        return false;
+
+    float sq = sSqrtF(disc);
+    float t = (-b - sq) / a;
+    // Ray starting inside the sphere hits the far side.
+    if(t < 0.0f)
+        t = (-b + sq) / a;
+    if(t < 0.0f || t > maxT)
+        return false;
+
+    outT = t;
+    return true;
+}
+
+
+
+
+#if RAY_SIMD_SSE
+
+static __m128 sRayAABB4(
+    __m128 px, __m128 py, __m128 pz, __m128 ix, __m128 iy, __m128 iz,
+    __m128 minX, __m128 minY, __m128 minZ, __m128 maxX, __m128 maxY, __m128 maxZ,
+    __m128 maxT, __m128 &outT)
+{
+    const __m128 t0x = _mm_mul_ps(_mm_sub_ps(minX, px), ix);
+    const __m128 t1x = _mm_mul_ps(_mm_sub_ps(maxX, px), ix);
+    const __m128 t0y = _mm_mul_ps(_mm_sub_ps(minY, py), iy);
+    const __m128 t1y = _mm_mul_ps(_mm_sub_ps(maxY, py), iy);
+    const __m128 t0z = _mm_mul_ps(_mm_sub_ps(minZ, pz), iz);
+    const __m128 t1z = _mm_mul_ps(_mm_sub_ps(maxZ, pz), iz);
+
+    const __m128 tNear = _mm_max_ps(
+        _mm_max_ps(_mm_min_ps(t0x, t1x), _mm_min_ps(t0y, t1y)),
+        _mm_max_ps(_mm_min_ps(t0z, t1z), _mm_setzero_ps()));
+    const __m128 tFar = _mm_min_ps(
+        _mm_min_ps(_mm_max_ps(t0x, t1x), _mm_max_ps(t0y, t1y)),
+        _mm_min_ps(_mm_max_ps(t0z, t1z), maxT));
+
+    const __m128 hit = _mm_cmple_ps(tNear, tFar);
+    outT = sSelect4(hit, tNear, _mm_set1_ps(FLT_MAX));
+    return hit;
+}
+
+static __m128 sRayTriangle4(
+    __m128 px, __m128 py, __m128 pz, __m128 dx, __m128 dy, __m128 dz,
+    __m128 v0x, __m128 v0y, __m128 v0z,
+    __m128 e1x, __m128 e1y, __m128 e1z,
+    __m128 e2x, __m128 e2y, __m128 e2z,
+    __m128 maxT, __m128 &outT)
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+
+    // pVec = cross(dir, e2)
+    const __m128 pvx = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+    const __m128 pvy = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+    const __m128 pvz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+
+    const __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, pvx), _mm_mul_ps(e1y, pvy)), _mm_mul_ps(e1z, pvz));
+    const __m128 invDet = _mm_div_ps(one, det);
+
+    const __m128 tx = _mm_sub_ps(px, v0x);
+    const __m128 ty = _mm_sub_ps(py, v0y);
+    const __m128 tz = _mm_sub_ps(pz, v0z);
+
+    const __m128 u = _mm_mul_ps(
+        _mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, pvx), _mm_mul_ps(ty, pvy)), _mm_mul_ps(tz, pvz)), invDet);
+
+    // qVec = cross(tVec, e1)
+    const __m128 qx = _mm_sub_ps(_mm_mul_ps(ty, e1z), _mm_mul_ps(tz, e1y));
+    const __m128 qy = _mm_sub_ps(_mm_mul_ps(tz, e1x), _mm_mul_ps(tx, e1z));
+    const __m128 qz = _mm_sub_ps(_mm_mul_ps(tx, e1y), _mm_mul_ps(ty, e1x));
+
+    const __m128 v = _mm_mul_ps(
+        _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), invDet);
+    const __m128 t = _mm_mul_ps(
+        _mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), invDet);
+
+    const __m128 absDet = _mm_andnot_ps(_mm_set1_ps(-0.0f), det);
+    __m128 hit = _mm_cmpgt_ps(absDet, _mm_set1_ps(RayTriangleDetEpsilon));
+    hit = _mm_and_ps(hit, _mm_cmpge_ps(u, zero));
+    hit = _mm_and_ps(hit, _mm_cmpge_ps(v, zero));
+    hit = _mm_and_ps(hit, _mm_cmple_ps(_mm_add_ps(u, v), one));
+    hit = _mm_and_ps(hit, _mm_cmpge_ps(t, zero));
+    hit = _mm_and_ps(hit, _mm_cmple_ps(t, maxT));
+
+    outT = sSelect4(hit, t, _mm_set1_ps(FLT_MAX));
+    return hit;
+}
+
+static __m128 sRaySphere4(
+    __m128 px, __m128 py, __m128 pz, __m128 dx, __m128 dy, __m128 dz,
+    __m128 cx, __m128 cy, __m128 cz, __m128 radius,
+    __m128 maxT, __m128 &outT)
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 ocx = _mm_sub_ps(px, cx);
+    const __m128 ocy = _mm_sub_ps(py, cy);
+    const __m128 ocz = _mm_sub_ps(pz, cz);
+
+    const __m128 a = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+    const __m128 b = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ocx, dx), _mm_mul_ps(ocy, dy)), _mm_mul_ps(ocz, dz));
+    const __m128 c = _mm_sub_ps(
+        _mm_add_ps(_mm_add_ps(_mm_mul_ps(ocx, ocx), _mm_mul_ps(ocy, ocy)), _mm_mul_ps(ocz, ocz)),
+        _mm_mul_ps(radius, radius));
+    const __m128 disc = _mm_sub_ps(_mm_mul_ps(b, b), _mm_mul_ps(a, c));
+
+    const __m128 sq = _mm_sqrt_ps(_mm_max_ps(disc, zero));
+    const __m128 invA = _mm_div_ps(_mm_set1_ps(1.0f), a);
+    const __m128 negB = _mm_sub_ps(zero, b);
+    const __m128 tNear = _mm_mul_ps(_mm_sub_ps(negB, sq), invA);
+    const __m128 tFar = _mm_mul_ps(_mm_add_ps(negB, sq), invA);
+    const __m128 t = sSelect4(_mm_cmpge_ps(tNear, zero), tNear, tFar);
+
+    __m128 hit = _mm_cmpge_ps(disc, zero);
+    hit = _mm_and_ps(hit, _mm_cmpgt_ps(a, zero));
+    hit = _mm_and_ps(hit, _mm_cmpge_ps(t, zero));
+    hit = _mm_and_ps(hit, _mm_cmple_ps(t, maxT));
+
+    outT = sSelect4(hit, t, _mm_set1_ps(FLT_MAX));
+    return hit;
+}
+
+static uint32_t sRayAABBPacket4(const Ray &ray, const float *minX, const float *minY, const float *minZ,
+    const float *maxX, const float *maxY, const float *maxZ, float maxT, float *outT)
+{
+    __m128 t;
+    const __m128 hit = sRayAABB4(
+        _mm_set1_ps(ray.pos.x), _mm_set1_ps(ray.pos.y), _mm_set1_ps(ray.pos.z),
+        _mm_set1_ps(1.0f / ray.dir.x), _mm_set1_ps(1.0f / ray.dir.y), _mm_set1_ps(1.0f / ray.dir.z),
+        _mm_load_ps(minX), _mm_load_ps(minY), _mm_load_ps(minZ),
+        _mm_load_ps(maxX), _mm_load_ps(maxY), _mm_load_ps(maxZ),
+        _mm_set1_ps(maxT), t);
+    _mm_storeu_ps(outT, t);
+    return uint32_t(_mm_movemask_ps(hit));
+}
+
+static uint32_t sRayPacket4AABB(const float *posX, const float *posY, const float *posZ,
+    const float *dirX, const float *dirY, const float *dirZ, const AABB &box, float maxT, float *outT)
+{
+    const __m128 one = _mm_set1_ps(1.0f);
+    __m128 t;
+    const __m128 hit = sRayAABB4(
+        _mm_load_ps(posX), _mm_load_ps(posY), _mm_load_ps(posZ),
+        _mm_div_ps(one, _mm_load_ps(dirX)), _mm_div_ps(one, _mm_load_ps(dirY)), _mm_div_ps(one, _mm_load_ps(dirZ)),
+        _mm_set1_ps(box.min.x), _mm_set1_ps(box.min.y), _mm_set1_ps(box.min.z),
+        _mm_set1_ps(box.max.x), _mm_set1_ps(box.max.y), _mm_set1_ps(box.max.z),
+        _mm_set1_ps(maxT), t);
+    _mm_storeu_ps(outT, t);
+    return uint32_t(_mm_movemask_ps(hit));
+}
+
+static uint32_t sRayTrianglePacket4(const Ray &ray,
+    const float *v0X, const float *v0Y, const float *v0Z,
+    const float *e1X, const float *e1Y, const float *e1Z,
+    const float *e2X, const float *e2Y, const float *e2Z, float maxT, float *outT)
+{
+    __m128 t;
+    const __m128 hit = sRayTriangle4(
+        _mm_set1_ps(ray.pos.x), _mm_set1_ps(ray.pos.y), _mm_set1_ps(ray.pos.z),
+        _mm_set1_ps(ray.dir.x), _mm_set1_ps(ray.dir.y), _mm_set1_ps(ray.dir.z),
+        _mm_load_ps(v0X), _mm_load_ps(v0Y), _mm_load_ps(v0Z),
+        _mm_load_ps(e1X), _mm_load_ps(e1Y), _mm_load_ps(e1Z),
+        _mm_load_ps(e2X), _mm_load_ps(e2Y), _mm_load_ps(e2Z),
+        _mm_set1_ps(maxT), t);
+    _mm_storeu_ps(outT, t);
+    return uint32_t(_mm_movemask_ps(hit));
+}
+
+static uint32_t sRayPacket4Triangle(const float *posX, const float *posY, const float *posZ,
+    const float *dirX, const float *dirY, const float *dirZ,
+    const Vec3 &v0, const Vec3 &e1, const Vec3 &e2, float maxT, float *outT)
+{
+    __m128 t;
+    const __m128 hit = sRayTriangle4(
+        _mm_load_ps(posX), _mm_load_ps(posY), _mm_load_ps(posZ),
+        _mm_load_ps(dirX), _mm_load_ps(dirY), _mm_load_ps(dirZ),
+        _mm_set1_ps(v0.x), _mm_set1_ps(v0.y), _mm_set1_ps(v0.z),
+        _mm_set1_ps(e1.x), _mm_set1_ps(e1.y), _mm_set1_ps(e1.z),
+        _mm_set1_ps(e2.x), _mm_set1_ps(e2.y), _mm_set1_ps(e2.z),
+        _mm_set1_ps(maxT), t);
+    _mm_storeu_ps(outT, t);
+    return uint32_t(_mm_movemask_ps(hit));
+}
+
+static uint32_t sRaySpherePacket4(const Ray &ray,
+    const float *centerX, const float *centerY, const float *centerZ, const float *radius,
+    float maxT, float *outT)
+{
+    __m128 t;
+    const __m128 hit = sRaySphere4(
+        _mm_set1_ps(ray.pos.x), _mm_set1_ps(ray.pos.y), _mm_set1_ps(ray.pos.z),
+        _mm_set1_ps(ray.dir.x), _mm_set1_ps(ray.dir.y), _mm_set1_ps(ray.dir.z),
+        _mm_load_ps(centerX), _mm_load_ps(centerY), _mm_load_ps(centerZ), _mm_load_ps(radius),
+        _mm_set1_ps(maxT), t);
+    _mm_storeu_ps(outT, t);
+    return uint32_t(_mm_movemask_ps(hit));
+}
+
+static uint32_t sRayPacket4Sphere(const float *posX, const float *posY, const float *posZ,
+    const float *dirX, const float *dirY, const float *dirZ,
+    const Vec3 &center, float radius, float maxT, float *outT)
+{
+    __m128 t;
+    const __m128 hit = sRaySphere4(
+        _mm_load_ps(posX), _mm_load_ps(posY), _mm_load_ps(posZ),
+        _mm_load_ps(dirX), _mm_load_ps(dirY), _mm_load_ps(dirZ),
+        _mm_set1_ps(center.x), _mm_set1_ps(center.y), _mm_set1_ps(center.z), _mm_set1_ps(radius),
+        _mm_set1_ps(maxT), t);
+    _mm_storeu_ps(outT, t);
+    return uint32_t(_mm_movemask_ps(hit));
+}
+
+#endif // RAY_SIMD_SSE
+
+
+
+
+#if CARPMATH_X86
+
+CARPMATH_TARGET_AVX2 static __m256 sSelect8(__m256 mask, __m256 a, __m256 b)
+{
+    return _mm256_blendv_ps(b, a, mask);
+}
+
+CARPMATH_TARGET_AVX2 static __m256 sRayAABB8(
+    __m256 px, __m256 py, __m256 pz, __m256 ix, __m256 iy, __m256 iz,
+    __m256 minX, __m256 minY, __m256 minZ, __m256 maxX, __m256 maxY, __m256 maxZ,
+    __m256 maxT, __m256 &outT)
+{
+    const __m256 t0x = _mm256_mul_ps(_mm256_sub_ps(minX, px), ix);
+    const __m256 t1x = _mm256_mul_ps(_mm256_sub_ps(maxX, px), ix);
+    const __m256 t0y = _mm256_mul_ps(_mm256_sub_ps(minY, py), iy);
+    const __m256 t1y = _mm256_mul_ps(_mm256_sub_ps(maxY, py), iy);
+    const __m256 t0z = _mm256_mul_ps(_mm256_sub_ps(minZ, pz), iz);
+    const __m256 t1z = _mm256_mul_ps(_mm256_sub_ps(maxZ, pz), iz);
+
+    const __m256 tNear = _mm256_max_ps(
+        _mm256_max_ps(_mm256_min_ps(t0x, t1x), _mm256_min_ps(t0y, t1y)),
+        _mm256_max_ps(_mm256_min_ps(t0z, t1z), _mm256_setzero_ps()));
+    const __m256 tFar = _mm256_min_ps(
+        _mm256_min_ps(_mm256_max_ps(t0x, t1x), _mm256_max_ps(t0y, t1y)),
+        _mm256_min_ps(_mm256_max_ps(t0z, t1z), maxT));
+
+    const __m256 hit = _mm256_cmp_ps(tNear, tFar, _CMP_LE_OQ);
+    outT = sSelect8(hit, tNear, _mm256_set1_ps(FLT_MAX));
+    return hit;
+}
+
+CARPMATH_TARGET_AVX2 static __m256 sRayTriangle8(
+    __m256 px, __m256 py, __m256 pz, __m256 dx, __m256 dy, __m256 dz,
+    __m256 v0x, __m256 v0y, __m256 v0z,
+    __m256 e1x, __m256 e1y, __m256 e1z,
+    __m256 e2x, __m256 e2y, __m256 e2z,
+    __m256 maxT, __m256 &outT)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+
+    const __m256 pvx = _mm256_sub_ps(_mm256_mul_ps(dy, e2z), _mm256_mul_ps(dz, e2y));
+    const __m256 pvy = _mm256_sub_ps(_mm256_mul_ps(dz, e2x), _mm256_mul_ps(dx, e2z));
+    const __m256 pvz = _mm256_sub_ps(_mm256_mul_ps(dx, e2y), _mm256_mul_ps(dy, e2x));
+
+    const __m256 det = _mm256_add_ps(
+        _mm256_add_ps(_mm256_mul_ps(e1x, pvx), _mm256_mul_ps(e1y, pvy)), _mm256_mul_ps(e1z, pvz));
+    const __m256 invDet = _mm256_div_ps(one, det);
+
+    const __m256 tx = _mm256_sub_ps(px, v0x);
+    const __m256 ty = _mm256_sub_ps(py, v0y);
+    const __m256 tz = _mm256_sub_ps(pz, v0z);
+
+    const __m256 u = _mm256_mul_ps(_mm256_add_ps(
+        _mm256_add_ps(_mm256_mul_ps(tx, pvx), _mm256_mul_ps(ty, pvy)), _mm256_mul_ps(tz, pvz)), invDet);
+
+    const __m256 qx = _mm256_sub_ps(_mm256_mul_ps(ty, e1z), _mm256_mul_ps(tz, e1y));
+    const __m256 qy = _mm256_sub_ps(_mm256_mul_ps(tz, e1x), _mm256_mul_ps(tx, e1z));
+    const __m256 qz = _mm256_sub_ps(_mm256_mul_ps(tx, e1y), _mm256_mul_ps(ty, e1x));
+
+    const __m256 v = _mm256_mul_ps(_mm256_add_ps(
+        _mm256_add_ps(_mm256_mul_ps(dx, qx), _mm256_mul_ps(dy, qy)), _mm256_mul_ps(dz, qz)), invDet);
+    const __m256 t = _mm256_mul_ps(_mm256_add_ps(
+        _mm256_add_ps(_mm256_mul_ps(e2x, qx), _mm256_mul_ps(e2y, qy)), _mm256_mul_ps(e2z, qz)), invDet);
+
+    const __m256 absDet = _mm256_andnot_ps(_mm256_set1_ps(-0.0f), det);
+    __m256 hit = _mm256_cmp_ps(absDet, _mm256_set1_ps(RayTriangleDetEpsilon), _CMP_GT_OQ);
+    hit = _mm256_and_ps(hit, _mm256_cmp_ps(u, zero, _CMP_GE_OQ));
+    hit = _mm256_and_ps(hit, _mm256_cmp_ps(v, zero, _CMP_GE_OQ));
+    hit = _mm256_and_ps(hit, _mm256_cmp_ps(_mm256_add_ps(u, v), one, _CMP_LE_OQ));
+    hit = _mm256_and_ps(hit, _mm256_cmp_ps(t, zero, _CMP_GE_OQ));
+    hit = _mm256_and_ps(hit, _mm256_cmp_ps(t, maxT, _CMP_LE_OQ));
+
+    outT = sSelect8(hit, t, _mm256_set1_ps(FLT_MAX));
+    return hit;
+}
+
+CARPMATH_TARGET_AVX2 static __m256 sRaySphere8(
+    __m256 px, __m256 py, __m256 pz, __m256 dx, __m256 dy, __m256 dz,
+    __m256 cx, __m256 cy, __m256 cz, __m256 radius,
+    __m256 maxT, __m256 &outT)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 ocx = _mm256_sub_ps(px, cx);
+    const __m256 ocy = _mm256_sub_ps(py, cy);
+    const __m256 ocz = _mm256_sub_ps(pz, cz);
+
+    const __m256 a = _mm256_add_ps(
+        _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+    const __m256 b = _mm256_add_ps(
+        _mm256_add_ps(_mm256_mul_ps(ocx, dx), _mm256_mul_ps(ocy, dy)), _mm256_mul_ps(ocz, dz));
+    const __m256 c = _mm256_sub_ps(_mm256_add_ps(
+        _mm256_add_ps(_mm256_mul_ps(ocx, ocx), _mm256_mul_ps(ocy, ocy)), _mm256_mul_ps(ocz, ocz)),
+        _mm256_mul_ps(radius, radius));
+    const __m256 disc = _mm256_sub_ps(_mm256_mul_ps(b, b), _mm256_mul_ps(a, c));
+
+    const __m256 sq = _mm256_sqrt_ps(_mm256_max_ps(disc, zero));
+    const __m256 invA = _mm256_div_ps(_mm256_set1_ps(1.0f), a);
+    const __m256 negB = _mm256_sub_ps(zero, b);
+    const __m256 tNear = _mm256_mul_ps(_mm256_sub_ps(negB, sq), invA);
+    const __m256 tFar = _mm256_mul_ps(_mm256_add_ps(negB, sq), invA);
+    const __m256 t = sSelect8(_mm256_cmp_ps(tNear, zero, _CMP_GE_OQ), tNear, tFar);
+
+    __m256 hit = _mm256_cmp_ps(disc, zero, _CMP_GE_OQ);
+    hit = _mm256_and_ps(hit, _mm256_cmp_ps(a, zero, _CMP_GT_OQ));
+    hit = _mm256_and_ps(hit, _mm256_cmp_ps(t, zero, _CMP_GE_OQ));
+    hit = _mm256_and_ps(hit, _mm256_cmp_ps(t, maxT, _CMP_LE_OQ));
+
+    outT = sSelect8(hit, t, _mm256_set1_ps(FLT_MAX));
+    return hit;
+}
+
+#endif // CARPMATH_X86
+
+
+
+
+uint32_t intersectRayAABB(const Ray &ray, const AABBPacket4 &boxes, float maxT, float *outT)
+{
+#if RAY_SIMD_SSE
+    return sRayAABBPacket4(ray, boxes.minX, boxes.minY, boxes.minZ,
+        boxes.maxX, boxes.maxY, boxes.maxZ, maxT, outT);
+#else
+    uint32_t mask = 0;
+    for(int i = 0; i < 4; ++i)
+    {
+        AABB box(Vec3(boxes.minX[i], boxes.minY[i], boxes.minZ[i]), Vec3(boxes.maxX[i], boxes.maxY[i], boxes.maxZ[i]));
+        mask |= intersectRayAABB(ray, box, maxT, outT[i]) ? (1u << i) : 0u;
+    }
+    return mask;
+#endif
+}
+
+#if CARPMATH_X86
+CARPMATH_TARGET_AVX2 static uint32_t sRayAABBPacket8AVX2(const Ray &ray, const AABBPacket8 &boxes, float maxT, float *outT)
+{
+    __m256 t;
+    const __m256 hit = sRayAABB8(
+        _mm256_set1_ps(ray.pos.x), _mm256_set1_ps(ray.pos.y), _mm256_set1_ps(ray.pos.z),
+        _mm256_set1_ps(1.0f / ray.dir.x), _mm256_set1_ps(1.0f / ray.dir.y), _mm256_set1_ps(1.0f / ray.dir.z),
+        _mm256_load_ps(boxes.minX), _mm256_load_ps(boxes.minY), _mm256_load_ps(boxes.minZ),
+        _mm256_load_ps(boxes.maxX), _mm256_load_ps(boxes.maxY), _mm256_load_ps(boxes.maxZ),
+        _mm256_set1_ps(maxT), t);
+    _mm256_storeu_ps(outT, t);
+    return uint32_t(_mm256_movemask_ps(hit));
+}
+#endif
+
+#if RAY_SIMD_SSE
+static uint32_t sRayAABBPacket8SSE(const Ray &ray, const AABBPacket8 &boxes, float maxT, float *outT)
+{
+    uint32_t lo = sRayAABBPacket4(ray, boxes.minX, boxes.minY, boxes.minZ,
+        boxes.maxX, boxes.maxY, boxes.maxZ, maxT, outT);
+    uint32_t hi = sRayAABBPacket4(ray, boxes.minX + 4, boxes.minY + 4, boxes.minZ + 4,
+        boxes.maxX + 4, boxes.maxY + 4, boxes.maxZ + 4, maxT, outT + 4);
+    return lo | (hi << 4u);
+}
+#endif
+
+static uint32_t sRayAABBPacket8Scalar(const Ray &ray, const AABBPacket8 &boxes, float maxT, float *outT)
+{
+    uint32_t mask = 0;
+    for(int i = 0; i < 8; ++i)
+    {
+        AABB box(Vec3(boxes.minX[i], boxes.minY[i], boxes.minZ[i]), Vec3(boxes.maxX[i], boxes.maxY[i], boxes.maxZ[i]));
+        mask |= intersectRayAABB(ray, box, maxT, outT[i]) ? (1u << i) : 0u;
+    }
+    return mask;
+}
+
+uint32_t intersectRayAABB(const Ray &ray, const AABBPacket8 &boxes, float maxT, float *outT)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdIntersectRayPacket8, 8u);
+    return getSimdKernels().intersectRayAABBPacket8(ray, boxes, maxT, outT);
+}
+
+uint32_t intersectRayAABB(const RayPacket4 &rays, const AABB &box, float maxT, float *outT)
+{
+#if RAY_SIMD_SSE
+    return sRayPacket4AABB(rays.posX, rays.posY, rays.posZ,
+        rays.dirX, rays.dirY, rays.dirZ, box, maxT, outT);
+#else
+    uint32_t mask = 0;
+    for(int i = 0; i < 4; ++i)
+    {
+        Ray ray(Vec3(rays.posX[i], rays.posY[i], rays.posZ[i]), Vec3(rays.dirX[i], rays.dirY[i], rays.dirZ[i]));
+        mask |= intersectRayAABB(ray, box, maxT, outT[i]) ? (1u << i) : 0u;
+    }
+    return mask;
+#endif
+}
+
+#if CARPMATH_X86
+CARPMATH_TARGET_AVX2 static uint32_t sRayPacket8AABBAVX2(const RayPacket8 &rays, const AABB &box, float maxT, float *outT)
+{
+    const __m256 one = _mm256_set1_ps(1.0f);
+    __m256 t;
+    const __m256 hit = sRayAABB8(
+        _mm256_load_ps(rays.posX), _mm256_load_ps(rays.posY), _mm256_load_ps(rays.posZ),
+        _mm256_div_ps(one, _mm256_load_ps(rays.dirX)),
+        _mm256_div_ps(one, _mm256_load_ps(rays.dirY)),
+        _mm256_div_ps(one, _mm256_load_ps(rays.dirZ)),
+        _mm256_set1_ps(box.min.x), _mm256_set1_ps(box.min.y), _mm256_set1_ps(box.min.z),
+        _mm256_set1_ps(box.max.x), _mm256_set1_ps(box.max.y), _mm256_set1_ps(box.max.z),
+        _mm256_set1_ps(maxT), t);
+    _mm256_storeu_ps(outT, t);
+    return uint32_t(_mm256_movemask_ps(hit));
+}
+#endif
+
+#if RAY_SIMD_SSE
+static uint32_t sRayPacket8AABBSSE(const RayPacket8 &rays, const AABB &box, float maxT, float *outT)
+{
+    uint32_t lo = sRayPacket4AABB(rays.posX, rays.posY, rays.posZ,
+        rays.dirX, rays.dirY, rays.dirZ, box, maxT, outT);
+    uint32_t hi = sRayPacket4AABB(rays.posX + 4, rays.posY + 4, rays.posZ + 4,
+        rays.dirX + 4, rays.dirY + 4, rays.dirZ + 4, box, maxT, outT + 4);
+    return lo | (hi << 4u);
+}
+#endif
+
+static uint32_t sRayPacket8AABBScalar(const RayPacket8 &rays, const AABB &box, float maxT, float *outT)
+{
+    uint32_t mask = 0;
+    for(int i = 0; i < 8; ++i)
+    {
+        Ray ray(Vec3(rays.posX[i], rays.posY[i], rays.posZ[i]), Vec3(rays.dirX[i], rays.dirY[i], rays.dirZ[i]));
+        mask |= intersectRayAABB(ray, box, maxT, outT[i]) ? (1u << i) : 0u;
+    }
+    return mask;
+}
+
+uint32_t intersectRayAABB(const RayPacket8 &rays, const AABB &box, float maxT, float *outT)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdIntersectRayPacket8, 8u);
+    return getSimdKernels().intersectRayPacket8AABB(rays, box, maxT, outT);
+}
+
+
+
+
+uint32_t intersectRayTriangle(const Ray &ray, const TrianglePacket4 &triangles, float maxT, float *outT)
+{
+#if RAY_SIMD_SSE
+    return sRayTrianglePacket4(ray,
+        triangles.v0X, triangles.v0Y, triangles.v0Z,
+        triangles.e1X, triangles.e1Y, triangles.e1Z,
+        triangles.e2X, triangles.e2Y, triangles.e2Z, maxT, outT);
+#else
+    uint32_t mask = 0;
+    for(int i = 0; i < 4; ++i)
+    {
+        Vec3 v0(triangles.v0X[i], triangles.v0Y[i], triangles.v0Z[i]);
+        Vec3 v1 = v0 + Vec3(triangles.e1X[i], triangles.e1Y[i], triangles.e1Z[i]);
+        Vec3 v2 = v0 + Vec3(triangles.e2X[i], triangles.e2Y[i], triangles.e2Z[i]);
+        mask |= intersectRayTriangle(ray, v0, v1, v2, maxT, outT[i]) ? (1u << i) : 0u;
+    }
+    return mask;
+#endif
+}
+
+#if CARPMATH_X86
+CARPMATH_TARGET_AVX2 static uint32_t sRayTrianglePacket8AVX2(const Ray &ray, const TrianglePacket8 &triangles, float maxT, float *outT)
+{
+    __m256 t;
+    const __m256 hit = sRayTriangle8(
+        _mm256_set1_ps(ray.pos.x), _mm256_set1_ps(ray.pos.y), _mm256_set1_ps(ray.pos.z),
+        _mm256_set1_ps(ray.dir.x), _mm256_set1_ps(ray.dir.y), _mm256_set1_ps(ray.dir.z),
+        _mm256_load_ps(triangles.v0X), _mm256_load_ps(triangles.v0Y), _mm256_load_ps(triangles.v0Z),
+        _mm256_load_ps(triangles.e1X), _mm256_load_ps(triangles.e1Y), _mm256_load_ps(triangles.e1Z),
+        _mm256_load_ps(triangles.e2X), _mm256_load_ps(triangles.e2Y), _mm256_load_ps(triangles.e2Z),
+        _mm256_set1_ps(maxT), t);
+    _mm256_storeu_ps(outT, t);
+    return uint32_t(_mm256_movemask_ps(hit));
+}
+#endif
+
+#if RAY_SIMD_SSE
+static uint32_t sRayTrianglePacket8SSE(const Ray &ray, const TrianglePacket8 &triangles, float maxT, float *outT)
+{
+    uint32_t lo = sRayTrianglePacket4(ray,
+        triangles.v0X, triangles.v0Y, triangles.v0Z,
+        triangles.e1X, triangles.e1Y, triangles.e1Z,
+        triangles.e2X, triangles.e2Y, triangles.e2Z, maxT, outT);
+    uint32_t hi = sRayTrianglePacket4(ray,
+        triangles.v0X + 4, triangles.v0Y + 4, triangles.v0Z + 4,
+        triangles.e1X + 4, triangles.e1Y + 4, triangles.e1Z + 4,
+        triangles.e2X + 4, triangles.e2Y + 4, triangles.e2Z + 4, maxT, outT + 4);
+    return lo | (hi << 4u);
+}
+#endif
+
+static uint32_t sRayTrianglePacket8Scalar(const Ray &ray, const TrianglePacket8 &triangles, float maxT, float *outT)
+{
+    uint32_t mask = 0;
+    for(int i = 0; i < 8; ++i)
+    {
+        Vec3 v0(triangles.v0X[i], triangles.v0Y[i], triangles.v0Z[i]);
+        Vec3 v1 = v0 + Vec3(triangles.e1X[i], triangles.e1Y[i], triangles.e1Z[i]);
+        Vec3 v2 = v0 + Vec3(triangles.e2X[i], triangles.e2Y[i], triangles.e2Z[i]);
+        mask |= intersectRayTriangle(ray, v0, v1, v2, maxT, outT[i]) ? (1u << i) : 0u;
+    }
+    return mask;
+}
+
+uint32_t intersectRayTriangle(const Ray &ray, const TrianglePacket8 &triangles, float maxT, float *outT)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdIntersectRayPacket8, 8u);
+    return getSimdKernels().intersectRayTrianglePacket8(ray, triangles, maxT, outT);
+}
+
+uint32_t intersectRayTriangle(const RayPacket4 &rays,
+    const Vec3 &v0, const Vec3 &v1, const Vec3 &v2, float maxT, float *outT)
+{
+#if RAY_SIMD_SSE
+    return sRayPacket4Triangle(rays.posX, rays.posY, rays.posZ,
+        rays.dirX, rays.dirY, rays.dirZ, v0, v1 - v0, v2 - v0, maxT, outT);
+#else
+    uint32_t mask = 0;
+    for(int i = 0; i < 4; ++i)
+    {
+        Ray ray(Vec3(rays.posX[i], rays.posY[i], rays.posZ[i]), Vec3(rays.dirX[i], rays.dirY[i], rays.dirZ[i]));
+        mask |= intersectRayTriangle(ray, v0, v1, v2, maxT, outT[i]) ? (1u << i) : 0u;
+    }
+    return mask;
+#endif
+}
+
+#if CARPMATH_X86
+CARPMATH_TARGET_AVX2 static uint32_t sRayPacket8TriangleAVX2(const RayPacket8 &rays,
+    const Vec3 &v0, const Vec3 &v1, const Vec3 &v2, float maxT, float *outT)
+{
+    const Vec3 e1 = v1 - v0;
+    const Vec3 e2 = v2 - v0;
+    __m256 t;
+    const __m256 hit = sRayTriangle8(
+        _mm256_load_ps(rays.posX), _mm256_load_ps(rays.posY), _mm256_load_ps(rays.posZ),
+        _mm256_load_ps(rays.dirX), _mm256_load_ps(rays.dirY), _mm256_load_ps(rays.dirZ),
+        _mm256_set1_ps(v0.x), _mm256_set1_ps(v0.y), _mm256_set1_ps(v0.z),
+        _mm256_set1_ps(e1.x), _mm256_set1_ps(e1.y), _mm256_set1_ps(e1.z),
+        _mm256_set1_ps(e2.x), _mm256_set1_ps(e2.y), _mm256_set1_ps(e2.z),
+        _mm256_set1_ps(maxT), t);
+    _mm256_storeu_ps(outT, t);
+    return uint32_t(_mm256_movemask_ps(hit));
+}
+#endif
+
+#if RAY_SIMD_SSE
+static uint32_t sRayPacket8TriangleSSE(const RayPacket8 &rays,
+    const Vec3 &v0, const Vec3 &v1, const Vec3 &v2, float maxT, float *outT)
+{
+    const Vec3 e1 = v1 - v0;
+    const Vec3 e2 = v2 - v0;
+    uint32_t lo = sRayPacket4Triangle(rays.posX, rays.posY, rays.posZ,
+        rays.dirX, rays.dirY, rays.dirZ, v0, e1, e2, maxT, outT);
+    uint32_t hi = sRayPacket4Triangle(rays.posX + 4, rays.posY + 4, rays.posZ + 4,
+        rays.dirX + 4, rays.dirY + 4, rays.dirZ + 4, v0, e1, e2, maxT, outT + 4);
+    return lo | (hi << 4u);
+}
+#endif
+
+static uint32_t sRayPacket8TriangleScalar(const RayPacket8 &rays,
+    const Vec3 &v0, const Vec3 &v1, const Vec3 &v2, float maxT, float *outT)
+{
+    uint32_t mask = 0;
+    for(int i = 0; i < 8; ++i)
+    {
+        Ray ray(Vec3(rays.posX[i], rays.posY[i], rays.posZ[i]), Vec3(rays.dirX[i], rays.dirY[i], rays.dirZ[i]));
+        mask |= intersectRayTriangle(ray, v0, v1, v2, maxT, outT[i]) ? (1u << i) : 0u;
+    }
+    return mask;
+}
+
+uint32_t intersectRayTriangle(const RayPacket8 &rays,
+    const Vec3 &v0, const Vec3 &v1, const Vec3 &v2, float maxT, float *outT)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdIntersectRayPacket8, 8u);
+    return getSimdKernels().intersectRayPacket8Triangle(rays, v0, v1, v2, maxT, outT);
+}
+
+
+
+
+uint32_t intersectRaySphere(const Ray &ray, const SpherePacket4 &spheres, float maxT, float *outT)
+{
+#if RAY_SIMD_SSE
+    return sRaySpherePacket4(ray, spheres.centerX, spheres.centerY, spheres.centerZ, spheres.radius, maxT, outT);
+#else
+    uint32_t mask = 0;
+    for(int i = 0; i < 4; ++i)
+    {
+        Vec3 center(spheres.centerX[i], spheres.centerY[i], spheres.centerZ[i]);
+        mask |= intersectRaySphere(ray, center, spheres.radius[i], maxT, outT[i]) ? (1u << i) : 0u;
+    }
+    return mask;
+#endif
+}
+
+#if CARPMATH_X86
+CARPMATH_TARGET_AVX2 static uint32_t sRaySpherePacket8AVX2(const Ray &ray, const SpherePacket8 &spheres, float maxT, float *outT)
+{
+    __m256 t;
+    const __m256 hit = sRaySphere8(
+        _mm256_set1_ps(ray.pos.x), _mm256_set1_ps(ray.pos.y), _mm256_set1_ps(ray.pos.z),
+        _mm256_set1_ps(ray.dir.x), _mm256_set1_ps(ray.dir.y), _mm256_set1_ps(ray.dir.z),
+        _mm256_load_ps(spheres.centerX), _mm256_load_ps(spheres.centerY), _mm256_load_ps(spheres.centerZ),
+        _mm256_load_ps(spheres.radius),
+        _mm256_set1_ps(maxT), t);
+    _mm256_storeu_ps(outT, t);
+    return uint32_t(_mm256_movemask_ps(hit));
+}
+#endif
+
+#if RAY_SIMD_SSE
+static uint32_t sRaySpherePacket8SSE(const Ray &ray, const SpherePacket8 &spheres, float maxT, float *outT)
+{
+    uint32_t lo = sRaySpherePacket4(ray,
+        spheres.centerX, spheres.centerY, spheres.centerZ, spheres.radius, maxT, outT);
+    uint32_t hi = sRaySpherePacket4(ray,
+        spheres.centerX + 4, spheres.centerY + 4, spheres.centerZ + 4, spheres.radius + 4, maxT, outT + 4);
+    return lo | (hi << 4u);
+}
+#endif
+
+static uint32_t sRaySpherePacket8Scalar(const Ray &ray, const SpherePacket8 &spheres, float maxT, float *outT)
+{
+    uint32_t mask = 0;
+    for(int i = 0; i < 8; ++i)
+    {
+        Vec3 center(spheres.centerX[i], spheres.centerY[i], spheres.centerZ[i]);
+        mask |= intersectRaySphere(ray, center, spheres.radius[i], maxT, outT[i]) ? (1u << i) : 0u;
+    }
+    return mask;
+}
+
+uint32_t intersectRaySphere(const Ray &ray, const SpherePacket8 &spheres, float maxT, float *outT)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdIntersectRayPacket8, 8u);
+    return getSimdKernels().intersectRaySpherePacket8(ray, spheres, maxT, outT);
+}
+
+uint32_t intersectRaySphere(const RayPacket4 &rays, const Vec3 &center, float radius, float maxT, float *outT)
+{
+#if RAY_SIMD_SSE
+    return sRayPacket4Sphere(rays.posX, rays.posY, rays.posZ,
+        rays.dirX, rays.dirY, rays.dirZ, center, radius, maxT, outT);
+#else
+    uint32_t mask = 0;
+    for(int i = 0; i < 4; ++i)
+    {
+        Ray ray(Vec3(rays.posX[i], rays.posY[i], rays.posZ[i]), Vec3(rays.dirX[i], rays.dirY[i], rays.dirZ[i]));
+        mask |= intersectRaySphere(ray, center, radius, maxT, outT[i]) ? (1u << i) : 0u;
+    }
+    return mask;
+#endif
+}
+
+#if CARPMATH_X86
+CARPMATH_TARGET_AVX2 static uint32_t sRayPacket8SphereAVX2(const RayPacket8 &rays, const Vec3 &center, float radius, float maxT, float *outT)
+{
+    __m256 t;
+    const __m256 hit = sRaySphere8(
+        _mm256_load_ps(rays.posX), _mm256_load_ps(rays.posY), _mm256_load_ps(rays.posZ),
+        _mm256_load_ps(rays.dirX), _mm256_load_ps(rays.dirY), _mm256_load_ps(rays.dirZ),
+        _mm256_set1_ps(center.x), _mm256_set1_ps(center.y), _mm256_set1_ps(center.z),
+        _mm256_set1_ps(radius),
+        _mm256_set1_ps(maxT), t);
+    _mm256_storeu_ps(outT, t);
+    return uint32_t(_mm256_movemask_ps(hit));
+}
+#endif
+
+#if RAY_SIMD_SSE
+static uint32_t sRayPacket8SphereSSE(const RayPacket8 &rays, const Vec3 &center, float radius, float maxT, float *outT)
+{
+    uint32_t lo = sRayPacket4Sphere(rays.posX, rays.posY, rays.posZ,
+        rays.dirX, rays.dirY, rays.dirZ, center, radius, maxT, outT);
+    uint32_t hi = sRayPacket4Sphere(rays.posX + 4, rays.posY + 4, rays.posZ + 4,
+        rays.dirX + 4, rays.dirY + 4, rays.dirZ + 4, center, radius, maxT, outT + 4);
+    return lo | (hi << 4u);
+}
+#endif
+
+static uint32_t sRayPacket8SphereScalar(const RayPacket8 &rays, const Vec3 &center, float radius, float maxT, float *outT)
+{
+    uint32_t mask = 0;
+    for(int i = 0; i < 8; ++i)
+    {
+        Ray ray(Vec3(rays.posX[i], rays.posY[i], rays.posZ[i]), Vec3(rays.dirX[i], rays.dirY[i], rays.dirZ[i]));
+        mask |= intersectRaySphere(ray, center, radius, maxT, outT[i]) ? (1u << i) : 0u;
+    }
+    return mask;
+}
+
+uint32_t intersectRaySphere(const RayPacket8 &rays, const Vec3 &center, float radius, float maxT, float *outT)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdIntersectRayPacket8, 8u);
+    return getSimdKernels().intersectRayPacket8Sphere(rays, center, radius, maxT, outT);
+}
+
+
+
+
+void bindRayKernels(SimdKernels &kernels, SimdBackend backend)
+{
+    kernels.intersectRayAABBPacket8 = sRayAABBPacket8Scalar;
+    kernels.intersectRayPacket8AABB = sRayPacket8AABBScalar;
+    kernels.intersectRayTrianglePacket8 = sRayTrianglePacket8Scalar;
+    kernels.intersectRayPacket8Triangle = sRayPacket8TriangleScalar;
+    kernels.intersectRaySpherePacket8 = sRaySpherePacket8Scalar;
+    kernels.intersectRayPacket8Sphere = sRayPacket8SphereScalar;
+#if RAY_SIMD_SSE
+    if(backend >= SimdBackendSSE4)
+    {
+        kernels.intersectRayAABBPacket8 = sRayAABBPacket8SSE;
+        kernels.intersectRayPacket8AABB = sRayPacket8AABBSSE;
+        kernels.intersectRayTrianglePacket8 = sRayTrianglePacket8SSE;
+        kernels.intersectRayPacket8Triangle = sRayPacket8TriangleSSE;
+        kernels.intersectRaySpherePacket8 = sRaySpherePacket8SSE;
+        kernels.intersectRayPacket8Sphere = sRayPacket8SphereSSE;
+    }
+#endif
+#if CARPMATH_X86
+    if(backend >= SimdBackendAVX2)
+    {
+        kernels.intersectRayAABBPacket8 = sRayAABBPacket8AVX2;
+        kernels.intersectRayPacket8AABB = sRayPacket8AABBAVX2;
+        kernels.intersectRayTrianglePacket8 = sRayTrianglePacket8AVX2;
+        kernels.intersectRayPacket8Triangle = sRayPacket8TriangleAVX2;
+        kernels.intersectRaySpherePacket8 = sRaySpherePacket8AVX2;
+        kernels.intersectRayPacket8Sphere = sRayPacket8SphereAVX2;
+    }
+#endif
+}
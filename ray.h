@@ -0,0 +1,134 @@
+#pragma once
+
+#include "aabb.h"
+#include "uninittype.h"
+#include "vec3.h"
+
+#include <stdint.h>
+
+// Ray tests against single primitives and 4/8 wide SoA packets.
+// Packet versions return hit mask where bit i is set if lane i hit,
+// and write hit distance per lane to outT, misses get FLT_MAX.
+// Hit distance is in units of ray.dir length, so dir does not have
+// to be normalized.
+struct Ray
+{
+    Ray() : dir(0.0f, 0.0f, 1.0f) {}
+    Ray(UninitType) : pos(UninitType{}), dir(UninitType{}) {}
+    Ray(const Vec3 &pos, const Vec3 &dir) : pos(pos), dir(dir) {}
+
+    Vec3 pos;
+    Vec3 dir;
+};
+
+struct alignas(16) RayPacket4
+{
+    float posX[4];
+    float posY[4];
+    float posZ[4];
+    float dirX[4];
+    float dirY[4];
+    float dirZ[4];
+};
+
+struct alignas(32) RayPacket8
+{
+    float posX[8];
+    float posY[8];
+    float posZ[8];
+    float dirX[8];
+    float dirY[8];
+    float dirZ[8];
+};
+
+struct alignas(16) AABBPacket4
+{
+    float minX[4];
+    float minY[4];
+    float minZ[4];
+    float maxX[4];
+    float maxY[4];
+    float maxZ[4];
+};
+
+struct alignas(32) AABBPacket8
+{
+    float minX[8];
+    float minY[8];
+    float minZ[8];
+    float maxX[8];
+    float maxY[8];
+    float maxZ[8];
+};
+
+// Triangles are stored as v0 and edges e1 = v1 - v0, e2 = v2 - v0.
+struct alignas(16) TrianglePacket4
+{
+    float v0X[4];
+    float v0Y[4];
+    float v0Z[4];
+    float e1X[4];
+    float e1Y[4];
+    float e1Z[4];
+    float e2X[4];
+    float e2Y[4];
+    float e2Z[4];
+};
+
+struct alignas(32) TrianglePacket8
+{
+    float v0X[8];
+    float v0Y[8];
+    float v0Z[8];
+    float e1X[8];
+    float e1Y[8];
+    float e1Z[8];
+    float e2X[8];
+    float e2Y[8];
+    float e2Z[8];
+};
+
+struct alignas(16) SpherePacket4
+{
+    float centerX[4];
+    float centerY[4];
+    float centerZ[4];
+    float radius[4];
+};
+
+struct alignas(32) SpherePacket8
+{
+    float centerX[8];
+    float centerY[8];
+    float centerZ[8];
+    float radius[8];
+};
+
+void setRay(RayPacket4 &packet, int index, const Ray &ray);
+void setRay(RayPacket8 &packet, int index, const Ray &ray);
+void setAABB(AABBPacket4 &packet, int index, const AABB &box);
+void setAABB(AABBPacket8 &packet, int index, const AABB &box);
+void setTriangle(TrianglePacket4 &packet, int index, const Vec3 &v0, const Vec3 &v1, const Vec3 &v2);
+void setTriangle(TrianglePacket8 &packet, int index, const Vec3 &v0, const Vec3 &v1, const Vec3 &v2);
+void setSphere(SpherePacket4 &packet, int index, const Vec3 &center, float radius);
+void setSphere(SpherePacket8 &packet, int index, const Vec3 &center, float radius);
+
+bool intersectRayAABB(const Ray &ray, const AABB &box, float maxT, float &outT);
+uint32_t intersectRayAABB(const Ray &ray, const AABBPacket4 &boxes, float maxT, float *outT);
+uint32_t intersectRayAABB(const Ray &ray, const AABBPacket8 &boxes, float maxT, float *outT);
+uint32_t intersectRayAABB(const RayPacket4 &rays, const AABB &box, float maxT, float *outT);
+uint32_t intersectRayAABB(const RayPacket8 &rays, const AABB &box, float maxT, float *outT);
+
+bool intersectRayTriangle(const Ray &ray, const Vec3 &v0, const Vec3 &v1, const Vec3 &v2, float maxT, float &outT);
+uint32_t intersectRayTriangle(const Ray &ray, const TrianglePacket4 &triangles, float maxT, float *outT);
+uint32_t intersectRayTriangle(const Ray &ray, const TrianglePacket8 &triangles, float maxT, float *outT);
+uint32_t intersectRayTriangle(const RayPacket4 &rays,
+    const Vec3 &v0, const Vec3 &v1, const Vec3 &v2, float maxT, float *outT);
+uint32_t intersectRayTriangle(const RayPacket8 &rays,
+    const Vec3 &v0, const Vec3 &v1, const Vec3 &v2, float maxT, float *outT);
+
+bool intersectRaySphere(const Ray &ray, const Vec3 &center, float radius, float maxT, float &outT);
+uint32_t intersectRaySphere(const Ray &ray, const SpherePacket4 &spheres, float maxT, float *outT);
+uint32_t intersectRaySphere(const Ray &ray, const SpherePacket8 &spheres, float maxT, float *outT);
+uint32_t intersectRaySphere(const RayPacket4 &rays, const Vec3 &center, float radius, float maxT, float *outT);
+uint32_t intersectRaySphere(const RayPacket8 &rays, const Vec3 &center, float radius, float maxT, float *outT);
@@ -0,0 +1,362 @@
+#pragma once
+
+// Load, store and math helpers shared by SIMD kernels. Only for .cpp files.
+
+#include "dispatch.h"
+#include "quat.h"
+#include "vec3.h"
+
+#if (__AVX__ || __SSE__ || __SSE2__ || __SSE3__ || __SSE4_1__ || _M_AMD64 || _M_X64) && 1
+#define SIMDHELP_SSE 1
+#include <emmintrin.h>
+#endif
+#if CARPMATH_X86
+#include <immintrin.h>
+#endif
+
+// Polynomial slerp weights, sin(t * angle) / sin(angle) as a series in cos(angle) - 1 with
+// 12 terms. Last term is scaled to spread the truncation error, max error about 7e-7 for
+// cos(angle) in [0, 1].
+static constexpr uint32_t SlerpTermCount = 12u;
+static constexpr float SlerpLastTermScale = 1.894f;
+static constexpr float SlerpU[SlerpTermCount] = {
+    1.0f / 3.0f, 1.0f / 10.0f, 1.0f / 21.0f, 1.0f / 36.0f, 1.0f / 55.0f, 1.0f / 78.0f,
+    1.0f / 105.0f, 1.0f / 136.0f, 1.0f / 171.0f, 1.0f / 210.0f, 1.0f / 253.0f,
+    SlerpLastTermScale / 300.0f };
+static constexpr float SlerpV[SlerpTermCount] = {
+    1.0f / 3.0f, 2.0f / 5.0f, 3.0f / 7.0f, 4.0f / 9.0f, 5.0f / 11.0f, 6.0f / 13.0f,
+    7.0f / 15.0f, 8.0f / 17.0f, 9.0f / 19.0f, 10.0f / 21.0f, 11.0f / 23.0f,
+    SlerpLastTermScale * 12.0f / 25.0f };
+
+// Shorter arc slerp without trigonometry.
+static inline Quat sSlerpPolynomial(const Quat &a, const Quat &b, float t)
+{
+    float x = dot(a, b);
+    const float sign = x < 0.0f ? -1.0f : 1.0f;
+    x *= sign;
+    const float xm1 = x - 1.0f;
+    const float d = 1.0f - t;
+    const float sqrT = t * t;
+    const float sqrD = d * d;
+    float weightT = 1.0f;
+    float weightD = 1.0f;
+    for(uint32_t i = SlerpTermCount; i-- > 0;)
+    {
+        weightT = 1.0f + (SlerpU[i] * sqrT - SlerpV[i]) * xm1 * weightT;
+        weightD = 1.0f + (SlerpU[i] * sqrD - SlerpV[i]) * xm1 * weightD;
+    }
+    weightT *= t * sign;
+    weightD *= d;
+    return Quat(
+        a.vx * weightD + b.vx * weightT,
+        a.vy * weightD + b.vy * weightT,
+        a.vz * weightD + b.vz * weightT,
+        a.w * weightD + b.w * weightT);
+}
+
+#if SIMDHELP_SSE
+
+// Per lane mask ? a : b, mask lanes are all ones or all zeros.
+static inline __m128 sSelect4(__m128 mask, __m128 a, __m128 b)
+{
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+static inline __m128i sSelect4(__m128i mask, __m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+// 4 vectors into SoA x, y, z.
+static inline void sLoadVec3x4(const Vec3 *v, __m128 &x, __m128 &y, __m128 &z)
+{
+    __m128 w;
+    x = _mm_load_ps(&v[0].x);
+    y = _mm_load_ps(&v[1].x);
+    z = _mm_load_ps(&v[2].x);
+    w = _mm_load_ps(&v[3].x);
+    _MM_TRANSPOSE4_PS(x, y, z, w);
+}
+
+// Packed vectors are 3 loads: x0y0z0x1 y1z1x2y2 z2x3y3z3.
+static inline void sLoadVec3x4(const PackedVec3 *v, __m128 &x, __m128 &y, __m128 &z)
+{
+    const __m128 a = _mm_loadu_ps(&v[0].x);
+    const __m128 b = _mm_loadu_ps(&v[0].x + 4);
+    const __m128 c = _mm_loadu_ps(&v[0].x + 8);
+    const __m128 xy23 = _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 1, 3, 2));
+    const __m128 yz01 = _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 0, 2, 1));
+    x = _mm_shuffle_ps(a, xy23, _MM_SHUFFLE(2, 0, 3, 0));
+    y = _mm_shuffle_ps(yz01, xy23, _MM_SHUFFLE(3, 1, 2, 0));
+    z = _mm_shuffle_ps(yz01, c, _MM_SHUFFLE(3, 0, 3, 1));
+}
+
+static inline void sStoreVec3x4(Vec3 *out, __m128 x, __m128 y, __m128 z)
+{
+    __m128 w = _mm_setzero_ps();
+    _MM_TRANSPOSE4_PS(x, y, z, w);
+    _mm_store_ps(&out[0].x, x);
+    _mm_store_ps(&out[1].x, y);
+    _mm_store_ps(&out[2].x, z);
+    _mm_store_ps(&out[3].x, w);
+}
+
+static inline void sStoreVec3x4(PackedVec3 *out, __m128 x, __m128 y, __m128 z)
+{
+    const __m128 xy01 = _mm_unpacklo_ps(x, y);
+    const __m128 xy23 = _mm_unpackhi_ps(x, y);
+    const __m128 zx = _mm_shuffle_ps(z, x, _MM_SHUFFLE(3, 1, 2, 0));
+    const __m128 yz = _mm_shuffle_ps(y, z, _MM_SHUFFLE(3, 1, 3, 1));
+    _mm_storeu_ps(&out[0].x, _mm_shuffle_ps(xy01, zx, _MM_SHUFFLE(2, 0, 1, 0)));
+    _mm_storeu_ps(&out[0].x + 4, _mm_shuffle_ps(yz, xy23, _MM_SHUFFLE(1, 0, 2, 0)));
+    _mm_storeu_ps(&out[0].x + 8, _mm_shuffle_ps(zx, yz, _MM_SHUFFLE(3, 1, 3, 1)));
+}
+
+struct Quat4
+{
+    __m128 x;
+    __m128 y;
+    __m128 z;
+    __m128 w;
+};
+
+static inline Quat4 sLoadQuat4(const Quat &q0, const Quat &q1, const Quat &q2, const Quat &q3)
+{
+    Quat4 q;
+    q.x = _mm_load_ps(&q0.vx);
+    q.y = _mm_load_ps(&q1.vx);
+    q.z = _mm_load_ps(&q2.vx);
+    q.w = _mm_load_ps(&q3.vx);
+    _MM_TRANSPOSE4_PS(q.x, q.y, q.z, q.w);
+    return q;
+}
+
+static inline Quat4 sSetQuat4(const Quat &q)
+{
+    return Quat4{ _mm_set1_ps(q.vx), _mm_set1_ps(q.vy), _mm_set1_ps(q.vz), _mm_set1_ps(q.w) };
+}
+
+static inline void sStoreQuat4(Quat &out0, Quat &out1, Quat &out2, Quat &out3, Quat4 q)
+{
+    _MM_TRANSPOSE4_PS(q.x, q.y, q.z, q.w);
+    _mm_store_ps(&out0.vx, q.x);
+    _mm_store_ps(&out1.vx, q.y);
+    _mm_store_ps(&out2.vx, q.z);
+    _mm_store_ps(&out3.vx, q.w);
+}
+
+static inline void sStoreQuat4(Quat *out, const Quat4 &q)
+{
+    sStoreQuat4(out[0], out[1], out[2], out[3], q);
+}
+
+static inline __m128 sDot4(const Quat4 &a, const Quat4 &b)
+{
+    return _mm_add_ps(_mm_add_ps(_mm_mul_ps(a.x, b.x), _mm_mul_ps(a.y, b.y)),
+        _mm_add_ps(_mm_mul_ps(a.z, b.z), _mm_mul_ps(a.w, b.w)));
+}
+
+static inline Quat4 sSlerpPolynomial4(const Quat4 &a, const Quat4 &b, __m128 t)
+{
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 dotAB = sDot4(a, b);
+    const __m128 sign = _mm_and_ps(dotAB, _mm_set1_ps(-0.0f));
+    const __m128 xm1 = _mm_sub_ps(_mm_xor_ps(dotAB, sign), one);
+    const __m128 d = _mm_sub_ps(one, t);
+    const __m128 sqrT = _mm_mul_ps(t, t);
+    const __m128 sqrD = _mm_mul_ps(d, d);
+    __m128 weightT = one;
+    __m128 weightD = one;
+    for(uint32_t i = SlerpTermCount; i-- > 0;)
+    {
+        const __m128 u = _mm_set1_ps(SlerpU[i]);
+        const __m128 v = _mm_set1_ps(SlerpV[i]);
+        weightT = _mm_add_ps(one, _mm_mul_ps(_mm_mul_ps(_mm_sub_ps(_mm_mul_ps(u, sqrT), v), xm1), weightT));
+        weightD = _mm_add_ps(one, _mm_mul_ps(_mm_mul_ps(_mm_sub_ps(_mm_mul_ps(u, sqrD), v), xm1), weightD));
+    }
+    weightT = _mm_xor_ps(_mm_mul_ps(weightT, t), sign);
+    weightD = _mm_mul_ps(weightD, d);
+    Quat4 result;
+    result.x = _mm_add_ps(_mm_mul_ps(a.x, weightD), _mm_mul_ps(b.x, weightT));
+    result.y = _mm_add_ps(_mm_mul_ps(a.y, weightD), _mm_mul_ps(b.y, weightT));
+    result.z = _mm_add_ps(_mm_mul_ps(a.z, weightD), _mm_mul_ps(b.z, weightT));
+    result.w = _mm_add_ps(_mm_mul_ps(a.w, weightD), _mm_mul_ps(b.w, weightT));
+    return result;
+}
+
+#endif
+
+#if CARPMATH_X86
+
+// 8 vectors into SoA, vectors 0-3 in low lanes and 4-7 in high lanes.
+CARPMATH_TARGET_AVX2 static inline void sLoadVec3x8(const Vec3 *v, __m256 &x, __m256 &y, __m256 &z)
+{
+    const __m256 t0 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_load_ps(&v[0].x)), _mm_load_ps(&v[4].x), 1);
+    const __m256 t1 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_load_ps(&v[1].x)), _mm_load_ps(&v[5].x), 1);
+    const __m256 t2 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_load_ps(&v[2].x)), _mm_load_ps(&v[6].x), 1);
+    const __m256 t3 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_load_ps(&v[3].x)), _mm_load_ps(&v[7].x), 1);
+    const __m256 xy01 = _mm256_unpacklo_ps(t0, t1);
+    const __m256 xy23 = _mm256_unpacklo_ps(t2, t3);
+    const __m256 zw01 = _mm256_unpackhi_ps(t0, t1);
+    const __m256 zw23 = _mm256_unpackhi_ps(t2, t3);
+    x = _mm256_shuffle_ps(xy01, xy23, _MM_SHUFFLE(1, 0, 1, 0));
+    y = _mm256_shuffle_ps(xy01, xy23, _MM_SHUFFLE(3, 2, 3, 2));
+    z = _mm256_shuffle_ps(zw01, zw23, _MM_SHUFFLE(1, 0, 1, 0));
+}
+
+// Same shuffles as the 4 wide version, one group of 4 per lane.
+CARPMATH_TARGET_AVX2 static inline void sLoadVec3x8(const PackedVec3 *v, __m256 &x, __m256 &y, __m256 &z)
+{
+    const float *f = &v[0].x;
+    const __m256 a = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(f + 0)), _mm_loadu_ps(f + 12), 1);
+    const __m256 b = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(f + 4)), _mm_loadu_ps(f + 16), 1);
+    const __m256 c = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(f + 8)), _mm_loadu_ps(f + 20), 1);
+    const __m256 xy23 = _mm256_shuffle_ps(b, c, _MM_SHUFFLE(2, 1, 3, 2));
+    const __m256 yz01 = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(1, 0, 2, 1));
+    x = _mm256_shuffle_ps(a, xy23, _MM_SHUFFLE(2, 0, 3, 0));
+    y = _mm256_shuffle_ps(yz01, xy23, _MM_SHUFFLE(3, 1, 2, 0));
+    z = _mm256_shuffle_ps(yz01, c, _MM_SHUFFLE(3, 0, 3, 1));
+}
+
+CARPMATH_TARGET_AVX2 static inline void sStoreVec3x8(Vec3 *out, __m256 x, __m256 y, __m256 z)
+{
+    const __m256 xy0 = _mm256_unpacklo_ps(x, y);
+    const __m256 xy1 = _mm256_unpackhi_ps(x, y);
+    const __m256 zw0 = _mm256_unpacklo_ps(z, _mm256_setzero_ps());
+    const __m256 zw1 = _mm256_unpackhi_ps(z, _mm256_setzero_ps());
+    const __m256 v0 = _mm256_shuffle_ps(xy0, zw0, _MM_SHUFFLE(1, 0, 1, 0));
+    const __m256 v1 = _mm256_shuffle_ps(xy0, zw0, _MM_SHUFFLE(3, 2, 3, 2));
+    const __m256 v2 = _mm256_shuffle_ps(xy1, zw1, _MM_SHUFFLE(1, 0, 1, 0));
+    const __m256 v3 = _mm256_shuffle_ps(xy1, zw1, _MM_SHUFFLE(3, 2, 3, 2));
+    _mm256_storeu_ps(&out[0].x, _mm256_permute2f128_ps(v0, v1, 0x20));
+    _mm256_storeu_ps(&out[2].x, _mm256_permute2f128_ps(v2, v3, 0x20));
+    _mm256_storeu_ps(&out[4].x, _mm256_permute2f128_ps(v0, v1, 0x31));
+    _mm256_storeu_ps(&out[6].x, _mm256_permute2f128_ps(v2, v3, 0x31));
+}
+
+CARPMATH_TARGET_AVX2 static inline void sStoreVec3x8(PackedVec3 *out, __m256 x, __m256 y, __m256 z)
+{
+    const __m256 xy01 = _mm256_unpacklo_ps(x, y);
+    const __m256 xy23 = _mm256_unpackhi_ps(x, y);
+    const __m256 zx = _mm256_shuffle_ps(z, x, _MM_SHUFFLE(3, 1, 2, 0));
+    const __m256 yz = _mm256_shuffle_ps(y, z, _MM_SHUFFLE(3, 1, 3, 1));
+    const __m256 a = _mm256_shuffle_ps(xy01, zx, _MM_SHUFFLE(2, 0, 1, 0));
+    const __m256 b = _mm256_shuffle_ps(yz, xy23, _MM_SHUFFLE(1, 0, 2, 0));
+    const __m256 c = _mm256_shuffle_ps(zx, yz, _MM_SHUFFLE(3, 1, 3, 1));
+    float *f = &out[0].x;
+    _mm256_storeu_ps(f + 0, _mm256_permute2f128_ps(a, b, 0x20));
+    _mm256_storeu_ps(f + 8, _mm256_permute2f128_ps(c, a, 0x30));
+    _mm256_storeu_ps(f + 16, _mm256_permute2f128_ps(b, c, 0x31));
+}
+
+struct Quat8
+{
+    __m256 x;
+    __m256 y;
+    __m256 z;
+    __m256 w;
+};
+
+// quats[0-3] to low lanes and quats[4-7] to high lanes.
+CARPMATH_TARGET_AVX2 static inline Quat8 sLoadQuat8(const Quat *const *quats)
+{
+    const __m256 t0 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_load_ps(&quats[0]->vx)), _mm_load_ps(&quats[4]->vx), 1);
+    const __m256 t1 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_load_ps(&quats[1]->vx)), _mm_load_ps(&quats[5]->vx), 1);
+    const __m256 t2 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_load_ps(&quats[2]->vx)), _mm_load_ps(&quats[6]->vx), 1);
+    const __m256 t3 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_load_ps(&quats[3]->vx)), _mm_load_ps(&quats[7]->vx), 1);
+    const __m256 xy01 = _mm256_unpacklo_ps(t0, t1);
+    const __m256 xy23 = _mm256_unpacklo_ps(t2, t3);
+    const __m256 zw01 = _mm256_unpackhi_ps(t0, t1);
+    const __m256 zw23 = _mm256_unpackhi_ps(t2, t3);
+    Quat8 result;
+    result.x = _mm256_shuffle_ps(xy01, xy23, _MM_SHUFFLE(1, 0, 1, 0));
+    result.y = _mm256_shuffle_ps(xy01, xy23, _MM_SHUFFLE(3, 2, 3, 2));
+    result.z = _mm256_shuffle_ps(zw01, zw23, _MM_SHUFFLE(1, 0, 1, 0));
+    result.w = _mm256_shuffle_ps(zw01, zw23, _MM_SHUFFLE(3, 2, 3, 2));
+    return result;
+}
+
+// 8 contiguous quats, same lanes as above.
+CARPMATH_TARGET_AVX2 static inline Quat8 sLoadQuat8(const Quat *q)
+{
+    const Quat *quats[8] = { q, q + 1, q + 2, q + 3, q + 4, q + 5, q + 6, q + 7 };
+    return sLoadQuat8(quats);
+}
+
+CARPMATH_TARGET_AVX2 static inline Quat8 sSetQuat8(const Quat &q)
+{
+    return Quat8{ _mm256_set1_ps(q.vx), _mm256_set1_ps(q.vy), _mm256_set1_ps(q.vz), _mm256_set1_ps(q.w) };
+}
+
+// Inverse of sLoadQuat8.
+CARPMATH_TARGET_AVX2 static inline void sStoreQuat8(Quat *const *outQuats, const Quat8 &q)
+{
+    const __m256 xy0 = _mm256_unpacklo_ps(q.x, q.y);
+    const __m256 xy1 = _mm256_unpackhi_ps(q.x, q.y);
+    const __m256 zw0 = _mm256_unpacklo_ps(q.z, q.w);
+    const __m256 zw1 = _mm256_unpackhi_ps(q.z, q.w);
+    const __m256 v0 = _mm256_shuffle_ps(xy0, zw0, _MM_SHUFFLE(1, 0, 1, 0));
+    const __m256 v1 = _mm256_shuffle_ps(xy0, zw0, _MM_SHUFFLE(3, 2, 3, 2));
+    const __m256 v2 = _mm256_shuffle_ps(xy1, zw1, _MM_SHUFFLE(1, 0, 1, 0));
+    const __m256 v3 = _mm256_shuffle_ps(xy1, zw1, _MM_SHUFFLE(3, 2, 3, 2));
+    _mm_store_ps(&outQuats[0]->vx, _mm256_castps256_ps128(v0));
+    _mm_store_ps(&outQuats[1]->vx, _mm256_castps256_ps128(v1));
+    _mm_store_ps(&outQuats[2]->vx, _mm256_castps256_ps128(v2));
+    _mm_store_ps(&outQuats[3]->vx, _mm256_castps256_ps128(v3));
+    _mm_store_ps(&outQuats[4]->vx, _mm256_extractf128_ps(v0, 1));
+    _mm_store_ps(&outQuats[5]->vx, _mm256_extractf128_ps(v1, 1));
+    _mm_store_ps(&outQuats[6]->vx, _mm256_extractf128_ps(v2, 1));
+    _mm_store_ps(&outQuats[7]->vx, _mm256_extractf128_ps(v3, 1));
+}
+
+// 8 contiguous quats.
+CARPMATH_TARGET_AVX2 static inline void sStoreQuat8(Quat *out, const Quat8 &q)
+{
+    const __m256 xy0 = _mm256_unpacklo_ps(q.x, q.y);
+    const __m256 xy1 = _mm256_unpackhi_ps(q.x, q.y);
+    const __m256 zw0 = _mm256_unpacklo_ps(q.z, q.w);
+    const __m256 zw1 = _mm256_unpackhi_ps(q.z, q.w);
+    const __m256 v0 = _mm256_shuffle_ps(xy0, zw0, _MM_SHUFFLE(1, 0, 1, 0));
+    const __m256 v1 = _mm256_shuffle_ps(xy0, zw0, _MM_SHUFFLE(3, 2, 3, 2));
+    const __m256 v2 = _mm256_shuffle_ps(xy1, zw1, _MM_SHUFFLE(1, 0, 1, 0));
+    const __m256 v3 = _mm256_shuffle_ps(xy1, zw1, _MM_SHUFFLE(3, 2, 3, 2));
+    _mm256_storeu_ps(&out[0].vx, _mm256_permute2f128_ps(v0, v1, 0x20));
+    _mm256_storeu_ps(&out[2].vx, _mm256_permute2f128_ps(v2, v3, 0x20));
+    _mm256_storeu_ps(&out[4].vx, _mm256_permute2f128_ps(v0, v1, 0x31));
+    _mm256_storeu_ps(&out[6].vx, _mm256_permute2f128_ps(v2, v3, 0x31));
+}
+
+CARPMATH_TARGET_AVX2 static inline __m256 sDot8(const Quat8 &a, const Quat8 &b)
+{
+    return _mm256_fmadd_ps(a.x, b.x, _mm256_fmadd_ps(a.y, b.y, _mm256_fmadd_ps(a.z, b.z, _mm256_mul_ps(a.w, b.w))));
+}
+
+CARPMATH_TARGET_AVX2 static inline Quat8 sSlerpPolynomial8(const Quat8 &a, const Quat8 &b, __m256 t)
+{
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 dotAB = sDot8(a, b);
+    const __m256 sign = _mm256_and_ps(dotAB, _mm256_set1_ps(-0.0f));
+    const __m256 xm1 = _mm256_sub_ps(_mm256_xor_ps(dotAB, sign), one);
+    const __m256 d = _mm256_sub_ps(one, t);
+    const __m256 sqrT = _mm256_mul_ps(t, t);
+    const __m256 sqrD = _mm256_mul_ps(d, d);
+    __m256 weightT = one;
+    __m256 weightD = one;
+    for(uint32_t i = SlerpTermCount; i-- > 0;)
+    {
+        const __m256 u = _mm256_set1_ps(SlerpU[i]);
+        const __m256 v = _mm256_set1_ps(SlerpV[i]);
+        weightT = _mm256_fmadd_ps(_mm256_mul_ps(_mm256_fmsub_ps(u, sqrT, v), xm1), weightT, one);
+        weightD = _mm256_fmadd_ps(_mm256_mul_ps(_mm256_fmsub_ps(u, sqrD, v), xm1), weightD, one);
+    }
+    weightT = _mm256_xor_ps(_mm256_mul_ps(weightT, t), sign);
+    weightD = _mm256_mul_ps(weightD, d);
+    Quat8 result;
+    result.x = _mm256_fmadd_ps(a.x, weightD, _mm256_mul_ps(b.x, weightT));
+    result.y = _mm256_fmadd_ps(a.y, weightD, _mm256_mul_ps(b.y, weightT));
+    result.z = _mm256_fmadd_ps(a.z, weightD, _mm256_mul_ps(b.z, weightT));
+    result.w = _mm256_fmadd_ps(a.w, weightD, _mm256_mul_ps(b.w, weightT));
+    return result;
+}
+
+#endif
@@ -0,0 +1,303 @@
+#include "spatialhash.h"
+
+#include "mathhelp.h"
+#include "parallel.h"
+#include "profile.h"
+
+#include <atomic>
+
+static constexpr uint32_t SpatialHashMinBucketBits = 6u;
+// Below this many items per thread the thread start costs more than it saves.
+static constexpr uint32_t SpatialHashMinItemsPerThread = 1u << 14u;
+static constexpr uint32_t SpatialHashPairBatchSize = 256u;
+// Cell coordinates are clamped so they fit int32.
+static constexpr float SpatialHashMaxCell = 1073741824.0f;
+static constexpr uint32_t SpatialHashMaxChunks = 256u;
+
+struct SpatialHashCell
+{
+    int32_t x;
+    int32_t y;
+    int32_t z;
+};
+
+// Floor without a libm call or a branch.
+static int32_t sGetCellCoordinate(float v, float invCellSize)
+{
+    const float f = sClampF(v * invCellSize, -SpatialHashMaxCell, SpatialHashMaxCell);
+    const int32_t i = int32_t(f);
+    return i - int32_t(float(i) > f);
+}
+
+static SpatialHashCell sGetCell(const Vec3 &p, float invCellSize)
+{
+    return SpatialHashCell{
+        sGetCellCoordinate(p.x, invCellSize),
+        sGetCellCoordinate(p.y, invCellSize),
+        sGetCellCoordinate(p.z, invCellSize) };
+}
+
+static bool sIsSameCell(const SpatialHashCell &a, const SpatialHashCell &b)
+{
+    return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+// 2x2x2 blocks of cells are hashed and the cell's place in its block is the low 3 bits,
+// so neighbouring cells mostly share cache lines in bucketStart and entry arrays. Block
+// coordinates are mixed with odd constants and a finalizer, top bits pick the block.
+static uint32_t sGetBucket(const SpatialHash &hash, int32_t x, int32_t y, int32_t z)
+{
+    const uint32_t local = (uint32_t(x) & 1u) | (uint32_t(y) & 1u) << 1u | (uint32_t(z) & 1u) << 2u;
+    uint32_t h = uint32_t(x >> 1) * 0x8DA6B343u + uint32_t(y >> 1) * 0xD8163841u + uint32_t(z >> 1) * 0xCB1AB31Fu;
+    h ^= h >> 16u;
+    h *= 0x7FEB352Du;
+    h ^= h >> 15u;
+    return (h >> hash.bucketShift) << 3u | local;
+}
+
+static uint32_t sGetWorkerCount(uint32_t count, uint32_t threadCount)
+{
+    const uint32_t maxThreads = (count + SpatialHashMinItemsPerThread - 1u) / SpatialHashMinItemsPerThread;
+    const uint32_t threads = getThreadCount(threadCount);
+    const uint32_t workers = threads < maxThreads ? threads : maxThreads;
+    return workers < SpatialHashMaxChunks ? workers : SpatialHashMaxChunks;
+}
+
+static void sFree(SpatialHash &hash)
+{
+    delete[] hash.bucketStart;
+    delete[] hash.entries;
+    delete[] hash.entryPositions;
+    delete[] hash.entryBuckets;
+    hash.bucketStart = nullptr;
+    hash.entries = nullptr;
+    hash.entryPositions = nullptr;
+    hash.entryBuckets = nullptr;
+    hash.itemCount = 0;
+    hash.itemCapacity = 0;
+    hash.bucketCapacity = 0;
+}
+
+static void sReserve(SpatialHash &hash, uint32_t count)
+{
+    // At least two buckets per item keeps chains short.
+    uint32_t bucketBits = SpatialHashMinBucketBits;
+    while((1u << bucketBits) < count * 2u && bucketBits < 31u)
+        ++bucketBits;
+    const uint32_t bucketCount = 1u << bucketBits;
+    hash.bucketMask = bucketCount - 1u;
+    hash.bucketShift = 32u - bucketBits + 3u;
+
+    if(count > hash.itemCapacity)
+    {
+        delete[] hash.entries;
+        delete[] hash.entryPositions;
+        delete[] hash.entryBuckets;
+        hash.entries = new uint32_t[count];
+        hash.entryPositions = new Vec3[count];
+        hash.entryBuckets = new uint32_t[count];
+        hash.itemCapacity = count;
+    }
+    if(bucketCount > hash.bucketCapacity)
+    {
+        delete[] hash.bucketStart;
+        hash.bucketStart = new uint32_t[bucketCount + 1u];
+        hash.bucketCapacity = bucketCount;
+    }
+}
+
+SpatialHash::~SpatialHash()
+{
+    sFree(*this);
+}
+
+template <typename GetPosition>
+static void sBuild(SpatialHash &hash, uint32_t count, float cellSize, uint32_t threadCount,
+    const GetPosition &getPosition)
+{
+    ASSERT_MATH(cellSize > 0.0f);
+    const uint32_t workers = sGetWorkerCount(count, threadCount);
+    sReserve(hash, count);
+    hash.cellSize = cellSize;
+    hash.invCellSize = 1.0f / cellSize;
+    hash.itemCount = count;
+
+    parallelFor(count, workers, [&](uint32_t begin, uint32_t end, uint32_t)
+    {
+        for(uint32_t i = begin; i < end; ++i)
+        {
+            const SpatialHashCell cell = sGetCell(getPosition(i), hash.invCellSize);
+            hash.entryBuckets[i] = sGetBucket(hash, cell.x, cell.y, cell.z);
+        }
+    });
+
+    // Stable, so each bucket ends up sorted by item index.
+    radixSort(hash.sortBuffers, hash.entryBuckets, count, 32u - hash.bucketShift + 3u, hash.entries, threadCount);
+
+    // Every bucket start is written by exactly one entry, the first one after it.
+    const uint32_t bucketCount = hash.bucketMask + 1u;
+    const uint32_t *buckets = hash.entryBuckets;
+    parallelFor(count, workers, [&](uint32_t begin, uint32_t end, uint32_t)
+    {
+        for(uint32_t k = begin; k < end; ++k)
+        {
+            const uint32_t first = k > 0 ? buckets[k - 1] + 1u : 0u;
+            for(uint32_t bucket = first; bucket <= buckets[k]; ++bucket)
+                hash.bucketStart[bucket] = k;
+            hash.entryPositions[k] = getPosition(hash.entries[k]);
+        }
+    });
+    for(uint32_t bucket = count > 0 ? buckets[count - 1] + 1u : 0u; bucket <= bucketCount; ++bucket)
+        hash.bucketStart[bucket] = count;
+}
+
+void buildSpatialHash(SpatialHash &hash, const Vec3 *positions, uint32_t count, float cellSize,
+    uint32_t threadCount)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdBuildSpatialHash, count);
+    sBuild(hash, count, cellSize, threadCount, [positions](uint32_t i) { return positions[i]; });
+}
+
+void buildSpatialHash(SpatialHash &hash, const AABB *boxes, uint32_t count, float cellSize,
+    uint32_t threadCount)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdBuildSpatialHash, count);
+    sBuild(hash, count, cellSize, threadCount, [boxes, cellSize](uint32_t i)
+    {
+        const AABB &box = boxes[i];
+        ASSERT_MATH(box.max.x - box.min.x <= cellSize
+            && box.max.y - box.min.y <= cellSize
+            && box.max.z - box.min.z <= cellSize);
+        return getCenter(box);
+    });
+}
+
+// Neighbour cells after the cell itself in z, y, x order. Each pair of different cells is
+// visited only from the first of them.
+static constexpr int32_t SpatialHashForwardCellCount = 13;
+static constexpr int32_t SpatialHashForwardCells[SpatialHashForwardCellCount][3] = {
+    { 1, 0, 0 },
+    { -1, 1, 0 }, { 0, 1, 0 }, { 1, 1, 0 },
+    { -1, -1, 1 }, { 0, -1, 1 }, { 1, -1, 1 },
+    { -1, 0, 1 }, { 0, 0, 1 }, { 1, 0, 1 },
+    { -1, 1, 1 }, { 0, 1, 1 }, { 1, 1, 1 } };
+
+// Entries after k in its own cell and all entries in the 13 forward cells, isPair(k, m)
+// decides. Entries are checked against the cell being visited, so buckets shared by
+// several cells are not reported twice. Cheap isPair goes first, most candidates fail it.
+// Consecutive entries are mostly in the same cell and reuse its bucket ranges.
+template <typename IsPair>
+static uint32_t sFindPairs(const SpatialHash &hash, SpatialHashPair *outPairs, uint32_t maxPairs,
+    uint32_t threadCount, const IsPair &isPair)
+{
+    std::atomic<uint32_t> total{ 0 };
+    parallelFor(hash.itemCount, sGetWorkerCount(hash.itemCount, threadCount), [&](uint32_t begin, uint32_t end, uint32_t)
+    {
+        SpatialHashPair batch[SpatialHashPairBatchSize];
+        uint32_t batchCount = 0;
+        const auto flush = [&]()
+        {
+            const uint32_t base = total.fetch_add(batchCount, std::memory_order_relaxed);
+            for(uint32_t i = 0; i < batchCount && base + i < maxPairs; ++i)
+                outPairs[base + i] = batch[i];
+            batchCount = 0;
+        };
+        const auto visit = [&](uint32_t k, uint32_t first, uint32_t last, const SpatialHashCell &cell)
+        {
+            for(uint32_t m = first; m < last; ++m)
+            {
+                if(!isPair(k, m) || !sIsSameCell(sGetCell(hash.entryPositions[m], hash.invCellSize), cell))
+                    continue;
+                const uint32_t a = hash.entries[k];
+                const uint32_t b = hash.entries[m];
+                batch[batchCount++] = a < b ? SpatialHashPair{ a, b } : SpatialHashPair{ b, a };
+                if(batchCount == SpatialHashPairBatchSize)
+                    flush();
+            }
+        };
+
+        SpatialHashCell cell{ 0, 0, 0 };
+        SpatialHashCell neighbours[SpatialHashForwardCellCount];
+        uint32_t rangeBegin[SpatialHashForwardCellCount];
+        uint32_t rangeEnd[SpatialHashForwardCellCount];
+        for(uint32_t k = begin; k < end; ++k)
+        {
+            const SpatialHashCell entryCell = sGetCell(hash.entryPositions[k], hash.invCellSize);
+            if(k == begin || !sIsSameCell(entryCell, cell))
+            {
+                cell = entryCell;
+                for(int32_t i = 0; i < SpatialHashForwardCellCount; ++i)
+                {
+                    neighbours[i] = SpatialHashCell{
+                        cell.x + SpatialHashForwardCells[i][0],
+                        cell.y + SpatialHashForwardCells[i][1],
+                        cell.z + SpatialHashForwardCells[i][2] };
+                    const uint32_t bucket = sGetBucket(hash, neighbours[i].x, neighbours[i].y, neighbours[i].z);
+                    rangeBegin[i] = hash.bucketStart[bucket];
+                    rangeEnd[i] = hash.bucketStart[bucket + 1];
+                }
+            }
+            visit(k, k + 1, hash.bucketStart[hash.entryBuckets[k] + 1], cell);
+            for(int32_t i = 0; i < SpatialHashForwardCellCount; ++i)
+                visit(k, rangeBegin[i], rangeEnd[i], neighbours[i]);
+        }
+        flush();
+    });
+    return total.load(std::memory_order_relaxed);
+}
+
+uint32_t findPairs(const SpatialHash &hash, float radius, SpatialHashPair *outPairs, uint32_t maxPairs,
+    uint32_t threadCount)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdFindPairs, hash.itemCount);
+    ASSERT_MATH(radius <= hash.cellSize);
+    const float sqrRadius = radius * radius;
+    return sFindPairs(hash, outPairs, maxPairs, threadCount, [&hash, sqrRadius](uint32_t k, uint32_t m)
+    {
+        const Vec3 &a = hash.entryPositions[k];
+        const Vec3 &b = hash.entryPositions[m];
+        const float dx = a.x - b.x;
+        const float dy = a.y - b.y;
+        const float dz = a.z - b.z;
+        return dx * dx + dy * dy + dz * dz <= sqrRadius;
+    });
+}
+
+uint32_t findOverlappingPairs(const SpatialHash &hash, const AABB *boxes, SpatialHashPair *outPairs,
+    uint32_t maxPairs, uint32_t threadCount)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdFindPairs, hash.itemCount);
+    return sFindPairs(hash, outPairs, maxPairs, threadCount, [&hash, boxes](uint32_t k, uint32_t m)
+    {
+        return overlaps(boxes[hash.entries[k]], boxes[hash.entries[m]]);
+    });
+}
+
+uint32_t queryRadius(const SpatialHash &hash, const Vec3 &center, float radius, uint32_t *outIndices,
+    uint32_t maxCount)
+{
+    const SpatialHashCell low = sGetCell(Vec3(center.x - radius, center.y - radius, center.z - radius), hash.invCellSize);
+    const SpatialHashCell high = sGetCell(Vec3(center.x + radius, center.y + radius, center.z + radius), hash.invCellSize);
+    const float sqrRadius = radius * radius;
+    uint32_t count = 0;
+    for(int32_t z = low.z; z <= high.z; ++z)
+    for(int32_t y = low.y; y <= high.y; ++y)
+    for(int32_t x = low.x; x <= high.x; ++x)
+    {
+        const SpatialHashCell cell{ x, y, z };
+        const uint32_t bucket = sGetBucket(hash, x, y, z);
+        for(uint32_t k = hash.bucketStart[bucket]; k < hash.bucketStart[bucket + 1]; ++k)
+        {
+            const Vec3 &p = hash.entryPositions[k];
+            const float dx = p.x - center.x;
+            const float dy = p.y - center.y;
+            const float dz = p.z - center.z;
+            if(dx * dx + dy * dy + dz * dz > sqrRadius || !sIsSameCell(sGetCell(p, hash.invCellSize), cell))
+                continue;
+            if(count < maxCount)
+                outIndices[count] = hash.entries[k];
+            ++count;
+        }
+    }
+    return count;
+}
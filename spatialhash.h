@@ -0,0 +1,70 @@
+#pragma once
+
+#include "aabb.h"
+#include "radixsort.h"
+#include "vec3.h"
+
+#include <stdint.h>
+
+// Uniform grid broadphase. Points, or box centers, are binned into cubic cells of
+// cellSize and cells are hashed into a power of two table, so the grid is unbounded.
+// Building radix sorts entries by bucket, within a bucket they stay in item index order,
+// so the layout doesn't depend on thread count. Arrays only grow and the passes run on
+// the parallelFor worker pool, so once warmed up, rebuilding with the same or smaller
+// count and thread count and finding pairs do not allocate.
+
+struct SpatialHashPair
+{
+    // a < b
+    uint32_t a;
+    uint32_t b;
+};
+
+struct SpatialHash
+{
+    SpatialHash() {}
+    ~SpatialHash();
+    SpatialHash(const SpatialHash &) = delete;
+    SpatialHash &operator=(const SpatialHash &) = delete;
+
+    // Bucket b holds entries [bucketStart[b], bucketStart[b + 1]).
+    uint32_t *bucketStart = nullptr;
+    // Item index of each entry.
+    uint32_t *entries = nullptr;
+    // Position of each entry, in entry order.
+    Vec3 *entryPositions = nullptr;
+
+    // Bucket of each entry.
+    uint32_t *entryBuckets = nullptr;
+
+    RadixSortBuffers sortBuffers;
+
+    float cellSize = 0.0f;
+    float invCellSize = 0.0f;
+    uint32_t bucketMask = 0;
+    // Shift of the block hash, see sGetBucket.
+    uint32_t bucketShift = 0;
+    uint32_t itemCount = 0;
+    uint32_t itemCapacity = 0;
+    uint32_t bucketCapacity = 0;
+};
+
+// threadCount 0 uses hardware concurrency.
+void buildSpatialHash(SpatialHash &hash, const Vec3 *positions, uint32_t count, float cellSize,
+    uint32_t threadCount = 0);
+// Bins box centers, no box may be bigger than cellSize on any axis.
+void buildSpatialHash(SpatialHash &hash, const AABB *boxes, uint32_t count, float cellSize,
+    uint32_t threadCount = 0);
+
+// Pairs of points closer than radius, radius <= cellSize. Writes up to maxPairs and
+// returns the total pair count. Pair order depends on threading.
+uint32_t findPairs(const SpatialHash &hash, float radius, SpatialHashPair *outPairs, uint32_t maxPairs,
+    uint32_t threadCount = 0);
+// Overlapping pairs of the boxes the hash was built from, same output as findPairs.
+uint32_t findOverlappingPairs(const SpatialHash &hash, const AABB *boxes, SpatialHashPair *outPairs,
+    uint32_t maxPairs, uint32_t threadCount = 0);
+
+// Items within radius of center, any radius, cost grows with (radius / cellSize)^3.
+// Writes up to maxCount item indices and returns the total count.
+uint32_t queryRadius(const SpatialHash &hash, const Vec3 &center, float radius, uint32_t *outIndices,
+    uint32_t maxCount);
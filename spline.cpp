@@ -0,0 +1,409 @@
+#include "spline.h"
+
+#include "dispatch.h"
+#include "mathhelp.h"
+#include "profile.h"
+#include "simdhelp.h"
+
+#if SIMDHELP_SSE
+#include <emmintrin.h>
+#endif
+#if CARPMATH_X86
+#include <immintrin.h>
+#endif
+
+static constexpr float SquadMinSinAngle = 1.0e-6f;
+
+CubicCurve getCatmullRomCurve(const Vec3 &p0, const Vec3 &p1, const Vec3 &p2, const Vec3 &p3)
+{
+    CubicCurve curve;
+    curve.a = p1;
+    curve.b = (p2 - p0) * 0.5f;
+    curve.c = p0 - p1 * 2.5f + p2 * 2.0f - p3 * 0.5f;
+    curve.d = (p3 - p0) * 0.5f + (p1 - p2) * 1.5f;
+    return curve;
+}
+
+CubicCurve getBezierCurve(const Vec3 &p0, const Vec3 &p1, const Vec3 &p2, const Vec3 &p3)
+{
+    CubicCurve curve;
+    curve.a = p0;
+    curve.b = (p1 - p0) * 3.0f;
+    curve.c = (p0 - p1 * 2.0f + p2) * 3.0f;
+    curve.d = p3 - p0 + (p1 - p2) * 3.0f;
+    return curve;
+}
+
+CubicCurve getHermiteCurve(const Vec3 &p0, const Vec3 &m0, const Vec3 &p1, const Vec3 &m1)
+{
+    CubicCurve curve;
+    curve.a = p0;
+    curve.b = m0;
+    curve.c = (p1 - p0) * 3.0f - m0 * 2.0f - m1;
+    curve.d = (p0 - p1) * 2.0f + m0 + m1;
+    return curve;
+}
+
+void getCatmullRomCurves(const Vec3 *points, uint32_t pointCount, CubicCurve *outCurves)
+{
+    for(uint32_t i = 0; i + 3 < pointCount; ++i)
+        outCurves[i] = getCatmullRomCurve(points[i], points[i + 1], points[i + 2], points[i + 3]);
+}
+
+Vec3 evaluate(const CubicCurve &curve, float t)
+{
+    return Vec3(
+        curve.a.x + t * (curve.b.x + t * (curve.c.x + t * curve.d.x)),
+        curve.a.y + t * (curve.b.y + t * (curve.c.y + t * curve.d.y)),
+        curve.a.z + t * (curve.b.z + t * (curve.c.z + t * curve.d.z)));
+}
+
+Vec3 evaluateTangent(const CubicCurve &curve, float t)
+{
+    return Vec3(
+        curve.b.x + t * (2.0f * curve.c.x + t * 3.0f * curve.d.x),
+        curve.b.y + t * (2.0f * curve.c.y + t * 3.0f * curve.d.y),
+        curve.b.z + t * (2.0f * curve.c.z + t * 3.0f * curve.d.z));
+}
+
+static void sEvaluateCurvesScalar(const CubicCurve *curves, float t, uint32_t count, Vec3 *outPoints)
+{
+    for(uint32_t i = 0; i < count; ++i)
+        outPoints[i] = evaluate(curves[i], t);
+}
+
+static void sEvaluateCurveScalar(const CubicCurve &curve, const float *ts, uint32_t count, Vec3 *outPoints)
+{
+    for(uint32_t i = 0; i < count; ++i)
+        outPoints[i] = evaluate(curve, ts[i]);
+}
+
+static Quat sSquad(const SquadSegment &segment, float t)
+{
+    const Quat p = sSlerpPolynomial(segment.q1, segment.q2, t);
+    const Quat s = sSlerpPolynomial(segment.s1, segment.s2, t);
+    return sSlerpPolynomial(p, s, 2.0f * t * (1.0f - t));
+}
+
+static void sSquadSegmentsScalar(const SquadSegment *segments, float t, uint32_t count, Quat *outQuats)
+{
+    for(uint32_t i = 0; i < count; ++i)
+        outQuats[i] = sSquad(segments[i], t);
+}
+
+static void sSquadSegmentScalar(const SquadSegment &segment, const float *ts, uint32_t count, Quat *outQuats)
+{
+    for(uint32_t i = 0; i < count; ++i)
+        outQuats[i] = sSquad(segment, ts[i]);
+}
+
+#if SIMDHELP_SSE
+
+static void sEvaluateCurvesSSE(const CubicCurve *curves, float t, uint32_t count, Vec3 *outPoints)
+{
+    const __m128 t4 = _mm_set1_ps(t);
+    const __m128 xyzMask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+    for(uint32_t i = 0; i < count; ++i)
+    {
+        const CubicCurve &curve = curves[i];
+        __m128 p = _mm_add_ps(_mm_load_ps(&curve.c.x), _mm_mul_ps(t4, _mm_load_ps(&curve.d.x)));
+        p = _mm_add_ps(_mm_load_ps(&curve.b.x), _mm_mul_ps(t4, p));
+        p = _mm_add_ps(_mm_load_ps(&curve.a.x), _mm_mul_ps(t4, p));
+        _mm_store_ps(&outPoints[i].x, _mm_and_ps(p, xyzMask));
+    }
+}
+
+static __m128 sEvaluateCubic4(float a, float b, float c, float d, __m128 t)
+{
+    __m128 p = _mm_add_ps(_mm_set1_ps(c), _mm_mul_ps(t, _mm_set1_ps(d)));
+    p = _mm_add_ps(_mm_set1_ps(b), _mm_mul_ps(t, p));
+    return _mm_add_ps(_mm_set1_ps(a), _mm_mul_ps(t, p));
+}
+
+static void sEvaluateCurveSSE(const CubicCurve &curve, const float *ts, uint32_t count, Vec3 *outPoints)
+{
+    uint32_t i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        const __m128 t = _mm_loadu_ps(ts + i);
+        sStoreVec3x4(outPoints + i,
+            sEvaluateCubic4(curve.a.x, curve.b.x, curve.c.x, curve.d.x, t),
+            sEvaluateCubic4(curve.a.y, curve.b.y, curve.c.y, curve.d.y, t),
+            sEvaluateCubic4(curve.a.z, curve.b.z, curve.c.z, curve.d.z, t));
+    }
+    sEvaluateCurveScalar(curve, ts + i, count - i, outPoints + i);
+}
+
+static Quat4 sSquad4(const Quat4 &q1, const Quat4 &q2, const Quat4 &s1, const Quat4 &s2, __m128 t)
+{
+    const __m128 h = _mm_mul_ps(_mm_add_ps(t, t), _mm_sub_ps(_mm_set1_ps(1.0f), t));
+    return sSlerpPolynomial4(sSlerpPolynomial4(q1, q2, t), sSlerpPolynomial4(s1, s2, t), h);
+}
+
+static void sSquadSegmentsSSE(const SquadSegment *segments, float t, uint32_t count, Quat *outQuats)
+{
+    const __m128 t4 = _mm_set1_ps(t);
+    uint32_t i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        const SquadSegment *s = segments + i;
+        const Quat4 q1 = sLoadQuat4(s[0].q1, s[1].q1, s[2].q1, s[3].q1);
+        const Quat4 q2 = sLoadQuat4(s[0].q2, s[1].q2, s[2].q2, s[3].q2);
+        const Quat4 s1 = sLoadQuat4(s[0].s1, s[1].s1, s[2].s1, s[3].s1);
+        const Quat4 s2 = sLoadQuat4(s[0].s2, s[1].s2, s[2].s2, s[3].s2);
+        sStoreQuat4(outQuats + i, sSquad4(q1, q2, s1, s2, t4));
+    }
+    sSquadSegmentsScalar(segments + i, t, count - i, outQuats + i);
+}
+
+static void sSquadSegmentSSE(const SquadSegment &segment, const float *ts, uint32_t count, Quat *outQuats)
+{
+    const Quat4 q1 = sSetQuat4(segment.q1);
+    const Quat4 q2 = sSetQuat4(segment.q2);
+    const Quat4 s1 = sSetQuat4(segment.s1);
+    const Quat4 s2 = sSetQuat4(segment.s2);
+    uint32_t i = 0;
+    for(; i + 4 <= count; i += 4)
+        sStoreQuat4(outQuats + i, sSquad4(q1, q2, s1, s2, _mm_loadu_ps(ts + i)));
+    sSquadSegmentScalar(segment, ts + i, count - i, outQuats + i);
+}
+
+#endif
+
+#if CARPMATH_X86
+
+// Two curves per iteration, one per 128-bit lane.
+CARPMATH_TARGET_AVX2 static void sEvaluateCurvesAVX2(const CubicCurve *curves, float t, uint32_t count, Vec3 *outPoints)
+{
+    const __m256 t8 = _mm256_set1_ps(t);
+    const __m256 xyzMask = _mm256_castsi256_ps(_mm256_setr_epi32(-1, -1, -1, 0, -1, -1, -1, 0));
+    uint32_t i = 0;
+    for(; i + 2 <= count; i += 2)
+    {
+        const CubicCurve &c0 = curves[i];
+        const CubicCurve &c1 = curves[i + 1];
+        const __m256 a = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_load_ps(&c0.a.x)), _mm_load_ps(&c1.a.x), 1);
+        const __m256 b = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_load_ps(&c0.b.x)), _mm_load_ps(&c1.b.x), 1);
+        const __m256 c = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_load_ps(&c0.c.x)), _mm_load_ps(&c1.c.x), 1);
+        const __m256 d = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_load_ps(&c0.d.x)), _mm_load_ps(&c1.d.x), 1);
+        const __m256 p = _mm256_fmadd_ps(t8, _mm256_fmadd_ps(t8, _mm256_fmadd_ps(t8, d, c), b), a);
+        _mm256_storeu_ps(&outPoints[i].x, _mm256_and_ps(p, xyzMask));
+    }
+    sEvaluateCurvesScalar(curves + i, t, count - i, outPoints + i);
+}
+
+CARPMATH_TARGET_AVX2 static __m256 sEvaluateCubic8(float a, float b, float c, float d, __m256 t)
+{
+    const __m256 p = _mm256_fmadd_ps(t, _mm256_set1_ps(d), _mm256_set1_ps(c));
+    return _mm256_fmadd_ps(t, _mm256_fmadd_ps(t, p, _mm256_set1_ps(b)), _mm256_set1_ps(a));
+}
+
+CARPMATH_TARGET_AVX2 static void sEvaluateCurveAVX2(const CubicCurve &curve, const float *ts, uint32_t count, Vec3 *outPoints)
+{
+    uint32_t i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        const __m256 t = _mm256_loadu_ps(ts + i);
+        sStoreVec3x8(outPoints + i,
+            sEvaluateCubic8(curve.a.x, curve.b.x, curve.c.x, curve.d.x, t),
+            sEvaluateCubic8(curve.a.y, curve.b.y, curve.c.y, curve.d.y, t),
+            sEvaluateCubic8(curve.a.z, curve.b.z, curve.c.z, curve.d.z, t));
+    }
+    sEvaluateCurveScalar(curve, ts + i, count - i, outPoints + i);
+}
+
+CARPMATH_TARGET_AVX2 static Quat8 sSquad8(const Quat8 &q1, const Quat8 &q2, const Quat8 &s1, const Quat8 &s2, __m256 t)
+{
+    const __m256 h = _mm256_mul_ps(_mm256_add_ps(t, t), _mm256_sub_ps(_mm256_set1_ps(1.0f), t));
+    return sSlerpPolynomial8(sSlerpPolynomial8(q1, q2, t), sSlerpPolynomial8(s1, s2, t), h);
+}
+
+CARPMATH_TARGET_AVX2 static void sSquadSegmentsAVX2(const SquadSegment *segments, float t, uint32_t count, Quat *outQuats)
+{
+    const __m256 t8 = _mm256_set1_ps(t);
+    uint32_t i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        const Quat *q1s[8];
+        const Quat *q2s[8];
+        const Quat *s1s[8];
+        const Quat *s2s[8];
+        for(uint32_t k = 0; k < 8; ++k)
+        {
+            q1s[k] = &segments[i + k].q1;
+            q2s[k] = &segments[i + k].q2;
+            s1s[k] = &segments[i + k].s1;
+            s2s[k] = &segments[i + k].s2;
+        }
+        sStoreQuat8(outQuats + i, sSquad8(sLoadQuat8(q1s), sLoadQuat8(q2s), sLoadQuat8(s1s), sLoadQuat8(s2s), t8));
+    }
+    sSquadSegmentsScalar(segments + i, t, count - i, outQuats + i);
+}
+
+CARPMATH_TARGET_AVX2 static void sSquadSegmentAVX2(const SquadSegment &segment, const float *ts, uint32_t count, Quat *outQuats)
+{
+    const Quat8 q1 = sSetQuat8(segment.q1);
+    const Quat8 q2 = sSetQuat8(segment.q2);
+    const Quat8 s1 = sSetQuat8(segment.s1);
+    const Quat8 s2 = sSetQuat8(segment.s2);
+    uint32_t i = 0;
+    for(; i + 8 <= count; i += 8)
+        sStoreQuat8(outQuats + i, sSquad8(q1, q2, s1, s2, _mm256_loadu_ps(ts + i)));
+    sSquadSegmentScalar(segment, ts + i, count - i, outQuats + i);
+}
+
+#endif
+
+void bindSplineKernels(SimdKernels &kernels, SimdBackend backend)
+{
+    kernels.evaluateCurves = sEvaluateCurvesScalar;
+    kernels.evaluateCurve = sEvaluateCurveScalar;
+    kernels.squadSegments = sSquadSegmentsScalar;
+    kernels.squadSegment = sSquadSegmentScalar;
+#if SIMDHELP_SSE
+    if(backend >= SimdBackendSSE4)
+    {
+        kernels.evaluateCurves = sEvaluateCurvesSSE;
+        kernels.evaluateCurve = sEvaluateCurveSSE;
+        kernels.squadSegments = sSquadSegmentsSSE;
+        kernels.squadSegment = sSquadSegmentSSE;
+    }
+#endif
+#if CARPMATH_X86
+    if(backend >= SimdBackendAVX2)
+    {
+        kernels.evaluateCurves = sEvaluateCurvesAVX2;
+        kernels.evaluateCurve = sEvaluateCurveAVX2;
+        kernels.squadSegments = sSquadSegmentsAVX2;
+        kernels.squadSegment = sSquadSegmentAVX2;
+    }
+#endif
+}
+
+void evaluateCurves(const CubicCurve *curves, float t, uint32_t count, Vec3 *outPoints)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdEvaluateCurves, count);
+    getSimdKernels().evaluateCurves(curves, t, count, outPoints);
+}
+
+void evaluateCurve(const CubicCurve &curve, const float *ts, uint32_t count, Vec3 *outPoints)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdEvaluateCurves, count);
+    getSimdKernels().evaluateCurve(curve, ts, count, outPoints);
+}
+
+void getArcLengthTable(const CubicCurve &curve, uint32_t sampleCount, float *outLengths)
+{
+    ASSERT_MATH(sampleCount > 0);
+    static constexpr uint32_t ChunkSize = 64u;
+    alignas(32) float ts[ChunkSize];
+    alignas(32) Vec3 points[ChunkSize];
+    const float step = 1.0f / float(sampleCount);
+    const SimdKernels &kernels = getSimdKernels();
+
+    Vec3 previous = curve.a;
+    float length = 0.0f;
+    outLengths[0] = 0.0f;
+    for(uint32_t begin = 1; begin <= sampleCount; begin += ChunkSize)
+    {
+        const uint32_t chunkCount = sampleCount + 1 - begin < ChunkSize ? sampleCount + 1 - begin : ChunkSize;
+        for(uint32_t i = 0; i < chunkCount; ++i)
+            ts[i] = float(begin + i) * step;
+        kernels.evaluateCurve(curve, ts, chunkCount, points);
+        for(uint32_t i = 0; i < chunkCount; ++i)
+        {
+            length += len(points[i] - previous);
+            outLengths[begin + i] = length;
+            previous = points[i];
+        }
+    }
+}
+
+// Branch-free binary search for the last sample with length <= distance.
+float getTFromArcLength(const float *lengths, uint32_t sampleCount, float distance)
+{
+    distance = sClampF(distance, 0.0f, lengths[sampleCount]);
+    uint32_t low = 0;
+    uint32_t size = sampleCount;
+    while(size > 1)
+    {
+        const uint32_t half = size / 2;
+        low = lengths[low + half] <= distance ? low + half : low;
+        size -= half;
+    }
+    const float segmentLength = lengths[low + 1] - lengths[low];
+    const float fraction = segmentLength > 0.0f ? (distance - lengths[low]) / segmentLength : 0.0f;
+    return (float(low) + sMinF(fraction, 1.0f)) / float(sampleCount);
+}
+
+void getTsFromArcLengths(const float *lengths, uint32_t sampleCount, const float *distances, uint32_t count, float *outTs)
+{
+    for(uint32_t i = 0; i < count; ++i)
+        outTs[i] = getTFromArcLength(lengths, sampleCount, distances[i]);
+}
+
+static Quat sLog(const Quat &q)
+{
+    const float sinAngle = sSqrtF(q.vx * q.vx + q.vy * q.vy + q.vz * q.vz);
+    const float scale = sinAngle > SquadMinSinAngle ? atan2f(sinAngle, q.w) / sinAngle : 1.0f;
+    return Quat(q.vx * scale, q.vy * scale, q.vz * scale, 0.0f);
+}
+
+static Quat sExp(const Quat &q)
+{
+    const float angle = sSqrtF(q.vx * q.vx + q.vy * q.vy + q.vz * q.vz);
+    const float scale = angle > SquadMinSinAngle ? sSinF(angle) / angle : 1.0f;
+    return Quat(q.vx * scale, q.vy * scale, q.vz * scale, sCosF(angle));
+}
+
+static Quat sToHemisphere(const Quat &q, const Quat &reference)
+{
+    return dot(q, reference) < 0.0f ? q * -1.0f : q;
+}
+
+Quat getSquadControl(const Quat &q0, const Quat &q1, const Quat &q2)
+{
+    const Quat inverse = conjugate(q1);
+    const Quat log0 = sLog(inverse * sToHemisphere(q0, q1));
+    const Quat log2 = sLog(inverse * sToHemisphere(q2, q1));
+    const Quat sum(
+        (log0.vx + log2.vx) * -0.25f,
+        (log0.vy + log2.vy) * -0.25f,
+        (log0.vz + log2.vz) * -0.25f,
+        0.0f);
+    return q1 * sExp(sum);
+}
+
+void getSquadSegments(const Quat *keys, uint32_t keyCount, SquadSegment *outSegments)
+{
+    if(keyCount < 2)
+        return;
+    Quat control = getSquadControl(keys[0], keys[0], keys[1]);
+    for(uint32_t i = 0; i + 1 < keyCount; ++i)
+    {
+        const Quat &next = i + 2 < keyCount ? keys[i + 2] : keys[i + 1];
+        SquadSegment &segment = outSegments[i];
+        segment.q1 = keys[i];
+        segment.q2 = keys[i + 1];
+        segment.s1 = control;
+        control = getSquadControl(keys[i], keys[i + 1], next);
+        segment.s2 = control;
+    }
+}
+
+Quat squad(const SquadSegment &segment, float t)
+{
+    return sSquad(segment, t);
+}
+
+void squad(const SquadSegment *segments, float t, uint32_t count, Quat *outQuats)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdSquad, count);
+    getSimdKernels().squadSegments(segments, t, count, outQuats);
+}
+
+void squad(const SquadSegment &segment, const float *ts, uint32_t count, Quat *outQuats)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdSquad, count);
+    getSimdKernels().squadSegment(segment, ts, count, outQuats);
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "quat.h"
+#include "vec3.h"
+
+#include <stdint.h>
+
+// Cubic segment in power basis, p(t) = a + b t + c t^2 + d t^3 for t in [0, 1].
+// Catmull-Rom, Bezier and Hermite segments are all converted to this.
+struct CubicCurve
+{
+    Vec3 a;
+    Vec3 b;
+    Vec3 c;
+    Vec3 d;
+};
+
+// Uniform Catmull-Rom, goes from p1 at t = 0 to p2 at t = 1.
+CubicCurve getCatmullRomCurve(const Vec3 &p0, const Vec3 &p1, const Vec3 &p2, const Vec3 &p3);
+CubicCurve getBezierCurve(const Vec3 &p0, const Vec3 &p1, const Vec3 &p2, const Vec3 &p3);
+// Goes from p0 with tangent m0 to p1 with tangent m1.
+CubicCurve getHermiteCurve(const Vec3 &p0, const Vec3 &m0, const Vec3 &p1, const Vec3 &m1);
+// Path through points[1] .. points[pointCount - 2], writes pointCount - 3 curves.
+void getCatmullRomCurves(const Vec3 *points, uint32_t pointCount, CubicCurve *outCurves);
+
+Vec3 evaluate(const CubicCurve &curve, float t);
+Vec3 evaluateTangent(const CubicCurve &curve, float t);
+// Many curves at one t, or one curve at many t.
+void evaluateCurves(const CubicCurve *curves, float t, uint32_t count, Vec3 *outPoints);
+void evaluateCurve(const CubicCurve &curve, const float *ts, uint32_t count, Vec3 *outPoints);
+
+// Cumulative chord length at sampleCount + 1 evenly spaced t, outLengths[0] is 0 and
+// outLengths[sampleCount] the curve length. outLengths holds sampleCount + 1 floats.
+void getArcLengthTable(const CubicCurve &curve, uint32_t sampleCount, float *outLengths);
+// t at distance along the curve from a getArcLengthTable table, linear between samples.
+// Distance is clamped to [0, curve length].
+float getTFromArcLength(const float *lengths, uint32_t sampleCount, float distance);
+void getTsFromArcLengths(const float *lengths, uint32_t sampleCount, const float *distances, uint32_t count, float *outTs);
+
+// SQUAD segment between keys q1 and q2 with inner controls s1 and s2.
+struct SquadSegment
+{
+    Quat q1;
+    Quat q2;
+    Quat s1;
+    Quat s2;
+};
+
+// Inner control at q1 with neighbours q0 and q2. Neighbours are flipped to q1's hemisphere.
+Quat getSquadControl(const Quat &q0, const Quat &q1, const Quat &q2);
+// Segments through keyCount unit quaternions, writes keyCount - 1 segments. End keys
+// use themselves as missing neighbour.
+void getSquadSegments(const Quat *keys, uint32_t keyCount, SquadSegment *outSegments);
+
+// slerp(slerp(q1, q2, t), slerp(s1, s2, t), 2t(1 - t)). Uses a polynomial slerp, max error
+// about 1e-6, each slerp takes the shorter arc.
+Quat squad(const SquadSegment &segment, float t);
+// Many segments at one t, or one segment at many t.
+void squad(const SquadSegment *segments, float t, uint32_t count, Quat *outQuats);
+void squad(const SquadSegment &segment, const float *ts, uint32_t count, Quat *outQuats);
@@ -0,0 +1,422 @@
+#include "textformat.h"
+
+#include "aabb.h"
+#include "mat4.h"
+#include "quat.h"
+#include "transform.h"
+#include "vec2.h"
+#include "vec3.h"
+#include "vec4.h"
+
+#include <charconv>
+#include <string.h>
+
+// Floats of a value in text order and how JSON groups them.
+struct TextLayout
+{
+    uint32_t floatCount;
+    uint32_t groupCount;
+    uint32_t groupSizes[4];
+    // Keys with quotes and colon, null for nested arrays.
+    const char *keys[4];
+};
+
+static constexpr TextLayout sVec2Layout = { 2, 1, { 2 }, {} };
+static constexpr TextLayout sVec3Layout = { 3, 1, { 3 }, {} };
+static constexpr TextLayout sVec4Layout = { 4, 1, { 4 }, {} };
+static constexpr TextLayout sMat3x4Layout = { 12, 3, { 4, 4, 4 }, {} };
+static constexpr TextLayout sMat4x4Layout = { 16, 4, { 4, 4, 4, 4 }, {} };
+static constexpr TextLayout sTransformLayout = { 10, 3, { 3, 4, 3 }, { "\"pos\":", "\"rot\":", "\"scale\":" } };
+static constexpr TextLayout sAABBLayout = { 6, 2, { 3, 3 }, { "\"min\":", "\"max\":" } };
+
+static const TextLayout &sGetLayout(const Vec2 &) { return sVec2Layout; }
+static const TextLayout &sGetLayout(const Vec3 &) { return sVec3Layout; }
+static const TextLayout &sGetLayout(const Vec4 &) { return sVec4Layout; }
+static const TextLayout &sGetLayout(const Quat &) { return sVec4Layout; }
+static const TextLayout &sGetLayout(const Mat3x4 &) { return sMat3x4Layout; }
+static const TextLayout &sGetLayout(const Mat4x4 &) { return sMat4x4Layout; }
+static const TextLayout &sGetLayout(const Transform &) { return sTransformLayout; }
+static const TextLayout &sGetLayout(const AABB &) { return sAABBLayout; }
+
+static void sGetFloats(const Vec2 &v, float *out) { out[0] = v.x; out[1] = v.y; }
+static void sGetFloats(const Vec3 &v, float *out) { out[0] = v.x; out[1] = v.y; out[2] = v.z; }
+static void sGetFloats(const Vec4 &v, float *out) { out[0] = v.x; out[1] = v.y; out[2] = v.z; out[3] = v.w; }
+static void sGetFloats(const Quat &q, float *out) { out[0] = q.vx; out[1] = q.vy; out[2] = q.vz; out[3] = q.w; }
+static void sGetFloats(const Mat3x4 &m, float *out) { memcpy(out, &m._00, sizeof(float) * 12); }
+static void sGetFloats(const Mat4x4 &m, float *out) { memcpy(out, &m._00, sizeof(float) * 16); }
+
+static void sGetFloats(const Transform &t, float *out)
+{
+    sGetFloats(t.pos, out);
+    sGetFloats(t.rot, out + 3);
+    sGetFloats(t.scale, out + 7);
+}
+
+static void sGetFloats(const AABB &box, float *out)
+{
+    sGetFloats(box.min, out);
+    sGetFloats(box.max, out + 3);
+}
+
+static void sSetFloats(const float *f, Vec2 &v) { v = Vec2(f[0], f[1]); }
+static void sSetFloats(const float *f, Vec3 &v) { v = Vec3(f[0], f[1], f[2]); }
+static void sSetFloats(const float *f, Vec4 &v) { v = Vec4(f[0], f[1], f[2], f[3]); }
+static void sSetFloats(const float *f, Quat &q) { q = Quat(f[0], f[1], f[2], f[3]); }
+static void sSetFloats(const float *f, Mat3x4 &m) { memcpy(&m._00, f, sizeof(float) * 12); }
+static void sSetFloats(const float *f, Mat4x4 &m) { memcpy(&m._00, f, sizeof(float) * 16); }
+
+static void sSetFloats(const float *f, Transform &t)
+{
+    sSetFloats(f, t.pos);
+    sSetFloats(f + 3, t.rot);
+    sSetFloats(f + 7, t.scale);
+}
+
+static void sSetFloats(const float *f, AABB &box)
+{
+    sSetFloats(f, box.min);
+    sSetFloats(f + 3, box.max);
+}
+
+// Cursor into the caller buffer, at is null once something did not fit.
+struct TextWriter
+{
+    char *at;
+    char *end;
+};
+
+static void sPut(TextWriter &writer, char c)
+{
+    if(writer.at == nullptr)
+        return;
+    if(writer.at == writer.end)
+    {
+        writer.at = nullptr;
+        return;
+    }
+    *writer.at++ = c;
+}
+
+static void sPut(TextWriter &writer, const char *text)
+{
+    if(writer.at == nullptr)
+        return;
+    const size_t length = strlen(text);
+    if(size_t(writer.end - writer.at) < length)
+    {
+        writer.at = nullptr;
+        return;
+    }
+    memcpy(writer.at, text, length);
+    writer.at += length;
+}
+
+static void sPutFloat(TextWriter &writer, float f)
+{
+    if(writer.at == nullptr)
+        return;
+    const std::to_chars_result result = std::to_chars(writer.at, writer.end, f);
+    writer.at = result.ec == std::errc() ? result.ptr : nullptr;
+}
+
+static void sPutValue(TextWriter &writer, const TextLayout &layout, const float *f, TextFormat format)
+{
+    if(format == TextFormatCSV)
+    {
+        for(uint32_t i = 0; i < layout.floatCount; ++i)
+        {
+            if(i > 0)
+                sPut(writer, ',');
+            sPutFloat(writer, f[i]);
+        }
+        return;
+    }
+
+    const bool object = layout.keys[0] != nullptr;
+    if(layout.groupCount > 1)
+        sPut(writer, object ? '{' : '[');
+    for(uint32_t group = 0; group < layout.groupCount; ++group)
+    {
+        if(group > 0)
+            sPut(writer, ',');
+        if(object)
+            sPut(writer, layout.keys[group]);
+        sPut(writer, '[');
+        for(uint32_t i = 0; i < layout.groupSizes[group]; ++i)
+        {
+            if(i > 0)
+                sPut(writer, ',');
+            sPutFloat(writer, *f++);
+        }
+        sPut(writer, ']');
+    }
+    if(layout.groupCount > 1)
+        sPut(writer, object ? '}' : ']');
+}
+
+template <typename T>
+static uint32_t sFormatText(const T &value, TextFormat format, char *buffer, uint32_t bufferSize)
+{
+    float f[16];
+    sGetFloats(value, f);
+    TextWriter writer = { buffer, buffer + bufferSize };
+    sPutValue(writer, sGetLayout(value), f, format);
+    return writer.at != nullptr ? uint32_t(writer.at - buffer) : 0u;
+}
+
+template <typename T>
+static uint32_t sFormatText(const T *values, uint32_t count, TextFormat format, char *buffer, uint32_t bufferSize)
+{
+    TextWriter writer = { buffer, buffer + bufferSize };
+    if(format == TextFormatJSON)
+        sPut(writer, '[');
+    for(uint32_t i = 0; i < count && writer.at != nullptr; ++i)
+    {
+        float f[16];
+        sGetFloats(values[i], f);
+        if(format == TextFormatJSON && i > 0)
+            sPut(writer, ",\n");
+        sPutValue(writer, sGetLayout(values[i]), f, format);
+        if(format == TextFormatCSV)
+            sPut(writer, '\n');
+    }
+    if(format == TextFormatJSON)
+        sPut(writer, ']');
+    return writer.at != nullptr ? uint32_t(writer.at - buffer) : 0u;
+}
+
+// Skips to the next float, returns false at the end of text or something not a separator.
+static bool sSkipSeparators(const char *&at, const char *end)
+{
+    while(at < end)
+    {
+        const char c = *at;
+        if(c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == ',' || c == ':'
+            || c == '[' || c == ']' || c == '{' || c == '}')
+        {
+            ++at;
+        }
+        else if(c == '"')
+        {
+            const char *close = (const char *)memchr(at + 1, '"', size_t(end - at - 1));
+            if(close == nullptr)
+                return false;
+            at = close + 1;
+        }
+        else
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool sParseValue(const char *&at, const char *end, uint32_t floatCount, float *outFloats)
+{
+    for(uint32_t i = 0; i < floatCount; ++i)
+    {
+        if(!sSkipSeparators(at, end))
+            return false;
+        const std::from_chars_result result = std::from_chars(at, end, outFloats[i]);
+        if(result.ec != std::errc())
+            return false;
+        at = result.ptr;
+    }
+    return true;
+}
+
+// Closing brackets and whitespace after a value count as read.
+static void sSkipValueEnd(const char *&at, const char *end)
+{
+    while(at < end && (*at == ' ' || *at == '\t' || *at == '\r' || *at == '\n' || *at == ']' || *at == '}'))
+        ++at;
+}
+
+template <typename T>
+static uint32_t sParseText(const char *text, uint32_t length, T &outValue)
+{
+    float f[16];
+    const char *at = text;
+    const char *end = text + length;
+    if(!sParseValue(at, end, sGetLayout(outValue).floatCount, f))
+        return 0u;
+    sSkipValueEnd(at, end);
+    sSetFloats(f, outValue);
+    return uint32_t(at - text);
+}
+
+template <typename T>
+static uint32_t sParseText(const char *text, uint32_t length, T *outValues, uint32_t maxCount)
+{
+    const char *at = text;
+    const char *end = text + length;
+    uint32_t count = 0;
+    for(; count < maxCount; ++count)
+    {
+        float f[16];
+        if(!sParseValue(at, end, sGetLayout(outValues[count]).floatCount, f))
+            break;
+        sSetFloats(f, outValues[count]);
+    }
+    return count;
+}
+
+uint32_t formatText(const Vec2 &value, TextFormat format, char *buffer, uint32_t bufferSize)
+{
+    return sFormatText(value, format, buffer, bufferSize);
+}
+
+uint32_t formatText(const Vec3 &value, TextFormat format, char *buffer, uint32_t bufferSize)
+{
+    return sFormatText(value, format, buffer, bufferSize);
+}
+
+uint32_t formatText(const Vec4 &value, TextFormat format, char *buffer, uint32_t bufferSize)
+{
+    return sFormatText(value, format, buffer, bufferSize);
+}
+
+uint32_t formatText(const Quat &value, TextFormat format, char *buffer, uint32_t bufferSize)
+{
+    return sFormatText(value, format, buffer, bufferSize);
+}
+
+uint32_t formatText(const Mat3x4 &value, TextFormat format, char *buffer, uint32_t bufferSize)
+{
+    return sFormatText(value, format, buffer, bufferSize);
+}
+
+uint32_t formatText(const Mat4x4 &value, TextFormat format, char *buffer, uint32_t bufferSize)
+{
+    return sFormatText(value, format, buffer, bufferSize);
+}
+
+uint32_t formatText(const Transform &value, TextFormat format, char *buffer, uint32_t bufferSize)
+{
+    return sFormatText(value, format, buffer, bufferSize);
+}
+
+uint32_t formatText(const AABB &value, TextFormat format, char *buffer, uint32_t bufferSize)
+{
+    return sFormatText(value, format, buffer, bufferSize);
+}
+
+uint32_t formatText(const Vec2 *values, uint32_t count, TextFormat format, char *buffer, uint32_t bufferSize)
+{
+    return sFormatText(values, count, format, buffer, bufferSize);
+}
+
+uint32_t formatText(const Vec3 *values, uint32_t count, TextFormat format, char *buffer, uint32_t bufferSize)
+{
+    return sFormatText(values, count, format, buffer, bufferSize);
+}
+
+uint32_t formatText(const Vec4 *values, uint32_t count, TextFormat format, char *buffer, uint32_t bufferSize)
+{
+    return sFormatText(values, count, format, buffer, bufferSize);
+}
+
+uint32_t formatText(const Quat *values, uint32_t count, TextFormat format, char *buffer, uint32_t bufferSize)
+{
+    return sFormatText(values, count, format, buffer, bufferSize);
+}
+
+uint32_t formatText(const Mat3x4 *values, uint32_t count, TextFormat format, char *buffer, uint32_t bufferSize)
+{
+    return sFormatText(values, count, format, buffer, bufferSize);
+}
+
+uint32_t formatText(const Mat4x4 *values, uint32_t count, TextFormat format, char *buffer, uint32_t bufferSize)
+{
+    return sFormatText(values, count, format, buffer, bufferSize);
+}
+
+uint32_t formatText(const Transform *values, uint32_t count, TextFormat format, char *buffer, uint32_t bufferSize)
+{
+    return sFormatText(values, count, format, buffer, bufferSize);
+}
+
+uint32_t formatText(const AABB *values, uint32_t count, TextFormat format, char *buffer, uint32_t bufferSize)
+{
+    return sFormatText(values, count, format, buffer, bufferSize);
+}
+
+uint32_t parseText(const char *text, uint32_t length, Vec2 &outValue)
+{
+    return sParseText(text, length, outValue);
+}
+
+uint32_t parseText(const char *text, uint32_t length, Vec3 &outValue)
+{
+    return sParseText(text, length, outValue);
+}
+
+uint32_t parseText(const char *text, uint32_t length, Vec4 &outValue)
+{
+    return sParseText(text, length, outValue);
+}
+
+uint32_t parseText(const char *text, uint32_t length, Quat &outValue)
+{
+    return sParseText(text, length, outValue);
+}
+
+uint32_t parseText(const char *text, uint32_t length, Mat3x4 &outValue)
+{
+    return sParseText(text, length, outValue);
+}
+
+uint32_t parseText(const char *text, uint32_t length, Mat4x4 &outValue)
+{
+    return sParseText(text, length, outValue);
+}
+
+uint32_t parseText(const char *text, uint32_t length, Transform &outValue)
+{
+    return sParseText(text, length, outValue);
+}
+
+uint32_t parseText(const char *text, uint32_t length, AABB &outValue)
+{
+    return sParseText(text, length, outValue);
+}
+
+uint32_t parseText(const char *text, uint32_t length, Vec2 *outValues, uint32_t maxCount)
+{
+    return sParseText(text, length, outValues, maxCount);
+}
+
+uint32_t parseText(const char *text, uint32_t length, Vec3 *outValues, uint32_t maxCount)
+{
+    return sParseText(text, length, outValues, maxCount);
+}
+
+uint32_t parseText(const char *text, uint32_t length, Vec4 *outValues, uint32_t maxCount)
+{
+    return sParseText(text, length, outValues, maxCount);
+}
+
+uint32_t parseText(const char *text, uint32_t length, Quat *outValues, uint32_t maxCount)
+{
+    return sParseText(text, length, outValues, maxCount);
+}
+
+uint32_t parseText(const char *text, uint32_t length, Mat3x4 *outValues, uint32_t maxCount)
+{
+    return sParseText(text, length, outValues, maxCount);
+}
+
+uint32_t parseText(const char *text, uint32_t length, Mat4x4 *outValues, uint32_t maxCount)
+{
+    return sParseText(text, length, outValues, maxCount);
+}
+
+uint32_t parseText(const char *text, uint32_t length, Transform *outValues, uint32_t maxCount)
+{
+    return sParseText(text, length, outValues, maxCount);
+}
+
+uint32_t parseText(const char *text, uint32_t length, AABB *outValues, uint32_t maxCount)
+{
+    return sParseText(text, length, outValues, maxCount);
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <stdint.h>
+
+struct AABB;
+struct Mat3x4;
+struct Mat4x4;
+struct Quat;
+struct Transform;
+struct Vec2;
+struct Vec3;
+struct Vec4;
+
+// Text dumps of math values with shortest round trip floats from std::to_chars, parsing
+// gives back the same bits. Nothing is allocated, text goes to caller buffers and is not
+// null terminated. Inf and nan are written as inf, -inf and nan, also in JSON.
+
+enum TextFormat : uint32_t
+{
+    // Floats separated by commas, matrices row by row, Transform as pos, rot, scale.
+    // Arrays have a value per line, each ending with a newline.
+    TextFormatCSV,
+    // Vectors [x,y,z], matrices an array of rows, AABB {"min":[..],"max":[..]} and
+    // Transform {"pos":[..],"rot":[..],"scale":[..]}. Arrays are [v0,\nv1].
+    TextFormatJSON,
+};
+
+// Longest float text with its separator.
+static constexpr uint32_t TextMaxFloatChars = 16u;
+// Brackets, keys and line breaks of one value.
+static constexpr uint32_t TextMaxValueOverhead = 32u;
+
+// Buffer size that always fits count values of floatCount floats, e.g. 16 for Mat4x4.
+constexpr uint32_t getMaxTextSize(uint32_t floatCount, uint32_t count)
+{
+    return count * (floatCount * TextMaxFloatChars + TextMaxValueOverhead) + 2u;
+}
+
+// Return the length of the text, 0 when it does not fit bufferSize.
+uint32_t formatText(const Vec2 &value, TextFormat format, char *buffer, uint32_t bufferSize);
+uint32_t formatText(const Vec3 &value, TextFormat format, char *buffer, uint32_t bufferSize);
+uint32_t formatText(const Vec4 &value, TextFormat format, char *buffer, uint32_t bufferSize);
+uint32_t formatText(const Quat &value, TextFormat format, char *buffer, uint32_t bufferSize);
+uint32_t formatText(const Mat3x4 &value, TextFormat format, char *buffer, uint32_t bufferSize);
+uint32_t formatText(const Mat4x4 &value, TextFormat format, char *buffer, uint32_t bufferSize);
+uint32_t formatText(const Transform &value, TextFormat format, char *buffer, uint32_t bufferSize);
+uint32_t formatText(const AABB &value, TextFormat format, char *buffer, uint32_t bufferSize);
+
+uint32_t formatText(const Vec2 *values, uint32_t count, TextFormat format, char *buffer, uint32_t bufferSize);
+uint32_t formatText(const Vec3 *values, uint32_t count, TextFormat format, char *buffer, uint32_t bufferSize);
+uint32_t formatText(const Vec4 *values, uint32_t count, TextFormat format, char *buffer, uint32_t bufferSize);
+uint32_t formatText(const Quat *values, uint32_t count, TextFormat format, char *buffer, uint32_t bufferSize);
+uint32_t formatText(const Mat3x4 *values, uint32_t count, TextFormat format, char *buffer, uint32_t bufferSize);
+uint32_t formatText(const Mat4x4 *values, uint32_t count, TextFormat format, char *buffer, uint32_t bufferSize);
+uint32_t formatText(const Transform *values, uint32_t count, TextFormat format, char *buffer, uint32_t bufferSize);
+uint32_t formatText(const AABB *values, uint32_t count, TextFormat format, char *buffer, uint32_t bufferSize);
+
+// Parsers take either format: floats are read in order, whitespace, commas, brackets,
+// braces, colons and quoted keys between them are skipped. Single value parsers return
+// how many chars were read, 0 on anything else or too few floats. Array parsers return
+// how many values were read, stopping at maxCount, the end of text or a bad value.
+uint32_t parseText(const char *text, uint32_t length, Vec2 &outValue);
+uint32_t parseText(const char *text, uint32_t length, Vec3 &outValue);
+uint32_t parseText(const char *text, uint32_t length, Vec4 &outValue);
+uint32_t parseText(const char *text, uint32_t length, Quat &outValue);
+uint32_t parseText(const char *text, uint32_t length, Mat3x4 &outValue);
+uint32_t parseText(const char *text, uint32_t length, Mat4x4 &outValue);
+uint32_t parseText(const char *text, uint32_t length, Transform &outValue);
+uint32_t parseText(const char *text, uint32_t length, AABB &outValue);
+
+uint32_t parseText(const char *text, uint32_t length, Vec2 *outValues, uint32_t maxCount);
+uint32_t parseText(const char *text, uint32_t length, Vec3 *outValues, uint32_t maxCount);
+uint32_t parseText(const char *text, uint32_t length, Vec4 *outValues, uint32_t maxCount);
+uint32_t parseText(const char *text, uint32_t length, Quat *outValues, uint32_t maxCount);
+uint32_t parseText(const char *text, uint32_t length, Mat3x4 *outValues, uint32_t maxCount);
+uint32_t parseText(const char *text, uint32_t length, Mat4x4 *outValues, uint32_t maxCount);
+uint32_t parseText(const char *text, uint32_t length, Transform *outValues, uint32_t maxCount);
+uint32_t parseText(const char *text, uint32_t length, AABB *outValues, uint32_t maxCount);
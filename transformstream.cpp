@@ -0,0 +1,776 @@
+#include "transformstream.h"
+
+#include "dispatch.h"
+#include "mathhelp.h"
+#include "profile.h"
+#include "simdhelp.h"
+#include "transform.h"
+
+#if (__AVX__ || __SSE__ || __SSE2__ || __SSE3__ || __SSE4_1__ || _M_AMD64 || _M_X64) && 1
+#define TRANSFORMSTREAM_SIMD_SSE 1
+#include <emmintrin.h>
+#endif
+#if CARPMATH_X86
+#include <immintrin.h>
+#endif
+
+static constexpr uint32_t TransformStreamBlockSize = 64u;
+static constexpr uint32_t TransformStreamRecordSize = 12u;
+// Grid positions are clamped to +-2^29 so deltas between them fit int32.
+static constexpr float PositionMaxGrid = 536870912.0f;
+static constexpr int32_t PositionMaxDelta = 32767;
+// Smallest three components are within +-1/sqrt(2), (v + bias) * scale maps them to 0..1023.
+// Add before multiply so no backend can contract it into fma and codes match everywhere.
+static constexpr float RotationCodeScale = 511.5f * 1.41421356f;
+static constexpr float RotationCodeInvScale = 1.0f / RotationCodeScale;
+static constexpr float RotationCodeBias = 0.70710678f;
+static constexpr float RotationCodeOffset = 511.5f;
+static constexpr float RotationCodeMax = 1023.0f;
+
+// Up to 64 entities in SoA. When encoding entry i is entity begin + i, x, y, z are the
+// position delta, or the absolute grid position when its absoluteBits bit is set. When
+// decoding entry k is the k-th record and index is the entity it goes to.
+struct TransformStreamBlock
+{
+    alignas(32) int32_t x[TransformStreamBlockSize];
+    alignas(32) int32_t y[TransformStreamBlockSize];
+    alignas(32) int32_t z[TransformStreamBlockSize];
+    alignas(32) uint32_t rotation[TransformStreamBlockSize];
+    alignas(32) uint32_t index[TransformStreamBlockSize];
+    uint64_t absoluteBits;
+    uint64_t scaleBits;
+};
+
+static int32_t sQuantizePosition(float v, float invStep)
+{
+    return int32_t(lrintf(sMaxF(sMinF(v * invStep, PositionMaxGrid), -PositionMaxGrid)));
+}
+
+static uint32_t sQuantizeRotationComponent(float v)
+{
+    const float f = sMinF(sMaxF((v + RotationCodeBias) * RotationCodeScale, 0.0f), RotationCodeMax);
+    return uint32_t(lrintf(f));
+}
+
+static float sDequantizeRotationComponent(uint32_t code)
+{
+    return (float(int32_t(code & 1023u)) - RotationCodeOffset) * RotationCodeInvScale;
+}
+
+// Drops the largest component, first one wins ties. q and -q give the same code.
+static uint32_t sEncodeRotation(const Quat &q)
+{
+    const float *c = &q.vx;
+    float best = sAbsF(c[0]);
+    uint32_t index = 0;
+    for(uint32_t i = 1; i < 4; ++i)
+    {
+        if(sAbsF(c[i]) > best)
+        {
+            best = sAbsF(c[i]);
+            index = i;
+        }
+    }
+    const float a = index == 0 ? c[1] : c[0];
+    const float b = index <= 1 ? c[2] : c[1];
+    const float d = index == 3 ? c[2] : c[3];
+    const float sign = c[index] < 0.0f ? -1.0f : 1.0f;
+    return (index << 30u)
+        | (sQuantizeRotationComponent(a * sign) << 20u)
+        | (sQuantizeRotationComponent(b * sign) << 10u)
+        | sQuantizeRotationComponent(d * sign);
+}
+
+static Quat sDecodeRotation(uint32_t code)
+{
+    const uint32_t index = code >> 30u;
+    const float a = sDequantizeRotationComponent(code >> 20u);
+    const float b = sDequantizeRotationComponent(code >> 10u);
+    const float c = sDequantizeRotationComponent(code);
+    const float sqrSum = a * a + b * b + c * c;
+    const float d = sSqrtF(sMaxF(1.0f - sqrSum, 0.0f));
+    switch(index)
+    {
+        case 0: return Quat(d, a, b, c);
+        case 1: return Quat(a, d, b, c);
+        case 2: return Quat(a, b, d, c);
+        default: return Quat(a, b, c, d);
+    }
+}
+
+static uint64_t sQuantizeTransformBlockScalar(const Transform *previous, const Transform *current, uint32_t count,
+    float invStep, TransformStreamBlock &outBlock)
+{
+    uint64_t changedBits = 0;
+    uint64_t absoluteBits = 0;
+    uint64_t scaleBits = 0;
+    for(uint32_t i = 0; i < count; ++i)
+    {
+        int32_t grid[3];
+        int32_t delta[3];
+        bool changed = false;
+        bool absolute = false;
+        for(uint32_t axis = 0; axis < 3; ++axis)
+        {
+            grid[axis] = sQuantizePosition(current[i].pos[axis], invStep);
+            delta[axis] = grid[axis] - sQuantizePosition(previous[i].pos[axis], invStep);
+            changed |= delta[axis] != 0;
+            absolute |= delta[axis] > PositionMaxDelta || delta[axis] < -PositionMaxDelta;
+        }
+        const int32_t *values = absolute ? grid : delta;
+        outBlock.x[i] = values[0];
+        outBlock.y[i] = values[1];
+        outBlock.z[i] = values[2];
+
+        outBlock.rotation[i] = sEncodeRotation(current[i].rot);
+        changed |= outBlock.rotation[i] != sEncodeRotation(previous[i].rot);
+
+        const bool scaleChanged = memcmp(&current[i].scale.x, &previous[i].scale.x, sizeof(float) * 3) != 0;
+        changed |= scaleChanged;
+
+        changedBits |= uint64_t(changed) << i;
+        absoluteBits |= uint64_t(absolute) << i;
+        scaleBits |= uint64_t(scaleChanged) << i;
+    }
+    outBlock.absoluteBits = absoluteBits;
+    outBlock.scaleBits = scaleBits;
+    return changedBits;
+}
+
+static void sDecodeTransformBlockScalar(const TransformStreamBlock &block, uint32_t count, float step, Transform *transforms)
+{
+    const float invStep = 1.0f / step;
+    for(uint32_t k = 0; k < count; ++k)
+    {
+        Transform &t = transforms[block.index[k]];
+        const bool absolute = ((block.absoluteBits >> k) & 1u) != 0;
+        const int32_t values[3] = { block.x[k], block.y[k], block.z[k] };
+        for(uint32_t axis = 0; axis < 3; ++axis)
+        {
+            const int32_t grid = absolute ? values[axis] : sQuantizePosition(t.pos[axis], invStep) + values[axis];
+            t.pos[axis] = float(grid) * step;
+        }
+        t.rot = sDecodeRotation(block.rotation[k]);
+    }
+}
+
+#if TRANSFORMSTREAM_SIMD_SSE
+
+// Lane i is all ones if bit i of bits is set.
+static __m128i sGetLaneMask4(uint32_t bits)
+{
+    const __m128i laneBits = _mm_setr_epi32(1, 2, 4, 8);
+    return _mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(int32_t(bits)), laneBits), laneBits);
+}
+
+static __m128i sQuantizePosition4(__m128 v, __m128 invStep)
+{
+    const __m128 maxGrid = _mm_set1_ps(PositionMaxGrid);
+    return _mm_cvtps_epi32(_mm_max_ps(_mm_min_ps(_mm_mul_ps(v, invStep), maxGrid), _mm_sub_ps(_mm_setzero_ps(), maxGrid)));
+}
+
+static __m128i sQuantizeRotationComponent4(__m128 v)
+{
+    const __m128 f = _mm_mul_ps(_mm_add_ps(v, _mm_set1_ps(RotationCodeBias)), _mm_set1_ps(RotationCodeScale));
+    return _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(f, _mm_setzero_ps()), _mm_set1_ps(RotationCodeMax)));
+}
+
+static __m128 sDequantizeRotationComponent4(__m128i code)
+{
+    const __m128 f = _mm_cvtepi32_ps(_mm_and_si128(code, _mm_set1_epi32(1023)));
+    return _mm_mul_ps(_mm_sub_ps(f, _mm_set1_ps(RotationCodeOffset)), _mm_set1_ps(RotationCodeInvScale));
+}
+
+static void sLoadRows4(const float *r0, const float *r1, const float *r2, const float *r3,
+    __m128 &x, __m128 &y, __m128 &z, __m128 &w)
+{
+    x = _mm_load_ps(r0);
+    y = _mm_load_ps(r1);
+    z = _mm_load_ps(r2);
+    w = _mm_load_ps(r3);
+    _MM_TRANSPOSE4_PS(x, y, z, w);
+}
+
+static __m128i sEncodeRotations4(const Transform *t)
+{
+    __m128 x, y, z, w;
+    sLoadRows4(&t[0].rot.vx, &t[1].rot.vx, &t[2].rot.vx, &t[3].rot.vx, x, y, z, w);
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    __m128 best = _mm_andnot_ps(signMask, x);
+    const __m128 is1 = _mm_cmpgt_ps(_mm_andnot_ps(signMask, y), best);
+    best = sSelect4(is1, _mm_andnot_ps(signMask, y), best);
+    const __m128 is2 = _mm_cmpgt_ps(_mm_andnot_ps(signMask, z), best);
+    best = sSelect4(is2, _mm_andnot_ps(signMask, z), best);
+    const __m128 is3 = _mm_cmpgt_ps(_mm_andnot_ps(signMask, w), best);
+
+    // Later masks override earlier ones, same as the scalar loop.
+    __m128i index = _mm_and_si128(_mm_castps_si128(is1), _mm_set1_epi32(1));
+    index = sSelect4(_mm_castps_si128(is2), _mm_set1_epi32(2), index);
+    index = sSelect4(_mm_castps_si128(is3), _mm_set1_epi32(3), index);
+    const __m128 largest = sSelect4(is3, w, sSelect4(is2, z, sSelect4(is1, y, x)));
+    const __m128 sign = _mm_and_ps(largest, signMask);
+
+    const __m128 above2 = _mm_or_ps(is2, is3);
+    const __m128 a = _mm_xor_ps(sSelect4(_mm_or_ps(is1, above2), x, y), sign);
+    const __m128 b = _mm_xor_ps(sSelect4(above2, y, z), sign);
+    const __m128 c = _mm_xor_ps(sSelect4(is3, z, w), sign);
+    __m128i code = _mm_slli_epi32(index, 30);
+    code = _mm_or_si128(code, _mm_slli_epi32(sQuantizeRotationComponent4(a), 20));
+    code = _mm_or_si128(code, _mm_slli_epi32(sQuantizeRotationComponent4(b), 10));
+    return _mm_or_si128(code, sQuantizeRotationComponent4(c));
+}
+
+static void sDecodeRotations4(__m128i code, __m128 &x, __m128 &y, __m128 &z, __m128 &w)
+{
+    const __m128i index = _mm_srli_epi32(code, 30);
+    const __m128 a = sDequantizeRotationComponent4(_mm_srli_epi32(code, 20));
+    const __m128 b = sDequantizeRotationComponent4(_mm_srli_epi32(code, 10));
+    const __m128 c = sDequantizeRotationComponent4(code);
+    const __m128 sqrSum = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, a), _mm_mul_ps(b, b)), _mm_mul_ps(c, c));
+    const __m128 d = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(_mm_set1_ps(1.0f), sqrSum), _mm_setzero_ps()));
+    const __m128 is0 = _mm_castsi128_ps(_mm_cmpeq_epi32(index, _mm_setzero_si128()));
+    const __m128 is1 = _mm_castsi128_ps(_mm_cmpeq_epi32(index, _mm_set1_epi32(1)));
+    const __m128 is2 = _mm_castsi128_ps(_mm_cmpeq_epi32(index, _mm_set1_epi32(2)));
+    const __m128 is3 = _mm_castsi128_ps(_mm_cmpeq_epi32(index, _mm_set1_epi32(3)));
+    x = sSelect4(is0, d, a);
+    y = sSelect4(is0, a, sSelect4(is1, d, b));
+    z = sSelect4(is3, c, sSelect4(is2, d, b));
+    w = sSelect4(is3, d, c);
+}
+
+static uint32_t sQuantizeTransforms4(const Transform *previous, const Transform *current, __m128 invStep,
+    TransformStreamBlock &outBlock, uint32_t i, uint32_t &outAbsolute, uint32_t &outScale)
+{
+    __m128 cx, cy, cz, cw;
+    __m128 px, py, pz, pw;
+    sLoadRows4(&current[0].pos.x, &current[1].pos.x, &current[2].pos.x, &current[3].pos.x, cx, cy, cz, cw);
+    sLoadRows4(&previous[0].pos.x, &previous[1].pos.x, &previous[2].pos.x, &previous[3].pos.x, px, py, pz, pw);
+    const __m128i gridX = sQuantizePosition4(cx, invStep);
+    const __m128i gridY = sQuantizePosition4(cy, invStep);
+    const __m128i gridZ = sQuantizePosition4(cz, invStep);
+    const __m128i dx = _mm_sub_epi32(gridX, sQuantizePosition4(px, invStep));
+    const __m128i dy = _mm_sub_epi32(gridY, sQuantizePosition4(py, invStep));
+    const __m128i dz = _mm_sub_epi32(gridZ, sQuantizePosition4(pz, invStep));
+
+    const __m128i maxDelta = _mm_set1_epi32(PositionMaxDelta);
+    const __m128i minDelta = _mm_set1_epi32(-PositionMaxDelta);
+    __m128i absolute = _mm_or_si128(_mm_cmpgt_epi32(dx, maxDelta), _mm_cmpgt_epi32(minDelta, dx));
+    absolute = _mm_or_si128(absolute, _mm_or_si128(_mm_cmpgt_epi32(dy, maxDelta), _mm_cmpgt_epi32(minDelta, dy)));
+    absolute = _mm_or_si128(absolute, _mm_or_si128(_mm_cmpgt_epi32(dz, maxDelta), _mm_cmpgt_epi32(minDelta, dz)));
+    _mm_store_si128((__m128i *)(outBlock.x + i), sSelect4(absolute, gridX, dx));
+    _mm_store_si128((__m128i *)(outBlock.y + i), sSelect4(absolute, gridY, dy));
+    _mm_store_si128((__m128i *)(outBlock.z + i), sSelect4(absolute, gridZ, dz));
+
+    const __m128i rotation = sEncodeRotations4(current);
+    _mm_store_si128((__m128i *)(outBlock.rotation + i), rotation);
+
+    const __m128i zero = _mm_setzero_si128();
+    __m128i same = _mm_cmpeq_epi32(_mm_or_si128(_mm_or_si128(dx, dy), dz), zero);
+    same = _mm_and_si128(same, _mm_cmpeq_epi32(rotation, sEncodeRotations4(previous)));
+
+    uint32_t scale = 0;
+    for(uint32_t k = 0; k < 4; ++k)
+    {
+        const __m128i equal = _mm_cmpeq_epi32(_mm_castps_si128(_mm_load_ps(&current[k].scale.x)),
+            _mm_castps_si128(_mm_load_ps(&previous[k].scale.x)));
+        scale |= uint32_t((_mm_movemask_ps(_mm_castsi128_ps(equal)) & 7) != 7) << k;
+    }
+    outAbsolute = uint32_t(_mm_movemask_ps(_mm_castsi128_ps(absolute)));
+    outScale = scale;
+    return (uint32_t(_mm_movemask_ps(_mm_castsi128_ps(same))) ^ 15u) | scale;
+}
+
+// The last partial group goes through copies, padding transforms compare equal.
+static uint64_t sQuantizeTransformBlockSSE(const Transform *previous, const Transform *current, uint32_t count,
+    float invStep, TransformStreamBlock &outBlock)
+{
+    const __m128 invStep4 = _mm_set1_ps(invStep);
+    Transform previousTail[4];
+    Transform currentTail[4];
+    uint64_t changedBits = 0;
+    uint64_t absoluteBits = 0;
+    uint64_t scaleBits = 0;
+    for(uint32_t i = 0; i < count; i += 4)
+    {
+        const Transform *p = previous + i;
+        const Transform *c = current + i;
+        if(count - i < 4)
+        {
+            for(uint32_t k = 0; k < count - i; ++k)
+            {
+                previousTail[k] = p[k];
+                currentTail[k] = c[k];
+            }
+            p = previousTail;
+            c = currentTail;
+        }
+        uint32_t absolute, scale;
+        changedBits |= uint64_t(sQuantizeTransforms4(p, c, invStep4, outBlock, i, absolute, scale)) << i;
+        absoluteBits |= uint64_t(absolute) << i;
+        scaleBits |= uint64_t(scale) << i;
+    }
+    outBlock.absoluteBits = absoluteBits;
+    outBlock.scaleBits = scaleBits;
+    return changedBits;
+}
+
+static void sDecodeTransformBlockSSE(const TransformStreamBlock &block, uint32_t count, float step, Transform *transforms)
+{
+    const __m128 step4 = _mm_set1_ps(step);
+    const __m128 invStep4 = _mm_set1_ps(1.0f / step);
+    for(uint32_t k = 0; k < count; k += 4)
+    {
+        // Padding lanes read the first entity of the group and are not stored.
+        const uint32_t laneCount = count - k < 4 ? count - k : 4;
+        Transform *t[4];
+        for(uint32_t lane = 0; lane < 4; ++lane)
+            t[lane] = transforms + block.index[k + (lane < laneCount ? lane : 0)];
+
+        __m128 x, y, z, w;
+        sLoadRows4(&t[0]->pos.x, &t[1]->pos.x, &t[2]->pos.x, &t[3]->pos.x, x, y, z, w);
+        const __m128i absolute = sGetLaneMask4(uint32_t(block.absoluteBits >> k));
+        const __m128i vx = _mm_load_si128((const __m128i *)(block.x + k));
+        const __m128i vy = _mm_load_si128((const __m128i *)(block.y + k));
+        const __m128i vz = _mm_load_si128((const __m128i *)(block.z + k));
+        x = _mm_mul_ps(_mm_cvtepi32_ps(sSelect4(absolute, vx, _mm_add_epi32(sQuantizePosition4(x, invStep4), vx))), step4);
+        y = _mm_mul_ps(_mm_cvtepi32_ps(sSelect4(absolute, vy, _mm_add_epi32(sQuantizePosition4(y, invStep4), vy))), step4);
+        z = _mm_mul_ps(_mm_cvtepi32_ps(sSelect4(absolute, vz, _mm_add_epi32(sQuantizePosition4(z, invStep4), vz))), step4);
+        w = _mm_setzero_ps();
+        _MM_TRANSPOSE4_PS(x, y, z, w);
+        const __m128 positions[4] = { x, y, z, w };
+
+        __m128 qx, qy, qz, qw;
+        sDecodeRotations4(_mm_load_si128((const __m128i *)(block.rotation + k)), qx, qy, qz, qw);
+        _MM_TRANSPOSE4_PS(qx, qy, qz, qw);
+        const __m128 rotations[4] = { qx, qy, qz, qw };
+
+        for(uint32_t lane = 0; lane < laneCount; ++lane)
+        {
+            _mm_store_ps(&t[lane]->pos.x, positions[lane]);
+            _mm_store_ps(&t[lane]->rot.vx, rotations[lane]);
+        }
+    }
+}
+
+#endif
+
+#if CARPMATH_X86
+
+CARPMATH_TARGET_AVX2 static __m256 sSelect8(__m256 mask, __m256 a, __m256 b)
+{
+    return _mm256_blendv_ps(b, a, mask);
+}
+
+CARPMATH_TARGET_AVX2 static __m256i sSelect8(__m256i mask, __m256i a, __m256i b)
+{
+    return _mm256_blendv_epi8(b, a, mask);
+}
+
+CARPMATH_TARGET_AVX2 static __m256i sGetLaneMask8(uint32_t bits)
+{
+    const __m256i laneBits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    return _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(int32_t(bits)), laneBits), laneBits);
+}
+
+CARPMATH_TARGET_AVX2 static __m256i sQuantizePosition8(__m256 v, __m256 invStep)
+{
+    const __m256 maxGrid = _mm256_set1_ps(PositionMaxGrid);
+    return _mm256_cvtps_epi32(_mm256_max_ps(_mm256_min_ps(_mm256_mul_ps(v, invStep), maxGrid),
+        _mm256_sub_ps(_mm256_setzero_ps(), maxGrid)));
+}
+
+CARPMATH_TARGET_AVX2 static __m256i sQuantizeRotationComponent8(__m256 v)
+{
+    const __m256 f = _mm256_mul_ps(_mm256_add_ps(v, _mm256_set1_ps(RotationCodeBias)), _mm256_set1_ps(RotationCodeScale));
+    return _mm256_cvtps_epi32(_mm256_min_ps(_mm256_max_ps(f, _mm256_setzero_ps()), _mm256_set1_ps(RotationCodeMax)));
+}
+
+CARPMATH_TARGET_AVX2 static __m256 sDequantizeRotationComponent8(__m256i code)
+{
+    const __m256 f = _mm256_cvtepi32_ps(_mm256_and_si256(code, _mm256_set1_epi32(1023)));
+    return _mm256_mul_ps(_mm256_sub_ps(f, _mm256_set1_ps(RotationCodeOffset)), _mm256_set1_ps(RotationCodeInvScale));
+}
+
+// Rows 0-3 go to low lanes and 4-7 to high lanes.
+CARPMATH_TARGET_AVX2 static void sLoadRows8(const float *const *rows, __m256 &x, __m256 &y, __m256 &z, __m256 &w)
+{
+    const __m256 t0 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_load_ps(rows[0])), _mm_load_ps(rows[4]), 1);
+    const __m256 t1 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_load_ps(rows[1])), _mm_load_ps(rows[5]), 1);
+    const __m256 t2 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_load_ps(rows[2])), _mm_load_ps(rows[6]), 1);
+    const __m256 t3 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_load_ps(rows[3])), _mm_load_ps(rows[7]), 1);
+    const __m256 xy01 = _mm256_unpacklo_ps(t0, t1);
+    const __m256 xy23 = _mm256_unpacklo_ps(t2, t3);
+    const __m256 zw01 = _mm256_unpackhi_ps(t0, t1);
+    const __m256 zw23 = _mm256_unpackhi_ps(t2, t3);
+    x = _mm256_shuffle_ps(xy01, xy23, _MM_SHUFFLE(1, 0, 1, 0));
+    y = _mm256_shuffle_ps(xy01, xy23, _MM_SHUFFLE(3, 2, 3, 2));
+    z = _mm256_shuffle_ps(zw01, zw23, _MM_SHUFFLE(1, 0, 1, 0));
+    w = _mm256_shuffle_ps(zw01, zw23, _MM_SHUFFLE(3, 2, 3, 2));
+}
+
+// Inverse of sLoadRows8, outRows[i] is row i.
+CARPMATH_TARGET_AVX2 static void sTransposeRows8(__m256 x, __m256 y, __m256 z, __m256 w, __m128 *outRows)
+{
+    const __m256 xy0 = _mm256_unpacklo_ps(x, y);
+    const __m256 xy1 = _mm256_unpackhi_ps(x, y);
+    const __m256 zw0 = _mm256_unpacklo_ps(z, w);
+    const __m256 zw1 = _mm256_unpackhi_ps(z, w);
+    const __m256 v0 = _mm256_shuffle_ps(xy0, zw0, _MM_SHUFFLE(1, 0, 1, 0));
+    const __m256 v1 = _mm256_shuffle_ps(xy0, zw0, _MM_SHUFFLE(3, 2, 3, 2));
+    const __m256 v2 = _mm256_shuffle_ps(xy1, zw1, _MM_SHUFFLE(1, 0, 1, 0));
+    const __m256 v3 = _mm256_shuffle_ps(xy1, zw1, _MM_SHUFFLE(3, 2, 3, 2));
+    outRows[0] = _mm256_castps256_ps128(v0);
+    outRows[1] = _mm256_castps256_ps128(v1);
+    outRows[2] = _mm256_castps256_ps128(v2);
+    outRows[3] = _mm256_castps256_ps128(v3);
+    outRows[4] = _mm256_extractf128_ps(v0, 1);
+    outRows[5] = _mm256_extractf128_ps(v1, 1);
+    outRows[6] = _mm256_extractf128_ps(v2, 1);
+    outRows[7] = _mm256_extractf128_ps(v3, 1);
+}
+
+CARPMATH_TARGET_AVX2 static __m256i sEncodeRotations8(const Transform *t)
+{
+    const float *rows[8];
+    for(uint32_t k = 0; k < 8; ++k)
+        rows[k] = &t[k].rot.vx;
+    __m256 x, y, z, w;
+    sLoadRows8(rows, x, y, z, w);
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    __m256 best = _mm256_andnot_ps(signMask, x);
+    const __m256 is1 = _mm256_cmp_ps(_mm256_andnot_ps(signMask, y), best, _CMP_GT_OQ);
+    best = sSelect8(is1, _mm256_andnot_ps(signMask, y), best);
+    const __m256 is2 = _mm256_cmp_ps(_mm256_andnot_ps(signMask, z), best, _CMP_GT_OQ);
+    best = sSelect8(is2, _mm256_andnot_ps(signMask, z), best);
+    const __m256 is3 = _mm256_cmp_ps(_mm256_andnot_ps(signMask, w), best, _CMP_GT_OQ);
+
+    __m256i index = _mm256_and_si256(_mm256_castps_si256(is1), _mm256_set1_epi32(1));
+    index = sSelect8(_mm256_castps_si256(is2), _mm256_set1_epi32(2), index);
+    index = sSelect8(_mm256_castps_si256(is3), _mm256_set1_epi32(3), index);
+    const __m256 largest = sSelect8(is3, w, sSelect8(is2, z, sSelect8(is1, y, x)));
+    const __m256 sign = _mm256_and_ps(largest, signMask);
+
+    const __m256 above2 = _mm256_or_ps(is2, is3);
+    const __m256 a = _mm256_xor_ps(sSelect8(_mm256_or_ps(is1, above2), x, y), sign);
+    const __m256 b = _mm256_xor_ps(sSelect8(above2, y, z), sign);
+    const __m256 c = _mm256_xor_ps(sSelect8(is3, z, w), sign);
+    __m256i code = _mm256_slli_epi32(index, 30);
+    code = _mm256_or_si256(code, _mm256_slli_epi32(sQuantizeRotationComponent8(a), 20));
+    code = _mm256_or_si256(code, _mm256_slli_epi32(sQuantizeRotationComponent8(b), 10));
+    return _mm256_or_si256(code, sQuantizeRotationComponent8(c));
+}
+
+CARPMATH_TARGET_AVX2 static void sDecodeRotations8(__m256i code, __m256 &x, __m256 &y, __m256 &z, __m256 &w)
+{
+    const __m256i index = _mm256_srli_epi32(code, 30);
+    const __m256 a = sDequantizeRotationComponent8(_mm256_srli_epi32(code, 20));
+    const __m256 b = sDequantizeRotationComponent8(_mm256_srli_epi32(code, 10));
+    const __m256 c = sDequantizeRotationComponent8(code);
+    const __m256 sqrSum = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a, a), _mm256_mul_ps(b, b)), _mm256_mul_ps(c, c));
+    const __m256 d = _mm256_sqrt_ps(_mm256_max_ps(_mm256_sub_ps(_mm256_set1_ps(1.0f), sqrSum), _mm256_setzero_ps()));
+    const __m256 is0 = _mm256_castsi256_ps(_mm256_cmpeq_epi32(index, _mm256_setzero_si256()));
+    const __m256 is1 = _mm256_castsi256_ps(_mm256_cmpeq_epi32(index, _mm256_set1_epi32(1)));
+    const __m256 is2 = _mm256_castsi256_ps(_mm256_cmpeq_epi32(index, _mm256_set1_epi32(2)));
+    const __m256 is3 = _mm256_castsi256_ps(_mm256_cmpeq_epi32(index, _mm256_set1_epi32(3)));
+    x = sSelect8(is0, d, a);
+    y = sSelect8(is0, a, sSelect8(is1, d, b));
+    z = sSelect8(is3, c, sSelect8(is2, d, b));
+    w = sSelect8(is3, d, c);
+}
+
+CARPMATH_TARGET_AVX2 static void sLoadPositions8(const Transform *t, __m256 &x, __m256 &y, __m256 &z)
+{
+    const float *rows[8];
+    for(uint32_t k = 0; k < 8; ++k)
+        rows[k] = &t[k].pos.x;
+    __m256 w;
+    sLoadRows8(rows, x, y, z, w);
+}
+
+CARPMATH_TARGET_AVX2 static uint32_t sQuantizeTransforms8(const Transform *previous, const Transform *current, __m256 invStep,
+    TransformStreamBlock &outBlock, uint32_t i, uint32_t &outAbsolute, uint32_t &outScale)
+{
+    __m256 cx, cy, cz;
+    __m256 px, py, pz;
+    sLoadPositions8(current, cx, cy, cz);
+    sLoadPositions8(previous, px, py, pz);
+    const __m256i gridX = sQuantizePosition8(cx, invStep);
+    const __m256i gridY = sQuantizePosition8(cy, invStep);
+    const __m256i gridZ = sQuantizePosition8(cz, invStep);
+    const __m256i dx = _mm256_sub_epi32(gridX, sQuantizePosition8(px, invStep));
+    const __m256i dy = _mm256_sub_epi32(gridY, sQuantizePosition8(py, invStep));
+    const __m256i dz = _mm256_sub_epi32(gridZ, sQuantizePosition8(pz, invStep));
+
+    const __m256i maxDelta = _mm256_set1_epi32(PositionMaxDelta);
+    const __m256i maxAbs = _mm256_max_epi32(_mm256_abs_epi32(dx), _mm256_max_epi32(_mm256_abs_epi32(dy), _mm256_abs_epi32(dz)));
+    const __m256i absolute = _mm256_cmpgt_epi32(maxAbs, maxDelta);
+    _mm256_store_si256((__m256i *)(outBlock.x + i), sSelect8(absolute, gridX, dx));
+    _mm256_store_si256((__m256i *)(outBlock.y + i), sSelect8(absolute, gridY, dy));
+    _mm256_store_si256((__m256i *)(outBlock.z + i), sSelect8(absolute, gridZ, dz));
+
+    const __m256i rotation = sEncodeRotations8(current);
+    _mm256_store_si256((__m256i *)(outBlock.rotation + i), rotation);
+
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i same = _mm256_cmpeq_epi32(_mm256_or_si256(_mm256_or_si256(dx, dy), dz), zero);
+    same = _mm256_and_si256(same, _mm256_cmpeq_epi32(rotation, sEncodeRotations8(previous)));
+
+    uint32_t scale = 0;
+    for(uint32_t k = 0; k < 8; k += 2)
+    {
+        const __m256 a = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_load_ps(&current[k].scale.x)),
+            _mm_load_ps(&current[k + 1].scale.x), 1);
+        const __m256 b = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_load_ps(&previous[k].scale.x)),
+            _mm_load_ps(&previous[k + 1].scale.x), 1);
+        const uint32_t equal = uint32_t(_mm256_movemask_ps(_mm256_castsi256_ps(
+            _mm256_cmpeq_epi32(_mm256_castps_si256(a), _mm256_castps_si256(b)))));
+        scale |= uint32_t((equal & 0x07u) != 0x07u) << k;
+        scale |= uint32_t((equal & 0x70u) != 0x70u) << (k + 1);
+    }
+    outAbsolute = uint32_t(_mm256_movemask_ps(_mm256_castsi256_ps(absolute)));
+    outScale = scale;
+    return (uint32_t(_mm256_movemask_ps(_mm256_castsi256_ps(same))) ^ 0xffu) | scale;
+}
+
+CARPMATH_TARGET_AVX2 static uint64_t sQuantizeTransformBlockAVX2(const Transform *previous, const Transform *current,
+    uint32_t count, float invStep, TransformStreamBlock &outBlock)
+{
+    const __m256 invStep8 = _mm256_set1_ps(invStep);
+    Transform previousTail[8];
+    Transform currentTail[8];
+    uint64_t changedBits = 0;
+    uint64_t absoluteBits = 0;
+    uint64_t scaleBits = 0;
+    for(uint32_t i = 0; i < count; i += 8)
+    {
+        const Transform *p = previous + i;
+        const Transform *c = current + i;
+        if(count - i < 8)
+        {
+            for(uint32_t k = 0; k < count - i; ++k)
+            {
+                previousTail[k] = p[k];
+                currentTail[k] = c[k];
+            }
+            p = previousTail;
+            c = currentTail;
+        }
+        uint32_t absolute, scale;
+        changedBits |= uint64_t(sQuantizeTransforms8(p, c, invStep8, outBlock, i, absolute, scale)) << i;
+        absoluteBits |= uint64_t(absolute) << i;
+        scaleBits |= uint64_t(scale) << i;
+    }
+    outBlock.absoluteBits = absoluteBits;
+    outBlock.scaleBits = scaleBits;
+    return changedBits;
+}
+
+CARPMATH_TARGET_AVX2 static void sDecodeTransformBlockAVX2(const TransformStreamBlock &block, uint32_t count,
+    float step, Transform *transforms)
+{
+    const __m256 step8 = _mm256_set1_ps(step);
+    const __m256 invStep8 = _mm256_set1_ps(1.0f / step);
+    for(uint32_t k = 0; k < count; k += 8)
+    {
+        const uint32_t laneCount = count - k < 8 ? count - k : 8;
+        Transform *t[8];
+        const float *rows[8];
+        for(uint32_t lane = 0; lane < 8; ++lane)
+        {
+            t[lane] = transforms + block.index[k + (lane < laneCount ? lane : 0)];
+            rows[lane] = &t[lane]->pos.x;
+        }
+
+        __m256 x, y, z, w;
+        sLoadRows8(rows, x, y, z, w);
+        const __m256i absolute = sGetLaneMask8(uint32_t(block.absoluteBits >> k));
+        const __m256i vx = _mm256_load_si256((const __m256i *)(block.x + k));
+        const __m256i vy = _mm256_load_si256((const __m256i *)(block.y + k));
+        const __m256i vz = _mm256_load_si256((const __m256i *)(block.z + k));
+        x = _mm256_mul_ps(_mm256_cvtepi32_ps(sSelect8(absolute, vx, _mm256_add_epi32(sQuantizePosition8(x, invStep8), vx))), step8);
+        y = _mm256_mul_ps(_mm256_cvtepi32_ps(sSelect8(absolute, vy, _mm256_add_epi32(sQuantizePosition8(y, invStep8), vy))), step8);
+        z = _mm256_mul_ps(_mm256_cvtepi32_ps(sSelect8(absolute, vz, _mm256_add_epi32(sQuantizePosition8(z, invStep8), vz))), step8);
+        __m128 positions[8];
+        sTransposeRows8(x, y, z, _mm256_setzero_ps(), positions);
+
+        __m256 qx, qy, qz, qw;
+        sDecodeRotations8(_mm256_load_si256((const __m256i *)(block.rotation + k)), qx, qy, qz, qw);
+        __m128 rotations[8];
+        sTransposeRows8(qx, qy, qz, qw, rotations);
+
+        for(uint32_t lane = 0; lane < laneCount; ++lane)
+        {
+            _mm_store_ps(&t[lane]->pos.x, positions[lane]);
+            _mm_store_ps(&t[lane]->rot.vx, rotations[lane]);
+        }
+    }
+}
+
+#endif
+
+void bindTransformStreamKernels(SimdKernels &kernels, SimdBackend backend)
+{
+    kernels.quantizeTransformBlock = sQuantizeTransformBlockScalar;
+    kernels.decodeTransformBlock = sDecodeTransformBlockScalar;
+#if TRANSFORMSTREAM_SIMD_SSE
+    if(backend >= SimdBackendSSE4)
+    {
+        kernels.quantizeTransformBlock = sQuantizeTransformBlockSSE;
+        kernels.decodeTransformBlock = sDecodeTransformBlockSSE;
+    }
+#endif
+#if CARPMATH_X86
+    if(backend >= SimdBackendAVX2)
+    {
+        kernels.quantizeTransformBlock = sQuantizeTransformBlockAVX2;
+        kernels.decodeTransformBlock = sDecodeTransformBlockAVX2;
+    }
+#endif
+}
+
+uint32_t getTransformStreamMaxSize(uint32_t count)
+{
+    const uint32_t wordCount = (count + TransformStreamBlockSize - 1) / TransformStreamBlockSize;
+    return uint32_t(sizeof(TransformStreamHeader)) + wordCount * uint32_t(sizeof(uint64_t))
+        + count * (TransformStreamRecordSize + 2u * 3u * uint32_t(sizeof(float)));
+}
+
+uint32_t encodeTransformStream(const Transform *previous, const Transform *current, uint32_t count,
+    float positionStep, uint8_t *outBuffer, uint32_t bufferSize)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdEncodeTransformStream, count);
+    ASSERT_MATH(positionStep > 0.0f);
+    if(bufferSize < getTransformStreamMaxSize(count))
+        return 0;
+
+    const SimdKernels &kernels = getSimdKernels();
+    const float invStep = 1.0f / positionStep;
+    const uint32_t wordCount = (count + TransformStreamBlockSize - 1) / TransformStreamBlockSize;
+    uint8_t *outBits = outBuffer + sizeof(TransformStreamHeader);
+    uint8_t *out = outBits + wordCount * sizeof(uint64_t);
+    uint32_t changedCount = 0;
+
+    TransformStreamBlock block;
+    for(uint32_t begin = 0; begin < count; begin += TransformStreamBlockSize)
+    {
+        const uint32_t blockCount = count - begin < TransformStreamBlockSize ? count - begin : TransformStreamBlockSize;
+        const uint64_t changedBits = kernels.quantizeTransformBlock(previous + begin, current + begin, blockCount, invStep, block);
+        memcpy(outBits + begin / 8, &changedBits, sizeof(uint64_t));
+        changedCount += sPopCount64(changedBits);
+
+        for(uint64_t bits = changedBits; bits != 0; bits &= bits - 1)
+        {
+            const uint32_t i = sCountTrailingZeros64(bits);
+            const bool absolute = ((block.absoluteBits >> i) & 1u) != 0;
+            const bool scale = ((block.scaleBits >> i) & 1u) != 0;
+            const int16_t delta[3] = {
+                int16_t(absolute ? 0 : block.x[i]),
+                int16_t(absolute ? 0 : block.y[i]),
+                int16_t(absolute ? 0 : block.z[i]) };
+            const uint16_t flags = uint16_t((absolute ? uint32_t(TransformStreamFlagAbsolutePosition) : 0u)
+                | (scale ? uint32_t(TransformStreamFlagScale) : 0u));
+            memcpy(out, &block.rotation[i], sizeof(uint32_t));
+            memcpy(out + 4, delta, sizeof(delta));
+            memcpy(out + 10, &flags, sizeof(uint16_t));
+            out += TransformStreamRecordSize;
+            if(absolute)
+            {
+                const int32_t grid[3] = { block.x[i], block.y[i], block.z[i] };
+                memcpy(out, grid, sizeof(grid));
+                out += sizeof(grid);
+            }
+            if(scale)
+            {
+                memcpy(out, &current[begin + i].scale.x, sizeof(float) * 3);
+                out += sizeof(float) * 3;
+            }
+        }
+    }
+
+    TransformStreamHeader header;
+    header.count = count;
+    header.changedCount = changedCount;
+    header.byteSize = uint32_t(out - outBuffer);
+    header.positionStep = positionStep;
+    memcpy(outBuffer, &header, sizeof(header));
+    return header.byteSize;
+}
+
+uint32_t decodeTransformStream(const uint8_t *buffer, uint32_t bufferSize, Transform *transforms, uint32_t count)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdDecodeTransformStream, count);
+    TransformStreamHeader header;
+    if(bufferSize < sizeof(header))
+        return 0;
+    memcpy(&header, buffer, sizeof(header));
+
+    const uint32_t wordCount = (count + TransformStreamBlockSize - 1) / TransformStreamBlockSize;
+    const uint32_t recordsOffset = uint32_t(sizeof(header)) + wordCount * uint32_t(sizeof(uint64_t));
+    if(header.count != count || header.byteSize > bufferSize || header.byteSize < recordsOffset
+        || !(header.positionStep > 0.0f))
+        return 0;
+
+    // Bits past count would index outside transforms.
+    const uint8_t *bitsIn = buffer + sizeof(header);
+    uint32_t changedCount = 0;
+    for(uint32_t word = 0; word < wordCount; ++word)
+    {
+        uint64_t bits;
+        memcpy(&bits, bitsIn + word * sizeof(uint64_t), sizeof(uint64_t));
+        const uint32_t validCount = count - word * TransformStreamBlockSize;
+        if(validCount < TransformStreamBlockSize && (bits >> validCount) != 0)
+            return 0;
+        changedCount += sPopCount64(bits);
+    }
+    if(changedCount != header.changedCount)
+        return 0;
+
+    const SimdKernels &kernels = getSimdKernels();
+    const uint8_t *in = buffer + recordsOffset;
+    const uint8_t *end = buffer + header.byteSize;
+    TransformStreamBlock block;
+    for(uint32_t word = 0; word < wordCount; ++word)
+    {
+        uint64_t bits;
+        memcpy(&bits, bitsIn + word * sizeof(uint64_t), sizeof(uint64_t));
+        uint32_t recordCount = 0;
+        uint64_t absoluteBits = 0;
+        for(; bits != 0; bits &= bits - 1)
+        {
+            if(uint32_t(end - in) < TransformStreamRecordSize)
+                return 0;
+            const uint32_t index = word * TransformStreamBlockSize + sCountTrailingZeros64(bits);
+            int16_t delta[3];
+            uint16_t flags;
+            memcpy(&block.rotation[recordCount], in, sizeof(uint32_t));
+            memcpy(delta, in + 4, sizeof(delta));
+            memcpy(&flags, in + 10, sizeof(uint16_t));
+            in += TransformStreamRecordSize;
+
+            const uint32_t extraSize = ((flags & TransformStreamFlagAbsolutePosition) ? 12u : 0u)
+                + ((flags & TransformStreamFlagScale) ? 12u : 0u);
+            if(uint32_t(end - in) < extraSize)
+                return 0;
+            int32_t grid[3] = { delta[0], delta[1], delta[2] };
+            if(flags & TransformStreamFlagAbsolutePosition)
+            {
+                memcpy(grid, in, sizeof(grid));
+                in += sizeof(grid);
+                absoluteBits |= uint64_t(1) << recordCount;
+            }
+            if(flags & TransformStreamFlagScale)
+            {
+                memcpy(&transforms[index].scale.x, in, sizeof(float) * 3);
+                in += sizeof(float) * 3;
+            }
+            block.index[recordCount] = index;
+            block.x[recordCount] = grid[0];
+            block.y[recordCount] = grid[1];
+            block.z[recordCount] = grid[2];
+            ++recordCount;
+        }
+        block.absoluteBits = absoluteBits;
+        kernels.decodeTransformBlock(block, recordCount, header.positionStep, transforms);
+    }
+    return in == end ? header.byteSize : 0;
+}
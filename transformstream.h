@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdint.h>
+
+struct Transform;
+
+// Delta compressed Transform replication. A stream has a header, a bitmask of changed
+// entities in 64-bit words and one record per changed entity in index order:
+//   uint32 rotation    smallest three, bits 30-31 index of dropped component, 3 x 10 bits
+//   int16 x, y, z      position delta in positionStep units
+//   uint16 flags       TransformStreamFlag bits, extra data follows in flag order
+// Positions are snapped to a grid of positionStep, so previous can be either the raw
+// transforms of the last encoded frame or what the decoder got from it, and decoded
+// positions don't drift. Keep |pos| / positionStep below 2^24 for exact grid values.
+// Streams must be decoded in the order they were encoded. Native byte order.
+
+enum TransformStreamFlag : uint16_t
+{
+    // Delta did not fit int16, 3 x int32 absolute grid position follows and x, y, z are 0.
+    TransformStreamFlagAbsolutePosition = 1u << 0u,
+    // Scale changed, 3 x float follows.
+    TransformStreamFlagScale = 1u << 1u,
+};
+
+struct TransformStreamHeader
+{
+    uint32_t count;
+    uint32_t changedCount;
+    uint32_t byteSize;
+    float positionStep;
+};
+
+// Upper bound of encodeTransformStream output for count transforms.
+uint32_t getTransformStreamMaxSize(uint32_t count);
+
+// Encodes changes from previous to current. Rotations should be normalized, scale is
+// compared bitwise. Returns bytes written, 0 if bufferSize < getTransformStreamMaxSize(count).
+uint32_t encodeTransformStream(const Transform *previous, const Transform *current, uint32_t count,
+    float positionStep, uint8_t *outBuffer, uint32_t bufferSize);
+
+// Applies a stream to transforms holding count entities. Returns bytes read, 0 if count
+// does not match or the stream is malformed. Header and bitmask are checked before
+// anything is written, a stream with broken records can leave transforms partially updated.
+uint32_t decodeTransformStream(const uint8_t *buffer, uint32_t bufferSize, Transform *transforms, uint32_t count);
@@ -1,6 +1,7 @@
 #include "vec2.h"
 
 #include "mathhelp.h"
+#include "profile.h"
 
 Vec2 operator+(const Vec2 &a, const Vec2 &b)
 {
@@ -151,9 +152,11 @@ Vec2 lerp(const Vec2 &a, const Vec2 &b, float t)
 
 Vec2 normalize(const Vec2 &a)
 {
+    PROFILE_MATH_SCOPE(ProfileIdNormalizeVec2);
     float l2 = sqrLen(a);
-    if(l2 < 1.0e-8f)
+    if(l2 < NormalizeMinSqrLength)
     {
+        PROFILE_MATH_EVENT(ProfileEventNormalizeZeroLength);
         DEBUG_BREAK_MACRO_MATH();
         return {};
     }
@@ -162,3 +165,25 @@ Vec2 normalize(const Vec2 &a)
     return {a.x * perLen, a.y * perLen};
 }
 
+Vec2 normalizeOr(const Vec2 &a, const Vec2 &fallback)
+{
+    const float l2 = a.x * a.x + a.y * a.y;
+    const float perLen = 1.0f / sSqrtF(sSelectGreaterEqualF(l2, NormalizeMinSqrLength, l2, 1.0f));
+    Vec2 result{ UninitType{} };
+    result.x = sSelectGreaterEqualF(l2, NormalizeMinSqrLength, a.x * perLen, fallback.x);
+    result.y = sSelectGreaterEqualF(l2, NormalizeMinSqrLength, a.y * perLen, fallback.y);
+    return result;
+}
+
+Vec2 normalizeOrZero(const Vec2 &a)
+{
+    return normalizeOr(a, Vec2());
+}
+
+Vec2 normalizeFast(const Vec2 &a)
+{
+    const float l2 = a.x * a.x + a.y * a.y;
+    const float perLen = sSelectGreaterEqualF(l2, NormalizeMinSqrLength, sRsqrtFastF(sMaxF(l2, NormalizeMinSqrLength)), 0.0f);
+    return Vec2(a.x * perLen, a.y * perLen);
+}
+
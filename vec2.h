@@ -27,12 +27,16 @@ Vec2 operator*(const Vec2 &a, const Vec2 &b);
 Vec2 operator/(const Vec2 &a,float value);
 Vec2 operator/(const Vec2 &a, const Vec2 &b);
 Vec2 operator/(float value, const Vec2 &a);
-Vec2 min(const Vec2 &v1, const Vec2 &v2);
-Vec2 max(const Vec2 &v1, const Vec2 &v2);
-float min(const Vec2 &v1);
-float max(const Vec2 &v1);
+Vec2 minVec(const Vec2 &v1, const Vec2 &v2);
+Vec2 maxVec(const Vec2 &v1, const Vec2 &v2);
+float minVec(const Vec2 &v1);
+float maxVec(const Vec2 &v1);
 float dot(const Vec2 &a, const Vec2 &b);
 float sqrLen(const Vec2 &a);
 float len(const Vec2 &a);
 Vec2 lerp(const Vec2 &a, const Vec2 &b, float t);
 Vec2 normalize(const Vec2 &a);
+// See Vec3 versions.
+Vec2 normalizeOrZero(const Vec2 &a);
+Vec2 normalizeOr(const Vec2 &a, const Vec2 &fallback);
+Vec2 normalizeFast(const Vec2 &a);
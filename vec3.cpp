@@ -1,6 +1,9 @@
 #include "vec3.h"
 
+#include "dispatch.h"
 #include "mathhelp.h"
+#include "profile.h"
+#include "simdhelp.h"
 
 Vec3 operator+(const Vec3 &a, const Vec3 &b)
 {
@@ -175,9 +178,11 @@ Vec3 lerp(const Vec3 &a, const Vec3 &b, float t)
 
 Vec3 normalize(const Vec3 &a)
 {
+    PROFILE_MATH_SCOPE(ProfileIdNormalizeVec3);
     float l2 = sqrLen(a);
-    if(l2 < 1.0e-8f)
+    if(l2 < NormalizeMinSqrLength)
     {
+        PROFILE_MATH_EVENT(ProfileEventNormalizeZeroLength);
         DEBUG_BREAK_MACRO_MATH();
         return {};
     }
@@ -186,6 +191,30 @@ Vec3 normalize(const Vec3 &a)
     return {a.x * perLen, a.y * perLen, a.z * perLen};
 }
 
+Vec3 normalizeOr(const Vec3 &a, const Vec3 &fallback)
+{
+    const float l2 = a.x * a.x + a.y * a.y + a.z * a.z;
+    const float perLen = 1.0f / sSqrtF(sSelectGreaterEqualF(l2, NormalizeMinSqrLength, l2, 1.0f));
+    Vec3 result{UninitType{} };
+    result.x = sSelectGreaterEqualF(l2, NormalizeMinSqrLength, a.x * perLen, fallback.x);
+    result.y = sSelectGreaterEqualF(l2, NormalizeMinSqrLength, a.y * perLen, fallback.y);
+    result.z = sSelectGreaterEqualF(l2, NormalizeMinSqrLength, a.z * perLen, fallback.z);
+    result.w = 0.0f;
+    return result;
+}
+
+Vec3 normalizeOrZero(const Vec3 &a)
+{
+    return normalizeOr(a, Vec3());
+}
+
+Vec3 normalizeFast(const Vec3 &a)
+{
+    const float l2 = a.x * a.x + a.y * a.y + a.z * a.z;
+    const float perLen = sSelectGreaterEqualF(l2, NormalizeMinSqrLength, sRsqrtFastF(sMaxF(l2, NormalizeMinSqrLength)), 0.0f);
+    return Vec3(a.x * perLen, a.y * perLen, a.z * perLen);
+}
+
 
 
 Vec3 cross(const Vec3 &a, const Vec3 &b)
@@ -207,3 +236,314 @@ Vec3 reject(const Vec3 &a, const Vec3 &b)
 {
     return a - proj(a, b);
 }
+
+static void sPackVec3sScalar(const Vec3 *vectors, uint32_t count, PackedVec3 *outPacked)
+{
+    for(uint32_t i = 0; i < count; ++i)
+        outPacked[i] = PackedVec3(vectors[i]);
+}
+
+static void sUnpackVec3sScalar(const PackedVec3 *packed, uint32_t count, Vec3 *outVectors)
+{
+    for(uint32_t i = 0; i < count; ++i)
+        outVectors[i] = Vec3(packed[i]);
+}
+
+static void sUnpackVec3sToSoAScalar(const PackedVec3 *packed, uint32_t count, float *outX, float *outY, float *outZ)
+{
+    for(uint32_t i = 0; i < count; ++i)
+    {
+        outX[i] = packed[i].x;
+        outY[i] = packed[i].y;
+        outZ[i] = packed[i].z;
+    }
+}
+
+static void sPackVec3sFromSoAScalar(const float *x, const float *y, const float *z, uint32_t count, PackedVec3 *outPacked)
+{
+    for(uint32_t i = 0; i < count; ++i)
+        outPacked[i] = PackedVec3(x[i], y[i], z[i]);
+}
+
+static void sNormalizeVec3sScalar(const Vec3 *vectors, const Vec3 &fallback, uint32_t count, Vec3 *outVectors)
+{
+    for(uint32_t i = 0; i < count; ++i)
+        outVectors[i] = normalizeOr(vectors[i], fallback);
+}
+
+static void sNormalizeVec3sFastScalar(const Vec3 *vectors, uint32_t count, Vec3 *outVectors)
+{
+    for(uint32_t i = 0; i < count; ++i)
+        outVectors[i] = normalizeFast(vectors[i]);
+}
+
+#if SIMDHELP_SSE
+
+static __m128 sSqrLen4(__m128 x, __m128 y, __m128 z)
+{
+    return _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+}
+
+// Same operations as normalizeOr so results match the scalar version exactly.
+static void sNormalizeVec3sSSE(const Vec3 *vectors, const Vec3 &fallback, uint32_t count, Vec3 *outVectors)
+{
+    const __m128 fallbackX = _mm_set1_ps(fallback.x);
+    const __m128 fallbackY = _mm_set1_ps(fallback.y);
+    const __m128 fallbackZ = _mm_set1_ps(fallback.z);
+    const __m128 minSqrLength = _mm_set1_ps(NormalizeMinSqrLength);
+    const __m128 one = _mm_set1_ps(1.0f);
+
+    uint32_t i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        __m128 x, y, z;
+        sLoadVec3x4(vectors + i, x, y, z);
+        const __m128 l2 = sSqrLen4(x, y, z);
+        const __m128 valid = _mm_cmpge_ps(l2, minSqrLength);
+        const __m128 perLen = _mm_div_ps(one, _mm_sqrt_ps(sSelect4(valid, l2, one)));
+        x = sSelect4(valid, _mm_mul_ps(x, perLen), fallbackX);
+        y = sSelect4(valid, _mm_mul_ps(y, perLen), fallbackY);
+        z = sSelect4(valid, _mm_mul_ps(z, perLen), fallbackZ);
+        sStoreVec3x4(outVectors + i, x, y, z);
+    }
+    sNormalizeVec3sScalar(vectors + i, fallback, count - i, outVectors + i);
+}
+
+static void sNormalizeVec3sFastSSE(const Vec3 *vectors, uint32_t count, Vec3 *outVectors)
+{
+    const __m128 minSqrLength = _mm_set1_ps(NormalizeMinSqrLength);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 threeHalves = _mm_set1_ps(1.5f);
+
+    uint32_t i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        __m128 x, y, z;
+        sLoadVec3x4(vectors + i, x, y, z);
+        const __m128 l2 = sSqrLen4(x, y, z);
+        const __m128 clamped = _mm_max_ps(l2, minSqrLength);
+        const __m128 estimate = _mm_rsqrt_ps(clamped);
+        __m128 perLen = _mm_sub_ps(threeHalves, _mm_mul_ps(_mm_mul_ps(half, clamped), _mm_mul_ps(estimate, estimate)));
+        perLen = _mm_and_ps(_mm_cmpge_ps(l2, minSqrLength), _mm_mul_ps(estimate, perLen));
+        sStoreVec3x4(outVectors + i, _mm_mul_ps(x, perLen), _mm_mul_ps(y, perLen), _mm_mul_ps(z, perLen));
+    }
+    sNormalizeVec3sFastScalar(vectors + i, count - i, outVectors + i);
+}
+
+static void sPackVec3sSSE(const Vec3 *vectors, uint32_t count, PackedVec3 *outPacked)
+{
+    uint32_t i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        __m128 x, y, z;
+        sLoadVec3x4(vectors + i, x, y, z);
+        sStoreVec3x4(outPacked + i, x, y, z);
+    }
+    sPackVec3sScalar(vectors + i, count - i, outPacked + i);
+}
+
+static void sUnpackVec3sSSE(const PackedVec3 *packed, uint32_t count, Vec3 *outVectors)
+{
+    uint32_t i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        __m128 x, y, z;
+        sLoadVec3x4(packed + i, x, y, z);
+        sStoreVec3x4(outVectors + i, x, y, z);
+    }
+    sUnpackVec3sScalar(packed + i, count - i, outVectors + i);
+}
+
+static void sUnpackVec3sToSoASSE(const PackedVec3 *packed, uint32_t count, float *outX, float *outY, float *outZ)
+{
+    uint32_t i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        __m128 x, y, z;
+        sLoadVec3x4(packed + i, x, y, z);
+        _mm_storeu_ps(outX + i, x);
+        _mm_storeu_ps(outY + i, y);
+        _mm_storeu_ps(outZ + i, z);
+    }
+    sUnpackVec3sToSoAScalar(packed + i, count - i, outX + i, outY + i, outZ + i);
+}
+
+static void sPackVec3sFromSoASSE(const float *x, const float *y, const float *z, uint32_t count, PackedVec3 *outPacked)
+{
+    uint32_t i = 0;
+    for(; i + 4 <= count; i += 4)
+        sStoreVec3x4(outPacked + i, _mm_loadu_ps(x + i), _mm_loadu_ps(y + i), _mm_loadu_ps(z + i));
+    sPackVec3sFromSoAScalar(x + i, y + i, z + i, count - i, outPacked + i);
+}
+
+#endif
+
+#if CARPMATH_X86
+
+CARPMATH_TARGET_AVX2 static void sNormalizeVec3sAVX2(const Vec3 *vectors, const Vec3 &fallback, uint32_t count, Vec3 *outVectors)
+{
+    const __m256 fallbackX = _mm256_set1_ps(fallback.x);
+    const __m256 fallbackY = _mm256_set1_ps(fallback.y);
+    const __m256 fallbackZ = _mm256_set1_ps(fallback.z);
+    const __m256 minSqrLength = _mm256_set1_ps(NormalizeMinSqrLength);
+    const __m256 one = _mm256_set1_ps(1.0f);
+
+    uint32_t i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        __m256 x, y, z;
+        sLoadVec3x8(vectors + i, x, y, z);
+        // No fma, to keep results same as scalar.
+        const __m256 l2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z));
+        const __m256 valid = _mm256_cmp_ps(l2, minSqrLength, _CMP_GE_OQ);
+        const __m256 perLen = _mm256_div_ps(one, _mm256_sqrt_ps(_mm256_blendv_ps(one, l2, valid)));
+        x = _mm256_blendv_ps(fallbackX, _mm256_mul_ps(x, perLen), valid);
+        y = _mm256_blendv_ps(fallbackY, _mm256_mul_ps(y, perLen), valid);
+        z = _mm256_blendv_ps(fallbackZ, _mm256_mul_ps(z, perLen), valid);
+        sStoreVec3x8(outVectors + i, x, y, z);
+    }
+    sNormalizeVec3sScalar(vectors + i, fallback, count - i, outVectors + i);
+}
+
+CARPMATH_TARGET_AVX2 static void sNormalizeVec3sFastAVX2(const Vec3 *vectors, uint32_t count, Vec3 *outVectors)
+{
+    const __m256 minSqrLength = _mm256_set1_ps(NormalizeMinSqrLength);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 threeHalves = _mm256_set1_ps(1.5f);
+
+    uint32_t i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        __m256 x, y, z;
+        sLoadVec3x8(vectors + i, x, y, z);
+        const __m256 l2 = _mm256_fmadd_ps(x, x, _mm256_fmadd_ps(y, y, _mm256_mul_ps(z, z)));
+        const __m256 clamped = _mm256_max_ps(l2, minSqrLength);
+        const __m256 estimate = _mm256_rsqrt_ps(clamped);
+        __m256 perLen = _mm256_fnmadd_ps(_mm256_mul_ps(half, clamped), _mm256_mul_ps(estimate, estimate), threeHalves);
+        perLen = _mm256_and_ps(_mm256_cmp_ps(l2, minSqrLength, _CMP_GE_OQ), _mm256_mul_ps(estimate, perLen));
+        sStoreVec3x8(outVectors + i, _mm256_mul_ps(x, perLen), _mm256_mul_ps(y, perLen), _mm256_mul_ps(z, perLen));
+    }
+    sNormalizeVec3sFastScalar(vectors + i, count - i, outVectors + i);
+}
+
+CARPMATH_TARGET_AVX2 static void sPackVec3sAVX2(const Vec3 *vectors, uint32_t count, PackedVec3 *outPacked)
+{
+    uint32_t i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        __m256 x, y, z;
+        sLoadVec3x8(vectors + i, x, y, z);
+        sStoreVec3x8(outPacked + i, x, y, z);
+    }
+    sPackVec3sScalar(vectors + i, count - i, outPacked + i);
+}
+
+CARPMATH_TARGET_AVX2 static void sUnpackVec3sAVX2(const PackedVec3 *packed, uint32_t count, Vec3 *outVectors)
+{
+    uint32_t i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        __m256 x, y, z;
+        sLoadVec3x8(packed + i, x, y, z);
+        sStoreVec3x8(outVectors + i, x, y, z);
+    }
+    sUnpackVec3sScalar(packed + i, count - i, outVectors + i);
+}
+
+CARPMATH_TARGET_AVX2 static void sUnpackVec3sToSoAAVX2(const PackedVec3 *packed, uint32_t count, float *outX, float *outY, float *outZ)
+{
+    uint32_t i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        __m256 x, y, z;
+        sLoadVec3x8(packed + i, x, y, z);
+        _mm256_storeu_ps(outX + i, x);
+        _mm256_storeu_ps(outY + i, y);
+        _mm256_storeu_ps(outZ + i, z);
+    }
+    sUnpackVec3sToSoAScalar(packed + i, count - i, outX + i, outY + i, outZ + i);
+}
+
+CARPMATH_TARGET_AVX2 static void sPackVec3sFromSoAAVX2(const float *x, const float *y, const float *z, uint32_t count, PackedVec3 *outPacked)
+{
+    uint32_t i = 0;
+    for(; i + 8 <= count; i += 8)
+        sStoreVec3x8(outPacked + i, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i), _mm256_loadu_ps(z + i));
+    sPackVec3sFromSoAScalar(x + i, y + i, z + i, count - i, outPacked + i);
+}
+
+#endif
+
+void bindVec3Kernels(SimdKernels &kernels, SimdBackend backend)
+{
+    kernels.packVec3s = sPackVec3sScalar;
+    kernels.unpackVec3s = sUnpackVec3sScalar;
+    kernels.unpackVec3sToSoA = sUnpackVec3sToSoAScalar;
+    kernels.packVec3sFromSoA = sPackVec3sFromSoAScalar;
+    kernels.normalizeVec3s = sNormalizeVec3sScalar;
+    kernels.normalizeVec3sFast = sNormalizeVec3sFastScalar;
+#if SIMDHELP_SSE
+    if(backend >= SimdBackendSSE4)
+    {
+        kernels.packVec3s = sPackVec3sSSE;
+        kernels.unpackVec3s = sUnpackVec3sSSE;
+        kernels.unpackVec3sToSoA = sUnpackVec3sToSoASSE;
+        kernels.packVec3sFromSoA = sPackVec3sFromSoASSE;
+        kernels.normalizeVec3s = sNormalizeVec3sSSE;
+        kernels.normalizeVec3sFast = sNormalizeVec3sFastSSE;
+    }
+#endif
+#if CARPMATH_X86
+    if(backend >= SimdBackendAVX2)
+    {
+        kernels.packVec3s = sPackVec3sAVX2;
+        kernels.unpackVec3s = sUnpackVec3sAVX2;
+        kernels.unpackVec3sToSoA = sUnpackVec3sToSoAAVX2;
+        kernels.packVec3sFromSoA = sPackVec3sFromSoAAVX2;
+        kernels.normalizeVec3s = sNormalizeVec3sAVX2;
+        kernels.normalizeVec3sFast = sNormalizeVec3sFastAVX2;
+    }
+#endif
+}
+
+void packVec3s(const Vec3 *vectors, uint32_t count, PackedVec3 *outPacked)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdConvertVec3s, count);
+    getSimdKernels().packVec3s(vectors, count, outPacked);
+}
+
+void unpackVec3s(const PackedVec3 *packed, uint32_t count, Vec3 *outVectors)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdConvertVec3s, count);
+    getSimdKernels().unpackVec3s(packed, count, outVectors);
+}
+
+void unpackVec3sToSoA(const PackedVec3 *packed, uint32_t count, float *outX, float *outY, float *outZ)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdConvertVec3s, count);
+    getSimdKernels().unpackVec3sToSoA(packed, count, outX, outY, outZ);
+}
+
+void packVec3sFromSoA(const float *x, const float *y, const float *z, uint32_t count, PackedVec3 *outPacked)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdConvertVec3s, count);
+    getSimdKernels().packVec3sFromSoA(x, y, z, count, outPacked);
+}
+
+void normalizeOrZero(const Vec3 *vectors, uint32_t count, Vec3 *outVectors)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdNormalizeVec3s, count);
+    getSimdKernels().normalizeVec3s(vectors, Vec3(), count, outVectors);
+}
+
+void normalizeOr(const Vec3 *vectors, const Vec3 &fallback, uint32_t count, Vec3 *outVectors)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdNormalizeVec3s, count);
+    getSimdKernels().normalizeVec3s(vectors, fallback, count, outVectors);
+}
+
+void normalizeFast(const Vec3 *vectors, uint32_t count, Vec3 *outVectors)
+{
+    PROFILE_MATH_BATCH_SCOPE(ProfileIdNormalizeVec3s, count);
+    getSimdKernels().normalizeVec3sFast(vectors, count, outVectors);
+}
@@ -3,6 +3,26 @@
 #include "vec2.h"
 #include "uninittype.h"
 
+#include <stdint.h>
+
+struct Vec3;
+
+// Unaligned 12 byte Vec3 for storage, vertex buffers and file formats.
+struct PackedVec3
+{
+    PackedVec3() : x(0.0f), y(0.0f), z(0.0f) {}
+    PackedVec3(UninitType) {}
+    PackedVec3(float x, float y, float z) : x(x), y(y), z(z) {}
+    explicit PackedVec3(const Vec3 &v);
+
+    float &operator[](int index) { return (&x)[index]; }
+    float operator[](int index) const { return (&x)[index]; }
+
+    float x;
+    float y;
+    float z;
+};
+
 struct alignas(16) Vec3
 {
     Vec3() : x(0.0f), y(0.0f), z(0.0f), w(0.0f) {}
@@ -13,8 +33,10 @@ struct alignas(16) Vec3
     Vec3(float b, const Vec2 &a) : x(b), y(a.x), z(a.y), w(0.0f) {}
 
     Vec3(float x, float y, float z) : x(x), y(y), z(z), w(0.0f) {}
+    explicit Vec3(const PackedVec3 &v) : x(v.x), y(v.y), z(v.z), w(0.0f) {}
 
     float &operator[](int index) { return (&x)[index]; }
+    float operator[](int index) const { return (&x)[index]; }
 
     float x;
     float y;
@@ -22,6 +44,8 @@ struct alignas(16) Vec3
     float w;
 };
 
+inline PackedVec3::PackedVec3(const Vec3 &v) : x(v.x), y(v.y), z(v.z) {}
+
 Vec3 operator+(const Vec3 &a, const Vec3 &b);
 Vec3 operator+(const Vec3 &a, float value);
 Vec3 operator+(float value, const Vec3 &a);
@@ -34,15 +58,32 @@ Vec3 operator*(const Vec3 &a, const Vec3 &b);
 Vec3 operator/(const Vec3 &a, float value);
 Vec3 operator/(const Vec3 &a, const Vec3 &b);
 Vec3 operator/(float value, const Vec3 &a);
-Vec3 min(const Vec3 &v1, const Vec3 &v2);
-Vec3 max(const Vec3 &v1, const Vec3 &v2);
-float min(const Vec3 &v1);
-float max(const Vec3 &v1);
+Vec3 minVec(const Vec3 &v1, const Vec3 &v2);
+Vec3 maxVec(const Vec3 &v1, const Vec3 &v2);
+float minVec(const Vec3 &v1);
+float maxVec(const Vec3 &v1);
 float dot(const Vec3 &a, const Vec3 &b);
 float sqrLen(const Vec3 &a);
 float len(const Vec3 &a);
 Vec3 lerp(const Vec3 &a, const Vec3 &b, float t);
 Vec3 normalize(const Vec3 &a);
+// Branch-free normalize, no debug break. normalizeOr returns fallback for zero length
+// and NaN input. normalizeFast uses approximate reciprocal square root and returns zero
+// for zero length.
+Vec3 normalizeOrZero(const Vec3 &a);
+Vec3 normalizeOr(const Vec3 &a, const Vec3 &fallback);
+Vec3 normalizeFast(const Vec3 &a);
 Vec3 cross(const Vec3 &a, const Vec3 &b);
 Vec3 proj(const Vec3 &a, const Vec3 &b);
 Vec3 reject(const Vec3 &a, const Vec3 &b);
+
+// Batch conversions between Vec3, PackedVec3 and SoA streams. Outputs must not overlap inputs.
+void packVec3s(const Vec3 *vectors, uint32_t count, PackedVec3 *outPacked);
+void unpackVec3s(const PackedVec3 *packed, uint32_t count, Vec3 *outVectors);
+void unpackVec3sToSoA(const PackedVec3 *packed, uint32_t count, float *outX, float *outY, float *outZ);
+void packVec3sFromSoA(const float *x, const float *y, const float *z, uint32_t count, PackedVec3 *outPacked);
+
+// Batch normalizeOrZero, normalizeOr and normalizeFast. outVectors can be the same array as vectors.
+void normalizeOrZero(const Vec3 *vectors, uint32_t count, Vec3 *outVectors);
+void normalizeOr(const Vec3 *vectors, const Vec3 &fallback, uint32_t count, Vec3 *outVectors);
+void normalizeFast(const Vec3 *vectors, uint32_t count, Vec3 *outVectors);
@@ -1,6 +1,7 @@
 #include "vec4.h"
 
 #include "mathhelp.h"
+#include "profile.h"
 
 Vec4 operator+(const Vec4 &a, const Vec4 &b)
 {
@@ -176,9 +177,11 @@ Vec4 lerp(const Vec4 &a, const Vec4 &b, float t)
 
 Vec4 normalize(const Vec4 &a)
 {
+    PROFILE_MATH_SCOPE(ProfileIdNormalizeVec4);
     float l2 = sqrLen(a);
-    if(l2 < 1.0e-8f)
+    if(l2 < NormalizeMinSqrLength)
     {
+        PROFILE_MATH_EVENT(ProfileEventNormalizeZeroLength);
         DEBUG_BREAK_MACRO_MATH();
         return {};
     }
@@ -187,3 +190,27 @@ Vec4 normalize(const Vec4 &a)
     return Vec4(a.x * perLen, a.y * perLen, a.z * perLen, a.w * perLen);
 }
 
+Vec4 normalizeOr(const Vec4 &a, const Vec4 &fallback)
+{
+    const float l2 = a.x * a.x + a.y * a.y + a.z * a.z + a.w * a.w;
+    const float perLen = 1.0f / sSqrtF(sSelectGreaterEqualF(l2, NormalizeMinSqrLength, l2, 1.0f));
+    Vec4 result{UninitType{} };
+    result.x = sSelectGreaterEqualF(l2, NormalizeMinSqrLength, a.x * perLen, fallback.x);
+    result.y = sSelectGreaterEqualF(l2, NormalizeMinSqrLength, a.y * perLen, fallback.y);
+    result.z = sSelectGreaterEqualF(l2, NormalizeMinSqrLength, a.z * perLen, fallback.z);
+    result.w = sSelectGreaterEqualF(l2, NormalizeMinSqrLength, a.w * perLen, fallback.w);
+    return result;
+}
+
+Vec4 normalizeOrZero(const Vec4 &a)
+{
+    return normalizeOr(a, Vec4());
+}
+
+Vec4 normalizeFast(const Vec4 &a)
+{
+    const float l2 = a.x * a.x + a.y * a.y + a.z * a.z + a.w * a.w;
+    const float perLen = sSelectGreaterEqualF(l2, NormalizeMinSqrLength, sRsqrtFastF(sMaxF(l2, NormalizeMinSqrLength)), 0.0f);
+    return Vec4(a.x * perLen, a.y * perLen, a.z * perLen, a.w * perLen);
+}
+
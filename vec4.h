@@ -39,12 +39,16 @@ Vec4 operator*(const Vec4 &a, const Vec4 &b);
 Vec4 operator/(const Vec4 &a, float value);
 Vec4 operator/(const Vec4 &a, const Vec4 &b);
 Vec4 operator/(float value, const Vec4 &a);
-Vec4 min(const Vec4 &v1, const Vec4 &v2);
-Vec4 max(const Vec4 &v1, const Vec4 &v2);
-float min(const Vec4 &v1);
-float max(const Vec4 &v1);
+Vec4 minVec(const Vec4 &v1, const Vec4 &v2);
+Vec4 maxVec(const Vec4 &v1, const Vec4 &v2);
+float minVec(const Vec4 &v1);
+float maxVec(const Vec4 &v1);
 float dot(const Vec4 &a, const Vec4 &b);
 float sqrLen(const Vec4 &a);
 float len(const Vec4 &a);
 Vec4 lerp(const Vec4 &a, const Vec4 &b, float t);
 Vec4 normalize(const Vec4 &a);
+// See Vec3 versions.
+Vec4 normalizeOrZero(const Vec4 &a);
+Vec4 normalizeOr(const Vec4 &a, const Vec4 &fallback);
+Vec4 normalizeFast(const Vec4 &a);